@@ -0,0 +1,1535 @@
+/* MCUSH designed by Peng Shulin, all rights reserved. */
+/* microbenchmarks of the core primitives, the same sources are built for
+   target and for host (halposix) so that numbers can be compared
+   each result line: name, cycles per byte/op, bytes or ops per second */
+#include <stdarg.h>
+#include "mcush.h"
+#include "bench.h"
+#if USE_SHELL_PRINTF2
+#include "mcush_printf2.h"
+#endif
+
+typedef struct {
+    const char *name;
+    const char *unit;  /* "byte" or "op" */
+    /* run n rounds, return units processed (0 for skipped/failed) */
+    uint32_t (*run)( uint32_t n );
+} bench_case_t;
+
+static uint8_t bench_buf[BENCH_BUF_SIZE];
+static char bench_buf2[BENCH_BUF_SIZE*2];
+static volatile uint32_t bench_sink;
+
+
+static uint32_t bench_crc8( uint32_t n )
+{
+    uint32_t i;
+    for( i=0; i<n; i++ )
+        bench_sink += crc8( bench_buf, BENCH_BUF_SIZE );
+    return n * BENCH_BUF_SIZE;
+}
+
+
+static uint32_t bench_crc16( uint32_t n )
+{
+    uint32_t i;
+    for( i=0; i<n; i++ )
+        bench_sink += crc16( bench_buf, BENCH_BUF_SIZE );
+    return n * BENCH_BUF_SIZE;
+}
+
+
+static uint32_t bench_crc16_xmodem( uint32_t n )
+{
+    uint32_t i;
+    for( i=0; i<n; i++ )
+        bench_sink += crc16_xmodem( bench_buf, BENCH_BUF_SIZE );
+    return n * BENCH_BUF_SIZE;
+}
+
+
+static uint32_t bench_crc16_modbus( uint32_t n )
+{
+    uint32_t i;
+    for( i=0; i<n; i++ )
+        bench_sink += crc16_modbus( bench_buf, BENCH_BUF_SIZE );
+    return n * BENCH_BUF_SIZE;
+}
+
+
+static uint32_t bench_crc16_kermit( uint32_t n )
+{
+    uint32_t i;
+    for( i=0; i<n; i++ )
+        bench_sink += crc16_kermit( bench_buf, BENCH_BUF_SIZE );
+    return n * BENCH_BUF_SIZE;
+}
+
+
+static uint32_t bench_crc24( uint32_t n )
+{
+    uint32_t i;
+    for( i=0; i<n; i++ )
+        bench_sink += crc24( bench_buf, BENCH_BUF_SIZE );
+    return n * BENCH_BUF_SIZE;
+}
+
+
+static uint32_t bench_crc32( uint32_t n )
+{
+    uint32_t i;
+    for( i=0; i<n; i++ )
+        bench_sink += crc32( bench_buf, BENCH_BUF_SIZE );
+    return n * BENCH_BUF_SIZE;
+}
+
+
+/* counted on the binary side */
+static uint32_t bench_base64_encode( uint32_t n )
+{
+    base64_encodestate s;
+    uint32_t i;
+    int l;
+
+    for( i=0; i<n; i++ )
+    {
+        base64_init_encodestate( &s );
+        l = base64_encode_block( (const char*)bench_buf, BENCH_BUF_SIZE, bench_buf2, &s );
+        l += base64_encode_blockend( bench_buf2 + l, &s );
+        bench_sink += l;
+    }
+    return n * BENCH_BUF_SIZE;
+}
+
+
+static uint32_t bench_base64_decode( uint32_t n )
+{
+    base64_encodestate es;
+    base64_decodestate s;
+    uint32_t i;
+    int l;
+
+    base64_init_encodestate( &es );
+    l = base64_encode_block( (const char*)bench_buf, BENCH_BUF_SIZE, bench_buf2, &es );
+    l += base64_encode_blockend( bench_buf2 + l, &es );
+    for( i=0; i<n; i++ )
+    {
+        base64_init_decodestate( &s );
+        bench_sink += base64_decode_block( bench_buf2, l, (char*)bench_buf, &s );
+    }
+    return n * BENCH_BUF_SIZE;
+}
+
+
+static uint32_t bench_printf_int( uint32_t n )
+{
+    uint32_t i;
+    char buf[64];
+
+    for( i=0; i<n; i++ )
+        bench_sink += sprintf( buf, "%d %u 0x%08X %s", -(int)i, i, i, "abc" );
+    return n;
+}
+
+
+static uint32_t bench_printf_float( uint32_t n )
+{
+    uint32_t i;
+    char buf[64];
+
+    for( i=0; i<n; i++ )
+        bench_sink += sprintf( buf, "%f %.3e", (double)i * 0.37, (double)i * 1.5e3 );
+    return n;
+}
+
+
+#define BENCH_PRINTF_FORMAT  "%d %u 0x%08X %s\n"
+
+static void bench_printf_sink( const char *buf, int len )
+{
+    (void)buf;
+    bench_sink += len;
+}
+
+
+/* shell_printf before printf2, formatted in a line buffer on the stack */
+static int bench_printf_buffered( const char *fmt, ... )
+{
+    char buf[SHELL_LINE_BUF_SIZE];
+    va_list ap;
+    int n;
+
+    va_start( ap, fmt );
+    n = vsnprintf( buf, SHELL_LINE_BUF_SIZE, fmt, ap );
+    va_end( ap );
+    if( n >= SHELL_LINE_BUF_SIZE )
+        n = SHELL_LINE_BUF_SIZE - 1;
+    bench_printf_sink( buf, n );
+    return n;
+}
+
+
+#if USE_SHELL_PRINTF2
+/* shell_printf now, streamed to the sink in small chunks */
+static int bench_printf_streamed( const char *fmt, ... )
+{
+    va_list ap;
+    int n;
+
+    va_start( ap, fmt );
+    n = stringfsv( bench_printf_sink, fmt, ap );
+    va_end( ap );
+    return n;
+}
+#endif
+
+
+static uint32_t bench_printf_buf( uint32_t n )
+{
+    uint32_t i, total=0;
+
+    for( i=0; i<n; i++ )
+        total += bench_printf_buffered( BENCH_PRINTF_FORMAT, -(int)i, i, i, "abc" );
+    return total;
+}
+
+
+#if USE_SHELL_PRINTF2
+static uint32_t bench_printf_sink_run( uint32_t n )
+{
+    uint32_t i, total=0;
+
+    for( i=0; i<n; i++ )
+        total += bench_printf_streamed( BENCH_PRINTF_FORMAT, -(int)i, i, i, "abc" );
+    return total;
+}
+#endif
+
+
+static uint32_t bench_malloc( uint32_t n )
+{
+    static const uint16_t sizes[8] = { 16, 24, 32, 48, 64, 100, 128, 256 };
+    void *p[8];
+    uint32_t i, j;
+
+    for( i=0; i<n; i++ )
+    {
+        for( j=0; j<8; j++ )
+            p[j] = pvPortMalloc( sizes[j] );
+        for( j=0; j<8; j++ )
+            vPortFree( p[7-j] );
+    }
+    return n * 8;
+}
+
+
+static QueueHandle_t bench_queue_req, bench_queue_ack;
+
+static void bench_echo_entry( void *p )
+{
+    uint32_t v;
+
+    while( 1 )
+    {
+        if( xQueueReceive( bench_queue_req, &v, portMAX_DELAY ) == pdPASS )
+            xQueueSend( bench_queue_ack, &v, portMAX_DELAY );
+    }
+}
+
+
+/* send to a higher priority task and wait for the echo, two switches */
+static uint32_t bench_queue( uint32_t n )
+{
+    TaskHandle_t task=0;
+    uint32_t i, v;
+
+    bench_queue_req = xQueueCreate( 1, sizeof(uint32_t) );
+    bench_queue_ack = xQueueCreate( 1, sizeof(uint32_t) );
+    if( bench_queue_req && bench_queue_ack )
+        xTaskCreate( bench_echo_entry, (const char *)"benchT",
+                     BENCH_STACK_SIZE / sizeof(portSTACK_TYPE), NULL,
+                     uxTaskPriorityGet(NULL) + 1, &task );
+    if( task )
+    {
+        for( i=0; i<n; i++ )
+        {
+            xQueueSend( bench_queue_req, &i, portMAX_DELAY );
+            xQueueReceive( bench_queue_ack, &v, portMAX_DELAY );
+        }
+        vTaskDelete( task );
+    }
+    else
+        n = 0;
+    if( bench_queue_req )
+        vQueueDelete( bench_queue_req );
+    if( bench_queue_ack )
+        vQueueDelete( bench_queue_ack );
+    return n;
+}
+
+
+int cmd_nop( int argc, char *argv[] )
+{
+    return 0;
+}
+
+
+static uint32_t bench_shell_call( uint32_t n )
+{
+    uint32_t i;
+
+    for( i=0; i<n; i++ )
+        bench_sink += shell_call( "nop", "-a", "1", 0 );
+    return n;
+}
+
+
+/* the scan that the command index replaced, kept for comparison */
+static int (*bench_cmd_scan( const char *name ))(int argc, char *argv[])
+{
+    const shell_cmd_t *ct;
+    int i, abbr = (name[1] == 0) ? 1 : 0;
+
+    for( i=0; i<SHELL_CMD_TABLE_LEN; i++ )
+    {
+        for( ct = shell_get_cmd_table( i ); ct && ct->name; ct++ )
+        {
+            if( abbr ? (*name == ct->sname) : (strcmp( name, ct->name ) == 0) )
+                return ct->cmd;
+        }
+    }
+    return 0;
+}
+
+
+/* every registered name once per round */
+static uint32_t bench_cmd_lookup_names( uint32_t n, int scan )
+{
+    const shell_cmd_t *ct;
+    uint32_t i, ops=0;
+    int t;
+
+    for( i=0; i<n; i++ )
+    {
+        for( t=0; t<SHELL_CMD_TABLE_LEN; t++ )
+        {
+            for( ct = shell_get_cmd_table( t ); ct && ct->name; ct++, ops++ )
+                bench_sink += (scan ? bench_cmd_scan( ct->name ) : shell_get_cmd_by_name( ct->name )) != 0;
+        }
+    }
+    return ops;
+}
+
+
+static uint32_t bench_cmd_lookup( uint32_t n )
+{
+    return bench_cmd_lookup_names( n, 0 );
+}
+
+
+static uint32_t bench_cmd_lookup_scan( uint32_t n )
+{
+    return bench_cmd_lookup_names( n, 1 );
+}
+
+
+/* the option parser as it was before the ids and the name index (adopt),
+   linear search by name and alias, kept as reference for the parse cost
+   and for the equivalence check, opt.id is not set */
+static const mcush_opt_spec *bench_opt_ref_byname( mcush_opt_parser *parser, const char *name, size_t namelen )
+{
+    const mcush_opt_spec *spec;
+
+    for( spec=parser->specs; spec->type; spec++ )
+    {
+        if( (spec->type == MCUSH_OPT_LITERAL) && (namelen == 0) )
+            return spec;
+        if( ((spec->type == MCUSH_OPT_SWITCH) || (spec->type == MCUSH_OPT_VALUE)) &&
+            spec->name && (strlen(spec->name) == namelen) && 
+            (strncmp( name, spec->name, namelen ) == 0) )
+            return spec;
+    }
+    return 0;
+}
+
+
+static const mcush_opt_spec *bench_opt_ref_byalias( mcush_opt_parser *parser, char alias )
+{
+    const mcush_opt_spec *spec;
+
+    for( spec=parser->specs; spec->type; spec++ )
+    {
+        if( ((spec->type == MCUSH_OPT_SWITCH) || (spec->type == MCUSH_OPT_VALUE)) &&
+            (alias == spec->alias) )
+            return spec;
+    }
+    return 0;
+}
+
+
+static const mcush_opt_spec *bench_opt_ref_nextarg( mcush_opt_parser *parser )
+{
+    const mcush_opt_spec *spec;
+    size_t args=0;
+
+    for( spec=parser->specs; spec->type; spec++ )
+    {
+        if( spec->type == MCUSH_OPT_ARG )
+        {
+            if( args == parser->arg_idx )
+            {
+                parser->arg_idx++;
+                return spec;
+            }
+            args++;
+        }
+    }
+    return 0;
+}
+
+
+/* value of an option, "rest" follows the name in the same argument */
+static void bench_opt_ref_value( mcush_opt *opt, mcush_opt_parser *parser, const char *rest, int inline_value )
+{
+    const mcush_opt_spec *spec = opt->spec;
+
+    if( spec->type != MCUSH_OPT_VALUE )
+        return;
+    if( inline_value )
+    {
+        opt->value = rest;
+        if( *opt->value == 0 )
+            opt->value = (spec->usage & MCUSH_OPT_USAGE_VALUE_REQUIRED) ? 0 : shell_str_nil;
+    }
+    else if( spec->usage & MCUSH_OPT_USAGE_VALUE_REQUIRED )
+        opt->value = (parser->idx + 1 <= parser->args_len) ? parser->args[parser->idx++] : 0;
+    else if( (parser->idx + 1 <= parser->args_len) && (parser->args[parser->idx][0] != '-') )
+        opt->value = parser->args[parser->idx++];
+    else
+        opt->value = shell_str_nil;
+}
+
+
+int bench_opt_ref_next( mcush_opt *opt, mcush_opt_parser *parser )
+{
+    const char *arg, *name, *eql;
+    size_t namelen;
+
+    memset( opt, 0, sizeof(mcush_opt) );
+    if( parser->idx >= parser->args_len )
+        return 0;
+    arg = parser->args[parser->idx++];
+    if( (strncmp( arg, "--", 2 ) == 0) && !parser->in_literal )
+    {
+        name = arg + 2;
+        namelen = (eql = strrchr( arg, '=' )) ? (size_t)(eql - name) : strlen( name );
+        opt->spec = bench_opt_ref_byname( parser, name, namelen );
+        if( ! opt->spec )
+            opt->value = arg;
+        else
+        {
+            if( opt->spec->type == MCUSH_OPT_LITERAL )
+                parser->in_literal = 1;
+            bench_opt_ref_value( opt, parser, eql ? eql + 1 : 0, eql ? 1 : 0 );
+        }
+    }
+    else if( (arg[0] == '-') && !parser->in_literal )
+    {
+        opt->spec = arg[1] ? bench_opt_ref_byalias( parser, arg[1] ) : 0;
+        if( ! opt->spec )
+            opt->value = arg;
+        else if( strlen( arg ) > 2 )  /* "-ifoo" or "-i=foo" */
+            bench_opt_ref_value( opt, parser, arg[2] == '=' ? arg + 3 : arg + 2, 1 );
+        else
+            bench_opt_ref_value( opt, parser, 0, 0 );
+    }
+    else
+    {
+        opt->spec = bench_opt_ref_nextarg( parser );
+        opt->value = arg;
+    }
+    return 1;
+}
+
+
+/* same as the options of spi, the most of all commands */
+enum { BENCH_OPT_DELAY=MCUSH_OPT_ID_USER, BENCH_OPT_SDI, BENCH_OPT_SDO, BENCH_OPT_SCK, 
+       BENCH_OPT_CS, BENCH_OPT_CPOL, BENCH_OPT_CPHA, BENCH_OPT_LSB, BENCH_OPT_VALUE };
+const mcush_opt_spec bench_opt_spec[] = {
+    { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED, 
+      'w', shell_str_width, "bits", "default 8" },
+    { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED, 
+      0, shell_str_delay, "delay_us", "default 5", BENCH_OPT_DELAY },
+    { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED, 
+      0, "sdi", "sdi_pin", "default 0.0", BENCH_OPT_SDI },
+    { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED, 
+      0, "sdo", "sdo_pin", "default 0.1", BENCH_OPT_SDO },
+    { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED, 
+      0, "sck", "sck_pin", "default 0.2", BENCH_OPT_SCK },
+    { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED, 
+      0, "cs", "cs_pin", "default 0.3", BENCH_OPT_CS },
+    { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
+      'I', shell_str_init, 0, "init pins" },
+    { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
+      'D', shell_str_deinit, 0, "deinit pins" },
+    { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
+      'U', shell_str_update, 0, "update" },
+    { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
+      'r', shell_str_read, 0, "print readout" },
+    { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
+      0, "cpol", 0, "clk polarity", BENCH_OPT_CPOL },
+    { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
+      0, "cpha", 0, "clk phase", BENCH_OPT_CPHA },
+    { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
+      0, "lsb", 0, "lsb first", BENCH_OPT_LSB },
+    { MCUSH_OPT_ARG, MCUSH_OPT_USAGE_REQUIRED, 
+      0, shell_str_value, 0, shell_str_data, BENCH_OPT_VALUE },
+    { MCUSH_OPT_NONE } };
+
+static const char *bench_opt_argv[] = { "--sdi", "1.2", "--sdo", "1.3", "--sck", "1.4", 
+    "--cs", "1.5", "--cpol", "--cpha", "--lsb", "--delay", "2", "-w", "16", "-I", "0x5A" };
+#define BENCH_OPT_ARGC  (sizeof(bench_opt_argv)/sizeof(bench_opt_argv[0]))
+
+
+/* one invocation of spi with all of its pin options, dispatched as the
+   handler does now (switch on id) and as before (STRCMP chain) */
+static uint32_t bench_opt_parse( uint32_t n )
+{
+    mcush_opt_parser parser;
+    mcush_opt opt;
+    uint32_t i, v;
+
+    for( i=0; i<n; i++ )
+    {
+        v = 0;
+        mcush_opt_parser_init( &parser, bench_opt_spec, bench_opt_argv, BENCH_OPT_ARGC );
+        while( mcush_opt_parser_next( &opt, &parser ) )
+        {
+            if( ! opt.spec )
+                break;
+            switch( opt.id )
+            {
+            case 'w': v += 1; break;
+            case BENCH_OPT_DELAY: v += 2; break;
+            case BENCH_OPT_SDI: v += 3; break;
+            case BENCH_OPT_SDO: v += 4; break;
+            case BENCH_OPT_SCK: v += 5; break;
+            case BENCH_OPT_CS: v += 6; break;
+            case 'I': v += 7; break;
+            case 'D': v += 8; break;
+            case 'U': v += 9; break;
+            case 'r': v += 10; break;
+            case BENCH_OPT_CPOL: v += 11; break;
+            case BENCH_OPT_CPHA: v += 12; break;
+            case BENCH_OPT_LSB: v += 13; break;
+            default: v += 14; break;
+            }
+        }
+        bench_sink += v;
+    }
+    return n;
+}
+
+
+static uint32_t bench_opt_parse_ref( uint32_t n )
+{
+    mcush_opt_parser parser;
+    mcush_opt opt;
+    uint32_t i, v;
+
+    for( i=0; i<n; i++ )
+    {
+        v = 0;
+        mcush_opt_parser_init( &parser, bench_opt_spec, bench_opt_argv, BENCH_OPT_ARGC );
+        while( bench_opt_ref_next( &opt, &parser ) )
+        {
+            if( ! opt.spec )
+                break;
+            /* STRCMP compares the shell_str pointers, same as here */
+            if( opt.spec->name == shell_str_delay )
+                v += 2;
+            else if( opt.spec->name == shell_str_read )
+                v += 10;
+            else if( opt.spec->name == shell_str_width )
+                v += 1;
+            else if( opt.spec->name == shell_str_init )
+                v += 7;
+            else if( opt.spec->name == shell_str_deinit )
+                v += 8;
+            else if( opt.spec->name == shell_str_update )
+                v += 9;
+            else if( strcmp( opt.spec->name, "cpol" ) == 0 )
+                v += 11;
+            else if( strcmp( opt.spec->name, "cpha" ) == 0 )
+                v += 12;
+            else if( strcmp( opt.spec->name, "lsb" ) == 0 )
+                v += 13;
+            else if( strcmp( opt.spec->name, "sdi" ) == 0 )
+                v += 3;
+            else if( strcmp( opt.spec->name, "sdo" ) == 0 )
+                v += 4;
+            else if( strcmp( opt.spec->name, "sck" ) == 0 )
+                v += 5;
+            else if( strcmp( opt.spec->name, "cs" ) == 0 )
+                v += 6;
+            else
+                v += 14;
+        }
+        bench_sink += v;
+    }
+    return n;
+}
+
+
+#if USE_SHELL_SCRIPT_IMAGE
+/* lines per second of a BENCH_SCRIPT_LINES lines script, fed to the
+   line editor as load did before (echo, history, tokenizing each line),
+   and run from the program image compiled once, the unit is one line */
+static char *bench_script, *bench_script_image;
+static int bench_script_image_size;
+
+static int bench_script_discard( void *arg, const char *buf, int len )
+{
+    (void)arg;
+    (void)buf;
+    return len;
+}
+
+
+static const char *bench_script_get( void )
+{
+    char *p;
+    int i;
+
+    if( ! bench_script )
+    {
+        bench_script = pvPortMalloc( BENCH_SCRIPT_LINES * 32 + 1 );
+        if( ! bench_script )
+            return 0;
+        p = bench_script;
+        for( i=0; i<BENCH_SCRIPT_LINES; i++ )
+            p += sprintf( p, "nop -a %d line%d arg%d\n", i, i, i & 7 );
+    }
+    return bench_script;
+}
+
+
+static uint32_t bench_script_text( uint32_t n )
+{
+    const char *script = bench_script_get();
+    uint32_t i, j;
+
+    if( ! script )
+        return 0;
+    shell_write_add_sink( bench_script_discard, 0, SHELL_WRITE_SINK_EXCLUSIVE );
+    for( i=0; i<n; i++ )
+    {
+        shell_set_script( script, 0 );
+        /* stop at the last line, reading on would wait for the driver */
+        for( j=0; j<BENCH_SCRIPT_LINES; j++ )
+        {
+            if( shell_read_line( 0, "" ) > 0 )
+                bench_sink += shell_call_line( shell_get_buf() );
+        }
+    }
+    shell_set_script( "", 0 );
+    shell_write_remove_sink( bench_script_discard, 0 );
+    return n * BENCH_SCRIPT_LINES;
+}
+
+
+static uint32_t bench_script_compile( uint32_t n )
+{
+    const char *script = bench_script_get();
+    uint32_t i;
+
+    if( ! script )
+        return 0;
+    for( i=0; i<n; i++ )
+    {
+        if( bench_script_image )
+            vPortFree( bench_script_image );
+        bench_script_image = 0;
+        if( ! shell_script_compile( script, &bench_script_image, &bench_script_image_size ) )
+            return 0;
+    }
+    return n * BENCH_SCRIPT_LINES;
+}
+
+
+static uint32_t bench_script_image_run( uint32_t n )
+{
+    uint32_t i;
+
+    if( ! bench_script_image && ! bench_script_compile( 1 ) )
+        return 0;
+    for( i=0; i<n; i++ )
+        bench_sink += shell_script_run( bench_script_image, bench_script_image_size );
+    return n * BENCH_SCRIPT_LINES;
+}
+#endif
+
+
+static const bench_case_t bench_cases[] = {
+    { "crc8", "byte", bench_crc8 },
+    { "crc16", "byte", bench_crc16 },
+    { "crc16_xmodem", "byte", bench_crc16_xmodem },
+    { "crc16_modbus", "byte", bench_crc16_modbus },
+    { "crc16_kermit", "byte", bench_crc16_kermit },
+    { "crc24", "byte", bench_crc24 },
+    { "crc32", "byte", bench_crc32 },
+    { "base64_enc", "byte", bench_base64_encode },
+    { "base64_dec", "byte", bench_base64_decode },
+    { "printf_int", "op", bench_printf_int },
+    { "printf_float", "op", bench_printf_float },
+    { "printf_buf", "byte", bench_printf_buf },
+#if USE_SHELL_PRINTF2
+    { "printf_sink", "byte", bench_printf_sink_run },
+#endif
+    { "malloc_free", "op", bench_malloc },
+    { "queue_rtt", "op", bench_queue },
+    { "shell_call", "op", bench_shell_call },
+    { "cmd_lookup", "op", bench_cmd_lookup },
+    { "cmd_scan", "op", bench_cmd_lookup_scan },
+    { "opt_parse", "op", bench_opt_parse },
+    { "opt_parse_ref", "op", bench_opt_parse_ref },
+#if USE_SHELL_SCRIPT_IMAGE
+    { "script_text", "op", bench_script_text },
+    { "script_image", "op", bench_script_image_run },
+    { "script_compile", "op", bench_script_compile },
+#endif
+    { 0 } };
+
+
+static uint32_t bench_counter_elapsed( uint32_t start )
+{
+    return BENCH_COUNTER() - start;
+}
+
+
+static void bench_report( const char *name, const char *unit, uint32_t units, uint32_t counts )
+{
+    uint64_t cycles, c100, rate;
+
+    if( !units || !counts )
+    {
+        shell_printf( "%-14s skipped\n", name );
+        return;
+    }
+    cycles = (uint64_t)counts * SystemCoreClock / BENCH_COUNTER_HZ;
+    c100 = cycles * 100 / units;
+    rate = (uint64_t)units * BENCH_COUNTER_HZ / counts;
+    if( strcmp( unit, "byte" ) == 0 )
+        shell_printf( "%-14s %8u.%02u cycles/byte %10u KB/s\n", name,
+                      (unsigned int)(c100 / 100), (unsigned int)(c100 % 100),
+                      (unsigned int)(rate / 1024) );
+    else
+        shell_printf( "%-14s %8u.%02u cycles/op   %10u op/s\n", name,
+                      (unsigned int)(c100 / 100), (unsigned int)(c100 % 100),
+                      (unsigned int)rate );
+}
+
+
+/* double the rounds until the case lasts long enough */
+static void bench_run_case( const char *name, const char *unit, uint32_t (*run)( uint32_t n ) )
+{
+    uint32_t min = (uint64_t)BENCH_COUNTER_HZ * BENCH_MIN_TIME_MS / 1000;
+    uint32_t n=1, units, start, counts;
+
+    while( 1 )
+    {
+        start = BENCH_COUNTER();
+        units = run( n );
+        counts = bench_counter_elapsed( start );
+        if( !units || (counts >= min) || (n >= 0x40000000) || (units >= 0x80000000) )
+            break;
+        n *= 2;
+    }
+    bench_report( name, unit, units, counts );
+}
+
+
+static int (*volatile bench_stack_printf)( const char *fmt, ... );
+static volatile uint8_t bench_stack_done;
+
+static void bench_stack_entry( void *p )
+{
+    if( bench_stack_printf )
+        bench_stack_printf( BENCH_PRINTF_FORMAT, -12345, 67890, 0xABCD, "abc" );
+    bench_stack_done = 1;
+    vTaskSuspend( NULL );
+}
+
+
+/* stack bytes never touched by a fresh task that calls printf once,
+   0 if the task can not be created */
+static uint32_t bench_stack_free( int (*fn)( const char *fmt, ... ) )
+{
+    TaskHandle_t task;
+    uint32_t free;
+
+    bench_stack_printf = fn;
+    bench_stack_done = 0;
+    if( xTaskCreate( bench_stack_entry, (const char *)"benchT",
+                     BENCH_PRINTF_STACK_SIZE / sizeof(portSTACK_TYPE), NULL,
+                     uxTaskPriorityGet(NULL), &task ) != pdPASS )
+        return 0;
+    while( ! bench_stack_done )
+        vTaskDelay( 1 );
+    free = uxTaskGetStackHighWaterMark( task ) * sizeof(portSTACK_TYPE);
+    vTaskDelete( task );
+    return free;
+}
+
+
+/* peak stack of the printf call itself, above an idle task entry,
+   skipped where tasks do not run on their own stack (halposix) */
+static void bench_printf_stack( void )
+{
+    uint32_t idle, buffered, streamed=0;
+
+    idle = bench_stack_free( 0 );
+    buffered = bench_stack_free( bench_printf_buffered );
+#if USE_SHELL_PRINTF2
+    streamed = bench_stack_free( bench_printf_streamed );
+#endif
+    if( !idle || !buffered || (buffered >= idle) )
+    {
+        bench_report( "printf_stack", "byte", 0, 0 );
+        return;
+    }
+    shell_printf( "%-14s %8u bytes buffered %8u bytes streamed\n", "printf_stack",
+                  (unsigned int)(idle - buffered),
+                  (unsigned int)(streamed ? idle - streamed : 0) );
+}
+
+
+#if MCUSH_VFS
+extern mcush_vfs_volume_t vfs_vol_tab[MCUSH_VFS_VOLUME_NUM];
+static char bench_file_name[32];
+static int bench_file_size;
+static uint32_t bench_file_len;
+static uint8_t *bench_file_buf=bench_buf;
+static int bench_file_chunk=BENCH_FILE_CHUNK;
+#if MCUSH_VFS_CACHE
+/* access sizes compared with and without the fd cache */
+static const int bench_cache_chunks[] = { 1, 16, 4096 };
+#define BENCH_CACHE_CHUNKS  (int)(sizeof(bench_cache_chunks)/sizeof(int))
+#endif
+
+#if MCUSH_ROMFS && MCUSH_ROMFS_USER && BENCH_ROMFS_SIZE
+static const char bench_romfs_data[BENCH_ROMFS_SIZE] = "MCUSH";
+const romfs_file_t romfs_tab[] = {
+    { "bench", bench_romfs_data, BENCH_ROMFS_SIZE },
+    { 0 } };
+#endif
+
+static void bench_find_file_cb( const char *name, int size, int mode )
+{
+    if( (size > bench_file_size) && (strlen(name) < sizeof(bench_file_name)-4) )
+    {
+        bench_file_size = size;
+        strcpy( bench_file_name + 3, name );
+    }
+}
+
+
+static uint32_t bench_file_write( uint32_t n )
+{
+    uint32_t i, j, total=0;
+    int fd, l;
+
+    for( i=0; i<n; i++ )
+    {
+        fd = mcush_open( bench_file_name, "w+" );
+        if( fd == 0 )
+            return 0;
+        for( j=0; j<bench_file_len; j+=l )
+        {
+            l = mcush_write( fd, bench_file_buf, bench_file_chunk );
+            if( l <= 0 )
+                break;
+        }
+        mcush_close( fd );
+        total += j;
+    }
+    return total;
+}
+
+
+static uint32_t bench_file_read( uint32_t n )
+{
+    uint32_t i, total=0;
+    int fd, l;
+
+    for( i=0; i<n; i++ )
+    {
+        fd = mcush_open( bench_file_name, "r" );
+        if( fd == 0 )
+            return 0;
+        while( (l = mcush_read( fd, bench_file_buf, bench_file_chunk )) > 0 )
+            total += l;
+        mcush_close( fd );
+    }
+    return total;
+}
+
+
+/* crc helper, reads in place from mapped volumes */
+static uint32_t bench_file_crc( uint32_t n )
+{
+    uint32_t i;
+    int size;
+
+    if( !mcush_size( bench_file_name, &size ) )
+        return 0;
+    for( i=0; i<n; i++ )
+        bench_sink += mcush_file_crc32( bench_file_name );
+    return size * n;
+}
+
+
+/* same crc over a copy */
+static uint32_t bench_file_crc_read( uint32_t n )
+{
+    uint32_t i, total=0, crc;
+    int fd, l;
+
+    for( i=0; i<n; i++ )
+    {
+        fd = mcush_open( bench_file_name, "r" );
+        if( fd == 0 )
+            return 0;
+        crc = crc32_init();
+        while( (l = mcush_read( fd, bench_buf, BENCH_BUF_SIZE )) > 0 )
+        {
+            crc = crc32_update( crc, bench_buf, l );
+            total += l;
+        }
+        mcush_close( fd );
+        bench_sink += crc32_final( crc );
+    }
+    return total;
+}
+
+
+#if MCUSH_VFS_CACHE
+/* small and large sequential access, uncached and then cached (with the
+   volume setting, skipped if it is 0) */
+static void bench_vfs_cache( const char *select, const char *path, int cache_size )
+{
+    char name[20];
+    int i, c;
+
+    bench_file_buf = pvPortMalloc( 4096 );
+    if( !bench_file_buf )
+    {
+        bench_file_buf = bench_buf;
+        return;
+    }
+    memset( bench_file_buf, 0x5A, 4096 );
+    for( i=0; i<BENCH_CACHE_CHUNKS; i++ )
+    {
+        bench_file_chunk = bench_cache_chunks[i];
+        for( c=0; c<2; c++ )
+        {
+            mcush_set_cache_size( path, c ? cache_size : 0 );
+            sprintf( name, "vfs_w%d%s_%s", bench_file_chunk, c ? "c" : "", path+1 );
+            if( select && strcmp( select, name ) )
+                ;
+            else if( c && !cache_size )
+                bench_report( name, "byte", 0, 0 );
+            else
+                bench_run_case( name, "byte", bench_file_write );
+            sprintf( name, "vfs_r%d%s_%s", bench_file_chunk, c ? "c" : "", path+1 );
+            if( select && strcmp( select, name ) )
+                ;
+            else if( c && !cache_size )
+                bench_report( name, "byte", 0, 0 );
+            else
+            {
+                bench_file_write( 1 );
+                bench_run_case( name, "byte", bench_file_read );
+            }
+        }
+    }
+    mcush_set_cache_size( path, cache_size );
+    vPortFree( bench_file_buf );
+    bench_file_buf = bench_buf;
+    bench_file_chunk = BENCH_FILE_CHUNK;
+}
+#endif
+
+
+#if MCUSH_VFS_LOCK
+/* tasks sharing the volumes, each writes and verifies its own file on a
+   writable volume, or reads and checks the crc of the largest file on a
+   read-only one, the timed tasks run n rounds and the others keep going
+   in background until the case ends */
+#define BENCH_MT_TASKS  4
+
+typedef struct {
+    char name[sizeof(bench_file_name)];  /* temporary or existing file */
+    int len;  /* to write, 0 for reading the existing file */
+    uint32_t crc;  /* of the existing file */
+    uint32_t n;  /* rounds, 0 for background */
+    uint32_t bytes;
+    int err;
+    volatile uint8_t running;
+    uint8_t buf[BENCH_FILE_CHUNK*2];
+} bench_mt_t;
+
+static bench_mt_t *bench_mt[BENCH_MT_TASKS+MCUSH_VFS_VOLUME_NUM];
+static int bench_mt_num, bench_mt_timed;
+static volatile uint8_t bench_mt_stop;
+static SemaphoreHandle_t bench_mt_done;
+
+
+/* the driver may run out of fds while other tasks hold them */
+static int bench_mt_open( const char *name, const char *mode )
+{
+    int fd, i;
+
+    for( i=0; i<100; i++ )
+    {
+        fd = mcush_open( name, mode );
+        if( fd )
+            return fd;
+        vTaskDelay( 1 );
+    }
+    return 0;
+}
+
+
+static int bench_mt_round( bench_mt_t *t, uint8_t seed )
+{
+    uint8_t *w=t->buf, *r=t->buf+BENCH_FILE_CHUNK;
+    uint32_t crc=crc32_init();
+    int fd, i, j, l, ok=1;
+
+    if( t->len )
+    {
+        fd = bench_mt_open( t->name, "w+" );
+        if( fd == 0 )
+            return 0;
+        for( i=0; i<t->len; i+=BENCH_FILE_CHUNK )
+        {
+            for( j=0; j<BENCH_FILE_CHUNK; j++ )
+                w[j] = (uint8_t)(i + j * 3 + seed);
+            if( mcush_write( fd, w, BENCH_FILE_CHUNK ) != BENCH_FILE_CHUNK )
+                break;
+        }
+        mcush_close( fd );
+        if( i < t->len )
+            return 0;
+        t->bytes += i;
+    }
+    fd = bench_mt_open( t->name, "r" );
+    if( fd == 0 )
+        return 0;
+    for( i=0; (l = mcush_read( fd, r, BENCH_FILE_CHUNK )) > 0; i+=l )
+    {
+        if( t->len )
+        {
+            for( j=0; j<l; j++ )
+                w[j] = (uint8_t)(i + j * 3 + seed);
+            if( memcmp( w, r, l ) )
+                ok = 0;
+        }
+        else
+            crc = crc32_update( crc, r, l );
+    }
+    mcush_close( fd );
+    t->bytes += i;
+    if( t->len )
+        return ok && (i == t->len);
+    return crc32_final( crc ) == t->crc;
+}
+
+
+static void bench_mt_entry( void *p )
+{
+    bench_mt_t *t = p;
+    uint32_t i;
+
+    for( i=0; t->n ? (i < t->n) : !bench_mt_stop; i++ )
+    {
+        if( !bench_mt_round( t, (uint8_t)i ) )
+        {
+            t->err++;
+            break;
+        }
+    }
+    t->running = 0;
+    xSemaphoreGive( bench_mt_done );
+    vTaskDelete( NULL );
+}
+
+
+static void bench_mt_wait( int num )
+{
+    int i;
+
+    for( i=0; i<num; i++ )
+    {
+        if( bench_mt[i]->running )
+        {
+            xSemaphoreTake( bench_mt_done, portMAX_DELAY );
+            i = -1;  /* check again */
+        }
+    }
+}
+
+
+static void bench_mt_start( int i, uint32_t n )
+{
+    bench_mt[i]->n = n;
+    bench_mt[i]->bytes = 0;
+    bench_mt[i]->running = 1;
+    if( xTaskCreate( bench_mt_entry, (const char *)"benchT",
+                     BENCH_STACK_SIZE / sizeof(portSTACK_TYPE), bench_mt[i],
+                     uxTaskPriorityGet(NULL), NULL ) != pdPASS )
+    {
+        bench_mt[i]->running = 0;
+        bench_mt[i]->err++;
+    }
+}
+
+
+/* only the timed tasks, the background ones keep running across calls */
+static uint32_t bench_mt_run( uint32_t n )
+{
+    uint32_t total=0;
+    int i, err=0;
+
+    for( i=0; i<bench_mt_timed; i++ )
+        bench_mt_start( i, n );
+    bench_mt_wait( bench_mt_timed );
+    for( i=0; i<bench_mt_num; i++ )
+    {
+        if( i < bench_mt_timed )
+            total += bench_mt[i]->bytes;
+        err += bench_mt[i]->err;
+    }
+    return err ? 0 : total;
+}
+
+
+/* task file on volume i, returns 0 if it has nothing to work with */
+static int bench_mt_add( int i, int timed )
+{
+    bench_mt_t *t;
+    char path[4];
+    int fd, crc;
+
+    t = pvPortMalloc( sizeof(bench_mt_t) );
+    if( !t )
+        return 0;
+    memset( t, 0, sizeof(bench_mt_t) );
+    bench_mt[bench_mt_num++] = t;
+    if( timed )
+        bench_mt_timed++;
+    snprintf( t->name, sizeof(t->name), "/%s/bench%d.tmp", vfs_vol_tab[i].mount_point, bench_mt_num );
+    fd = mcush_open( t->name, "w+" );
+    if( fd )
+    {
+        mcush_close( fd );
+        t->len = BENCH_FILE_SIZE;
+        return 1;
+    }
+    sprintf( path, "/%s", vfs_vol_tab[i].mount_point );
+    sprintf( bench_file_name, "/%s/", vfs_vol_tab[i].mount_point );
+    bench_file_size = 0;
+    mcush_list( path, bench_find_file_cb );
+    if( !bench_file_size )
+        return 0;
+    strcpy( t->name, bench_file_name );
+    crc = mcush_file_crc32( t->name );
+    t->crc = (uint32_t)crc;
+    return crc != -1;
+}
+
+
+static void bench_mt_case( const char *name, int ok )
+{
+    int i, err=0;
+
+    if( ok && bench_mt_done )
+    {
+        bench_mt_stop = 0;
+        for( i=bench_mt_timed; i<bench_mt_num; i++ )
+            bench_mt_start( i, 0 );
+        bench_run_case( name, "byte", bench_mt_run );
+        bench_mt_stop = 1;
+        bench_mt_wait( bench_mt_num );
+        while( xSemaphoreTake( bench_mt_done, 0 ) == pdPASS )
+            ;
+        for( i=0; i<bench_mt_num; i++ )
+            err += bench_mt[i]->err;
+        if( err )
+            shell_printf( "%-14s %d errors\n", name, err );
+    }
+    else
+        bench_report( name, "byte", 0, 0 );
+    for( i=0; i<bench_mt_num; i++ )
+    {
+        if( bench_mt[i]->len )
+            mcush_remove( bench_mt[i]->name );
+        vPortFree( bench_mt[i] );
+    }
+    bench_mt_num = bench_mt_timed = 0;
+}
+
+
+/* 1/2/4 tasks on one volume, then a reader on each read-only volume
+   with a writer on every writable one in background */
+static void bench_vfs_mt( const char *select )
+{
+    char name[20];
+    int i, j, k, ok;
+
+    if( !bench_mt_done )
+        bench_mt_done = xSemaphoreCreateCounting( BENCH_MT_TASKS+MCUSH_VFS_VOLUME_NUM, 0 );
+    for( i=0; i<MCUSH_VFS_VOLUME_NUM; i++ )
+    {
+        if( !vfs_vol_tab[i].mount_point )
+            continue;
+        for( k=1; k<=BENCH_MT_TASKS; k*=2 )
+        {
+            sprintf( name, "vfs_mt%d_%s", k, vfs_vol_tab[i].mount_point );
+            if( select && strcmp( select, name ) )
+                continue;
+            ok = 1;
+            for( j=0; j<k; j++ )
+                ok = bench_mt_add( i, 1 ) && ok;
+            bench_mt_case( name, ok );
+        }
+    }
+    for( i=0; i<MCUSH_VFS_VOLUME_NUM; i++ )
+    {
+        if( !vfs_vol_tab[i].mount_point )
+            continue;
+        sprintf( name, "vfs_mtw_%s", vfs_vol_tab[i].mount_point );
+        if( select && strcmp( select, name ) )
+            continue;
+        ok = bench_mt_add( i, 1 ) && !bench_mt[0]->len;
+        for( j=0; j<MCUSH_VFS_VOLUME_NUM; j++ )
+        {
+            if( (j != i) && vfs_vol_tab[j].mount_point )
+            {
+                if( !bench_mt_add( j, 0 ) || !bench_mt[bench_mt_num-1]->len )
+                    vPortFree( bench_mt[--bench_mt_num] );  /* read-only */
+            }
+        }
+        bench_mt_case( name, ok && (bench_mt_num > 1) );
+    }
+}
+#endif
+
+
+#if MCUSH_VFS_AIO
+/* up to BENCH_AIO_REQS writes are in flight, the writer only waits when
+   all of them are, vfs_aw_ for throughput, vfs_alat_ for a logger writing
+   a chunk each period, reporting the longest time it is held in
+   mcush_write against that in submitting (and waiting for a free request) */
+#define BENCH_AIO_REQS  4
+
+typedef struct {
+    mcush_vfs_aio_req_t req;
+    uint8_t busy;
+    uint8_t buf[BENCH_FILE_CHUNK];
+} bench_aio_t;
+
+static bench_aio_t *bench_aio;
+static int bench_aio_next, bench_aio_err;
+
+
+static void bench_aio_reuse( bench_aio_t *a )
+{
+    if( a->busy )
+    {
+        mcush_vfs_aio_wait( &a->req, portMAX_DELAY );
+        if( a->req.ret != a->req.len )
+            bench_aio_err++;
+        a->busy = 0;
+    }
+}
+
+
+static void bench_aio_drain( void )
+{
+    int i;
+
+    for( i=0; i<BENCH_AIO_REQS; i++ )
+        bench_aio_reuse( &bench_aio[i] );
+}
+
+
+static void bench_aio_write( int fd )
+{
+    bench_aio_t *a = &bench_aio[bench_aio_next++ % BENCH_AIO_REQS];
+
+    bench_aio_reuse( a );
+    a->req.op = MCUSH_VFS_AIO_WRITE;
+    a->req.fd = fd;
+    a->req.buf = a->buf;
+    a->req.len = BENCH_FILE_CHUNK;
+    a->req.cb = 0;
+    if( mcush_vfs_aio_submit( &a->req, portMAX_DELAY ) )
+        a->busy = 1;
+    else
+        bench_aio_err++;
+}
+
+
+static uint32_t bench_aio_file_write( uint32_t n )
+{
+    uint32_t i, j, total=0;
+    int fd;
+
+    bench_aio_err = 0;
+    for( i=0; i<n; i++ )
+    {
+        fd = mcush_open( bench_file_name, "w+" );
+        if( fd == 0 )
+            return 0;
+        for( j=0; j<bench_file_len; j+=BENCH_FILE_CHUNK )
+            bench_aio_write( fd );
+        bench_aio_drain();
+        mcush_close( fd );
+        total += j;
+    }
+    return bench_aio_err ? 0 : total;
+}
+
+
+/* longest time held in counts, 0 for error */
+static uint32_t bench_aio_logger( int async )
+{
+    TickType_t wake, period;
+    uint32_t t, held=0;
+    int fd, i;
+
+    period = BENCH_AIO_PERIOD_MS * configTICK_RATE_HZ / 1000;
+    fd = mcush_open( bench_file_name, "w+" );
+    if( fd == 0 )
+        return 0;
+    bench_aio_err = 0;
+    wake = xTaskGetTickCount();
+    for( i=0; i<BENCH_AIO_ROUNDS; i++ )
+    {
+        vTaskDelayUntil( &wake, period ? period : 1 );
+        t = BENCH_COUNTER();
+        if( async )
+            bench_aio_write( fd );
+        else if( mcush_write( fd, bench_file_buf, BENCH_FILE_CHUNK ) != BENCH_FILE_CHUNK )
+            bench_aio_err++;
+        t = bench_counter_elapsed( t );
+        if( t > held )
+            held = t;
+    }
+    bench_aio_drain();
+    mcush_close( fd );
+    return bench_aio_err ? 0 : (held ? held : 1);
+}
+
+
+static void bench_vfs_aio( const char *select, const char *vol )
+{
+    char name[20];
+    uint32_t sync, async;
+    int i;
+
+    bench_aio = pvPortMalloc( sizeof(bench_aio_t) * BENCH_AIO_REQS );
+    if( !bench_aio )
+        return;
+    memset( bench_aio, 0, sizeof(bench_aio_t) * BENCH_AIO_REQS );
+    sprintf( name, "vfs_aw_%s", vol );
+    if( !select || strcmp( select, name ) == 0 )
+        bench_run_case( name, "byte", bench_aio_file_write );
+    sprintf( name, "vfs_alat_%s", vol );
+    if( !select || strcmp( select, name ) == 0 )
+    {
+        sync = bench_aio_logger( 0 );
+        async = bench_aio_logger( 1 );
+        if( !sync || !async )
+            bench_report( name, "byte", 0, 0 );
+        else
+            shell_printf( "%-14s held max %8u us sync %8u us async\n", name,
+                          (unsigned int)((uint64_t)sync * 1000000 / BENCH_COUNTER_HZ),
+                          (unsigned int)((uint64_t)async * 1000000 / BENCH_COUNTER_HZ) );
+    }
+    for( i=0; i<BENCH_AIO_REQS; i++ )
+        mcush_vfs_aio_release( &bench_aio[i].req );
+    vPortFree( bench_aio );
+}
+#endif
+
+
+/* write/read a temporary file on writable volumes, otherwise read the
+   largest existing file */
+static void bench_vfs( const char *select )
+{
+    char name[20], path[4];
+    int i, fd;
+
+    for( i=0; i<MCUSH_VFS_VOLUME_NUM; i++ )
+    {
+        if( !vfs_vol_tab[i].mount_point )
+            continue;
+        sprintf( path, "/%s", vfs_vol_tab[i].mount_point );
+        sprintf( bench_file_name, "/%s/.bench", vfs_vol_tab[i].mount_point );
+        bench_file_len = BENCH_FILE_SIZE;
+        sprintf( name, "vfs_write_%s", vfs_vol_tab[i].mount_point );
+        fd = mcush_open( bench_file_name, "w+" );
+        if( fd )
+        {
+            mcush_close( fd );
+            if( !select || strcmp( select, name ) == 0 )
+                bench_run_case( name, "byte", bench_file_write );
+        }
+        else
+        {
+            bench_file_size = 0;
+            bench_file_name[3] = 0;
+            mcush_list( path, bench_find_file_cb );
+        }
+        sprintf( name, "vfs_read_%s", vfs_vol_tab[i].mount_point );
+        if( !select || strcmp( select, name ) == 0 )
+        {
+            if( fd )
+                bench_file_write( 1 );
+            bench_run_case( name, "byte", bench_file_read );
+        }
+        sprintf( name, "vfs_crc_%s", vfs_vol_tab[i].mount_point );
+        if( !select || strcmp( select, name ) == 0 )
+        {
+            if( fd )
+                bench_file_write( 1 );
+            bench_run_case( name, "byte", bench_file_crc );
+        }
+        sprintf( name, "vfs_crcr_%s", vfs_vol_tab[i].mount_point );
+        if( !select || strcmp( select, name ) == 0 )
+        {
+            if( fd )
+                bench_file_write( 1 );
+            bench_run_case( name, "byte", bench_file_crc_read );
+        }
+#if MCUSH_VFS_CACHE
+        if( fd )
+            bench_vfs_cache( select, path, vfs_vol_tab[i].cache_size );
+#endif
+#if MCUSH_VFS_AIO
+        if( fd )
+            bench_vfs_aio( select, vfs_vol_tab[i].mount_point );
+#endif
+        if( fd )
+            mcush_remove( bench_file_name );
+    }
+#if MCUSH_VFS_LOCK
+    bench_vfs_mt( select );
+#endif
+}
+#endif
+
+
+int cmd_bench( int argc, char *argv[] )
+{
+    static const mcush_opt_spec opt_spec[] = {
+        { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED,
+          'l', shell_str_list, 0, "list cases" },
+        { MCUSH_OPT_ARG, MCUSH_OPT_USAGE_REQUIRED,
+          0, shell_str_name, 0, "case name, all by default" },
+        { MCUSH_OPT_NONE } };
+    mcush_opt_parser parser;
+    mcush_opt opt;
+    const bench_case_t *c;
+    const char *select=0;
+    uint8_t list=0;
+    int i;
+#if MCUSH_VFS && (MCUSH_VFS_CACHE || MCUSH_VFS_LOCK)
+    int j;
+#endif
+
+    mcush_opt_parser_init( &parser, opt_spec, (const char **)(argv+1), argc-1 );
+    while( mcush_opt_parser_next( &opt, &parser ) )
+    {
+        if( ! opt.spec )
+            STOP_AT_INVALID_ARGUMENT
+        if( opt.id == 'l' )
+            list = 1;
+        else
+            select = opt.value;
+    }
+
+    if( list )
+    {
+        for( c=bench_cases; c->name; c++ )
+            shell_printf( "%s\n", c->name );
+        shell_printf( "printf_stack\n" );
+#if MCUSH_VFS
+        for( i=0; i<MCUSH_VFS_VOLUME_NUM; i++ )
+        {
+            if( !vfs_vol_tab[i].mount_point )
+                continue;
+            shell_printf( "vfs_write_%s\nvfs_read_%s\nvfs_crc_%s\nvfs_crcr_%s\n",
+                          vfs_vol_tab[i].mount_point, vfs_vol_tab[i].mount_point,
+                          vfs_vol_tab[i].mount_point, vfs_vol_tab[i].mount_point );
+#if MCUSH_VFS_CACHE
+            for( j=0; j<BENCH_CACHE_CHUNKS; j++ )
+                shell_printf( "vfs_w%d_%s\nvfs_r%d_%s\nvfs_w%dc_%s\nvfs_r%dc_%s\n",
+                              bench_cache_chunks[j], vfs_vol_tab[i].mount_point,
+                              bench_cache_chunks[j], vfs_vol_tab[i].mount_point,
+                              bench_cache_chunks[j], vfs_vol_tab[i].mount_point,
+                              bench_cache_chunks[j], vfs_vol_tab[i].mount_point );
+#endif
+#if MCUSH_VFS_AIO
+            shell_printf( "vfs_aw_%s\nvfs_alat_%s\n", vfs_vol_tab[i].mount_point,
+                          vfs_vol_tab[i].mount_point );
+#endif
+#if MCUSH_VFS_LOCK
+            for( j=1; j<=BENCH_MT_TASKS; j*=2 )
+                shell_printf( "vfs_mt%d_%s\n", j, vfs_vol_tab[i].mount_point );
+            shell_printf( "vfs_mtw_%s\n", vfs_vol_tab[i].mount_point );
+#endif
+        }
+#endif
+        return 0;
+    }
+
+    for( i=0; i<BENCH_BUF_SIZE; i++ )
+        bench_buf[i] = (uint8_t)(i * 7 + 3);
+    shell_printf( "cpu %u Hz, counter %u Hz\n", (unsigned int)SystemCoreClock,
+                  (unsigned int)BENCH_COUNTER_HZ );
+    for( c=bench_cases; c->name; c++ )
+    {
+        if( !select || strcmp( select, c->name ) == 0 )
+            bench_run_case( c->name, c->unit, c->run );
+    }
+    if( !select || strcmp( select, "printf_stack" ) == 0 )
+        bench_printf_stack();
+#if MCUSH_VFS
+    bench_vfs( select );
+#endif
+    return 0;
+}
+
+
+static const shell_cmd_t cmd_tab_bench[] = {
+    {   0, 0, "bench",  cmd_bench,
+        "run benchmarks",
+        "bench [-l] [name]"
+    },
+    {   CMD_HIDDEN, 0, "nop",  cmd_nop,
+        "do nothing",
+        "nop"
+    },
+    {   CMD_END  }
+};
+
+
+void bench_init(void)
+{
+    BENCH_COUNTER_INIT();
+    shell_add_cmd_table( cmd_tab_bench );
+}
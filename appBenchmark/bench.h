@@ -0,0 +1,102 @@
+/* MCUSH designed by Peng Shulin, all rights reserved. */
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+/* free-running 32-bit counter for timing, results are scaled to cpu cycles
+   with SystemCoreClock, so on host (SystemCoreClock=1GHz) they read as ns */
+#ifndef BENCH_COUNTER
+    #if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+        /* DWT cycle counter of Cortex-M3/M4/M7 */
+        #define BENCH_COUNTER()     (*(volatile uint32_t*)0xE0001004)
+        #define BENCH_COUNTER_HZ    (SystemCoreClock)
+        #define BENCH_COUNTER_INIT()  do { \
+            *(volatile uint32_t*)0xE000EDFC |= (1<<24);  /* DEMCR.TRCENA */ \
+            *(volatile uint32_t*)0xE0001000 |= 1;  /* DWT_CTRL.CYCCNTENA */ \
+            } while(0)
+    #else
+        #define BENCH_COUNTER()     xTaskGetTickCount()
+        #define BENCH_COUNTER_HZ    (configTICK_RATE_HZ)
+    #endif
+#endif
+#ifndef BENCH_COUNTER_INIT
+    #define BENCH_COUNTER_INIT()
+#endif
+
+/* each case is repeated until it lasts longer than this */
+#ifndef BENCH_MIN_TIME_MS
+    #define BENCH_MIN_TIME_MS  200
+#endif
+
+#ifndef BENCH_BUF_SIZE
+    #define BENCH_BUF_SIZE  1024
+#endif
+
+#ifndef BENCH_FILE_SIZE
+    #define BENCH_FILE_SIZE  (16*1024)
+#endif
+
+#ifndef BENCH_FILE_CHUNK
+    #define BENCH_FILE_CHUNK  256
+#endif
+
+/* romfs with one static file of this size (MCUSH_ROMFS_USER=1 builds),
+   for mapped against copied reads, 0 for none */
+#ifndef BENCH_ROMFS_SIZE
+    #define BENCH_ROMFS_SIZE  0
+#endif
+
+/* vfs aio logger case, one chunk written each period */
+#ifndef BENCH_AIO_PERIOD_MS
+    #define BENCH_AIO_PERIOD_MS  10
+#endif
+
+#ifndef BENCH_AIO_ROUNDS
+    #define BENCH_AIO_ROUNDS  50
+#endif
+
+#define BENCH_STACK_SIZE  (2*1024)
+
+/* task for the printf stack usage, room for the 512 bytes line buffer of
+   the buffered path and the libc formatter under it */
+#ifndef BENCH_PRINTF_STACK_SIZE
+    #define BENCH_PRINTF_STACK_SIZE  (4*1024)
+#endif
+
+/* lines of the script run through the line editor and as image */
+#ifndef BENCH_SCRIPT_LINES
+    #define BENCH_SCRIPT_LINES  1000
+#endif
+
+/* random rounds of each check case by default */
+#ifndef CHECK_ROUNDS
+    #define CHECK_ROUNDS  10000
+#endif
+
+#ifndef CHECK_SEED
+    #define CHECK_SEED  1
+#endif
+
+/* mismatches printed for each case */
+#ifndef CHECK_REPORT_MAX
+    #define CHECK_REPORT_MAX  5
+#endif
+
+/* hal_vcp_tx.c of halstm32f4 linked in (host build, see posix.mk) */
+#ifndef CHECK_VCP_TX
+    #define CHECK_VCP_TX  0
+#endif
+
+/* values of the mkbuf upload check in each mode, text and reference of
+   that many values are allocated (about 3MB for 100k), 0 to leave it out */
+#ifndef CHECK_MKBUF_VALUES
+    #define CHECK_MKBUF_VALUES  0
+#endif
+
+/* option parser before the ids, see bench.c */
+extern const mcush_opt_spec bench_opt_spec[];
+extern int bench_opt_ref_next( mcush_opt *opt, mcush_opt_parser *parser );
+
+extern void bench_init(void);
+extern void check_init(void);
+
+#endif
@@ -0,0 +1,973 @@
+/* MCUSH designed by Peng Shulin, all rights reserved. */
+/* correctness checks of the optimized primitives against reference
+   implementations, with random input from a fixed seed so that a failed
+   round can be repeated, run on host (halposix) to compare with glibc
+   each result line: name, rounds, mismatches */
+#include "mcush.h"
+#include "bench.h"
+#if USE_SHELL_PRINTF2
+#include "mcush_printf2.h"
+#endif
+#if CHECK_VCP_TX
+#include "hal_vcp_tx.h"
+#endif
+
+typedef struct {
+    const char *name;
+    /* run n random rounds, return mismatches */
+    uint32_t (*run)( uint32_t n );
+} check_case_t;
+
+static uint32_t check_seed;
+static uint32_t check_reported;
+
+
+/* xorshift32 */
+static uint32_t check_rand( void )
+{
+    check_seed ^= check_seed << 13;
+    check_seed ^= check_seed >> 17;
+    check_seed ^= check_seed << 5;
+    return check_seed;
+}
+
+
+/* print the first few mismatches of each case */
+static void check_report( const char *what, const char *out, const char *ref )
+{
+    if( check_reported++ < CHECK_REPORT_MAX )
+        shell_printf( "  %s: \"%s\", expect \"%s\"\n", what, out, ref );
+}
+
+
+#if USE_SHELL_PRINTF2
+static const char * const check_int_formats[] = {
+    "%d", "%5d", "%-8d|", "%08d", "%+d", "%+6d", "%u", "%12u", "%-12u|",
+    "%x", "%X", "%08X", "%-6x|", "%hd", "%hu", "%hx", "%c|", 0 };
+
+/* '#' with 'g' is left out, glibc prints "1.e+03" for %#.3g of 999.5 */
+static const char * const check_float_formats[] = {
+    "%f", "%.0f", "%.1f", "%.2f", "%.6f", "%.9f", "%F",
+    "%e", "%.0e", "%.3e", "%.8e", "%E",
+    "%g", "%.1g", "%.4g", "%.9g", "%G",
+    "%+f", "% e", "% g", "%12.3f", "%-12.3e|", "%012.3f", "%+010.2e",
+    "%#.0f", "%#.0e", 0 };
+
+
+/* small, large and boundary values */
+static int check_rand_int( void )
+{
+    uint32_t r = check_rand();
+
+    switch( r & 3 )
+    {
+    case 0: return (int)(r >> 2) % 1000 - 500;
+    case 1: return (int)check_rand() >> (r >> 27);
+    case 2: return (r & 4) ? INT32_MIN : INT32_MAX;
+    default: return (int)check_rand();
+    }
+}
+
+
+/* raw bit patterns (no nan), measurement-like values and short decimals */
+static float check_rand_float( void )
+{
+    uint32_t r = check_rand(), u;
+    float f;
+
+    switch( r & 3 )
+    {
+    case 0:
+        do
+            u = check_rand();
+        while( (u & 0x7F800000) == 0x7F800000 && (u & 0x007FFFFF) );
+        memcpy( &f, &u, 4 );
+        return f;
+    case 1:
+        return (float)(int)check_rand() / (float)(1 << ((r >> 2) & 31));
+    case 2:
+        return (float)((int)(check_rand() % 2000001) - 1000000) / 1000.0f;
+    default:
+        return (r & 4) ? 1.0f/0.0f : (float)((r >> 3) & 0xFF);
+    }
+}
+
+
+static uint32_t check_printf_int( uint32_t n )
+{
+    char out[64], ref[64];
+    const char * const *fmt;
+    uint32_t i, err=0;
+    int v;
+
+    for( i=0; i<n; i++ )
+    {
+        v = check_rand_int();
+        for( fmt=check_int_formats; *fmt; fmt++ )
+        {
+            stringfn( out, sizeof(out), *fmt, v );
+            snprintf( ref, sizeof(ref), *fmt, v );
+            if( strcmp( out, ref ) )
+            {
+                err++;
+                check_report( *fmt, out, ref );
+            }
+        }
+    }
+    return err;
+}
+
+
+/* printf2 formats floats with float precision */
+static uint32_t check_printf_float( uint32_t n )
+{
+    char out[80], ref[80];
+    const char * const *fmt;
+    uint32_t i, err=0;
+    float f;
+
+    for( i=0; i<n; i++ )
+    {
+        f = check_rand_float();
+        for( fmt=check_float_formats; *fmt; fmt++ )
+        {
+            stringfn( out, sizeof(out), *fmt, f );
+            snprintf( ref, sizeof(ref), *fmt, (double)f );
+            if( strcmp( out, ref ) )
+            {
+                err++;
+                check_report( *fmt, out, ref );
+            }
+        }
+    }
+    return err;
+}
+
+
+/* shortest output must read back to the same float,
+   and with one digit less it must not */
+static uint32_t check_printf_shortest( uint32_t n )
+{
+    char out[32], ref[32];
+    uint32_t i, err=0;
+    float f;
+    int digits;
+    char *p;
+
+    for( i=0; i<n; i++ )
+    {
+        f = check_rand_float();
+        if( f - f != 0.0f )
+            continue;  /* inf */
+        stringf_float( out, f, -1, 'g' );
+        digits = 0;
+        for( p=out; *p && (*p != 'e'); p++ )
+        {
+            if( (*p >= '1' && *p <= '9') || (digits && *p == '0') )
+                digits++;
+        }
+        if( (digits > 1) && (digits <= 9) )
+            snprintf( ref, sizeof(ref), "%.*g", digits-1, (double)f );
+        if( (strtof( out, 0 ) != f) || (digits > 9) || 
+            ((digits > 1) && (strtof( ref, 0 ) == f)) )
+        {
+            err++;
+            snprintf( ref, sizeof(ref), "%.9g", (double)f );
+            check_report( "shortest", out, ref );
+        }
+    }
+    return err;
+}
+
+
+/* long output through the sink in chunks, same as the buffer */
+static char check_sink_buf[256];
+static int check_sink_len;
+
+static void check_sink( const char *buf, int len )
+{
+    if( check_sink_len + len < (int)sizeof(check_sink_buf) )
+        memcpy( check_sink_buf + check_sink_len, buf, len );
+    check_sink_len += len;
+}
+
+
+static uint32_t check_printf_sink( uint32_t n )
+{
+    char ref[256];
+    uint32_t i, err=0;
+    int v;
+    float f;
+
+    for( i=0; i<n; i++ )
+    {
+        v = check_rand_int();
+        f = check_rand_float();
+        check_sink_len = 0;
+        stringfs( check_sink, "%s %d %08X %-12.3e|%s %u %f",
+                  "the quick brown fox", v, v, f, "jumps over the lazy dog", v, f );
+        snprintf( ref, sizeof(ref), "%s %d %08X %-12.3e|%s %u %f",
+                  "the quick brown fox", v, v, (double)f, "jumps over the lazy dog", v, (double)f );
+        check_sink_buf[check_sink_len < (int)sizeof(check_sink_buf) ? check_sink_len : 0] = 0;
+        if( strcmp( check_sink_buf, ref ) )
+        {
+            err++;
+            check_report( "sink", check_sink_buf, ref );
+        }
+    }
+    return err;
+}
+#endif
+
+
+/* bytewise loops of the tables generated library, the tables are the
+   same and the sliced/streaming versions must give the same crc */
+static uint8_t check_crc8_ref( const uint8_t *data, int len, uint8_t crc, const uint8_t *table )
+{
+    while( len-- > 0 )
+        crc = table[*data++ ^ crc];
+    return crc;
+}
+
+
+static uint16_t check_crc16_ref( const uint8_t *data, int len, uint16_t crc, const uint16_t *table )
+{
+    while( len-- > 0 )
+        crc = table[*data++ ^ (uint8_t)crc] ^ (crc >> 8);
+    return crc;
+}
+
+
+static uint32_t check_crc32_ref( const uint8_t *data, int len, uint32_t crc, const uint32_t *table )
+{
+    crc ^= 0xFFFFFFFFu;
+    while( len-- > 0 )
+        crc = table[*data++ ^ (uint8_t)crc] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+
+static uint8_t check_buf[BENCH_BUF_SIZE+8];
+
+#define CHECK_CRC( name, crc, ref )  do { \
+    uint32_t _c=(crc), _r=(ref); \
+    if( _c != _r ) { \
+        err++; \
+        snprintf( out, sizeof(out), "%X", (unsigned int)_c ); \
+        snprintf( ref_str, sizeof(ref_str), "%X len %d", (unsigned int)_r, len ); \
+        check_report( name, out, ref_str ); \
+    } } while(0)
+
+/* one call and streaming in two parts, random length, alignment and split */
+static uint32_t check_crc( uint32_t n )
+{
+    char out[16], ref_str[32];
+    uint8_t *buf;
+    uint32_t i, err=0;
+    int len, split, j;
+
+    for( i=0; i<n; i++ )
+    {
+        buf = check_buf + (check_rand() & 7);
+        len = check_rand() % (BENCH_BUF_SIZE+1);
+        split = len ? check_rand() % (len+1) : 0;
+        for( j=0; j<len; j++ )
+            buf[j] = (uint8_t)check_rand();
+
+        CHECK_CRC( "crc8", crc8( buf, len ), check_crc8_ref( buf, len, 0, crc8_table ) );
+        CHECK_CRC( "crc8 stream", crc8_final( crc8_update( crc8_update( crc8_init(), 
+                   buf, split ), buf+split, len-split ) ), crc8( buf, len ) );
+        CHECK_CRC( "crc16", crc16( buf, len ), check_crc16_ref( buf, len, 0, crc16_table ) );
+        CHECK_CRC( "crc16 stream", crc16_final( crc16_update( crc16_update( crc16_init(), 
+                   buf, split ), buf+split, len-split ) ), crc16( buf, len ) );
+        CHECK_CRC( "crc16_xmodem", crc16_xmodem( buf, len ), 
+                   check_crc16_ref( buf, len, 0, crc16_xmodem_table ) );
+        CHECK_CRC( "crc16_xmodem stream", crc16_xmodem_final( crc16_xmodem_update( 
+                   crc16_xmodem_update( crc16_xmodem_init(), buf, split ), buf+split, len-split ) ), 
+                   crc16_xmodem( buf, len ) );
+        CHECK_CRC( "crc16_modbus", crc16_modbus( buf, len ), 
+                   check_crc16_ref( buf, len, 0xFFFF, crc16_modbus_table ) );
+        CHECK_CRC( "crc16_modbus stream", crc16_modbus_final( crc16_modbus_update( 
+                   crc16_modbus_update( crc16_modbus_init(), buf, split ), buf+split, len-split ) ), 
+                   crc16_modbus( buf, len ) );
+        CHECK_CRC( "crc16_kermit", crc16_kermit( buf, len ), 
+                   check_crc16_ref( buf, len, 0, crc16_kermit_table ) );
+        CHECK_CRC( "crc16_kermit stream", crc16_kermit_final( crc16_kermit_update( 
+                   crc16_kermit_update( crc16_kermit_init(), buf, split ), buf+split, len-split ) ), 
+                   crc16_kermit( buf, len ) );
+        CHECK_CRC( "crc24", crc24( buf, len ), check_crc32_ref( buf, len, 0xB704CE, crc24_table ) );
+        CHECK_CRC( "crc24 stream", crc24_final( crc24_update( crc24_update( crc24_init(), 
+                   buf, split ), buf+split, len-split ) ), crc24( buf, len ) );
+        CHECK_CRC( "crc32", crc32( buf, len ), check_crc32_ref( buf, len, 0, crc32_table ) );
+        CHECK_CRC( "crc32 stream", crc32_final( crc32_update( crc32_update( crc32_init(), 
+                   buf, split ), buf+split, len-split ) ), crc32( buf, len ) );
+    }
+    return err;
+}
+
+
+/* per char codec as the original libb64: a newline after every 76 code
+   chars and at the end, decoder skips all chars out of the alphabet */
+static const char check_base64_chars[] = 
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static int check_base64_encode_ref( const uint8_t *in, int len, char *out )
+{
+    char *p = out;
+    uint32_t v;
+    int i, groups=0;
+
+    for( i=0; i+3<=len; i+=3 )
+    {
+        v = ((uint32_t)in[i] << 16) | ((uint32_t)in[i+1] << 8) | in[i+2];
+        *p++ = check_base64_chars[v >> 18];
+        *p++ = check_base64_chars[(v >> 12) & 0x3F];
+        *p++ = check_base64_chars[(v >> 6) & 0x3F];
+        *p++ = check_base64_chars[v & 0x3F];
+        if( ++groups == 76/4 )
+        {
+            *p++ = '\n';
+            groups = 0;
+        }
+    }
+    if( len - i )
+    {
+        v = (uint32_t)in[i] << 16;
+        if( len - i == 2 )
+            v |= (uint32_t)in[i+1] << 8;
+        *p++ = check_base64_chars[v >> 18];
+        *p++ = check_base64_chars[(v >> 12) & 0x3F];
+        *p++ = (len - i == 2) ? check_base64_chars[(v >> 6) & 0x3F] : '=';
+        *p++ = '=';
+    }
+    *p++ = '\n';
+    return p - out;
+}
+
+
+/* every 4 chars give 3 bytes, a partial group gives the complete bytes */
+static int check_base64_decode_ref( const char *in, int len, uint8_t *out )
+{
+    const char *c;
+    uint32_t bits=0;
+    int nbits=0, l=0;
+
+    for( ; len > 0; len--, in++ )
+    {
+        if( ! *in || ! (c = strchr( check_base64_chars, *in )) )
+            continue;
+        bits = (bits << 6) | (uint32_t)(c - check_base64_chars);
+        nbits += 6;
+        if( nbits >= 8 )
+        {
+            nbits -= 8;
+            out[l++] = (uint8_t)(bits >> nbits);
+        }
+    }
+    return l;
+}
+
+
+static char check_code[BENCH_BUF_SIZE*2], check_code_ref[BENCH_BUF_SIZE*2];
+static uint8_t check_plain[BENCH_BUF_SIZE+8];
+
+/* random data and length, fed to the encoder in random chunks */
+static uint32_t check_base64_enc( uint32_t n )
+{
+    base64_encodestate s;
+    uint32_t i, err=0;
+    int len, l, lr, done, chunk, j;
+
+    for( i=0; i<n; i++ )
+    {
+        len = check_rand() % (BENCH_BUF_SIZE+1);
+        for( j=0; j<len; j++ )
+            check_buf[j] = (uint8_t)check_rand();
+        base64_init_encodestate( &s );
+        for( l=done=0; done<len; done+=chunk )
+        {
+            chunk = 1 + check_rand() % ((check_rand() & 1) ? 4 : len);
+            if( chunk > len - done )
+                chunk = len - done;
+            l += base64_encode_block( (const char*)check_buf+done, chunk, check_code+l, &s );
+        }
+        l += base64_encode_blockend( check_code+l, &s );
+        lr = check_base64_encode_ref( check_buf, len, check_code_ref );
+        if( (l != lr) || memcmp( check_code, check_code_ref, l ) )
+        {
+            err++;
+            check_code[l < 40 ? l : 40] = 0;
+            check_code_ref[lr < 40 ? lr : 40] = 0;
+            check_report( "base64 encode", check_code, check_code_ref );
+        }
+    }
+    return err;
+}
+
+
+/* valid code with random noise (line ends, padding, any byte) inserted,
+   fed to the decoder in random chunks */
+static uint32_t check_base64_dec( uint32_t n )
+{
+    static const char noise[] = "\r\n =\t";
+    base64_decodestate s;
+    char out[24], ref[24];
+    uint32_t i, err=0;
+    int len, l, lr, done, chunk, j, k;
+
+    for( i=0; i<n; i++ )
+    {
+        len = check_rand() % (BENCH_BUF_SIZE*3/4);
+        for( j=0; j<len; j++ )
+            check_buf[j] = (uint8_t)check_rand();
+        l = check_base64_encode_ref( check_buf, len, check_code_ref );
+        /* drop the tail for incomplete code sometimes */
+        if( (check_rand() & 7) == 0 )
+            l -= check_rand() % (l < 8 ? l+1 : 8);
+        for( j=k=0; (j<l) && (k<(int)sizeof(check_code)-1); j++ )
+        {
+            switch( check_rand() & 63 )
+            {
+            case 0: check_code[k++] = (char)check_rand(); break;
+            case 1: check_code[k++] = noise[check_rand() % (sizeof(noise)-1)]; break;
+            }
+            check_code[k++] = check_code_ref[j];
+        }
+        base64_init_decodestate( &s );
+        for( l=done=0; done<k; done+=chunk )
+        {
+            chunk = 1 + check_rand() % ((check_rand() & 1) ? 5 : k);
+            if( chunk > k - done )
+                chunk = k - done;
+            l += base64_decode_block( check_code+done, chunk, (char*)check_plain+l, &s );
+        }
+        lr = check_base64_decode_ref( check_code, k, check_buf );
+        if( (l != lr) || memcmp( check_plain, check_buf, l ) )
+        {
+            err++;
+            snprintf( out, sizeof(out), "%d bytes", l );
+            snprintf( ref, sizeof(ref), "%d bytes", lr );
+            check_report( "base64 decode", out, ref );
+        }
+    }
+    return err;
+}
+
+
+/* ring buffer against a counting model, the producer is a task (put) or a
+   circular dma (update), the consumer a task (get) or a dma transmitter
+   (peek_linear/skip), indexes start anywhere to cross the 2^32 wrap */
+#define CHECK_RB_BYTE(seq)  ((uint8_t)((seq) ^ ((seq) >> 8)))
+
+static int check_ringbuf_round( void )
+{
+    ringbuf_t rb;
+    uint8_t *p;
+    uint32_t size, wr, rd, pos=0, overrun=0, n, len, expect, mode, j, k;
+
+    size = 4u << (check_rand() % 6);
+    ringbuf_init( &rb, check_plain, size );
+    rb.head = rb.tail = wr = rd = check_rand();
+    mode = check_rand() & 3;  /* bit0: dma producer, bit1: dma consumer */
+    if( mode & 1 )
+        pos = wr & (size-1);
+    for( k=0; k<200; k++ )
+    {
+        /* produce */
+        len = check_rand() % (size + 2);
+        if( mode & 1 )
+        {
+            /* dma writes on regardless of the consumer, updated at least
+               every half buffer */
+            len = len % (size/2 + 1);
+            for( j=0; j<len; j++, pos++, wr++ )
+                check_plain[pos & (size-1)] = CHECK_RB_BYTE(wr);
+            if( ringbuf_dma_update( &rb, pos & (size-1) ) != len )
+                return 1;
+            if( wr - rd > size )
+            {
+                overrun += wr - rd - size;
+                rd = wr - size;
+            }
+        }
+        else
+        {
+            for( j=0; j<len; j++ )
+                check_buf[j] = CHECK_RB_BYTE(wr+j);
+            expect = size - (wr - rd);
+            if( expect > len )
+                expect = len;
+            if( ringbuf_put( &rb, check_buf, len ) != expect )
+                return 1;
+            wr += expect;
+        }
+        if( (ringbuf_len( &rb ) != wr - rd) || (ringbuf_free( &rb ) != size - (wr - rd)) )
+            return 1;
+        /* consume, sometimes not at all */
+        if( (check_rand() & 3) == 0 )
+            continue;
+        if( mode & 2 )
+        {
+            n = ringbuf_peek_linear( &rb, &p );
+            expect = size - (rd & (size-1));
+            if( expect > wr - rd )
+                expect = wr - rd;
+            if( (n != expect) || (p != check_plain + (rd & (size-1))) )
+                return 1;
+            /* transmitted in part */
+            n = n ? check_rand() % (n+1) : 0;
+            for( j=0; j<n; j++ )
+                if( p[j] != CHECK_RB_BYTE(rd+j) )
+                    return 1;
+            ringbuf_skip( &rb, n );
+        }
+        else
+        {
+            len = check_rand() % (size + 2);
+            expect = wr - rd < len ? wr - rd : len;
+            n = ringbuf_get( &rb, check_buf, len );
+            if( n != expect )
+                return 1;
+            for( j=0; j<n; j++ )
+                if( check_buf[j] != CHECK_RB_BYTE(rd+j) )
+                    return 1;
+        }
+        rd += n;
+        if( (rb.tail != rd) || (rb.overrun != overrun) )
+            return 1;
+    }
+    return 0;
+}
+
+
+static uint32_t check_ringbuf( uint32_t n )
+{
+    char out[24];
+    uint32_t i, err=0;
+
+    for( i=0; i<n; i++ )
+    {
+        if( check_ringbuf_round() )
+        {
+            err++;
+            snprintf( out, sizeof(out), "round %u", (unsigned int)i );
+            check_report( "ringbuf", out, "model" );
+        }
+    }
+    return err;
+}
+
+
+#if CHECK_VCP_TX
+/* vcp transmit packing on a mocked endpoint, writers deliver random bursts
+   and go idle for one read between them */
+typedef struct {
+    int len, pos;     /* source */
+    int burst;        /* left in current burst */
+    uint8_t gap;      /* idle read due */
+    uint8_t idle;     /* last read timed out */
+    uint8_t boundary; /* last transfer ended on packet boundary */
+    int bank_size;
+    const uint8_t *last;  /* bank of last data transfer */
+    int host_len;
+    int err;
+} check_vcp_t;
+
+
+static int check_vcp_read( void *arg, uint8_t *buf, int len, int wait )
+{
+    check_vcp_t *v = (check_vcp_t*)arg;
+    int n;
+
+    if( ! v->burst )
+    {
+        if( (v->gap && (wait != HAL_VCP_TX_WAIT_FOREVER)) || (v->pos >= v->len) )
+        {
+            v->gap = 0;
+            v->idle = 1;
+            return 0;
+        }
+        v->burst = 1 + check_rand() % ((check_rand() & 1) ? 8 : 300);
+        if( v->burst > v->len - v->pos )
+            v->burst = v->len - v->pos;
+    }
+    n = v->burst < len ? v->burst : len;
+    memcpy( buf, check_buf + v->pos, n );
+    v->pos += n;
+    v->burst -= n;
+    v->gap = v->burst ? 0 : 1;
+    v->idle = 0;
+    return n;
+}
+
+
+static int check_vcp_transmit( void *arg, const uint8_t *buf, int len )
+{
+    check_vcp_t *v = (check_vcp_t*)arg;
+
+    if( ! len )
+    {
+        /* zlp only to terminate a transfer ended on packet boundary */
+        if( ! v->boundary )
+            v->err++;
+        v->boundary = 0;
+        return 0;
+    }
+    /* short packet only when writers are idle, never from the bank in
+       flight, never more than one bank */
+    if( ((len % HAL_VCP_TX_PACKET_SIZE) && ! v->idle) || (buf == v->last) || 
+        (len > v->bank_size) || (v->host_len + len > v->len) )
+    {
+        v->err++;
+        return 0;
+    }
+    memcpy( check_plain + v->host_len, buf, len );
+    v->host_len += len;
+    v->last = buf;
+    v->boundary = (len % HAL_VCP_TX_PACKET_SIZE) == 0;
+    return 0;
+}
+
+
+static uint32_t check_vcp_tx( uint32_t n )
+{
+    static uint8_t bank1[4*HAL_VCP_TX_PACKET_SIZE], bank2[4*HAL_VCP_TX_PACKET_SIZE];
+    char out[32], ref[32];
+    hal_vcp_tx_t tx;
+    check_vcp_t v;
+    uint32_t i, err=0;
+    int j;
+
+    for( i=0; i<n; i++ )
+    {
+        memset( &v, 0, sizeof(v) );
+        v.len = check_rand() % (BENCH_BUF_SIZE+1);
+        for( j=0; j<v.len; j++ )
+            check_buf[j] = (uint8_t)check_rand();
+        v.bank_size = HAL_VCP_TX_PACKET_SIZE * (1 + check_rand() % 4);
+        hal_vcp_tx_init( &tx, bank1, bank2, v.bank_size );
+        tx.read = check_vcp_read;
+        tx.transmit = check_vcp_transmit;
+        tx.arg = &v;
+        /* until all is sent and terminated */
+        for( j=0; (j<4*BENCH_BUF_SIZE) && ((v.pos < v.len) || tx.len || tx.zlp); j++ )
+            hal_vcp_tx_poll( &tx );
+        if( v.err || v.boundary || (v.host_len != v.len) || memcmp( check_plain, check_buf, v.len ) )
+        {
+            err++;
+            snprintf( out, sizeof(out), "%d bytes, %d errors%s", v.host_len, v.err, 
+                      v.boundary ? ", no zlp" : "" );
+            snprintf( ref, sizeof(ref), "%d bytes", v.len );
+            check_report( "vcp_tx", out, ref );
+        }
+    }
+    return err;
+}
+#endif
+
+
+/* option parser against the one before the ids and the name index, on
+   random command lines of options, prefixes, unknown and malformed ones,
+   each step must match the same spec with the same value and consume
+   the same args, the id must be the spec id or its alias */
+static const mcush_opt_spec check_opt_spec[] = {
+    { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
+      'v', "verbose", 0, 0 },
+    { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED, 
+      'o', "output", "file", 0 },
+    { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED, 
+      0, "output-dir", "dir", 0, MCUSH_OPT_ID_USER },
+    { MCUSH_OPT_LITERAL },
+    { MCUSH_OPT_ARG, MCUSH_OPT_USAGE_REQUIRED, 
+      0, "name", 0, 0, MCUSH_OPT_ID_USER+1 },
+    { MCUSH_OPT_ARGS, 0, 0, "files" },
+    { MCUSH_OPT_NONE } };
+
+static const char * const check_opt_tokens[] = {
+    "--sdi", "--sdo", "--sck", "--cs", "--cpol", "--cpha", "--lsb", "--delay", 
+    "--width", "--init", "--deinit", "--update", "--read", "--s", "--sd", "--c",
+    "--sdix", "--cs=1.2", "--delay=", "--width=8", "--x", "--", "-", "-w", "-w16",
+    "-w=", "-w=3", "-I", "-D", "-U", "-r", "-z", "-Ix", "1.2", "0x5A", "abc", "",
+    "--verbose", "--verb", "-v", "--output", "--output=", "--output=f", "-o",
+    "-ofile", "-o=", "--output-dir", "--output-dir=", "--output-dir=d", "--o",
+    "--=", "--==", "-=", "name", "file" };
+#define CHECK_OPT_TOKENS  (sizeof(check_opt_tokens)/sizeof(check_opt_tokens[0]))
+#define CHECK_OPT_ARGC  12
+
+
+static uint32_t check_opt_line( const mcush_opt_spec *specs, const char **argv, int argc )
+{
+    mcush_opt_parser parser, ref_parser;
+    mcush_opt opt, ref;
+    char out[48], ref_str[48];
+    int ret, ref_ret, step=0, id, pos;
+
+    mcush_opt_parser_init( &parser, specs, argv, argc );
+    mcush_opt_parser_init( &ref_parser, specs, argv, argc );
+    do
+    {
+        pos = parser.idx;
+        ret = mcush_opt_parser_next( &opt, &parser );
+        ref_ret = bench_opt_ref_next( &ref, &ref_parser );
+        id = ref.spec ? (ref.spec->id ? ref.spec->id : ref.spec->alias) : 0;
+        if( (ret != ref_ret) || (opt.spec != ref.spec) || (opt.value != ref.value) ||
+            (parser.idx != ref_parser.idx) || (opt.id != id) )
+        {
+            snprintf( out, sizeof(out), "%d %s %s %d", step, 
+                      opt.spec && opt.spec->name ? opt.spec->name : "-", 
+                      opt.value ? opt.value : "(null)", opt.id );
+            snprintf( ref_str, sizeof(ref_str), "%d %s %s %d", step, 
+                      ref.spec && ref.spec->name ? ref.spec->name : "-", 
+                      ref.value ? ref.value : "(null)", id );
+            check_report( pos < argc ? argv[pos] : "end", out, ref_str );
+            return 1;
+        }
+        step++;
+    } while( ret );
+    return 0;
+}
+
+
+static uint32_t check_opt( uint32_t n )
+{
+    const char *argv[CHECK_OPT_ARGC];
+    uint32_t i, err=0;
+    int argc, j;
+
+    for( i=0; i<n; i++ )
+    {
+        argc = check_rand() % (CHECK_OPT_ARGC+1);
+        for( j=0; j<argc; j++ )
+            argv[j] = check_opt_tokens[check_rand() % CHECK_OPT_TOKENS];
+        err += check_opt_line( bench_opt_spec, argv, argc );
+        err += check_opt_line( check_opt_spec, argv, argc );
+    }
+    return err;
+}
+
+
+#if CHECK_MKBUF_VALUES
+/* one upload of CHECK_MKBUF_VALUES random tokens in each mode fed to the
+   data buffer parser as script input, values must be the same as libc
+   gives for each token, rounds are not used */
+static const char * const check_mkbuf_seps[] = { " ", ",", ", ", "\t", " \t" };
+
+static int check_mkbuf_discard( void *arg, const char *buf, int len )
+{
+    (void)arg;
+    (void)buf;
+    return len;
+}
+
+
+static int check_mkbuf_token( char *tok, int float_mode )
+{
+    uint32_t r = check_rand();
+
+    if( float_mode )
+    {
+        switch( r & 3 )
+        {
+        case 0: return snprintf( tok, 24, "%d", (int)(check_rand() % 200001) - 100000 );
+        case 1: return snprintf( tok, 24, "%d.%03u", (int)(check_rand() % 2001) - 1000, 
+                                 (unsigned int)(r >> 2) % 1000 );
+        default: return snprintf( tok, 24, "%.6e", 
+                                  (double)(int)check_rand() / (double)(1u << ((r >> 2) & 31)) );
+        }
+    }
+    switch( r & 3 )
+    {
+    case 0: return snprintf( tok, 24, "%u", (unsigned int)(r >> 16) );
+    case 1: return snprintf( tok, 24, "0x%X", (unsigned int)(r >> 16) );
+    case 2: return snprintf( tok, 24, "-%u", (unsigned int)(r >> 2) % 1000 );
+    default: return snprintf( tok, 24, "%u", (unsigned int)(r >> 2) % 100 );
+    }
+}
+
+
+static uint32_t check_mkbuf_mode( int float_mode )
+{
+    int unit = float_mode ? sizeof(float) : sizeof(uint16_t);
+    char *text, *p, *line_start, tok[24], out[32], ref[32];
+    uint8_t *ref_buf;
+    void *buf=0;
+    int i, len, ok;
+    uint32_t err=0;
+
+    /* longest token, separator and newline of each value */
+    text = pvPortMalloc( CHECK_MKBUF_VALUES * 28 + 3 );
+    ref_buf = pvPortMalloc( CHECK_MKBUF_VALUES * unit );
+    if( !text || !ref_buf )
+    {
+        check_report( float_mode ? "mkbuf -f" : "mkbuf", "malloc failed", "" );
+        err = 1;
+        goto done;
+    }
+    p = line_start = text;
+    for( i=0; i<CHECK_MKBUF_VALUES; i++ )
+    {
+        len = check_mkbuf_token( tok, float_mode );
+        if( float_mode )
+            ((float*)ref_buf)[i] = strtof( tok, 0 );
+        else
+            ((uint16_t*)ref_buf)[i] = strtol( tok, 0, 0 );
+        /* chars over SHELL_CMDLINE_LEN are dropped by the line editor */
+        if( (p > line_start) && ((p - line_start + 2 + len > SHELL_CMDLINE_LEN) || !(check_rand() % 8)) )
+        {
+            p += sprintf( p, (check_rand() & 1) ? "\r\n" : "\n" );
+            line_start = p;
+        }
+        p += sprintf( p, "%s%s", (p > line_start) ? check_mkbuf_seps[check_rand() % 5] : "", tok );
+    }
+    strcpy( p, "\n\n" );  /* empty line ends the input */
+
+    /* the echo would be several times the input */
+    shell_write_add_sink( check_mkbuf_discard, 0, SHELL_WRITE_SINK_EXCLUSIVE );
+    shell_set_script( text, 0 );
+    ok = float_mode ? shell_make_float_data_buffer( &buf, &len ) :
+                      shell_make_16bits_data_buffer( &buf, &len );
+    shell_set_script( "", 0 );  /* rest of a failed upload, text is freed */
+    shell_write_remove_sink( check_mkbuf_discard, 0 );
+    if( !ok || (len != CHECK_MKBUF_VALUES) )
+    {
+        snprintf( out, sizeof(out), "%d values", ok ? len : 0 );
+        snprintf( ref, sizeof(ref), "%d values", CHECK_MKBUF_VALUES );
+        check_report( float_mode ? "mkbuf -f" : "mkbuf", out, ref );
+        err = 1;
+        goto done;
+    }
+    for( i=0; i<CHECK_MKBUF_VALUES; i++ )
+    {
+        if( memcmp( (uint8_t*)buf + i*unit, ref_buf + i*unit, unit ) )
+        {
+            err++;
+            if( float_mode )
+            {
+                snprintf( out, sizeof(out), "%.9g", (double)((float*)buf)[i] );
+                snprintf( ref, sizeof(ref), "%.9g [%d]", (double)((float*)ref_buf)[i], i );
+            }
+            else
+            {
+                snprintf( out, sizeof(out), "%u", ((uint16_t*)buf)[i] );
+                snprintf( ref, sizeof(ref), "%u [%d]", ((uint16_t*)ref_buf)[i], i );
+            }
+            check_report( float_mode ? "mkbuf -f" : "mkbuf", out, ref );
+        }
+    }
+done:
+    if( buf )
+        vPortFree( buf );
+    if( ref_buf )
+        vPortFree( ref_buf );
+    if( text )
+        vPortFree( text );
+    return err;
+}
+
+
+static uint32_t check_mkbuf( uint32_t n )
+{
+    (void)n;
+    return check_mkbuf_mode( 0 ) + check_mkbuf_mode( 1 );
+}
+#endif
+
+
+static const check_case_t check_cases[] = {
+#if USE_SHELL_PRINTF2
+    { "printf_int", check_printf_int },
+    { "printf_float", check_printf_float },
+    { "printf_shortest", check_printf_shortest },
+    { "printf_sink", check_printf_sink },
+#endif
+    { "crc", check_crc },
+    { "base64_enc", check_base64_enc },
+    { "base64_dec", check_base64_dec },
+    { "ringbuf", check_ringbuf },
+    { "opt", check_opt },
+#if CHECK_VCP_TX
+    { "vcp_tx", check_vcp_tx },
+#endif
+#if CHECK_MKBUF_VALUES
+    { "mkbuf", check_mkbuf },
+#endif
+    { 0 } };
+
+
+int cmd_check( int argc, char *argv[] )
+{
+    static const mcush_opt_spec opt_spec[] = {
+        { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED,
+          'l', shell_str_list, 0, "list cases" },
+        { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED,
+          'n', shell_str_number, "rounds", "random rounds of each case" },
+        { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED,
+          's', "seed", "seed", "random seed" },
+        { MCUSH_OPT_ARG, MCUSH_OPT_USAGE_REQUIRED,
+          0, shell_str_name, 0, "case name, all by default" },
+        { MCUSH_OPT_NONE } };
+    mcush_opt_parser parser;
+    mcush_opt opt;
+    const check_case_t *c;
+    const char *select=0;
+    uint8_t list=0;
+    int rounds=CHECK_ROUNDS, seed=CHECK_SEED;
+    uint32_t err, total=0;
+
+    mcush_opt_parser_init( &parser, opt_spec, (const char **)(argv+1), argc-1 );
+    while( mcush_opt_parser_next( &opt, &parser ) )
+    {
+        if( ! opt.spec )
+            STOP_AT_INVALID_ARGUMENT
+        switch( opt.id )
+        {
+        case 'l':
+            list = 1;
+            break;
+        case 'n':
+            if( ! parse_int( opt.value, &rounds ) || (rounds <= 0) )
+                goto usage_error;
+            break;
+        case 's':
+            if( ! parse_int( opt.value, &seed ) || (seed == 0) )
+                goto usage_error;
+            break;
+        default:
+            select = opt.value;
+            break;
+        }
+    }
+
+    for( c=check_cases; c->name; c++ )
+    {
+        if( list )
+            shell_printf( "%s\n", c->name );
+        else if( !select || strcmp( select, c->name ) == 0 )
+        {
+            check_seed = (uint32_t)seed;
+            check_reported = 0;
+            err = c->run( rounds );
+            shell_printf( "%-16s %8d %8u\n", c->name, rounds, (unsigned int)err );
+            total += err;
+        }
+    }
+    return total ? 1 : 0;
+usage_error:
+    mcush_opt_usage_print( argv[0], opt_spec );
+    return -1;
+}
+
+
+static const shell_cmd_t cmd_tab_check[] = {
+    {   0, 0, "check",  cmd_check,
+        "check against references",
+        "check [-l] [-n <rounds>] [-s <seed>] [name]"
+    },
+    {   CMD_END  }
+};
+
+
+void check_init(void)
+{
+    shell_add_cmd_table( cmd_tab_check );
+}
@@ -0,0 +1,12 @@
+#include "mcush.h"
+#include "bench.h"
+
+
+int main(void)
+{
+    mcush_init();
+    bench_init();
+    check_init();
+    mcush_start();
+    while(1);
+}
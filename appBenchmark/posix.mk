@@ -0,0 +1,10 @@
+# MCUSH designed by Peng Shulin, all rights reserved.
+# additions to the host build (halposix/Makefile)
+
+# vcp transmit packing has no usb/freertos dependency, checked on host
+PATHS += $(TOP)/halstm32f4/hal/vcp
+SOURCES += $(TOP)/halstm32f4/hal/vcp/hal_vcp_tx.c
+override DEFINES += CHECK_VCP_TX=1
+
+# large mkbuf upload fed through the script input
+override DEFINES += CHECK_MKBUF_VALUES=100000
@@ -0,0 +1,29 @@
+# Linux/POSIX host, tasks run as threads on the FreeRTOS POSIX port
+# (libFreeRTOS/portable/GCC/POSIX) with heap_3 over the C library malloc,
+# halposix/Makefile does the same build where site_scons is not available
+from Host.Posix import *
+
+env = Posix()
+env.appendDefineFlags( [
+    'MCUSH_NEWLIB_STUB=0',
+    'CONFIG_TICK_RATE_HZ=1000',
+    'CRC_SLICING=4',
+    'BASE64_LUT12=1',
+    ] )
+env.appendLib( ['pthread', 'rt'] )
+
+hal_config.paths += ['.']
+hal_config.sources += ['*.c']
+
+if hal_config.use_spiffs:
+    env.appendDefineFlags( [ 'SPIFLASH_AUTO_DETECT=1' ] )
+    hal_config.paths += ['spiffs']
+    hal_config.sources += ['spiffs/*.c']
+
+if hal_config.use_fatfs:
+    hal_config.paths += ['fatfs']
+    hal_config.sources += ['fatfs/*.c']
+
+if hal_config.use_romfs:
+    # contents come from the MCUSH_ROMFS directory at startup
+    env.appendDefineFlags( [ 'MCUSH_ROMFS_USER=1' ] )
@@ -0,0 +1,122 @@
+/* MCUSH designed by Peng Shulin, all rights reserved. */
+/* fatfs disk on an image file, a new sparse file is created when missing,
+   MCUSH_FATFS_DELAY=<ms> blocks each sector read/write call as a card
+   transfer would */
+#include "mcush.h"
+#if MCUSH_FATFS
+#include "diskio.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifndef HAL_FATFS_SIZE
+    #define HAL_FATFS_SIZE  (64*1024*1024)  /* fat32 needs more than 32M */
+#endif
+
+#define SECTOR_SIZE  512
+
+static int fatfs_fd=-1;
+static int fatfs_delay;
+
+
+void hal_fatfs_init(void)
+{
+    const char *fname = getenv("MCUSH_FATFS");
+    struct stat st;
+
+    if( fatfs_fd >= 0 )
+        return;
+    if( getenv("MCUSH_FATFS_DELAY") )
+        fatfs_delay = atoi( getenv("MCUSH_FATFS_DELAY") );
+    if( !fname )
+        fname = "fatfs.img";
+    fatfs_fd = open( fname, O_RDWR | O_CREAT, 0644 );
+    if( fatfs_fd < 0 )
+        return;
+    if( fstat( fatfs_fd, &st ) || (st.st_size < SECTOR_SIZE) )
+    {
+        if( ftruncate( fatfs_fd, HAL_FATFS_SIZE ) )
+        {
+            close( fatfs_fd );
+            fatfs_fd = -1;
+        }
+    }
+}
+
+
+DWORD get_fattime(void)
+{
+    uint32_t tick;
+    if( get_rtc_tick(&tick) )
+        return (DWORD)tick;
+    else
+        return 0;
+}
+
+
+DSTATUS disk_status( BYTE pdrv )
+{
+    return (pdrv || fatfs_fd < 0) ? STA_NOINIT : 0;
+}
+
+
+DSTATUS disk_initialize( BYTE pdrv )
+{
+    if( pdrv )
+        return STA_NOINIT;
+    hal_fatfs_init();
+    return disk_status( pdrv );
+}
+
+
+DRESULT disk_read( BYTE pdrv, BYTE *buff, DWORD sector, UINT count )
+{
+    if( disk_status( pdrv ) )
+        return RES_NOTRDY;
+    if( pread( fatfs_fd, buff, count * SECTOR_SIZE, (off_t)sector * SECTOR_SIZE ) != (ssize_t)(count * SECTOR_SIZE) )
+        return RES_ERROR;
+    if( fatfs_delay )
+        vTaskDelay( fatfs_delay * configTICK_RATE_HZ / 1000 );
+    return RES_OK;
+}
+
+
+DRESULT disk_write( BYTE pdrv, const BYTE *buff, DWORD sector, UINT count )
+{
+    if( disk_status( pdrv ) )
+        return RES_NOTRDY;
+    if( pwrite( fatfs_fd, buff, count * SECTOR_SIZE, (off_t)sector * SECTOR_SIZE ) != (ssize_t)(count * SECTOR_SIZE) )
+        return RES_ERROR;
+    if( fatfs_delay )
+        vTaskDelay( fatfs_delay * configTICK_RATE_HZ / 1000 );
+    return RES_OK;
+}
+
+
+DRESULT disk_ioctl( BYTE pdrv, BYTE cmd, void *buff )
+{
+    struct stat st;
+
+    if( disk_status( pdrv ) )
+        return RES_NOTRDY;
+    switch( cmd )
+    {
+    case CTRL_SYNC:
+        return fsync( fatfs_fd ) ? RES_ERROR : RES_OK;
+    case GET_SECTOR_COUNT:
+        if( fstat( fatfs_fd, &st ) )
+            return RES_ERROR;
+        *(DWORD*)buff = st.st_size / SECTOR_SIZE;
+        return RES_OK;
+    case GET_SECTOR_SIZE:
+        *(WORD*)buff = SECTOR_SIZE;
+        return RES_OK;
+    case GET_BLOCK_SIZE:
+        *(DWORD*)buff = 1;
+        return RES_OK;
+    default:
+        return RES_PARERR;
+    }
+}
+
+#endif
@@ -0,0 +1,141 @@
+/* MCUSH designed by Peng Shulin, all rights reserved. */
+/* Linux/POSIX host HAL, tasks run on the FreeRTOS POSIX port
+ *
+ * environment variables:
+ *   MCUSH_PTY=1           shell on a new pseudo terminal (name printed on
+ *                         stderr) instead of stdin/stdout
+ *   MCUSH_PTY=n           n terminals, the others run shell sessions of
+ *                         their own (up to 1+HAL_UART_SESSION_NUM)
+ *   MCUSH_SPIFLASH=file   spi flash image for spiffs (default spiflash.img)
+ *   MCUSH_FATFS=file      disk image for fatfs (default fatfs.img)
+ *   MCUSH_ROMFS=dir       files loaded into romfs (default romfs), needs
+ *                         MCUSH_ROMFS_USER=1
+ */
+#include "mcush.h"
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/time.h>
+
+uint32_t SystemCoreClock = 1000000000;
+
+/* no init script */
+char _isdata = 0;
+
+
+void hal_clk_init(void)
+{
+}
+
+
+void hal_platform_init(void)
+{
+#if MCUSH_ROMFS && MCUSH_ROMFS_USER
+    hal_romfs_init();
+#endif
+}
+
+
+void hal_platform_reset(void)
+{
+}
+
+
+int hal_init(void)
+{
+    hal_clk_init();
+    hal_wdg_init();
+    hal_gpio_init();
+    hal_led_init();
+    hal_platform_init();
+    if( !hal_uart_init(0) )
+        return 0;
+    return 1;
+}
+
+
+static uint64_t hal_clock_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+uint32_t hal_counter_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+
+/* busy waiting as the target does, not a task delay */
+void hal_delay_us(uint32_t us)
+{
+    uint64_t t = hal_clock_us() + us;
+
+    while( hal_clock_us() < t )
+        ;
+}
+
+
+void hal_delay_ms(uint32_t ms)
+{
+    hal_delay_us( ms * 1000 );
+}
+
+
+void hal_delay_10ms(uint32_t ms10)
+{
+    hal_delay_ms( 10 * ms10 );
+}
+
+
+/* restart the process with the same arguments */
+void hal_reboot(void)
+{
+    static char cmdline[1024];
+    char *argv[32];
+    struct itimerval itv = { { 0, 0 }, { 0, 0 } };
+    int fd, len, i, argc=0;
+
+    setitimer( ITIMER_REAL, &itv, NULL );
+    hal_uart_enable( 0 );
+    fd = open( "/proc/self/cmdline", O_RDONLY );
+    len = fd < 0 ? -1 : read( fd, cmdline, sizeof(cmdline) - 1 );
+    if( len > 0 )
+    {
+        cmdline[len] = 0;
+        for( i=0; (i<len) && (argc<31); i+=strlen(cmdline+i)+1 )
+            argv[argc++] = cmdline + i;
+        argv[argc] = 0;
+        execv( "/proc/self/exe", argv );
+    }
+    _exit( 1 );
+}
+
+
+int hal_get_serial_number( char *buf )
+{
+    sprintf( buf, "%08lX", (unsigned long)gethostid() & 0xFFFFFFFFUL );
+    return 1;
+}
+
+
+void _halt(void)
+{
+    hal_uart_enable( 0 );
+    fprintf( stderr, "\nhalt\n" );
+    _exit( 1 );
+}
+
+
+void _halt_with_message(const char *message)
+{
+    hal_uart_enable( 0 );
+    fprintf( stderr, "\nhalt: %s\n", message );
+    _exit( 1 );
+}
@@ -0,0 +1,61 @@
+#ifndef __HAL_H__
+#define __HAL_H__
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern uint32_t SystemCoreClock;
+
+void hal_clk_init(void);
+
+void hal_led_init(void);
+int hal_led_get_num(void);
+void hal_led_set(int index);
+void hal_led_clr(int index);
+void hal_led_toggle(int index);
+int hal_led_get(int index);
+
+int hal_key_get_num(void);
+int hal_key_get(int mask);
+
+void hal_delay_us(uint32_t us);
+void hal_delay_ms(uint32_t ms);
+void hal_delay_10ms(uint32_t ms10);
+
+void hal_reboot(void);
+
+int hal_gpio_get_port_num(void);
+void hal_gpio_init(void);
+void hal_gpio_set_input(int port, int bits);
+void hal_gpio_set_input_pull(int port, int bits, int pull);
+void hal_gpio_set_output(int port, int bits);
+void hal_gpio_set_output_open_drain(int port, int bits);
+void hal_gpio_set(int port, int bits);
+void hal_gpio_clr(int port, int bits);
+void hal_gpio_toggle(int port, int bits);
+int hal_gpio_get(int port, int bits);
+
+int hal_uart_init(uint32_t baudrate);
+void hal_uart_enable(uint8_t enable);
+void hal_uart_reset(void);
+
+void hal_wdg_init(void);
+int hal_wdg_is_enable(void);
+void hal_wdg_enable(void);
+void hal_wdg_disable(void);
+void hal_wdg_clear(void);
+
+int hal_init(void);
+int hal_get_serial_number( char *buf );
+void hal_platform_reset(void);
+void hal_platform_init(void);
+void hal_romfs_init(void);
+#include "hal_platform.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,72 @@
+/* MCUSH designed by Peng Shulin, all rights reserved. */
+#include "hal.h"
+
+/* virtual ports, outputs read back what is written, inputs read
+   the pull level (pull-up as 1) */
+static uint32_t gpio_odr[HAL_GPIO_PORT_NUM];
+static uint32_t gpio_output[HAL_GPIO_PORT_NUM];
+static uint32_t gpio_pullup[HAL_GPIO_PORT_NUM];
+
+
+int hal_gpio_get_port_num(void)
+{
+    return HAL_GPIO_PORT_NUM;
+}
+
+
+void hal_gpio_init(void)
+{
+}
+
+
+void hal_gpio_set_input(int port, int bits)
+{
+    gpio_output[port] &= ~bits;
+    gpio_pullup[port] &= ~bits;
+}
+
+
+void hal_gpio_set_input_pull(int port, int bits, int pull)
+{
+    gpio_output[port] &= ~bits;
+    if( pull > 0 )
+        gpio_pullup[port] |= bits;
+    else
+        gpio_pullup[port] &= ~bits;
+}
+
+
+void hal_gpio_set_output(int port, int bits)
+{
+    gpio_output[port] |= bits;
+}
+
+
+void hal_gpio_set_output_open_drain(int port, int bits)
+{
+    gpio_output[port] |= bits;
+}
+
+
+void hal_gpio_set(int port, int bits)
+{
+    gpio_odr[port] |= bits;
+}
+
+
+void hal_gpio_clr(int port, int bits)
+{
+    gpio_odr[port] &= ~bits;
+}
+
+
+void hal_gpio_toggle(int port, int bits)
+{
+    gpio_odr[port] ^= bits;
+}
+
+
+int hal_gpio_get(int port, int bits)
+{
+    return ((gpio_odr[port] & gpio_output[port]) | (gpio_pullup[port] & ~gpio_output[port])) & bits;
+}
@@ -0,0 +1,39 @@
+/* MCUSH designed by Peng Shulin, all rights reserved. */
+#include "hal.h"
+
+static uint8_t led_state[HAL_LED_NUM];
+
+
+void hal_led_init(void)
+{
+}
+
+
+int hal_led_get_num(void)
+{
+    return HAL_LED_NUM;
+}
+
+
+void hal_led_set(int index)
+{
+    led_state[index] = 1;
+}
+
+
+void hal_led_clr(int index)
+{
+    led_state[index] = 0;
+}
+
+
+void hal_led_toggle(int index)
+{
+    led_state[index] ^= 1;
+}
+
+
+int hal_led_get(int index)
+{
+    return led_state[index];
+}
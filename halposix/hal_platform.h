@@ -0,0 +1,83 @@
+#ifndef __HAL_PLATFORM_H__
+#define __HAL_PLATFORM_H__
+
+/* Linux/POSIX host, see hal.c for the runtime environment variables */
+
+#define HAL_LED_NUM   4
+#define HAL_GPIO_PORT_NUM  4
+
+/* no such peripherals on host */
+#ifndef USE_CMD_SGPIO
+#define USE_CMD_SGPIO  0
+#endif
+#ifndef USE_CMD_PWM
+#define USE_CMD_PWM  0
+#endif
+#ifndef USE_CMD_ADC
+#define USE_CMD_ADC  0
+#endif
+#ifndef USE_CMD_BEEP
+#define USE_CMD_BEEP  0
+#endif
+#ifndef USE_CMD_SYSTEM_HEAP
+#define USE_CMD_SYSTEM_HEAP  0  /* no linker symbols */
+#endif
+#ifndef USE_CMD_SYSTEM_STACK
+#define USE_CMD_SYSTEM_STACK  0
+#endif
+#ifndef USE_CMD_FATFS
+#define USE_CMD_FATFS  0  /* sd card specific */
+#endif
+#ifndef USE_CMD_UPGRADE
+#define USE_CMD_UPGRADE  0
+#endif
+#ifndef USE_CMD_CRC
+#define USE_CMD_CRC  1
+#endif
+#ifndef USE_SHELL_WRITE_REDIRECT
+#define USE_SHELL_WRITE_REDIRECT  1
+#endif
+#ifndef USE_SHELL_JOB
+#define USE_SHELL_JOB  1
+#endif
+#ifndef SHELL_JOB_NUM
+#define SHELL_JOB_NUM  4
+#endif
+/* shells on the terminals after the first one (MCUSH_PTY=n), see hal_uart.c */
+#ifndef HAL_UART_SESSION_NUM
+#define HAL_UART_SESSION_NUM  1
+#endif
+#ifndef SHELL_SESSION_NUM
+#define SHELL_SESSION_NUM  (1+SHELL_JOB_NUM+HAL_UART_SESSION_NUM)
+#endif
+
+/* file backed spi flash, reported as W25Q32 */
+#define HAL_SPIFLASH_ID    0xEF4016
+#define HAL_SPIFLASH_SIZE  (4*1024*1024)
+
+/* free-running nanosecond counter for timing */
+uint32_t hal_counter_ns(void);
+#define BENCH_COUNTER()     hal_counter_ns()
+#define BENCH_COUNTER_HZ    1000000000
+#ifndef MCUSH_VFS_PROFILER_COUNTER
+#define MCUSH_VFS_PROFILER_COUNTER()     hal_counter_ns()
+#define MCUSH_VFS_PROFILER_COUNTER_HZ    1000000000
+#define MCUSH_VFS_PROFILER_BUCKETS       24  /* up to 16 ms */
+#endif
+#ifndef MCUSH_VFS_CACHE
+#define MCUSH_VFS_CACHE  1
+#endif
+#ifndef MCUSH_VFS_LOCK
+#define MCUSH_VFS_LOCK  1
+#endif
+#ifndef MCUSH_VFS_AIO
+#define MCUSH_VFS_AIO  1  /* against the slow drivers, see MCUSH_xxx_DELAY */
+#endif
+#ifndef MCUSH_VFS_AIO_COUNTER
+#define MCUSH_VFS_AIO_COUNTER()     hal_counter_ns()
+#define MCUSH_VFS_AIO_COUNTER_HZ    1000000000
+#endif
+
+#include "mcush_vfs.h"
+
+#endif
@@ -0,0 +1,59 @@
+/* MCUSH designed by Peng Shulin, all rights reserved. */
+/* romfs contents loaded from a host directory at startup,
+   applications defining their own romfs_tab override this one */
+#include "mcush.h"
+#if MCUSH_ROMFS && MCUSH_ROMFS_USER
+#include <unistd.h>
+#include <fcntl.h>
+#include <glob.h>  /* dirent.h conflicts with fatfs DIR */
+#include <sys/stat.h>
+
+#ifndef HAL_ROMFS_FILES_MAX
+    #define HAL_ROMFS_FILES_MAX  32
+#endif
+
+__attribute__((weak))
+romfs_file_t romfs_tab[HAL_ROMFS_FILES_MAX+1];
+
+
+void hal_romfs_init(void)
+{
+    const char *dname = getenv("MCUSH_ROMFS");
+    char pattern[256];
+    struct stat st;
+    char *name, *buf;
+    glob_t g;
+    int i=0, fd, len;
+    size_t j;
+
+    if( romfs_tab[0].name )
+        return;  /* user table, or loaded */
+    if( !dname )
+        dname = "romfs";
+    snprintf( pattern, sizeof(pattern), "%s/*", dname );
+    if( glob( pattern, 0, NULL, &g ) )
+        return;
+    for( j=0; (j < g.gl_pathc) && (i < HAL_ROMFS_FILES_MAX); j++ )
+    {
+        if( stat( g.gl_pathv[j], &st ) || !S_ISREG(st.st_mode) )
+            continue;
+        fd = open( g.gl_pathv[j], O_RDONLY );
+        if( fd < 0 )
+            continue;
+        name = strdup( strrchr( g.gl_pathv[j], '/' ) + 1 );
+        buf = malloc( st.st_size + 1 );
+        len = (name && buf) ? read( fd, buf, st.st_size ) : -1;
+        close( fd );
+        if( len < 0 )
+        {
+            free( name );
+            free( buf );
+            continue;
+        }
+        /* entries are read-only once filled */
+        memcpy( &romfs_tab[i++], &(romfs_file_t){ name, buf, len }, sizeof(romfs_file_t) );
+    }
+    globfree( &g );
+}
+
+#endif
@@ -0,0 +1,442 @@
+/* MCUSH designed by Peng Shulin, all rights reserved. */
+/* shell driver on stdin/stdout, or on a new pseudo terminal (MCUSH_PTY=1)
+   the input is read by the simulated interrupt into a ring buffer as the
+   target uart does, a host thread only watches the descriptor and raises
+   the interrupt, so nothing else is touched outside of the scheduler
+   MCUSH_PTY=n opens n terminals, the ones after the first are served by
+   shell sessions of their own, as a board with a shell on each port */
+#define _GNU_SOURCE  /* pty api */
+#include "mcush.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <signal.h>
+#include <termios.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#ifndef HAL_UART_RX_BUF_SIZE
+    #define HAL_UART_RX_BUF_SIZE  4096  /* power of 2 */
+#endif
+
+#ifndef HAL_UART_FEED_BUF_SIZE
+    #define HAL_UART_FEED_BUF_SIZE  256  /* power of 2 */
+#endif
+
+#define HAL_UART_CHAN_NUM  (1+HAL_UART_SESSION_NUM)
+
+typedef struct {
+    int fd_in, fd_out;
+    volatile uint8_t eof;
+    volatile uint8_t hangup;  /* extra terminal without client */
+    volatile uint8_t raised;  /* by the watch thread, not serviced */
+    uint8_t rx_buf[HAL_UART_RX_BUF_SIZE];
+    ringbuf_t rx_ring;
+    SemaphoreHandle_t rx_sem;
+    sem_t rx_done;  /* descriptor drained by isr */
+} hal_uart_chan_t;
+
+static hal_uart_chan_t hal_uart_chan[HAL_UART_CHAN_NUM];
+static int hal_uart_chan_num;
+static struct termios hal_uart_termios;
+static uint8_t hal_uart_termios_saved;
+static uint8_t hal_uart_feed_buf[HAL_UART_FEED_BUF_SIZE];
+static ringbuf_t hal_uart_feed_ring;
+
+
+static int hal_uart_readable( hal_uart_chan_t *ch )
+{
+    struct pollfd pfd = { ch->fd_in, POLLIN, 0 };
+
+    return poll( &pfd, 1, 0 ) > 0;
+}
+
+
+/* interrupt context, called on each tick and when input arrives */
+static void hal_uart_isr( void )
+{
+    portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+    hal_uart_chan_t *ch;
+    uint8_t *p;
+    uint32_t l;
+    int i, n, got;
+
+    for( i=0; i<hal_uart_chan_num; i++ )
+    {
+        ch = &hal_uart_chan[i];
+        got = 0;
+        while( !ch->eof && !ch->hangup && hal_uart_readable( ch ) )
+        {
+            l = ringbuf_free( &ch->rx_ring );
+            if( !l )
+                break;  /* retry on next tick */
+            p = ch->rx_buf + (ch->rx_ring.head & (HAL_UART_RX_BUF_SIZE - 1));
+            if( l > HAL_UART_RX_BUF_SIZE - (ch->rx_ring.head & (HAL_UART_RX_BUF_SIZE - 1)) )
+                l = HAL_UART_RX_BUF_SIZE - (ch->rx_ring.head & (HAL_UART_RX_BUF_SIZE - 1));
+            n = read( ch->fd_in, p, l );
+            if( n > 0 )
+            {
+                ch->rx_ring.head += n;
+                got = 1;
+            }
+            else if( (n == 0) || (errno != EINTR && errno != EAGAIN) )
+            {
+                /* closed slave side of an extra terminal, wait for next */
+                if( i )
+                    ch->hangup = 1;
+                else
+                {
+                    ch->eof = 1;
+                    got = 1;
+                }
+            }
+        }
+        if( ch->raised && (ch->eof || ch->hangup || !hal_uart_readable( ch )) )
+        {
+            ch->raised = 0;
+            sem_post( &ch->rx_done );
+        }
+        if( got )
+            xSemaphoreGiveFromISR( ch->rx_sem, &xHigherPriorityTaskWoken );
+    }
+    portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
+
+
+/* host thread, never runs any task code */
+static void *hal_uart_watch( void *arg )
+{
+    hal_uart_chan_t *ch = (hal_uart_chan_t*)arg;
+    struct pollfd pfd = { ch->fd_in, POLLIN, 0 };
+
+    while( !ch->eof )
+    {
+        if( ch->hangup )
+        {
+            usleep( 50000 );  /* poll returns at once until reopened */
+            ch->hangup = 0;
+        }
+        if( poll( &pfd, 1, -1 ) <= 0 )
+            continue;
+        ch->raised = 1;
+        vPortGenerateInterrupt();
+        while( sem_wait( &ch->rx_done ) != 0 )
+            ;
+    }
+    return NULL;
+}
+
+
+static void hal_uart_restore( void )
+{
+    if( hal_uart_termios_saved )
+        tcsetattr( hal_uart_chan[0].fd_in, TCSANOW, &hal_uart_termios );
+}
+
+
+static void hal_uart_quit( int sig )
+{
+    hal_uart_restore();
+    _exit( 128 + sig );
+}
+
+
+static int hal_uart_open_pty( hal_uart_chan_t *ch )
+{
+    struct termios t;
+
+    ch->fd_in = posix_openpt( O_RDWR | O_NOCTTY );
+    if( (ch->fd_in < 0) || grantpt( ch->fd_in ) || unlockpt( ch->fd_in ) )
+        return 0;
+    ch->fd_out = ch->fd_in;
+    /* line discipline works on the slave side, disable it */
+    tcgetattr( ch->fd_in, &t );
+    cfmakeraw( &t );
+    tcsetattr( ch->fd_in, TCSANOW, &t );
+    fprintf( stderr, "mcush: %s\n", ptsname( ch->fd_in ) );
+    return 1;
+}
+
+
+static int hal_uart_chan_init( hal_uart_chan_t *ch )
+{
+    ringbuf_init( &ch->rx_ring, ch->rx_buf, HAL_UART_RX_BUF_SIZE );
+    ch->rx_sem = xSemaphoreCreateBinary();
+    if( !ch->rx_sem )
+        return 0;
+    sem_init( &ch->rx_done, 0, 0 );
+    return 1;
+}
+
+
+#if HAL_UART_SESSION_NUM
+static int hal_uart_read( int chan, char *buf, int len, TickType_t xBlockTime );
+static int hal_uart_write( int chan, const char *buf, int len );
+
+/* driver ops of the extra terminals, the session does not pass its index */
+#define HAL_UART_SESSION_OPS( i ) \
+    static int hal_uart_session_init##i( void ) { return 1; } \
+    static void hal_uart_session_reset##i( void ) \
+    { \
+        portENTER_CRITICAL(); \
+        hal_uart_chan[i].rx_ring.tail = hal_uart_chan[i].rx_ring.head; \
+        portEXIT_CRITICAL(); \
+    } \
+    static int hal_uart_session_read_char_blocked##i( char *c, int block_time ) \
+    { \
+        return hal_uart_read( i, c, 1, block_time ) ? (int)(uint8_t)*c : -1; \
+    } \
+    static int hal_uart_session_read_char##i( char *c ) \
+    { \
+        return hal_uart_session_read_char_blocked##i( c, portMAX_DELAY ); \
+    } \
+    static int hal_uart_session_write##i( const char *buf, int len ) \
+    { \
+        return hal_uart_write( i, buf, len ); \
+    } \
+    static void hal_uart_session_write_char##i( char c ) \
+    { \
+        hal_uart_write( i, &c, 1 ); \
+    } \
+    static const shell_driver_ops_t hal_uart_session_ops##i = { \
+        hal_uart_session_init##i, hal_uart_session_reset##i, \
+        hal_uart_session_read_char##i, hal_uart_session_read_char_blocked##i, \
+        hal_uart_session_write##i, hal_uart_session_write_char##i };
+
+HAL_UART_SESSION_OPS( 1 )
+#if HAL_UART_SESSION_NUM > 1
+HAL_UART_SESSION_OPS( 2 )
+#endif
+#if HAL_UART_SESSION_NUM > 2
+HAL_UART_SESSION_OPS( 3 )
+#endif
+#if HAL_UART_SESSION_NUM > 3
+    #error "HAL_UART_SESSION_NUM up to 3"
+#endif
+
+static const shell_driver_ops_t * const hal_uart_session_ops[] = {
+    &hal_uart_session_ops1,
+#if HAL_UART_SESSION_NUM > 1
+    &hal_uart_session_ops2,
+#endif
+#if HAL_UART_SESSION_NUM > 2
+    &hal_uart_session_ops3,
+#endif
+};
+
+
+static void hal_uart_session_entry( void *p )
+{
+    shell_session_run( (const shell_driver_ops_t*)p, 0 );
+    halt("uart session");
+}
+#endif
+
+
+int hal_uart_init( uint32_t baudrate )
+{
+    const char *env = getenv( "MCUSH_PTY" );
+    hal_uart_chan_t *ch = &hal_uart_chan[0];
+    struct termios t;
+    pthread_t thread;
+    sigset_t all, old;
+    int i, ptys = env ? atoi(env) : 0;
+
+    ringbuf_init( &hal_uart_feed_ring, hal_uart_feed_buf, HAL_UART_FEED_BUF_SIZE );
+    if( ptys > HAL_UART_CHAN_NUM )
+        ptys = HAL_UART_CHAN_NUM;
+    hal_uart_chan_num = ptys ? ptys : 1;
+    for( i=0; i<hal_uart_chan_num; i++ )
+    {
+        if( ! hal_uart_chan_init( &hal_uart_chan[i] ) )
+            return 0;
+        if( ptys && ! hal_uart_open_pty( &hal_uart_chan[i] ) )
+            return 0;
+    }
+
+    if( ! ptys )
+    {
+        ch->fd_in = 0;
+        ch->fd_out = 1;
+        if( isatty( ch->fd_in ) && (tcgetattr( ch->fd_in, &hal_uart_termios ) == 0) )
+        {
+            /* characters go to the shell as they are typed, Ctrl-C included,
+               Ctrl-\ quits */
+            t = hal_uart_termios;
+            t.c_iflag &= ~(IXON | INLCR);  /* keep ICRNL, shell ends line with \n */
+            t.c_lflag &= ~(ICANON | ECHO | IEXTEN);
+            t.c_cc[VINTR] = _POSIX_VDISABLE;
+            t.c_cc[VSUSP] = _POSIX_VDISABLE;
+            t.c_cc[VMIN] = 1;
+            t.c_cc[VTIME] = 0;
+            tcsetattr( ch->fd_in, TCSANOW, &t );
+            hal_uart_termios_saved = 1;
+            atexit( hal_uart_restore );
+        }
+    }
+    signal( SIGQUIT, hal_uart_quit );
+    signal( SIGTERM, hal_uart_quit );
+    signal( SIGHUP, hal_uart_quit );
+
+    vPortSetInterruptHandler( hal_uart_isr );
+    sigfillset( &all );
+    pthread_sigmask( SIG_SETMASK, &all, &old );
+    for( i=0; i<hal_uart_chan_num; i++ )
+    {
+        if( pthread_create( &thread, NULL, hal_uart_watch, &hal_uart_chan[i] ) != 0 )
+            return 0;
+    }
+    pthread_sigmask( SIG_SETMASK, &old, NULL );
+
+#if HAL_UART_SESSION_NUM
+    for( i=1; i<hal_uart_chan_num; i++ )
+    {
+        if( xTaskCreate( hal_uart_session_entry, (const char *)"uartS",
+                         MCUSH_STACK_SIZE / sizeof(portSTACK_TYPE),
+                         (void*)hal_uart_session_ops[i-1], MCUSH_PRIORITY, NULL ) != pdPASS )
+            return 0;
+    }
+#endif
+    return 1;
+}
+
+
+/* restore terminal when disabled (halt/reboot) */
+void hal_uart_enable( uint8_t enable )
+{
+    if( !enable )
+        hal_uart_restore();
+}
+
+
+void hal_uart_reset( void )
+{
+    portENTER_CRITICAL();
+    hal_uart_chan[0].rx_ring.tail = hal_uart_chan[0].rx_ring.head;
+    hal_uart_feed_ring.tail = hal_uart_feed_ring.head;
+    portEXIT_CRITICAL();
+}
+
+
+/* returns bytes read, wait only if nothing available,
+   exits when input is closed and all has been read (scripted run),
+   polling reads just time out so running commands can finish */
+static int hal_uart_read( int chan, char *buf, int len, TickType_t xBlockTime )
+{
+    hal_uart_chan_t *ch = &hal_uart_chan[chan];
+    int r;
+
+    while( 1 )
+    {
+        r = chan ? 0 : ringbuf_get( &hal_uart_feed_ring, buf, len );
+        if( ! r )
+            r = ringbuf_get( &ch->rx_ring, buf, len );
+        if( r || ! len )
+            return r;
+        if( ch->eof )
+        {
+            if( xBlockTime == portMAX_DELAY )
+                exit( 0 );
+            return 0;
+        }
+        if( xSemaphoreTake( ch->rx_sem, xBlockTime ) != pdPASS )
+            return 0;
+    }
+}
+
+
+static int hal_uart_write( int chan, const char *buf, int len )
+{
+    hal_uart_chan_t *ch = &hal_uart_chan[chan];
+    int written=0, r;
+
+    while( written < len )
+    {
+        /* a blocking write is still preempted by ticks */
+        r = write( ch->fd_out, buf + written, len - written );
+        if( r > 0 )
+            written += r;
+        else if( (r < 0) && (errno != EINTR) && (errno != EAGAIN) )
+            return len;  /* output closed, dropped */
+    }
+    return written;
+}
+
+
+/****************************************************************************/
+/* shell APIs                                                               */
+/****************************************************************************/
+
+int shell_driver_init( void )
+{
+    return 1;  /* already inited */
+}
+
+
+void shell_driver_reset( void )
+{
+    hal_uart_reset();
+}
+
+
+int  shell_driver_read_feed( char *buffer, int len )
+{
+    int bytes=0;
+
+    while( bytes < len )
+    {
+        bytes += ringbuf_put( &hal_uart_feed_ring, buffer + bytes, len - bytes );
+        xSemaphoreGive( hal_uart_chan[0].rx_sem );
+        if( bytes < len )
+            vTaskDelay(1);
+    }
+    return bytes;
+}
+
+
+int  shell_driver_read( char *buffer, int len )
+{
+    return hal_uart_read( 0, buffer, len, 0 );
+}
+
+
+int  shell_driver_read_char( char *c )
+{
+    if( hal_uart_read( 0, c, 1, portMAX_DELAY ) == 0 )
+        return -1;
+    else
+        return (int)(uint8_t)*c;  /* -1 is timeout, binary data uses 0xFF */
+}
+
+
+int  shell_driver_read_char_blocked( char *c, int block_time )
+{
+    if( hal_uart_read( 0, c, 1, block_time ) == 0 )
+        return -1;
+    else
+        return (int)(uint8_t)*c;
+}
+
+
+int  shell_driver_read_is_empty( void )
+{
+    return ringbuf_len( &hal_uart_feed_ring ) == 0 && ringbuf_len( &hal_uart_chan[0].rx_ring ) == 0;
+}
+
+
+int  shell_driver_write( const char *buffer, int len )
+{
+    return hal_uart_write( 0, buffer, len );
+}
+
+
+void shell_driver_write_char( char c )
+{
+    hal_uart_write( 0, &c, 1 );
+}
+
+
+void shell_driver_write_flush( void )
+{
+}
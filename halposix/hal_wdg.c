@@ -0,0 +1,27 @@
+/* MCUSH designed by Peng Shulin, all rights reserved. */
+#include "hal.h"
+
+static char _wdg_enable=0;
+
+void hal_wdg_init(void)
+{
+}
+
+int hal_wdg_is_enable(void)
+{
+    return _wdg_enable;
+}
+
+void hal_wdg_enable(void)
+{
+    _wdg_enable = 1;
+}
+
+void hal_wdg_disable(void)
+{
+    _wdg_enable = 0;
+}
+
+void hal_wdg_clear(void)
+{
+}
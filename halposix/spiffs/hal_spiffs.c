@@ -0,0 +1,148 @@
+/* MCUSH designed by Peng Shulin, all rights reserved. */
+/* spi flash emulated by a file mapped into memory,
+   programming only clears bits and erasing sets them as nor flash does,
+   MCUSH_SPIFLASH_DELAY=<ms> blocks each program/erase call as a driver
+   waiting for the busy flag would */
+#include "hal.h"
+#include "spi_flash.h"
+#include "mcush.h"
+#include "mcush_vfs.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#if MCUSH_SPIFFS
+
+static uint8_t *spiflash;
+static int spiflash_locked;
+static int spiflash_delay;
+
+
+static void spiflash_program(uint32_t addr, const uint8_t *src, uint32_t size)
+{
+    uint8_t *p = spiflash + addr;
+
+    if( spiflash_locked || (addr + size > HAL_SPIFLASH_SIZE) )
+        return;
+    while( size-- )
+        *p++ &= *src++;
+}
+
+
+static void spiflash_erase(uint32_t addr, uint32_t size)
+{
+    if( spiflash_locked || (addr + size > HAL_SPIFLASH_SIZE) )
+        return;
+    memset( spiflash + addr, 0xFF, size );
+}
+
+
+void sFLASH_EraseSector(uint32_t SectorAddr)
+{
+    spiflash_erase( SectorAddr & ~(sFLASH_SPI_SECTORSIZE-1), sFLASH_SPI_SECTORSIZE );
+}
+
+
+void sFLASH_EraseBulk(void)
+{
+    spiflash_erase( 0, HAL_SPIFLASH_SIZE );
+}
+
+
+/* wraps within the page as the chip does */
+void sFLASH_WritePage(uint8_t* pBuffer, uint32_t WriteAddr, uint16_t NumByteToWrite)
+{
+    uint32_t page = WriteAddr & ~(sFLASH_SPI_PAGESIZE-1);
+
+    while( NumByteToWrite-- )
+    {
+        spiflash_program( page + (WriteAddr++ & (sFLASH_SPI_PAGESIZE-1)), pBuffer++, 1 );
+    }
+}
+
+
+void sFLASH_WriteBuffer(uint8_t* pBuffer, uint32_t WriteAddr, uint16_t NumByteToWrite)
+{
+    spiflash_program( WriteAddr, pBuffer, NumByteToWrite );
+}
+
+
+void sFLASH_ReadBuffer(uint8_t* pBuffer, uint32_t ReadAddr, uint16_t NumByteToRead)
+{
+    if( ReadAddr + NumByteToRead <= HAL_SPIFLASH_SIZE )
+        memcpy( pBuffer, spiflash + ReadAddr, NumByteToRead );
+}
+
+
+uint32_t sFLASH_ReadID(void)
+{
+    return HAL_SPIFLASH_ID;
+}
+
+
+void hal_spiffs_flash_init(void)
+{
+    const char *fname = getenv("MCUSH_SPIFLASH");
+    struct stat st;
+    int fd, blank;
+
+    if( spiflash )
+        return;
+    if( getenv("MCUSH_SPIFLASH_DELAY") )
+        spiflash_delay = atoi( getenv("MCUSH_SPIFLASH_DELAY") );
+    if( !fname )
+        fname = "spiflash.img";
+    fd = open( fname, O_RDWR | O_CREAT, 0644 );
+    if( fd < 0 )
+        halt("spiflash open");
+    blank = fstat( fd, &st ) || (st.st_size != HAL_SPIFLASH_SIZE);
+    if( blank && ftruncate( fd, HAL_SPIFLASH_SIZE ) )
+        halt("spiflash size");
+    spiflash = mmap( 0, HAL_SPIFLASH_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    close( fd );
+    if( spiflash == MAP_FAILED )
+        halt("spiflash mmap");
+    if( blank )
+        memset( spiflash, 0xFF, HAL_SPIFLASH_SIZE );
+}
+
+
+int hal_spiffs_flash_read_id(void)
+{
+    return (int)sFLASH_ReadID();
+}
+
+
+void hal_spiffs_flash_lock(int lock)
+{
+    spiflash_locked = lock;
+}
+
+
+s32_t *hal_spiffs_flash_read(u32_t addr, u32_t size, u8_t *dst)
+{
+    if( addr + size <= HAL_SPIFLASH_SIZE )
+        memcpy( dst, spiflash + addr, size );
+    return SPIFFS_OK;
+}
+
+
+s32_t *hal_spiffs_flash_write(u32_t addr, u32_t size, u8_t *src)
+{
+    spiflash_program( addr, src, size );
+    if( spiflash_delay )
+        vTaskDelay( spiflash_delay * configTICK_RATE_HZ / 1000 );
+    return SPIFFS_OK;
+}
+
+
+s32_t *hal_spiffs_flash_erase(u32_t addr, u32_t size)
+{
+    spiflash_erase( addr, size );
+    if( spiflash_delay )
+        vTaskDelay( spiflash_delay * configTICK_RATE_HZ / 1000 );
+    return SPIFFS_OK;
+}
+
+
+#endif
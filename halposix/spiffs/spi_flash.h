@@ -0,0 +1,17 @@
+/* MCUSH designed by Peng Shulin, all rights reserved. */
+#ifndef __SPI_FLASH_H
+#define __SPI_FLASH_H
+#include <stdint.h>
+
+/* same low level api as the target drivers, on the image file */
+#define sFLASH_SPI_PAGESIZE       0x100
+#define sFLASH_SPI_SECTORSIZE     0x10000
+
+void sFLASH_EraseSector(uint32_t SectorAddr);
+void sFLASH_EraseBulk(void);
+void sFLASH_WritePage(uint8_t* pBuffer, uint32_t WriteAddr, uint16_t NumByteToWrite);
+void sFLASH_WriteBuffer(uint8_t* pBuffer, uint32_t WriteAddr, uint16_t NumByteToWrite);
+void sFLASH_ReadBuffer(uint8_t* pBuffer, uint32_t ReadAddr, uint16_t NumByteToRead);
+uint32_t sFLASH_ReadID(void);
+
+#endif
@@ -35,6 +35,24 @@
     #define HAL_UART_QUEUE_RX_LEN           128
     #define HAL_UART_QUEUE_TX_LEN           128
     #define HAL_UART_QUEUE_ADD_TO_REG       1
+    #define HAL_UART_DMA                    1
+    #define HAL_UART_RCC_DMA_ENABLE_CMD     LL_AHB1_GRP1_EnableClock
+    #define HAL_UART_RCC_DMA_ENABLE_BIT     LL_AHB1_GRP1_PERIPH_DMA2
+    #define HAL_UARTx_DMA                   DMA2
+    #define HAL_UARTx_DMA_CHANNEL           LL_DMA_CHANNEL_4
+    #define HAL_UARTx_DMA_RX_STREAM         LL_DMA_STREAM_2
+    #define HAL_UARTx_DMA_RX_IRQn           DMA2_Stream2_IRQn
+    #define HAL_UARTx_DMA_RX_IRQHandler     DMA2_Stream2_IRQHandler
+    #define HAL_UARTx_DMA_RX_CLEAR_FLAGS()  do { LL_DMA_ClearFlag_HT2(DMA2); LL_DMA_ClearFlag_TC2(DMA2); \
+                                                 LL_DMA_ClearFlag_TE2(DMA2); LL_DMA_ClearFlag_FE2(DMA2); \
+                                                 LL_DMA_ClearFlag_DME2(DMA2); } while(0)
+    #define HAL_UARTx_DMA_TX_STREAM         LL_DMA_STREAM_7
+    #define HAL_UARTx_DMA_TX_IRQn           DMA2_Stream7_IRQn
+    #define HAL_UARTx_DMA_TX_IRQHandler     DMA2_Stream7_IRQHandler
+    #define HAL_UARTx_DMA_TX_IS_TC()        LL_DMA_IsActiveFlag_TC7(DMA2)
+    #define HAL_UARTx_DMA_TX_CLEAR_FLAGS()  do { LL_DMA_ClearFlag_HT7(DMA2); LL_DMA_ClearFlag_TC7(DMA2); \
+                                                 LL_DMA_ClearFlag_TE7(DMA2); LL_DMA_ClearFlag_FE7(DMA2); \
+                                                 LL_DMA_ClearFlag_DME7(DMA2); } while(0)
 #endif
 
 
@@ -50,8 +68,45 @@
 #ifndef HAL_UART_QUEUE_ADD_TO_REG
     #define HAL_UART_QUEUE_ADD_TO_REG       1
 #endif
+/* DMA transport: circular rx with idle-line detection, tx from ring buffer,
+   an interrupt per burst instead of per byte */
+#ifndef HAL_UART_DMA
+    #define HAL_UART_DMA                    0
+#endif
+#ifndef HAL_UART_DMA_RX_BUF_SIZE
+    #define HAL_UART_DMA_RX_BUF_SIZE        256
+#endif
+#ifndef HAL_UART_DMA_TX_BUF_SIZE
+    #define HAL_UART_DMA_TX_BUF_SIZE        512
+#endif
+#ifndef HAL_UART_FEED_BUF_SIZE
+    #define HAL_UART_FEED_BUF_SIZE          64
+#endif
+#if HAL_UART_DMA && ((HAL_UART_DMA_RX_BUF_SIZE & (HAL_UART_DMA_RX_BUF_SIZE-1)) || (HAL_UART_DMA_TX_BUF_SIZE & (HAL_UART_DMA_TX_BUF_SIZE-1)))
+    #error "HAL_UART_DMA_xX_BUF_SIZE must be power of 2"
+#endif
+#ifndef USE_CMD_UART_BENCH
+    #define USE_CMD_UART_BENCH              0  /* takes a command table slot */
+#endif
 
+/* counters for the benchmark */
+static struct {
+    uint32_t irq;
+    uint32_t rx;
+    uint32_t tx;
+} hal_uart_stat;
+
+#if HAL_UART_DMA
+static uint8_t hal_uart_rx_buf[HAL_UART_DMA_RX_BUF_SIZE];
+static uint8_t hal_uart_tx_buf[HAL_UART_DMA_TX_BUF_SIZE];
+static uint8_t hal_uart_feed_buf[HAL_UART_FEED_BUF_SIZE];
+static ringbuf_t hal_uart_rx_ring, hal_uart_tx_ring, hal_uart_feed_ring;
+static SemaphoreHandle_t hal_uart_rx_sem, hal_uart_tx_sem;
+static SemaphoreHandle_t hal_uart_tx_mutex;  /* tx ring allows only one writer */
+static volatile uint32_t hal_uart_tx_dma_len;  /* 0: tx stream idle */
+#else
 QueueHandle_t hal_uart_queue_rx, hal_uart_queue_tx;
+#endif
 
 
 
@@ -60,6 +115,16 @@ int hal_uart_init( uint32_t baudrate )
     LL_GPIO_InitTypeDef gpio_init;
     LL_USART_InitTypeDef usart_init;
 
+#if HAL_UART_DMA
+    ringbuf_init( &hal_uart_rx_ring, hal_uart_rx_buf, HAL_UART_DMA_RX_BUF_SIZE );
+    ringbuf_init( &hal_uart_tx_ring, hal_uart_tx_buf, HAL_UART_DMA_TX_BUF_SIZE );
+    ringbuf_init( &hal_uart_feed_ring, hal_uart_feed_buf, HAL_UART_FEED_BUF_SIZE );
+    hal_uart_rx_sem = xSemaphoreCreateBinary();
+    hal_uart_tx_sem = xSemaphoreCreateBinary();
+    hal_uart_tx_mutex = xSemaphoreCreateMutex();
+    if( !hal_uart_rx_sem || !hal_uart_tx_sem || !hal_uart_tx_mutex )
+        return 0;
+#else
     hal_uart_queue_rx = xQueueCreate( HAL_UART_QUEUE_RX_LEN, ( unsigned portBASE_TYPE ) sizeof( signed char ) );
     hal_uart_queue_tx = xQueueCreate( HAL_UART_QUEUE_TX_LEN, ( unsigned portBASE_TYPE ) sizeof( signed char ) );
     if( !hal_uart_queue_rx || !hal_uart_queue_tx )
@@ -68,6 +133,7 @@ int hal_uart_init( uint32_t baudrate )
 #if HAL_UART_QUEUE_ADD_TO_REG
     vQueueAddToRegistry( hal_uart_queue_rx, "rxQ" );
     vQueueAddToRegistry( hal_uart_queue_tx, "txQ" );
+#endif
 #endif
 
     HAL_UART_RCC_GPIO_ENABLE_CMD( HAL_UART_RCC_GPIO_ENABLE_BIT );
@@ -102,7 +168,41 @@ int hal_uart_init( uint32_t baudrate )
     LL_USART_ClearFlag_FE( HAL_UARTx );
     LL_USART_ClearFlag_NE( HAL_UARTx );
     LL_USART_ClearFlag_ORE( HAL_UARTx );
+#if HAL_UART_DMA
+    HAL_UART_RCC_DMA_ENABLE_CMD( HAL_UART_RCC_DMA_ENABLE_BIT );
+    /* rx: circular, never stopped, the ring follows the write position */
+    LL_DMA_SetChannelSelection( HAL_UARTx_DMA, HAL_UARTx_DMA_RX_STREAM, HAL_UARTx_DMA_CHANNEL );
+    LL_DMA_ConfigTransfer( HAL_UARTx_DMA, HAL_UARTx_DMA_RX_STREAM,
+                LL_DMA_DIRECTION_PERIPH_TO_MEMORY | LL_DMA_PRIORITY_HIGH | LL_DMA_MODE_CIRCULAR |
+                LL_DMA_PERIPH_NOINCREMENT | LL_DMA_MEMORY_INCREMENT |
+                LL_DMA_PDATAALIGN_BYTE | LL_DMA_MDATAALIGN_BYTE );
+    LL_DMA_ConfigAddresses( HAL_UARTx_DMA, HAL_UARTx_DMA_RX_STREAM, LL_USART_DMA_GetRegAddr( HAL_UARTx ),
+                (uint32_t)hal_uart_rx_buf, LL_DMA_DIRECTION_PERIPH_TO_MEMORY );
+    LL_DMA_SetDataLength( HAL_UARTx_DMA, HAL_UARTx_DMA_RX_STREAM, HAL_UART_DMA_RX_BUF_SIZE );
+    HAL_UARTx_DMA_RX_CLEAR_FLAGS();
+    /* half/full irq make sure the ring is updated twice per buffer wrap */
+    LL_DMA_EnableIT_HT( HAL_UARTx_DMA, HAL_UARTx_DMA_RX_STREAM );
+    LL_DMA_EnableIT_TC( HAL_UARTx_DMA, HAL_UARTx_DMA_RX_STREAM );
+    LL_DMA_EnableStream( HAL_UARTx_DMA, HAL_UARTx_DMA_RX_STREAM );
+    /* tx: normal mode, started on each contiguous block of the ring */
+    LL_DMA_SetChannelSelection( HAL_UARTx_DMA, HAL_UARTx_DMA_TX_STREAM, HAL_UARTx_DMA_CHANNEL );
+    LL_DMA_ConfigTransfer( HAL_UARTx_DMA, HAL_UARTx_DMA_TX_STREAM,
+                LL_DMA_DIRECTION_MEMORY_TO_PERIPH | LL_DMA_PRIORITY_LOW | LL_DMA_MODE_NORMAL |
+                LL_DMA_PERIPH_NOINCREMENT | LL_DMA_MEMORY_INCREMENT |
+                LL_DMA_PDATAALIGN_BYTE | LL_DMA_MDATAALIGN_BYTE );
+    LL_DMA_ConfigAddresses( HAL_UARTx_DMA, HAL_UARTx_DMA_TX_STREAM, (uint32_t)hal_uart_tx_buf,
+                LL_USART_DMA_GetRegAddr( HAL_UARTx ), LL_DMA_DIRECTION_MEMORY_TO_PERIPH );
+    LL_DMA_EnableIT_TC( HAL_UARTx_DMA, HAL_UARTx_DMA_TX_STREAM );
+    LL_USART_EnableDMAReq_RX( HAL_UARTx );
+    LL_USART_EnableDMAReq_TX( HAL_UARTx );
+    LL_USART_EnableIT_IDLE( HAL_UARTx );
+    HAL_NVIC_SetPriority( HAL_UARTx_DMA_RX_IRQn, 10, 0 );
+    HAL_NVIC_EnableIRQ( HAL_UARTx_DMA_RX_IRQn );
+    HAL_NVIC_SetPriority( HAL_UARTx_DMA_TX_IRQn, 10, 0 );
+    HAL_NVIC_EnableIRQ( HAL_UARTx_DMA_TX_IRQn );
+#else
     LL_USART_EnableIT_RXNE( HAL_UARTx );
+#endif
 
     /* Interrupt Enable */  
     HAL_NVIC_SetPriority( HAL_UARTx_IRQn, 10, 0 );
@@ -111,16 +211,202 @@ int hal_uart_init( uint32_t baudrate )
 }
 
 
+#if HAL_UART_DMA
+/* sync the rx ring with dma write position, wake up the reader */
+static void hal_uart_dma_rx_update( portBASE_TYPE *xHigherPriorityTaskWoken )
+{
+    uint32_t n;
+
+    n = ringbuf_dma_update( &hal_uart_rx_ring, HAL_UART_DMA_RX_BUF_SIZE - 
+                LL_DMA_GetDataLength( HAL_UARTx_DMA, HAL_UARTx_DMA_RX_STREAM ) );
+    if( n )
+    {
+        hal_uart_stat.rx += n;
+        xSemaphoreGiveFromISR( hal_uart_rx_sem, xHigherPriorityTaskWoken );
+    }
+}
+
+
+/* start next block if idle, called from isr or within critical section */
+static void hal_uart_dma_tx_start( void )
+{
+    uint8_t *p;
+    uint32_t len;
+
+    if( hal_uart_tx_dma_len )
+        return;
+    len = ringbuf_peek_linear( &hal_uart_tx_ring, &p );
+    if( ! len )
+        return;
+    hal_uart_tx_dma_len = len;
+    HAL_UARTx_DMA_TX_CLEAR_FLAGS();
+    LL_DMA_SetMemoryAddress( HAL_UARTx_DMA, HAL_UARTx_DMA_TX_STREAM, (uint32_t)p );
+    LL_DMA_SetDataLength( HAL_UARTx_DMA, HAL_UARTx_DMA_TX_STREAM, len );
+    LL_DMA_EnableStream( HAL_UARTx_DMA, HAL_UARTx_DMA_TX_STREAM );
+}
+
+
+void HAL_UARTx_IRQHandler(void)
+{
+    portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+    hal_uart_stat.irq++;
+    if( LL_USART_IsActiveFlag_IDLE( HAL_UARTx ) )
+    {
+        /* end of burst, the data may not reach half buffer */
+        LL_USART_ClearFlag_IDLE( HAL_UARTx );
+        hal_uart_dma_rx_update( &xHigherPriorityTaskWoken );
+    }
+
+    if( LL_USART_IsActiveFlag_ORE( HAL_UARTx ) )
+    {
+        LL_USART_ReceiveData8( HAL_UARTx );
+        LL_USART_ClearFlag_ORE( HAL_UARTx );
+    }
+
+    portEND_SWITCHING_ISR( xHigherPriorityTaskWoken );
+}
+
+
+void HAL_UARTx_DMA_RX_IRQHandler(void)
+{
+    portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+    hal_uart_stat.irq++;
+    HAL_UARTx_DMA_RX_CLEAR_FLAGS();
+    hal_uart_dma_rx_update( &xHigherPriorityTaskWoken );
+    portEND_SWITCHING_ISR( xHigherPriorityTaskWoken );
+}
+
+
+void HAL_UARTx_DMA_TX_IRQHandler(void)
+{
+    portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+    hal_uart_stat.irq++;
+    if( HAL_UARTx_DMA_TX_IS_TC() )
+    {
+        HAL_UARTx_DMA_TX_CLEAR_FLAGS();
+        ringbuf_skip( &hal_uart_tx_ring, hal_uart_tx_dma_len );
+        hal_uart_stat.tx += hal_uart_tx_dma_len;
+        hal_uart_tx_dma_len = 0;
+        hal_uart_dma_tx_start();
+        xSemaphoreGiveFromISR( hal_uart_tx_sem, &xHigherPriorityTaskWoken );
+    }
+    else
+        HAL_UARTx_DMA_TX_CLEAR_FLAGS();
+    portEND_SWITCHING_ISR( xHigherPriorityTaskWoken );
+}
+
+
+void hal_uart_reset(void)
+{
+    /* head is the producer index, no writer may be in ringbuf_put */
+    xSemaphoreTake( hal_uart_tx_mutex, portMAX_DELAY );
+    portENTER_CRITICAL();
+    /* drop received, and tx data not yet handed to dma */
+    hal_uart_rx_ring.tail = hal_uart_rx_ring.head;
+    hal_uart_feed_ring.tail = hal_uart_feed_ring.head;
+    hal_uart_tx_ring.head = hal_uart_tx_ring.tail + hal_uart_tx_dma_len;
+    portEXIT_CRITICAL();
+    xSemaphoreGive( hal_uart_tx_mutex );
+}
+
+
+/* returns bytes written, less than len if timeout, 
+   writes from different tasks are not interleaved */
+int hal_uart_write( const char *buf, int len, TickType_t xBlockTime )
+{
+    int written=0;
+
+    if( xSemaphoreTake( hal_uart_tx_mutex, xBlockTime ) != pdPASS )
+        return 0;
+    while( 1 )
+    {
+        written += ringbuf_put( &hal_uart_tx_ring, buf + written, len - written );
+        portENTER_CRITICAL();
+        hal_uart_dma_tx_start();
+        portEXIT_CRITICAL();
+        if( written >= len )
+            break;
+        /* wait for some room */
+        if( xSemaphoreTake( hal_uart_tx_sem, xBlockTime ) != pdPASS )
+            break;
+    }
+    xSemaphoreGive( hal_uart_tx_mutex );
+    return written;
+}
+
+
+/* returns bytes read, wait only if nothing available */
+int hal_uart_read( char *buf, int len, TickType_t xBlockTime )
+{
+    int r;
+
+    while( 1 )
+    {
+        r = ringbuf_get( &hal_uart_feed_ring, buf, len );
+        if( ! r )
+            r = ringbuf_get( &hal_uart_rx_ring, buf, len );
+        if( r || ! len )
+            return r;
+        if( xSemaphoreTake( hal_uart_rx_sem, xBlockTime ) != pdPASS )
+            return 0;
+    }
+}
+
+
+signed portBASE_TYPE hal_uart_putc( char c, TickType_t xBlockTime )
+{
+    return hal_uart_write( &c, 1, xBlockTime ) ? pdPASS : pdFAIL;
+}
+
+
+signed portBASE_TYPE hal_uart_getc( char *c, TickType_t xBlockTime )
+{
+    return hal_uart_read( c, 1, xBlockTime ) ? pdPASS : pdFAIL;
+}
+
+
+/* feed data as if received, for shell_read_feed */
+signed portBASE_TYPE hal_uart_feedc( char c, TickType_t xBlockTime )
+{
+    if( ! ringbuf_put( &hal_uart_feed_ring, &c, 1 ) )
+        return pdFAIL;
+    xSemaphoreGive( hal_uart_rx_sem );
+    return pdPASS;
+}
+
+
+void hal_uart_enable(uint8_t enable)
+{
+    if( enable )
+        LL_USART_Enable( HAL_UARTx );
+    else
+        LL_USART_Disable( HAL_UARTx );
+}
+
+
+static int hal_uart_tx_pending(void)
+{
+    return ringbuf_len( &hal_uart_tx_ring ) || hal_uart_tx_dma_len;
+}
+
+#else
+
+
 void HAL_UARTx_IRQHandler(void)
 {
     portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
     char c;
 
+    hal_uart_stat.irq++;
     if( LL_USART_IsEnabledIT_TXE( HAL_UARTx ) && LL_USART_IsActiveFlag_TXE( HAL_UARTx ) )
     {
         if( xQueueReceiveFromISR( hal_uart_queue_tx, &c, &xHigherPriorityTaskWoken ) == pdTRUE )
         {
             LL_USART_TransmitData8( HAL_UARTx, c );
+            hal_uart_stat.tx++;
         }
         else
         {
@@ -131,6 +417,7 @@ void HAL_UARTx_IRQHandler(void)
     if( LL_USART_IsActiveFlag_RXNE( HAL_UARTx ) )
     {
         c = LL_USART_ReceiveData8( HAL_UARTx );
+        hal_uart_stat.rx++;
         xQueueSendFromISR( hal_uart_queue_rx, &c, &xHigherPriorityTaskWoken );
     }   
 
@@ -179,6 +466,12 @@ signed portBASE_TYPE hal_uart_getc( char *c, TickType_t xBlockTime )
 }
 
 
+static int hal_uart_tx_pending(void)
+{
+    return uxQueueMessagesWaiting( hal_uart_queue_tx ) || LL_USART_IsEnabledIT_TXE( HAL_UARTx );
+}
+
+
 signed portBASE_TYPE hal_uart_feedc( char c, TickType_t xBlockTime )
 {
     if( xQueueSend( hal_uart_queue_rx, &c, xBlockTime ) == pdPASS )
@@ -188,6 +481,152 @@ signed portBASE_TYPE hal_uart_feedc( char c, TickType_t xBlockTime )
 }
 
 
+int hal_uart_write( const char *buf, int len, TickType_t xBlockTime )
+{
+    int written=0;
+
+    while( (written < len) && (hal_uart_putc( buf[written], xBlockTime ) == pdPASS) )
+        written++;
+    return written;
+}
+
+
+int hal_uart_read( char *buf, int len, TickType_t xBlockTime )
+{
+    int r=0;
+
+    if( len && (hal_uart_getc( buf, xBlockTime ) == pdPASS) )
+    {
+        /* the rest only if already received */
+        for( r=1; (r < len) && (hal_uart_getc( buf+r, 0 ) == pdPASS); r++ );
+    }
+    return r;
+}
+#endif
+
+
+
+#if USE_CMD_UART_BENCH
+static void uart_bench_report( const char *name, uint32_t bytes, TickType_t t, uint32_t irq )
+{
+    if( t == 0 )
+        t = 1;
+    shell_printf( "%s %u bytes %u ms %u B/s, %u irq (%u per KB)\n", name, bytes, 
+                  t * 1000 / configTICK_RATE_HZ, (uint32_t)((uint64_t)bytes * configTICK_RATE_HZ / t),
+                  irq, bytes ? (uint32_t)((uint64_t)irq * 1024 / bytes) : 0 );
+}
+
+
+/* interrupts per KB is the cpu load figure: each one costs an isr entry,
+   possible task wakeup and context switch */
+int cmd_uart_bench( int argc, char *argv[] )
+{
+    static const mcush_opt_spec const opt_spec[] = {
+        { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED,
+          't', "tx", "bytes", "transmit test pattern" },
+        { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED,
+          'r', "rx", "bytes", "receive from host and discard" },
+        { MCUSH_OPT_NONE } };
+    mcush_opt_parser parser;
+    mcush_opt opt;
+    char buf[64];
+    int tx=0, rx=0, i, n;
+    uint32_t bytes, irq;
+    TickType_t t0, t;
+
+    mcush_opt_parser_init(&parser, opt_spec, (const char **)(argv+1), argc-1 );
+    while( mcush_opt_parser_next( &opt, &parser ) )
+    {
+        if( opt.spec )
+        {
+            if( strcmp( opt.spec->name, "tx" ) == 0 )
+            {
+                if( ! parse_int(opt.value, &tx) || (tx < 0) )
+                    goto usage_error;
+            }
+            else if( strcmp( opt.spec->name, "rx" ) == 0 )
+            {
+                if( ! parse_int(opt.value, &rx) || (rx < 0) )
+                    goto usage_error;
+            }
+        }
+        else
+            STOP_AT_INVALID_ARGUMENT 
+    }
+
+    if( tx )
+    {
+        for( i=0; i<sizeof(buf)-1; i++ )
+            buf[i] = '0' + i % 64;
+        buf[sizeof(buf)-1] = '\n';
+        while( hal_uart_tx_pending() )
+            vTaskDelay(1);
+        irq = hal_uart_stat.irq;
+        t0 = xTaskGetTickCount();
+        for( bytes=0; bytes<tx; bytes+=n )
+        {
+            n = tx - bytes < sizeof(buf) ? tx - bytes : sizeof(buf);
+            if( hal_uart_write( buf, n, portMAX_DELAY ) != n )
+                return 1;
+        }
+        while( hal_uart_tx_pending() )
+            vTaskDelay(1);
+        t = xTaskGetTickCount() - t0;
+        irq = hal_uart_stat.irq - irq;
+        uart_bench_report( "\ntx", bytes, t, irq );
+    }
+
+    if( rx )
+    {
+        /* wait for the host, then stop at the count or 1s silence */
+        bytes = 0;
+        irq = hal_uart_stat.irq;
+        n = hal_uart_read( buf, sizeof(buf), 10*configTICK_RATE_HZ );
+        t0 = xTaskGetTickCount();
+        while( n > 0 )
+        {
+            bytes += n;
+            if( bytes >= rx )
+                break;
+            n = hal_uart_read( buf, sizeof(buf), configTICK_RATE_HZ );
+        }
+        t = xTaskGetTickCount() - t0;
+        if( n <= 0 )
+            t -= configTICK_RATE_HZ;
+        irq = hal_uart_stat.irq - irq;
+        uart_bench_report( "rx", bytes, t, irq );
+#if HAL_UART_DMA
+        shell_printf( "overrun %u\n", hal_uart_rx_ring.overrun );
+#endif
+        if( bytes < rx )
+            return 1;
+    }
+
+    if( !tx && !rx )
+    {
+        shell_printf( "irq %u, rx %u, tx %u\n", hal_uart_stat.irq, hal_uart_stat.rx, hal_uart_stat.tx );
+#if HAL_UART_DMA
+        shell_printf( "dma rx %u/%u, tx %u/%u, overrun %u\n", 
+                      ringbuf_len(&hal_uart_rx_ring), HAL_UART_DMA_RX_BUF_SIZE,
+                      ringbuf_len(&hal_uart_tx_ring), HAL_UART_DMA_TX_BUF_SIZE,
+                      hal_uart_rx_ring.overrun );
+#endif
+    }
+    return 0;
+usage_error:
+    mcush_opt_usage_print( argv[0], opt_spec );
+    return -1;
+}
+
+
+static const shell_cmd_t cmd_tab_uart[] = {
+{   0, 0, "uartbench", cmd_uart_bench, 
+    "uart throughput/load test",
+    "uartbench [-t <bytes>] [-r <bytes>]"  },
+{   CMD_END  } };
+#endif
+
+
 
 /****************************************************************************/
 /* shell APIs                                                               */
@@ -195,6 +634,9 @@ signed portBASE_TYPE hal_uart_feedc( char c, TickType_t xBlockTime )
 
 int shell_driver_init( void )
 {
+#if USE_CMD_UART_BENCH
+    shell_add_cmd_table( cmd_tab_uart );
+#endif
     return 1;  /* already inited */
 }
 
@@ -220,7 +662,7 @@ int  shell_driver_read_feed( char *buffer, int len )
 
 int  shell_driver_read( char *buffer, int len )
 {
-    return 0;  /* not supported */
+    return hal_uart_read( buffer, len, 0 );
 }
 
 
@@ -254,9 +696,9 @@ int  shell_driver_write( const char *buffer, int len )
 
     while( written < len )
     {
-        while( hal_uart_putc( *(char*)((int)buffer + written), portMAX_DELAY ) == pdFAIL )
+        written += hal_uart_write( buffer + written, len - written, portMAX_DELAY );
+        if( written < len )
             vTaskDelay(1);
-        written += 1;
     }
     return written;
 }
@@ -1,20 +1,23 @@
 //* MCUSH designed by Peng Shulin, all rights reserved. */
 #include "mcush.h"
+#include "stream_buffer.h"
 #include "usbd_def.h"
 #include "usbd_core.h"
 #include "usbd_desc.h"
 #include "usbd_cdc.h"
 #include "usbd_cdc_if.h"
+#include "hal_vcp_tx.h"
 
 
 #define TASK_VCP_TX_STACK_SIZE  (300)
 #define TASK_VCP_TX_PRIORITY    (MCUSH_PRIORITY)
 
-#define TASK_VCP_TX_READ_TIMEOUT_MS    5  /* timeout for the last byte, actual cycle timeout will be doubled */
-#define TASK_VCP_TX_READ_TIMEOUT_TICK  (TASK_VCP_TX_READ_TIMEOUT_MS*configTICK_RATE_HZ/1000)
+#define TASK_VCP_TX_IDLE_TIMEOUT_MS    1  /* wait for more data before sending the short tail */
+#define TASK_VCP_TX_IDLE_TIMEOUT_TICK  ((TASK_VCP_TX_IDLE_TIMEOUT_MS*configTICK_RATE_HZ+999)/1000)
 
 #define VCP_RX_BUF_LEN   128  /* memory consumption: RX_LEN x 2 */
-#define VCP_TX_BUF_LEN   63  /* memory consumption: TX_LEN x 3 */
+#define VCP_TX_BUF_LEN   256  /* stream buffer filled by writers */
+#define VCP_TX_BANK_LEN  (4*HAL_VCP_TX_PACKET_SIZE)  /* memory consumption: BANK_LEN x 2 */
 
 #define VCP_WRITE_BLOCK_AUTO_ADAPTED  1
 #define VCP_WRITE_BLOCK_AUTO_ADAPTED_BLOCK_TICK  (1000*configTICK_RATE_HZ/1000)
@@ -25,13 +28,13 @@ extern USBD_DescriptorsTypeDef FS_Desc;
 extern USBD_CDC_ItfTypeDef USBD_Interface_fops_FS;
 
 char hal_vcp_rx_buf[VCP_RX_BUF_LEN];
-char hal_vcp_tx_buf1[VCP_TX_BUF_LEN];
-char hal_vcp_tx_buf2[VCP_TX_BUF_LEN];
-int hal_vcp_tx_buf1_len, hal_vcp_tx_buf2_len;
-int8_t hal_vcp_tx_use_buf2;
+uint8_t hal_vcp_tx_bank1[VCP_TX_BANK_LEN];
+uint8_t hal_vcp_tx_bank2[VCP_TX_BANK_LEN];
+hal_vcp_tx_t hal_vcp_tx;
 QueueHandle_t hal_queue_vcp_rx;
-QueueHandle_t hal_queue_vcp_tx;
+StreamBufferHandle_t hal_stream_vcp_tx;
 SemaphoreHandle_t hal_sem_vcp_tx;
+SemaphoreHandle_t hal_mutex_vcp_tx;  /* stream buffer allows only one writer */
 
 
 /* NOTE: call this hook in ST/USB_Device_Library/usbd_cdc.c/USBD_CDC_DataIn function */
@@ -42,61 +45,41 @@ void hal_vcp_tx_done_isr_hook(void)
 }
 
 
-void task_vcp_tx_entry(void *p)
+static int hal_vcp_tx_read( void *arg, uint8_t *buf, int len, int wait )
 {
-    char c;
-    char *next_buf;
-    int *next_buf_len;
-    TickType_t timeout;
+    TickType_t t;
 
-    while(1)
+    if( wait == HAL_VCP_TX_WAIT_FOREVER )
+        t = portMAX_DELAY;
+    else if( wait == HAL_VCP_TX_WAIT_IDLE )
+        t = TASK_VCP_TX_IDLE_TIMEOUT_TICK;
+    else
+        t = wait;
+    return xStreamBufferReceive( hal_stream_vcp_tx, buf, len, t );
+}
+
+
+static int hal_vcp_tx_transmit( void *arg, const uint8_t *buf, int len )
+{
+    /* try to send */
+    while( hUsbDeviceFS.dev_config )
     {
-        next_buf = hal_vcp_tx_use_buf2 ? hal_vcp_tx_buf2 : hal_vcp_tx_buf1;
-        next_buf_len = hal_vcp_tx_use_buf2 ? &hal_vcp_tx_buf2_len : &hal_vcp_tx_buf1_len;
-        
-        /* get the first item from the queue */ 
-        if( xQueueReceive( hal_queue_vcp_tx, &c, portMAX_DELAY ) != pdPASS )
-            continue;
-        timeout = xTaskGetTickCount() + TASK_VCP_TX_READ_TIMEOUT_TICK;
-        *next_buf = c;
-        *next_buf_len = 1;
-
-        /* read as much as possible from the queue with time limit */
-        while( *next_buf_len < VCP_TX_BUF_LEN )
+        if( xSemaphoreTake( hal_sem_vcp_tx, portMAX_DELAY ) == pdTRUE )
         {
-            if( xQueueReceive( hal_queue_vcp_tx, &c, TASK_VCP_TX_READ_TIMEOUT_TICK ) == pdPASS )
-            {
-                *(next_buf + *next_buf_len) = c;
-                *next_buf_len += 1;
-            }
-            if( xTaskGetTickCount() > timeout )
-                break;
+            if( CDC_Transmit_FS( (uint8_t*)buf, len ) == USBD_OK )
+                return 0;
+            xSemaphoreGive( hal_sem_vcp_tx );
         }
+        vTaskDelay(1);
+    }
+    return -1;
+}
 
-        /* try to send */
-        while( hUsbDeviceFS.dev_config )
-        {
-            if( xSemaphoreTake( hal_sem_vcp_tx, portMAX_DELAY ) == pdTRUE )
-            {
-                if( CDC_Transmit_FS( (uint8_t*)next_buf, *next_buf_len ) == USBD_OK )
-                {
-                    break;
-                }
-                else
-                {
-                    xSemaphoreGive( hal_sem_vcp_tx );
-                    //taskYIELD();
-                    vTaskDelay(1);
-                }
-            }
-            else
-                //taskYIELD();
-                vTaskDelay(1);
-        }
 
-        /* switch to next bank */
-        hal_vcp_tx_use_buf2 = hal_vcp_tx_use_buf2 ? 0 : 1;
-    }
+void task_vcp_tx_entry(void *p)
+{
+    while(1)
+        hal_vcp_tx_poll( &hal_vcp_tx );
 }
 
 
@@ -105,12 +88,15 @@ int hal_uart_init(uint32_t baudrate)
     TaskHandle_t task_vcp_tx;
 
     hal_queue_vcp_rx = xQueueCreate( VCP_RX_BUF_LEN, ( unsigned portBASE_TYPE ) sizeof( signed char ) );
-    hal_queue_vcp_tx = xQueueCreate( VCP_TX_BUF_LEN, ( unsigned portBASE_TYPE ) sizeof( signed char ) );
+    hal_stream_vcp_tx = xStreamBufferCreate( VCP_TX_BUF_LEN, 1 );
     hal_sem_vcp_tx = xSemaphoreCreateBinary();
-    if( !hal_queue_vcp_rx || !hal_queue_vcp_tx || !hal_sem_vcp_tx )
+    hal_mutex_vcp_tx = xSemaphoreCreateMutex();
+    if( !hal_queue_vcp_rx || !hal_stream_vcp_tx || !hal_sem_vcp_tx || !hal_mutex_vcp_tx )
         return 0;
     xSemaphoreGive(hal_sem_vcp_tx);
-    hal_vcp_tx_buf1_len = hal_vcp_tx_buf2_len = 0;
+    hal_vcp_tx_init( &hal_vcp_tx, hal_vcp_tx_bank1, hal_vcp_tx_bank2, VCP_TX_BANK_LEN );
+    hal_vcp_tx.read = hal_vcp_tx_read;
+    hal_vcp_tx.transmit = hal_vcp_tx_transmit;
 
     /* create vcp/tx task */
     (void)xTaskCreate(task_vcp_tx_entry, (const char *)"vcp/txT", 
@@ -136,8 +122,6 @@ int  shell_driver_init( void )
 void shell_driver_reset( void )
 {
     xQueueReset( hal_queue_vcp_rx );
-    hal_vcp_tx_buf1_len = hal_vcp_tx_buf2_len = 0;
-
 }
 
 
@@ -184,33 +168,20 @@ int  shell_driver_write( const char *buffer, int len )
 {
     int written=0;
 #if VCP_WRITE_BLOCK_AUTO_ADAPTED
-    /* auto adapt, ignore short-time continuous data if connection broken and queue full */
+    /* auto adapt, ignore short-time continuous data if connection broken and buffer full */
     static uint8_t broken=0;
-    while( written < len )
-    {
-        if( broken )
-        {
-            if( xQueueSend( hal_queue_vcp_tx, (void*)(buffer), 0 ) == pdPASS )
-                broken = 0; 
-        } 
-        else
-        {
-            if( xQueueSend( hal_queue_vcp_tx, (void*)(buffer), VCP_WRITE_BLOCK_AUTO_ADAPTED_BLOCK_TICK ) != pdPASS )
-                broken = 1; 
-        }
-        written ++;
-        buffer ++;
-    }
+
+    xSemaphoreTake( hal_mutex_vcp_tx, portMAX_DELAY );
+    written = xStreamBufferSend( hal_stream_vcp_tx, buffer, len, broken ? 0 : VCP_WRITE_BLOCK_AUTO_ADAPTED_BLOCK_TICK );
+    broken = written < len;
+    xSemaphoreGive( hal_mutex_vcp_tx );
+    written = len;
 #else
     /* always blocked, this will make the running task blocked (if connection is broken) */
+    xSemaphoreTake( hal_mutex_vcp_tx, portMAX_DELAY );
     while( written < len )
-    {
-        if( xQueueSend( hal_queue_vcp_tx, (void*)(buffer), portMAX_DELAY ) == pdPASS )
-        {
-            written ++;
-            buffer ++;
-        }
-    }
+        written += xStreamBufferSend( hal_stream_vcp_tx, buffer + written, len - written, portMAX_DELAY );
+    xSemaphoreGive( hal_mutex_vcp_tx );
 #endif
     return written;
 }
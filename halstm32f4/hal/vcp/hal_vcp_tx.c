@@ -0,0 +1,58 @@
+/* MCUSH designed by Peng Shulin, all rights reserved. */
+#include <string.h>
+#include "hal_vcp_tx.h"
+
+
+void hal_vcp_tx_init( hal_vcp_tx_t *tx, uint8_t *bank1, uint8_t *bank2, int bank_size )
+{
+    tx->bank[0] = bank1;
+    tx->bank[1] = bank2;
+    tx->bank_size = bank_size;
+    tx->len = 0;
+    tx->cur = 0;
+    tx->zlp = 0;
+}
+
+
+/* full packets are sent at once, the short tail only when writers are idle
+   (it ends the host side read, no more coalescing after that) */
+int hal_vcp_tx_chunk_len( int len, int idle )
+{
+    if( idle )
+        return len;
+    return len - len % HAL_VCP_TX_PACKET_SIZE;
+}
+
+
+/* one read/transmit cycle, returns bytes transmitted */
+int hal_vcp_tx_poll( hal_vcp_tx_t *tx )
+{
+    uint8_t *buf = tx->bank[tx->cur];
+    int n, chunk;
+
+    /* sleep if nothing is pending, otherwise wait a little for more */
+    n = tx->read( tx->arg, buf + tx->len, tx->bank_size - tx->len,
+                  (tx->len || tx->zlp) ? HAL_VCP_TX_WAIT_IDLE : HAL_VCP_TX_WAIT_FOREVER );
+    tx->len += n;
+    chunk = hal_vcp_tx_chunk_len( tx->len, n == 0 );
+    if( chunk )
+    {
+        /* dropped if failed (not connected) */
+        tx->transmit( tx->arg, buf, chunk );
+        tx->zlp = (chunk % HAL_VCP_TX_PACKET_SIZE) == 0;
+        /* this bank is in flight, move the rest to the other one */
+        tx->cur ^= 1;
+        tx->len -= chunk;
+        if( tx->len )
+            memcpy( tx->bank[tx->cur], buf + chunk, tx->len );
+        return chunk;
+    }
+    if( (n == 0) && tx->zlp )
+    {
+        /* transfer ended on packet boundary and nothing follows,
+           terminate it or the host will not return the data */
+        tx->zlp = 0;
+        tx->transmit( tx->arg, buf, 0 );
+    }
+    return 0;
+}
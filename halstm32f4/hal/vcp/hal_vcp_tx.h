@@ -0,0 +1,40 @@
+/* MCUSH designed by Peng Shulin, all rights reserved. */
+#ifndef __HAL_VCP_TX_H__
+#define __HAL_VCP_TX_H__
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* VCP transmit packing, no FreeRTOS/USB dependency so that it can be
+   tested on host with mocked read/transmit functions */
+
+#define HAL_VCP_TX_PACKET_SIZE  64  /* bulk IN max packet size (full speed) */
+
+#define HAL_VCP_TX_WAIT_FOREVER  (-1)
+#define HAL_VCP_TX_WAIT_IDLE     (-2)  /* coalescing window, defined by reader */
+
+typedef struct _hal_vcp_tx_t {
+    /* read from writers' buffer, returns bytes got (0 if timeout) */
+    int (*read)( void *arg, uint8_t *buf, int len, int wait );
+    /* start an IN transfer (len 0 for ZLP), blocks until the endpoint is
+       free, buf must be kept until next call, returns 0 if ok */
+    int (*transmit)( void *arg, const uint8_t *buf, int len );
+    void *arg;
+    uint8_t *bank[2];  /* staging buffers, one may be in flight */
+    int bank_size;     /* multiple of packet size */
+    int len;           /* staged in current bank */
+    uint8_t cur;       /* current bank */
+    uint8_t zlp;       /* last transfer ended on packet boundary */
+} hal_vcp_tx_t;
+
+void hal_vcp_tx_init( hal_vcp_tx_t *tx, uint8_t *bank1, uint8_t *bank2, int bank_size );
+int hal_vcp_tx_chunk_len( int len, int idle );
+int hal_vcp_tx_poll( hal_vcp_tx_t *tx );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -56,12 +56,8 @@
 
 
 extern char hal_vcp_rx_buf[];
-extern char hal_vcp_tx_buf1[];
-extern char hal_vcp_tx_buf2[];
-extern int hal_vcp_tx_buf1_len, hal_vcp_tx_buf2_len;
-extern uint8_t hal_vcp_tx_use_buf2;
+extern uint8_t hal_vcp_tx_bank1[];
 extern QueueHandle_t hal_queue_vcp_rx;
-extern QueueHandle_t hal_queue_vcp_tx;
 
 /* USER CODE END INCLUDE */
 
@@ -193,9 +189,8 @@ static int8_t CDC_Init_FS(void)
 {
   /* USER CODE BEGIN 3 */
   /* Set Application Buffers */
-    USBD_CDC_SetTxBuffer(&hUsbDeviceFS, (uint8_t *)hal_vcp_tx_buf1, 0);
+    USBD_CDC_SetTxBuffer(&hUsbDeviceFS, hal_vcp_tx_bank1, 0);
     USBD_CDC_SetRxBuffer(&hUsbDeviceFS, (uint8_t *)hal_vcp_rx_buf);
-    hal_vcp_tx_buf1_len = hal_vcp_tx_buf2_len = 0;
     return (USBD_OK);
   /* USER CODE END 3 */
 }
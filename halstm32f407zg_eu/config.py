@@ -11,6 +11,9 @@ env.appendDefineFlags( [ 'HSE_VALUE=8000000' ] )
 env.appendDefineFlags( [ 'HAL_RNG=1' ] )
 #env.appendDefineFlags( [ 'USE_CMD_UPGRADE=1' ] )
 env.appendDefineFlags( [ 'HAL_REBOOT_COUNTER=1' ] )
+# large flash, sliced crc16_modbus/crc32 (4.5 KB more tables)
+env.appendDefineFlags( [ 'CRC_SLICING=4' ] )
+env.appendDefineFlags( [ 'BASE64_LUT12=1' ] )  # 8 KB base64 encoder table
 #env.appendDefineFlags( [ 'HAL_WDG_ENABLE=1' ] )
 
 hal_config.paths += ['common']
@@ -32,6 +32,14 @@ uint32_t hal_rng_get(void);
 #endif
 
 
+/* enough ram for the per fd buffers and locks */
+#ifndef MCUSH_VFS_CACHE
+  #define MCUSH_VFS_CACHE  1
+#endif
+#ifndef MCUSH_VFS_LOCK
+  #define MCUSH_VFS_LOCK  1
+#endif
+
 #include "mcush_vfs.h"
 
 
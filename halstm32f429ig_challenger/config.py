@@ -4,6 +4,9 @@ env.setLinkfile( '/ld/stm32f429xg_ccmsram.ld' )
 #env.setLinkfile( '/ld/stm32f429xg_min.ld' )
 #env.setLinkfile( '/ld/stm32f429xg_sdram_b2.ld' )
 env.appendDefineFlags( [ 'HSE_VALUE=25000000', 'NEED_FMC' ] )
+# large flash, sliced crc16_modbus/crc32 (4.5 KB more tables)
+env.appendDefineFlags( [ 'CRC_SLICING=4' ] )
+env.appendDefineFlags( [ 'BASE64_LUT12=1' ] )  # 8 KB base64 encoder table
 
 
 hal_config.paths += ['common']
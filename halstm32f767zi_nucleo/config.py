@@ -2,6 +2,9 @@ from Arm.Stm32 import *
 
 env = Stm32f767xx()
 env.setLinkfile( '/ld/stm32f767zi_min.ld' )
+# large flash, sliced crc16_modbus/crc32 (4.5 KB more tables)
+env.appendDefineFlags( [ 'CRC_SLICING=4' ] )
+env.appendDefineFlags( [ 'BASE64_LUT12=1' ] )  # 8 KB base64 encoder table
 
 hal_config.paths += ['common']
 hal_config.sources += ['common/*.c']
@@ -69,6 +69,14 @@ void hal_sgpio_stop( void );
 int hal_sgpio_set_freq( float freq );
 sgpio_cfg_t *hal_sgpio_info( void );
 
+/* enough ram for the per fd buffers and locks */
+#ifndef MCUSH_VFS_CACHE
+  #define MCUSH_VFS_CACHE  1
+#endif
+#ifndef MCUSH_VFS_LOCK
+  #define MCUSH_VFS_LOCK  1
+#endif
+
 #include "mcush_vfs.h"
 
 #ifndef MCUSH_SPIFFS
@@ -0,0 +1,325 @@
+/* FreeRTOS port for POSIX hosts (Linux), used by halposix
+ * MCUSH designed by Peng Shulin, all rights reserved. */
+/*
+ * Every task is a pthread, but only the one selected by the scheduler is
+ * allowed to run, the others wait on their own semaphore.  Interrupts are
+ * simulated with signals delivered to the running thread:
+ *   SIGALRM -- system tick (setitimer)
+ *   SIGUSR1 -- external interrupt, raised by vPortGenerateInterrupt()
+ *              from any host thread (e.g. stdin reader)
+ * The interrupt mask is a flag instead of the thread signal mask, signals
+ * arrived while masked are recorded and serviced when unmasked, just like
+ * pending NVIC interrupts.  Task switch requested in critical section is
+ * deferred until the section exits, the same as PendSV.
+ *
+ * Only async-signal-safe libc functions should be called by tasks that may
+ * be preempted, the interrupted thread can be holding libc internal locks
+ * (malloc, stdio) when the next task runs.  Tasks allocate from the
+ * FreeRTOS heap and output via write(), so this is seldom an issue.
+ */
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+typedef struct {
+    pthread_t thread;
+    sem_t wake;             /* posted when selected to run */
+    TaskFunction_t code;
+    void *param;
+    volatile int deleted;
+} port_thread_t;
+
+#define PENDING_TICK  (1<<0)
+#define PENDING_IRQ   (1<<1)
+
+extern void * volatile pxCurrentTCB;
+
+static volatile sig_atomic_t xInterruptsDisabled = 1;
+static volatile sig_atomic_t xInISR;
+static volatile int xPending;          /* PENDING_xxx */
+static volatile int xSwitchPending;
+static volatile UBaseType_t uxCriticalNesting;  /* always 0 when switching, not
+                                                   to be updated before the mask */
+static void (*pxInterruptHandler)( void );
+static sigset_t xIrqSignals;
+static sem_t xSchedulerEnd;
+
+
+/* the thread block is returned as top of stack, which is the first member
+   of the task control block */
+static port_thread_t *prvThreadOf( void *pxTCB )
+{
+    return *(port_thread_t **)pxTCB;
+}
+
+
+static void prvWait( port_thread_t *t )
+{
+    while( sem_wait( &t->wake ) != 0 )
+        ;  /* EINTR */
+    if( t->deleted )
+        pthread_exit( NULL );
+}
+
+
+/* called with interrupts disabled, returns when this task is selected again */
+static void prvSwitch( void )
+{
+    port_thread_t *self = prvThreadOf( pxCurrentTCB ), *next;
+
+    xSwitchPending = 0;
+    vTaskSwitchContext();
+    next = prvThreadOf( pxCurrentTCB );
+    if( next == self )
+        return;
+    pthread_sigmask( SIG_BLOCK, &xIrqSignals, NULL );
+    sem_post( &next->wake );
+    prvWait( self );
+    pthread_sigmask( SIG_UNBLOCK, &xIrqSignals, NULL );
+}
+
+
+/* called with interrupts disabled */
+static void prvServiceInterrupts( void )
+{
+    int pending;
+
+    xInISR = 1;
+    while( (pending = __atomic_exchange_n( &xPending, 0, __ATOMIC_SEQ_CST )) != 0 )
+    {
+        if( (pending & PENDING_TICK) && xTaskIncrementTick() )
+            xSwitchPending = 1;
+        /* handler polls its sources on each tick too */
+        if( pxInterruptHandler )
+            pxInterruptHandler();
+    }
+    xInISR = 0;
+    if( xSwitchPending )
+        prvSwitch();
+}
+
+
+static void prvSignalHandler( int sig )
+{
+    int saved_errno = errno;
+
+    __atomic_fetch_or( &xPending, sig == SIGALRM ? PENDING_TICK : PENDING_IRQ, __ATOMIC_SEQ_CST );
+    if( ! xInterruptsDisabled )
+    {
+        xInterruptsDisabled = 1;
+        prvServiceInterrupts();
+        vPortEnableInterrupts();
+    }
+    errno = saved_errno;
+}
+
+
+/* signals are only recorded until the scheduler starts, as interrupts are
+   disabled at reset */
+static void prvSetupSignals( void )
+{
+    static int xDone;
+    struct sigaction sa;
+
+    if( xDone )
+        return;
+    xDone = 1;
+    sigemptyset( &xIrqSignals );
+    sigaddset( &xIrqSignals, SIGALRM );
+    sigaddset( &xIrqSignals, SIGUSR1 );
+    sa.sa_handler = prvSignalHandler;
+    sa.sa_mask = xIrqSignals;
+    sa.sa_flags = SA_RESTART;
+    sigaction( SIGALRM, &sa, NULL );
+    sigaction( SIGUSR1, &sa, NULL );
+}
+
+
+static void *prvThreadStart( void *arg )
+{
+    port_thread_t *t = (port_thread_t *)arg;
+
+    prvWait( t );
+    pthread_sigmask( SIG_UNBLOCK, &xIrqSignals, NULL );
+    vPortEnableInterrupts();
+    t->code( t->param );
+    /* task function should never return */
+    vTaskDelete( NULL );
+    return NULL;
+}
+
+
+StackType_t *pxPortInitialiseStack( StackType_t *pxTopOfStack, TaskFunction_t pxCode, void *pvParameters )
+{
+    port_thread_t *t;
+    sigset_t all, old;
+    UBaseType_t mask;
+
+    /* the stack itself is not used, thread block is placed on the top */
+    t = (port_thread_t *)(((portPOINTER_SIZE_TYPE)(pxTopOfStack + 1) - sizeof(port_thread_t))
+                          & ~((portPOINTER_SIZE_TYPE)portBYTE_ALIGNMENT_MASK));
+    t->code = pxCode;
+    t->param = pvParameters;
+    t->deleted = 0;
+    sem_init( &t->wake, 0, 0 );
+
+    prvSetupSignals();
+    /* new thread starts with all signals blocked, no switch in between as
+       libc holds its thread list lock, see vPortCleanUpTCB */
+    mask = xPortSetInterruptMask();
+    sigfillset( &all );
+    pthread_sigmask( SIG_SETMASK, &all, &old );
+    if( pthread_create( &t->thread, NULL, prvThreadStart, t ) != 0 )
+    {
+        fprintf( stderr, "pthread_create failed\n" );
+        abort();
+    }
+    pthread_sigmask( SIG_SETMASK, &old, NULL );
+    vPortClearInterruptMask( mask );
+    return (StackType_t *)t;
+}
+
+
+BaseType_t xPortStartScheduler( void )
+{
+    struct itimerval itv;
+
+    /* this thread never runs tasks nor takes interrupts */
+    prvSetupSignals();
+    pthread_sigmask( SIG_BLOCK, &xIrqSignals, NULL );
+
+    itv.it_interval.tv_sec = 0;
+    itv.it_interval.tv_usec = 1000000 / configTICK_RATE_HZ;
+    itv.it_value = itv.it_interval;
+    setitimer( ITIMER_REAL, &itv, NULL );
+
+    sem_init( &xSchedulerEnd, 0, 0 );
+    sem_post( &prvThreadOf( pxCurrentTCB )->wake );
+    while( sem_wait( &xSchedulerEnd ) != 0 )
+        ;
+    return pdFALSE;
+}
+
+
+void vPortEndScheduler( void )
+{
+    struct itimerval itv = { { 0, 0 }, { 0, 0 } };
+
+    setitimer( ITIMER_REAL, &itv, NULL );
+    sem_post( &xSchedulerEnd );
+}
+
+
+void vPortYield( void )
+{
+    if( xInISR || uxCriticalNesting || xInterruptsDisabled )
+    {
+        /* taken when interrupts are enabled */
+        xSwitchPending = 1;
+        return;
+    }
+    xInterruptsDisabled = 1;
+    prvSwitch();
+    vPortEnableInterrupts();
+}
+
+
+void vPortYieldFromISR( void )
+{
+    vPortYield();
+}
+
+
+void vPortDisableInterrupts( void )
+{
+    xInterruptsDisabled = 1;
+}
+
+
+void vPortEnableInterrupts( void )
+{
+    for( ;; )
+    {
+        xInterruptsDisabled = 0;
+        if( ! xPending && ! xSwitchPending )
+            break;
+        /* signal arrived before, service it now */
+        xInterruptsDisabled = 1;
+        prvServiceInterrupts();
+    }
+}
+
+
+void vPortEnterCritical( void )
+{
+    xInterruptsDisabled = 1;
+    uxCriticalNesting++;
+}
+
+
+void vPortExitCritical( void )
+{
+    if( --uxCriticalNesting == 0 )
+        vPortEnableInterrupts();
+}
+
+
+UBaseType_t xPortSetInterruptMask( void )
+{
+    UBaseType_t ret = xInterruptsDisabled;
+
+    xInterruptsDisabled = 1;
+    return ret;
+}
+
+
+void vPortClearInterruptMask( UBaseType_t xMask )
+{
+    if( ! xMask )
+        vPortEnableInterrupts();
+}
+
+
+void vPortCleanUpTCB( void *pxTCB )
+{
+    port_thread_t *t = prvThreadOf( pxTCB );
+    UBaseType_t mask;
+
+    /* wake it up to exit, the stack will be freed after return, the join
+       must not be preempted or the next pthread_create from another task
+       would wait for the libc lock held here forever */
+    mask = xPortSetInterruptMask();
+    t->deleted = 1;
+    sem_post( &t->wake );
+    pthread_join( t->thread, NULL );
+    sem_destroy( &t->wake );
+    vPortClearInterruptMask( mask );
+}
+
+
+void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
+{
+    (void)xExpectedIdleTime;
+    /* no tick is suppressed, just sleep until next tick or interrupt */
+    pause();
+}
+
+
+void vPortSetInterruptHandler( void (*pxHandler)( void ) )
+{
+    prvSetupSignals();
+    pxInterruptHandler = pxHandler;
+}
+
+
+void vPortGenerateInterrupt( void )
+{
+    kill( getpid(), SIGUSR1 );
+}
@@ -0,0 +1,86 @@
+/* FreeRTOS port for POSIX hosts (Linux), used by halposix
+ * MCUSH designed by Peng Shulin, all rights reserved. */
+#ifndef PORTMACRO_H
+#define PORTMACRO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Type definitions. */
+#define portCHAR        char
+#define portFLOAT       float
+#define portDOUBLE      double
+#define portLONG        long
+#define portSHORT       short
+#define portSTACK_TYPE  unsigned long
+#define portBASE_TYPE   long
+
+typedef portSTACK_TYPE StackType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#if( configUSE_16_BIT_TICKS == 1 )
+    typedef uint16_t TickType_t;
+    #define portMAX_DELAY ( TickType_t ) 0xffff
+#else
+    typedef uint32_t TickType_t;
+    #define portMAX_DELAY ( TickType_t ) 0xffffffffUL
+    #define portTICK_TYPE_IS_ATOMIC 1
+#endif
+
+/* Architecture specifics. */
+#define portSTACK_GROWTH            ( -1 )
+#define portTICK_PERIOD_MS          ( ( TickType_t ) 1000 / configTICK_RATE_HZ )
+#define portBYTE_ALIGNMENT          8
+#define portPOINTER_SIZE_TYPE       size_t
+#define portNOP()
+
+/* every task runs in its own thread, only one of them is allowed to run at
+   a time; the tick is SIGALRM and the interrupt mask is a flag checked by
+   the tick handler, so entering/exiting critical section costs no syscall */
+void vPortYield( void );
+void vPortYieldFromISR( void );
+void vPortDisableInterrupts( void );
+void vPortEnableInterrupts( void );
+void vPortEnterCritical( void );
+void vPortExitCritical( void );
+UBaseType_t xPortSetInterruptMask( void );
+void vPortClearInterruptMask( UBaseType_t xMask );
+void vPortCleanUpTCB( void *pxTCB );
+void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime );
+
+/* simulated interrupt, the handler runs in interrupt context on each
+   vPortGenerateInterrupt() call (safe from any host thread) and each tick */
+void vPortSetInterruptHandler( void (*pxHandler)( void ) );
+void vPortGenerateInterrupt( void );
+
+#define portYIELD()                                 vPortYield()
+#define portEND_SWITCHING_ISR( xSwitchRequired )    if( xSwitchRequired ) vPortYieldFromISR()
+#define portYIELD_FROM_ISR( x )                     portEND_SWITCHING_ISR( x )
+
+#define portDISABLE_INTERRUPTS()                    vPortDisableInterrupts()
+#define portENABLE_INTERRUPTS()                     vPortEnableInterrupts()
+#define portSET_INTERRUPT_MASK_FROM_ISR()           xPortSetInterruptMask()
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR( x )      vPortClearInterruptMask( x )
+#define portENTER_CRITICAL()                        vPortEnterCritical()
+#define portEXIT_CRITICAL()                         vPortExitCritical()
+
+/* the thread of a deleted task is joined before its stack is freed */
+#define portCLEAN_UP_TCB( pxTCB )                   vPortCleanUpTCB( pxTCB )
+
+/* idle task sleeps until next tick instead of spinning on a host core */
+#ifndef configUSE_TICKLESS_IDLE
+    #define configUSE_TICKLESS_IDLE                 1
+#endif
+#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime )  vPortSuppressTicksAndSleep( xExpectedIdleTime )
+
+/* Task function macros as described on the FreeRTOS.org WEB site. */
+#define portTASK_FUNCTION_PROTO( vFunction, pvParameters ) void vFunction( void *pvParameters )
+#define portTASK_FUNCTION( vFunction, pvParameters ) void vFunction( void *pvParameters )
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PORTMACRO_H */
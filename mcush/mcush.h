@@ -20,7 +20,9 @@
 #include "mcush_base64.h"
 #include "mcush_lib.h"
 #include "mcush_lib_crc.h"
+#include "mcush_ringbuf.h"
 #include "mcush_lib_fs.h"
+#include "mcush_xfer.h"
 
 
 #ifdef __cplusplus
@@ -34,7 +36,7 @@ extern "C" {
  * 5 -- reserved
  * 4 -- reserved
  * 3 -- shell task default
- * 2 -- reserved
+ * 2 -- vfs aio task default
  * 1 -- reserved
  * 0 -- lowest (idle task)
  */
@@ -50,6 +52,12 @@ extern "C" {
     #define MCUSH_QUEUE_SIZE  (64)
 #endif
 
+/* newlib syscall stubs (mcush_stub.c) and stdio overrides (mcush_vfs.c),
+   host builds use the C library instead */
+#ifndef MCUSH_NEWLIB_STUB
+    #define MCUSH_NEWLIB_STUB  1
+#endif
+
 #ifndef MCUSH_FREERTOS_PEEK_API
     #define MCUSH_FREERTOS_PEEK_API   1
 #endif
@@ -197,6 +205,29 @@ extern "C" {
 #ifndef USE_CMD_LOOP
     #define USE_CMD_LOOP  1
 #endif
+#if USE_SHELL_JOB
+    #ifndef USE_CMD_JOBS
+        #define USE_CMD_JOBS  1
+    #endif
+#else
+    #ifdef USE_CMD_JOBS
+        #undef USE_CMD_JOBS
+    #endif
+    #define USE_CMD_JOBS  0
+#endif
+#ifndef USE_CMD_CAPTURE
+    #define USE_CMD_CAPTURE  1
+#endif
+#if USE_SHELL_FRAME
+    #ifndef USE_CMD_FRAME
+        #define USE_CMD_FRAME  1
+    #endif
+#else
+    #ifdef USE_CMD_FRAME
+        #undef USE_CMD_FRAME
+    #endif
+    #define USE_CMD_FRAME  0
+#endif
 
 
 #if MCUSH_SPIFFS
@@ -244,6 +275,13 @@ extern "C" {
     #ifndef USE_CMD_CRC
         #define USE_CMD_CRC  0
     #endif
+    #ifndef USE_CMD_XFER
+        #define USE_CMD_XFER  1
+    #endif
+    /* opt-in, commands ending with "> file" or ">> file" change meaning */
+    #ifndef USE_SHELL_WRITE_REDIRECT
+        #define USE_SHELL_WRITE_REDIRECT  0
+    #endif
 #else
     #ifdef USE_CMD_CAT
         #undef USE_CMD_CAT
@@ -273,6 +311,14 @@ extern "C" {
         #undef USE_CMD_CRC
     #endif
     #define USE_CMD_CRC  0
+    #ifdef USE_CMD_XFER
+        #undef USE_CMD_XFER
+    #endif
+    #define USE_CMD_XFER  0
+    #ifdef USE_SHELL_WRITE_REDIRECT
+        #undef USE_SHELL_WRITE_REDIRECT
+    #endif
+    #define USE_SHELL_WRITE_REDIRECT  0
 
     #undef USE_CMD_UPGRADE
     #define USE_CMD_UPGRADE  0
@@ -1,4 +1,6 @@
 /* MCUSH designed by Peng Shulin, all rights reserved. */
+#include <stdint.h>
+#include <string.h>
 #include "mcush_base64.h"
 /****************************************************************************
 libb64: Base64 Encoding/Decoding Routines
@@ -53,6 +55,39 @@ For details, see http://sourceforge.net/projects/libb64
 
 static const int CHARS_PER_LINE = 76;
 
+static const char base64_encoding[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+#if BASE64_LUT12
+/* code chars for every 12 bits, 3 bytes are encoded with 2 lookups */
+#define _B64_ROW(c)  \
+    c"A" c"B" c"C" c"D" c"E" c"F" c"G" c"H" \
+    c"I" c"J" c"K" c"L" c"M" c"N" c"O" c"P" \
+    c"Q" c"R" c"S" c"T" c"U" c"V" c"W" c"X" \
+    c"Y" c"Z" c"a" c"b" c"c" c"d" c"e" c"f" \
+    c"g" c"h" c"i" c"j" c"k" c"l" c"m" c"n" \
+    c"o" c"p" c"q" c"r" c"s" c"t" c"u" c"v" \
+    c"w" c"x" c"y" c"z" c"0" c"1" c"2" c"3" \
+    c"4" c"5" c"6" c"7" c"8" c"9" c"+" c"/"
+
+static const char base64_lut12[] =
+    _B64_ROW("A") _B64_ROW("B") _B64_ROW("C") _B64_ROW("D")
+    _B64_ROW("E") _B64_ROW("F") _B64_ROW("G") _B64_ROW("H")
+    _B64_ROW("I") _B64_ROW("J") _B64_ROW("K") _B64_ROW("L")
+    _B64_ROW("M") _B64_ROW("N") _B64_ROW("O") _B64_ROW("P")
+    _B64_ROW("Q") _B64_ROW("R") _B64_ROW("S") _B64_ROW("T")
+    _B64_ROW("U") _B64_ROW("V") _B64_ROW("W") _B64_ROW("X")
+    _B64_ROW("Y") _B64_ROW("Z") _B64_ROW("a") _B64_ROW("b")
+    _B64_ROW("c") _B64_ROW("d") _B64_ROW("e") _B64_ROW("f")
+    _B64_ROW("g") _B64_ROW("h") _B64_ROW("i") _B64_ROW("j")
+    _B64_ROW("k") _B64_ROW("l") _B64_ROW("m") _B64_ROW("n")
+    _B64_ROW("o") _B64_ROW("p") _B64_ROW("q") _B64_ROW("r")
+    _B64_ROW("s") _B64_ROW("t") _B64_ROW("u") _B64_ROW("v")
+    _B64_ROW("w") _B64_ROW("x") _B64_ROW("y") _B64_ROW("z")
+    _B64_ROW("0") _B64_ROW("1") _B64_ROW("2") _B64_ROW("3")
+    _B64_ROW("4") _B64_ROW("5") _B64_ROW("6") _B64_ROW("7")
+    _B64_ROW("8") _B64_ROW("9") _B64_ROW("+") _B64_ROW("/");
+#endif
+
 void base64_init_encodestate(base64_encodestate* state_in)
 {
     state_in->step = step_A;
@@ -63,11 +98,10 @@ void base64_init_encodestate(base64_encodestate* state_in)
     
 char base64_encode_value(char value_in)
 {
-    static const char encoding[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
     if (value_in > 63)
         return '=';
     else
-        return encoding[(int)value_in];
+        return base64_encoding[(int)value_in];
 }
 
 int base64_encode_block(const char* plaintext_in, int length_in, char* code_out, base64_encodestate* state_in)
@@ -77,6 +111,7 @@ int base64_encode_block(const char* plaintext_in, int length_in, char* code_out,
     char *codechar = code_out;
     char result;
     char fragment;
+    uint32_t v;
     
     result = state_in->result;
     
@@ -85,6 +120,29 @@ int base64_encode_block(const char* plaintext_in, int length_in, char* code_out,
         while (1)
         {
     case step_A:
+            /* bulk: whole 3-byte groups while aligned to a group */
+            while (plaintextend - plainchar >= 3)
+            {
+                v = ((uint32_t)(uint8_t)plainchar[0] << 16) |
+                    ((uint32_t)(uint8_t)plainchar[1] << 8) |
+                     (uint32_t)(uint8_t)plainchar[2];
+                plainchar += 3;
+#if BASE64_LUT12
+                memcpy(codechar, &base64_lut12[(v >> 12) << 1], 2);
+                memcpy(codechar+2, &base64_lut12[(v & 0xFFFu) << 1], 2);
+#else
+                codechar[0] = base64_encoding[v >> 18];
+                codechar[1] = base64_encoding[(v >> 12) & 0x3Fu];
+                codechar[2] = base64_encoding[(v >> 6) & 0x3Fu];
+                codechar[3] = base64_encoding[v & 0x3Fu];
+#endif
+                codechar += 4;
+                if (++(state_in->stepcount) == CHARS_PER_LINE/4)
+                {
+                    *codechar++ = '\n';
+                    state_in->stepcount = 0;
+                }
+            }
             if (plainchar == plaintextend)
             {
                 state_in->result = result;
@@ -167,16 +225,29 @@ For details, see http://sourceforge.net/projects/libb64
 //#include "cdecode.h"
 
 
+/* -1 for chars to be skipped, -2 for the padding */
+static const signed char base64_decoding[256] = {
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,62,-1,-1,-1,63,
+    52,53,54,55,56,57,58,59,60,61,-1,-1,-1,-2,-1,-1,
+    -1,0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,
+    15,16,17,18,19,20,21,22,23,24,25,-1,-1,-1,-1,-1,
+    -1,26,27,28,29,30,31,32,33,34,35,36,37,38,39,40,
+    41,42,43,44,45,46,47,48,49,50,51,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+};
+
 int base64_decode_value(char value_in)
 {
-    static const signed char decoding[] = {62,-1,-1,-1,63,52,53,54,55,56,57,58,59,60,61,-1,-1,-1,-2,-1,-1,-1,0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,-1,-1,-1,-1,-1,-1,26,27,28,29,30,31,32,33,34,35,36,37,38,39,40,41,42,43,44,45,46,47,48,49,50,51};
-    static const char decoding_size = sizeof(decoding);
-    if (value_in < 43)
-        return -1;
-    value_in -= 43;
-    if (value_in > decoding_size)
-        return -1;
-    return decoding[(int)value_in];
+    return base64_decoding[(uint8_t)value_in];
 }
 
 void base64_init_decodestate(base64_decodestate* state_in)
@@ -198,6 +269,23 @@ int base64_decode_block(const char* code_in, const int length_in, char* plaintex
         while (1)
         {
     case step_a:
+            /* bulk: 4 valid chars to 3 bytes, falls back on line ends,
+               padding and noise */
+            while (code_in + length_in - codechar >= 4)
+            {
+                int a = base64_decoding[(uint8_t)codechar[0]];
+                int b = base64_decoding[(uint8_t)codechar[1]];
+                int c = base64_decoding[(uint8_t)codechar[2]];
+                int d = base64_decoding[(uint8_t)codechar[3]];
+                if ((a | b | c | d) < 0)
+                    break;
+                fragment = (a << 18) | (b << 12) | (c << 6) | d;
+                plainchar[0] = (char)(fragment >> 16);
+                plainchar[1] = (char)(fragment >> 8);
+                plainchar[2] = (char)fragment;
+                plainchar += 3;
+                codechar += 4;
+            }
             do {
                 if (codechar == code_in+length_in)
                 {
@@ -52,6 +52,12 @@ For details, see http://sourceforge.net/projects/libb64
 extern "C" {
 #endif
 
+/* 8KB code table for the encoder, 0 for the 64 chars table,
+   enable it for large flash chips only */
+#ifndef BASE64_LUT12
+    #define BASE64_LUT12  0
+#endif
+
 
 typedef enum
 {
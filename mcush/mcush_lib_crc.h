@@ -1,7 +1,7 @@
 /****************************** BEGIN OF FILE *******************************/
 /* NOTES:                                                                   */
 /* THIS FILE IS GENERATED AUTOMATICALLY, DO NOT MODIFY IT MANUALLY !!!      */
-/* Last modified at Tue Aug 21 08:32:01 2018                                */
+/* Last modified at Sat Oct 17 05:53:41 2026                                */
 /****************************************************************************/
 #ifndef __MCUSH_LIB_CRC_H__
 #define __MCUSH_LIB_CRC_H__
@@ -16,25 +16,66 @@
 extern "C" {
 #endif
 
+/* lookup tables per byte for the sliced crcs, 1 (bytewise), 4 or 8,
+   costs (CRC_SLICING-1)*256 more entries each (crc16_modbus and crc32),
+   define it for the whole build as the tables are shared */
+#ifndef CRC_SLICING
+    #define CRC_SLICING  1
+#endif
+
+#if (CRC_SLICING != 1) && (CRC_SLICING != 4) && (CRC_SLICING != 8)
+    #error "CRC_SLICING must be 1, 4 or 8"
+#endif
 
 uint8_t _crc8(const uint8_t *data, int len, uint8_t crc, const uint8_t *table);
 uint16_t _crc16(const uint8_t *data, int len, uint16_t crc, const uint16_t *table);
 uint32_t _crc32(const uint8_t *data, int len, uint32_t crc, const uint32_t *table);
+uint32_t _crc32_update(const uint8_t *data, int len, uint32_t crc, const uint32_t *table);
+uint16_t _crc16_slicing(const uint8_t *data, int len, uint16_t crc, const uint16_t (*table)[256]);
+uint32_t _crc32_slicing(const uint8_t *data, int len, uint32_t crc, const uint32_t (*table)[256]);
+
+/* streaming api, for each crc type:
+       crcX( buf, len ) == crcX_final( crcX_update( crcX_init(), buf, len ) )
+   crcX_update is weak, hal may override it with the hardware crc unit,
+   the value passed between calls is the raw crc register */
 
 extern const uint8_t crc8_table[256];
 uint8_t crc8( uint8_t *buf, int len );
+uint8_t crc8_init( void );
+uint8_t crc8_update( uint8_t crc, const uint8_t *buf, int len );
+uint8_t crc8_final( uint8_t crc );
 extern const uint16_t crc16_table[256];
 uint16_t crc16( uint8_t *buf, int len );
+uint16_t crc16_init( void );
+uint16_t crc16_update( uint16_t crc, const uint8_t *buf, int len );
+uint16_t crc16_final( uint16_t crc );
 extern const uint16_t crc16_xmodem_table[256];
 uint16_t crc16_xmodem( uint8_t *buf, int len );
-extern const uint16_t crc16_modbus_table[256];
+uint16_t crc16_xmodem_init( void );
+uint16_t crc16_xmodem_update( uint16_t crc, const uint8_t *buf, int len );
+uint16_t crc16_xmodem_final( uint16_t crc );
+extern const uint16_t crc16_modbus_tables[CRC_SLICING][256];
+#define crc16_modbus_table  (crc16_modbus_tables[0])
 uint16_t crc16_modbus( uint8_t *buf, int len );
+uint16_t crc16_modbus_init( void );
+uint16_t crc16_modbus_update( uint16_t crc, const uint8_t *buf, int len );
+uint16_t crc16_modbus_final( uint16_t crc );
 extern const uint16_t crc16_kermit_table[256];
 uint16_t crc16_kermit( uint8_t *buf, int len );
+uint16_t crc16_kermit_init( void );
+uint16_t crc16_kermit_update( uint16_t crc, const uint8_t *buf, int len );
+uint16_t crc16_kermit_final( uint16_t crc );
 extern const uint32_t crc24_table[256];
 uint32_t crc24( uint8_t *buf, int len );
-extern const uint32_t crc32_table[256];
+uint32_t crc24_init( void );
+uint32_t crc24_update( uint32_t crc, const uint8_t *buf, int len );
+uint32_t crc24_final( uint32_t crc );
+extern const uint32_t crc32_tables[CRC_SLICING][256];
+#define crc32_table  (crc32_tables[0])
 uint32_t crc32( uint8_t *buf, int len );
+uint32_t crc32_init( void );
+uint32_t crc32_update( uint32_t crc, const uint8_t *buf, int len );
+uint32_t crc32_final( uint32_t crc );
 
 #ifdef __cplusplus
 }
@@ -1,6 +1,9 @@
 /* MCUSH designed by Peng Shulin, all rights reserved. */
 #if MCUSH_VFS
 #include "mcush.h"
+#if USE_SHELL_PRINTF2
+#include "mcush_printf2.h"
+#endif
 #include <sys/fcntl.h>
 
 
@@ -58,29 +61,230 @@ int mcush_file_crc8( const char *fname )
 }
 
 
+#ifndef MCUSH_FILE_CRC_BUF_SIZE
+    #define MCUSH_FILE_CRC_BUF_SIZE  1024
+#endif
+/* straight from memory for mapped files, otherwise large buffer from heap
+   if possible, fewer driver calls and sliced crc */
 int mcush_file_crc32( const char *fname )
 {
     int fd = mcush_open( fname, "r" );
-    uint8_t buf[_READ_BUF_SIZE];
-    uint32_t crc=0;
+    uint8_t sbuf[_READ_BUF_SIZE], *buf;
+    const void *map;
+    int size=MCUSH_FILE_CRC_BUF_SIZE;
+    uint32_t crc;
     int r;
     int bytes=0;
 
     if( fd == 0 )
         return -1;
+    if( mcush_mmap( fd, &map, &bytes ) )
+    {
+        mcush_close( fd );
+        return bytes > 0 ? crc32_final( crc32_update( crc32_init(), map, bytes ) ) : -1;
+    }
+    buf = pvPortMalloc( size );
+    if( buf == 0 )
+    {
+        buf = sbuf;
+        size = _READ_BUF_SIZE;
+    }
+    crc = crc32_init();
     while(1)
     { 
-        r = mcush_read( fd, buf, _READ_BUF_SIZE );
+        r = mcush_read( fd, buf, size );
         if( r < 0 )
             break;
         bytes += r;
         if( r > 0 )
-            crc = _crc32( buf, r, crc, crc32_table ); 
-        if( r != _READ_BUF_SIZE )
+            crc = crc32_update( crc, buf, r ); 
+        if( r != size )
             break;
     }
     mcush_close( fd );
-    return bytes > 0 ? crc : -1;
+    if( buf != sbuf )
+        vPortFree( buf );
+    return bytes > 0 ? crc32_final( crc ) : -1;
+}
+
+
+#ifndef MCUSH_FILE_COPY_BUF_SIZE
+    #define MCUSH_FILE_COPY_BUF_SIZE  4096
+#endif
+#ifndef MCUSH_FILE_COPY_OVERLAP
+    #define MCUSH_FILE_COPY_OVERLAP  1
+#endif
+#ifndef MCUSH_FILE_COPY_STACK_SIZE
+    #define MCUSH_FILE_COPY_STACK_SIZE  (2*1024)
+#endif
+#ifndef MCUSH_FILE_COPY_PRIORITY
+    #define MCUSH_FILE_COPY_PRIORITY  (MCUSH_PRIORITY)
+#endif
+#define _COPY_SLOTS  2
+
+#if MCUSH_FILE_COPY_OVERLAP
+typedef struct {
+    int fd;
+    QueueHandle_t empty, full;
+    uint8_t *buf[_COPY_SLOTS];
+    int len[_COPY_SLOTS];
+    volatile int err;
+} mcush_file_copy_ctx_t;
+
+
+/* writer task, zero length slot ends it, every slot is returned to the
+   empty queue so the reader knows when all has been written */
+static void mcush_file_copy_writer( void *p )
+{
+    mcush_file_copy_ctx_t *ctx = (mcush_file_copy_ctx_t*)p;
+    uint8_t i;
+
+    while( 1 )
+    {
+        xQueueReceive( ctx->full, &i, portMAX_DELAY );
+        if( ctx->len[i] == 0 )
+            break;
+        if( ! ctx->err && (mcush_write( ctx->fd, ctx->buf[i], ctx->len[i] ) != ctx->len[i]) )
+            ctx->err = 1;
+        xQueueSend( ctx->empty, &i, portMAX_DELAY );
+    }
+    xQueueSend( ctx->empty, &i, portMAX_DELAY );
+    vTaskDelete( NULL );
+}
+
+
+/* read into one slot while the other is being written,
+   returns bytes copied or -1 if resources are not available */
+static int mcush_file_copy_overlapped( int fd, int fd2, int size, int *err )
+{
+    mcush_file_copy_ctx_t ctx;
+    uint8_t i, eof=0;
+    int r, bytes=0;
+
+    memset( &ctx, 0, sizeof(ctx) );
+    ctx.fd = fd2;
+    ctx.buf[0] = pvPortMalloc( size * _COPY_SLOTS );
+    ctx.empty = xQueueCreate( _COPY_SLOTS, 1 );
+    ctx.full = xQueueCreate( _COPY_SLOTS, 1 );
+    if( ctx.buf[0] && ctx.empty && ctx.full )
+    {
+        for( i=0; i<_COPY_SLOTS; i++ )
+        {
+            ctx.buf[i] = ctx.buf[0] + i * size;
+            xQueueSend( ctx.empty, &i, 0 );
+        }
+        if( xTaskCreate( (TaskFunction_t)mcush_file_copy_writer, (const char *)"cpT",
+                    MCUSH_FILE_COPY_STACK_SIZE / sizeof(portSTACK_TYPE),
+                    &ctx, MCUSH_FILE_COPY_PRIORITY, NULL ) != pdPASS )
+            bytes = -1;
+    }
+    else
+        bytes = -1;
+
+    if( bytes == 0 )
+    {
+        while( 1 )
+        {
+            xQueueReceive( ctx.empty, &i, portMAX_DELAY );
+            r = (eof || ctx.err) ? 0 : mcush_read( fd, ctx.buf[i], size );
+            if( r < 0 )
+            {
+                ctx.err = 1;
+                r = 0;
+            }
+            ctx.len[i] = r;
+            xQueueSend( ctx.full, &i, portMAX_DELAY );
+            if( r == 0 )
+                break;
+            bytes += r;
+            if( r < size )
+                eof = 1;
+        }
+        /* all slots back means the writer has quit */
+        for( r=0; r<_COPY_SLOTS; r++ )
+            xQueueReceive( ctx.empty, &i, portMAX_DELAY );
+        *err = ctx.err;
+    }
+    if( ctx.full )
+        vQueueDelete( ctx.full );
+    if( ctx.empty )
+        vQueueDelete( ctx.empty );
+    if( ctx.buf[0] )
+        vPortFree( ctx.buf[0] );
+    return bytes;
+}
+#endif
+
+
+/* copy with large heap buffer (0 for default size), the reading and writing
+   overlap when the files are on different volumes, returns 1 for success */
+int mcush_file_copy( const char *src, const char *dst, int buf_size, mcush_file_copy_stat_t *stat )
+{
+    uint8_t sbuf[_READ_BUF_SIZE], *buf=0;
+    TickType_t t0 = xTaskGetTickCount();
+    int fd, fd2, r, bytes=-1, err=0;
+
+    if( buf_size <= 0 )
+        buf_size = MCUSH_FILE_COPY_BUF_SIZE;
+    if( stat )
+        memset( stat, 0, sizeof(mcush_file_copy_stat_t) );
+    fd = mcush_open( src, "r" );
+    if( fd == 0 )
+        return 0;
+    fd2 = mcush_open( dst, "w+" );
+    if( fd2 == 0 )
+    {
+        mcush_close( fd );
+        return 0;
+    }
+#if MCUSH_FILE_COPY_OVERLAP
+    if( get_vol( src ) != get_vol( dst ) )
+    {
+        bytes = mcush_file_copy_overlapped( fd, fd2, buf_size, &err );
+        if( (bytes >= 0) && stat )
+            stat->overlapped = 1;
+    }
+#endif
+    if( bytes < 0 )
+    {
+        /* same volume, or not enough memory for two slots */
+        buf = pvPortMalloc( buf_size );
+        if( buf == 0 )
+        {
+            buf = sbuf;
+            buf_size = _READ_BUF_SIZE;
+        }
+        bytes = 0;
+        while( 1 )
+        {
+            r = mcush_read( fd, buf, buf_size );
+            if( r < 0 )
+                err = 1;
+            if( r <= 0 )
+                break;
+            if( mcush_write( fd2, buf, r ) != r )
+            {
+                err = 1;
+                break;
+            }
+            bytes += r;
+            if( r < buf_size )
+                break;
+        }
+        if( buf != sbuf )
+            vPortFree( buf );
+    }
+    mcush_close( fd );
+    /* the last cached/buffered data is written back on close */
+    if( ! mcush_close( fd2 ) )
+        err = 1;
+    if( stat )
+    {
+        stat->bytes = bytes;
+        stat->buf_size = buf_size;
+        stat->ticks = xTaskGetTickCount() - t0;
+    }
+    return err ? 0 : 1;
 }
 
 
@@ -253,7 +457,12 @@ int mcush_file_write_float( const char *fname, float val )
 {
     char buf[64];
 
+#if USE_SHELL_PRINTF2
+    /* shortest string that reads back the same value */
+    stringf_float( buf, val, -1, 'g' );
+#else
     sprintf( buf, "%f", val );
+#endif
     return mcush_file_write_string( fname, buf );
 }
 
@@ -4,10 +4,18 @@
 
 char *parse_file_flag( int flag, char *buf );
 
+typedef struct {
+    int bytes;
+    int buf_size;
+    uint32_t ticks;
+    uint8_t overlapped;
+} mcush_file_copy_stat_t;
+
 
 int mcush_file_exists( const char *fname );
 int mcush_file_crc8( const char *fname );
 int mcush_file_crc32( const char *fname );
+int mcush_file_copy( const char *src, const char *dst, int buf_size, mcush_file_copy_stat_t *stat );
 int mcush_file_remove_retry( const char *fname, int retry_num );
 int mcush_file_read_line( int fd, char *line );
 
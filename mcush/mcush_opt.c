@@ -18,11 +18,74 @@
     #define ASSERT(c)
 #endif
 
+#if MCUSH_OPT_INDEX_SIZE
+/* long names are hashed by the first two chars, so that neither building
+   the index nor looking up needs the length, short aliases are compared
+   directly as it's as cheap as hashing */
+#define INDEX_MASK  (MCUSH_OPT_INDEX_SIZE - 1)
+#define HASH_NAME(c0, c1)  (((unsigned char)(c0) + ((unsigned char)(c1) << 1) + 7) & INDEX_MASK)
+
+static int index_add(mcush_opt_parser *parser, unsigned int hash, int pos)
+{
+    int i;
+
+    for (i = 0; i < INDEX_MASK; i++) {
+        if (!parser->index[hash]) {
+            parser->index[hash] = pos + 1;
+            return 1;
+        }
+        hash = (hash + 1) & INDEX_MASK;
+    }
+    /* at least one empty slot is kept to stop the lookup */
+    return 0;
+}
+
+static void index_build(mcush_opt_parser *parser)
+{
+    const mcush_opt_spec *spec;
+    int pos;
+
+    for (spec = parser->specs, pos = 0; spec->type; ++spec, ++pos) {
+        if (spec->type != MCUSH_OPT_SWITCH && spec->type != MCUSH_OPT_VALUE)
+            continue;
+        if (pos > 254)
+            return;
+        if (spec->name && spec->name[0] &&
+                !index_add(parser, HASH_NAME(spec->name[0], spec->name[1]), pos))
+            return;
+    }
+    parser->indexed = 1;
+}
+#endif
+
+
 INLINE(const mcush_opt_spec *) spec_byname(
     mcush_opt_parser *parser, const char *name, size_t namelen)
 {
     const mcush_opt_spec *spec;
 
+#if MCUSH_OPT_INDEX_SIZE
+    /* built on first use, commands are often called with short options only */
+    if (!parser->index_built) {
+        parser->index_built = 1;
+        index_build(parser);
+    }
+    if (parser->indexed && namelen) {
+        unsigned int hash = HASH_NAME(name[0], namelen > 1 ? name[1] : 0);
+        unsigned char pos;
+
+        while ((pos = parser->index[hash]) != 0) {
+            spec = &parser->specs[pos - 1];
+            if (spec->name && spec->name[0] == name[0] &&
+                    strncmp(name, spec->name, namelen) == 0 &&
+                    spec->name[namelen] == 0)
+                return spec;
+            hash = (hash + 1) & INDEX_MASK;
+        }
+        return NULL;
+    }
+#endif
+
     for (spec = parser->specs; spec->type; ++spec) {
         if (spec->type == MCUSH_OPT_LITERAL && namelen == 0)
             return spec;
@@ -85,6 +148,7 @@ static void parse_long(mcush_opt *opt, mcush_opt_parser *parser)
     }
 
     opt->spec = spec;
+    opt->id = spec->id ? spec->id : spec->alias;
 
     /* Future options parsed as literal */
     if (spec->type == MCUSH_OPT_LITERAL) {
@@ -147,6 +211,7 @@ static void parse_short(mcush_opt *opt, mcush_opt_parser *parser)
     }
 
     opt->spec = spec;
+    opt->id = spec->id ? spec->id : spec->alias;
 
     /* parse values in this order:
          (single argument mode)
@@ -200,6 +265,8 @@ static void parse_arg(mcush_opt *opt, mcush_opt_parser *parser)
 {
     opt->spec = spec_nextarg(parser);
     opt->value = parser->args[parser->idx++];
+    if (opt->spec)
+        opt->id = opt->spec->id;
 }
 
 
@@ -77,8 +77,18 @@ typedef struct mcush_opt_spec {
 	 */
 	const char *help;
 
+	/**
+	 * Option id returned in `mcush_opt.id`, defaults to the alias.
+	 * Options without alias use ids from `MCUSH_OPT_ID_USER` so that
+	 * handlers can `switch` on it instead of comparing names.
+	 */
+	const unsigned char id;
+
 } mcush_opt_spec;
 
+/** First id for options without alias, above all alias characters. */
+#define MCUSH_OPT_ID_USER  0x80
+
 /** An option provided on the command-line. */
 typedef struct mcush_opt {
 	/**
@@ -94,8 +104,23 @@ typedef struct mcush_opt {
 	 * point to the unknown argument.
 	 */
 	const char *value;
+
+	/**
+	 * The `id` of the matched spec (or its alias if id is not set),
+	 * 0 if the argument did not match.
+	 */
+	int id;
 } mcush_opt;
 
+/**
+ * Slots of the long option name index, built by the parser on the first
+ * long option. Power of 2 and larger than the number of named options,
+ * or the parser falls back to linear search. 0 to disable.
+ */
+#ifndef MCUSH_OPT_INDEX_SIZE
+	#define MCUSH_OPT_INDEX_SIZE  32
+#endif
+
 /**
  * The mcush_opt_parser structure.  Callers should not modify these values
  * directory.
@@ -108,7 +133,13 @@ typedef struct mcush_opt_parser {
 	size_t idx;
 	size_t arg_idx;
 	int in_literal : 1,
-		in_short : 1;
+		in_short : 1,
+		index_built : 1,
+		indexed : 1;
+#if MCUSH_OPT_INDEX_SIZE
+	/** spec position + 1 hashed by name, 0 for empty slot */
+	unsigned char index[MCUSH_OPT_INDEX_SIZE];
+#endif
 } mcush_opt_parser;
 
 /**
@@ -70,17 +70,10 @@
 #include "shell.h"
 #if USE_SHELL_PRINTF2
 #include "mcush_printf2.h"
-#include <math.h>
 #include <string.h>
 #include <stdarg.h>
 #include <limits.h>
 
-#if USE_FLOATING_POINT
-#define FLOAT_OR_DOUBLE float
-#else
-#define FLOAT_OR_DOUBLE double
-#endif
-
 //lint -e534  Ignoring return value of function 
 //lint -e539  Did not expect positive indentation from line ...
 //lint -e525  Negative indentation from line ...
@@ -90,9 +83,31 @@ typedef  unsigned int   uint ;
 
 
 
+//****************************************************************************
+//  output context: either a plain string or a sink callback, for the sink
+//  mode characters are collected in a small chunk and flushed when full
+//****************************************************************************
+typedef struct {
+    char *str;
+    printf2_sink_t sink;
+    char *chunk;
+    int chunk_len;
+} printf2_out_t;
+
+
+static void flush_chunk( printf2_out_t *out )
+{
+    if( out->chunk_len )
+    {
+        out->sink( out->chunk, out->chunk_len );
+        out->chunk_len = 0;
+    }
+}
+
+
 //****************************************************************************
 static int printchar (
-    char **str,
+    printf2_out_t *out,
     int c,
     unsigned int max_output_len,
     int *cur_output_char_p)
@@ -100,9 +115,15 @@ static int printchar (
     if (max_output_len >= 0  &&  *cur_output_char_p >= max_output_len)
         return PRINTF2_OK;
 
-    if (str) {
-        **str = (char) c;
-        ++(*str);
+    if (out->sink) {
+        out->chunk[out->chunk_len++] = (char) c;
+        if (out->chunk_len >= PRINTF2_SINK_CHUNK_SIZE)
+            flush_chunk(out);
+        (*cur_output_char_p)++ ;
+    }
+    else if (out->str) {
+        *out->str = (char) c;
+        ++out->str;
         (*cur_output_char_p)++ ;
     }
     else return PRINTF2_NULL_PTR;
@@ -111,195 +132,507 @@ static int printchar (
 }
 
 //****************************************************************************
-//  This version returns the length of the output string.
-//  It is more useful when implementing a walking-string function.
+//  bulk version of printchar, the output length is counted even if truncated
 //****************************************************************************
-//lint -esym(728, round_nums)
-//static const FLOAT_OR_DOUBLE round_nums[8] = {
-static const FLOAT_OR_DOUBLE round_nums[] = {
-        0.5,
-        0.05,
-        0.005,
-        0.0005,
-        0.00005,
-        0.000005,
-        0.0000005,
-        0.00000005,
-#if ! USE_FLOATING_POINT
-        0.000000005,
-        0.0000000005,
-        0.00000000005,
-        0.000000000005,
-        0.0000000000005,
-        0.00000000000005,
-        0.000000000000005,
-#endif
-} ;
-
-static unsigned fltordbl2stri(char *outbfr, FLOAT_OR_DOUBLE flt_or_dbl, unsigned dec_digits, int use_leading_plus)
+static int printbuf (
+    printf2_out_t *out,
+    const char *buf,
+    int len,
+    unsigned int max_output_len,
+    int *cur_output_char_p)
 {
-    static char local_bfr[128] ;
-    char *output = (outbfr == 0) ? local_bfr : outbfr ;
-
-    //*******************************************
-    //  extract negative info
-    //*******************************************
-    if (flt_or_dbl < 0.0) {
-        *output++ = '-' ;
-        flt_or_dbl *= -1.0 ;
-    } else {
-        if (use_leading_plus) {
-            *output++ = '+' ;
-        }
+    unsigned int n, l;
 
+    if ((unsigned)*cur_output_char_p >= max_output_len)
+        return PRINTF2_OK;
+    /* unsigned, max_output_len is huge for unbounded sprintf */
+    n = max_output_len - (unsigned)*cur_output_char_p;
+    if (n > (unsigned)len)
+        n = len;
+
+    if (out->sink) {
+        while (n) {
+            l = PRINTF2_SINK_CHUNK_SIZE - out->chunk_len;
+            if (l > n)
+                l = n;
+            memcpy(out->chunk + out->chunk_len, buf, l);
+            out->chunk_len += l;
+            if (out->chunk_len >= PRINTF2_SINK_CHUNK_SIZE)
+                flush_chunk(out);
+            buf += l;
+            n -= l;
+            *cur_output_char_p += l;
+        }
+    }
+    else if (out->str) {
+        memcpy(out->str, buf, n);
+        out->str += n;
+        *cur_output_char_p += n;
     }
+    else return PRINTF2_NULL_PTR;
+
+    return PRINTF2_OK;
+}
+
+
+//****************************************************************************
+//  integer to decimal, two digits per division
+//****************************************************************************
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/* written backward ending at end, nothing for zero, returns the first digit */
+static char *u32_to_dec(char *end, uint32_t u)
+{
+    const char *p;
 
-    //  handling rounding by adding .5LSB to the floating-point data
-    if (dec_digits < 8) {
-        flt_or_dbl += round_nums[dec_digits] ;
+    while (u >= 100) {
+        p = digit_pairs + (u % 100) * 2;
+        u /= 100;
+        *--end = p[1];
+        *--end = p[0];
     }
+    if (u >= 10) {
+        p = digit_pairs + u * 2;
+        *--end = p[1];
+        *--end = p[0];
+    }
+    else if (u)
+        *--end = '0' + u;
+    return end;
+}
+
+
+//****************************************************************************
+//  float32 to decimal
+//  A float is m*2^e with m of 24 bits, so its decimal expansion is finite
+//  and can be generated exactly: the integer part with (multiword) division,
+//  the fractional part by multiplying a multiword fixed-point number by 10.
+//  For usual magnitudes both fit in one word.  Rounding is half to even on
+//  the exact value, same as glibc.
+//****************************************************************************
+#define FTOA_INT_WORDS   5     /* 2^128 for FLT_MAX, m<2^26 for boundaries */
+#define FTOA_INT_DIGITS  45
+#define FTOA_FRAC_WORDS  5     /* 2^-151 for boundaries of denormals */
+#define FTOA_FLAG_PLUS   0x01
+#define FTOA_FLAG_SPACE  0x02
+#define FTOA_FLAG_ALT    0x04
+#define FTOA_FLAG_UPPER  0x08
+
+#ifndef PRINTF2_FLOAT_PREC_MAX
+    #define PRINTF2_FLOAT_PREC_MAX  48
+#endif
+#define FTOA_BUF_LEN  (PRINTF2_FLOAT_PREC_MAX+48)
+
+typedef struct {
+    char idig[FTOA_INT_DIGITS];  /* integer part digits */
+    int ipos, iend;              /* not yet consumed integer digits */
+    uint32_t w[FTOA_FRAC_WORDS]; /* fraction, w[0] is the most significant */
+    int nw;                      /* fraction words, 0 if no more digits */
+} ftoa_src_t;
 
-    //**************************************************************************
-    //  construct fractional multiplier for specified number of digits.
-    //**************************************************************************
-    uint mult = 1 ;
-    uint idx ;
-    for (idx=0; idx < dec_digits; idx++)
-        mult *= 10 ;
+typedef struct {
+    char dig[FTOA_INT_DIGITS+PRINTF2_FLOAT_PREC_MAX+2];
+    int n;       /* digits */
+    int dexp;    /* decimal exponent of dig[0] */
+    int rdig;    /* next digit, for rounding */
+    int sticky;  /* any non-zero after rdig */
+} ftoa_dig_t;
 
-    // printf("mult=%u\n", mult) ;
-    uint wholeNum = (uint) flt_or_dbl ;
-    uint decimalNum = (uint) ((flt_or_dbl - wholeNum) * mult);
 
-    //*******************************************
-    //  convert integer portion
-    //*******************************************
-    char tbfr[40] ;
-    idx = 0 ;
-    while (wholeNum != 0) {
-        tbfr[idx++] = '0' + (wholeNum % 10) ;
-        wholeNum /= 10 ;
+static void ftoa_src_init(ftoa_src_t *src, uint32_t m, int e)
+{
+    uint32_t b[FTOA_INT_WORDS], r, fm;
+    int nb, i, shift;
+    char *p, *end;
+
+    end = src->idig + FTOA_INT_DIGITS;
+    src->nw = 0;
+    if (e >= 0) {
+        if (e <= 5) {
+            p = u32_to_dec(end, m << e);
+        }
+        else {
+            /* big integer, little endian words */
+            memset(b, 0, sizeof(b));
+            nb = e / 32;
+            shift = e % 32;
+            b[nb] = m << shift;
+            if (shift)
+                b[nb+1] = m >> (32 - shift);
+            nb += 2;
+            p = end;
+            while (1) {
+                while (nb && !b[nb-1])
+                    nb--;
+                if (!nb)
+                    break;
+                for (r=0, i=nb-1; i>=0; i--) {
+                    uint64_t t = ((uint64_t)r << 32) | b[i];
+                    b[i] = (uint32_t)(t / 1000000000);
+                    r = (uint32_t)(t % 1000000000);
+                }
+                /* 9 digits per chunk, zero padded except the leading one */
+                end = p - 9;
+                p = u32_to_dec(p, r);
+                if (nb > 1 || b[0]) {
+                    while (p > end)
+                        *--p = '0';
+                }
+            }
+        }
     }
-    // printf("%.3f: whole=%s, dec=%d\n", dbl, tbfr, decimalNum) ;
-    if (idx == 0) {
-        *output++ = '0' ;
-    } else {
-        while (idx > 0) {
-            *output++ = tbfr[idx-1] ;  //lint !e771
-            idx-- ;
+    else {
+        shift = -e;
+        if (shift < 32) {
+            p = u32_to_dec(end, m >> shift);
+            fm = m & ((1u << shift) - 1);
         }
+        else {
+            p = end;
+            fm = m;
+        }
+        if (fm) {
+            /* fm placed at the bottom of nw words, left aligned to the point */
+            src->nw = (shift + 31) / 32;
+            memset(src->w, 0, sizeof(src->w));
+            shift = src->nw * 32 - shift;
+            src->w[src->nw-1] = fm << shift;
+            if (shift && src->nw > 1)
+                src->w[src->nw-2] = fm >> (32 - shift);
+        }
+    }
+    src->ipos = p - src->idig;
+    src->iend = FTOA_INT_DIGITS;
+}
+
+
+static int ftoa_src_next(ftoa_src_t *src)
+{
+    uint32_t carry = 0;
+    uint64_t t;
+    int i;
+
+    if (src->ipos < src->iend)
+        return src->idig[src->ipos++] - '0';
+    for (i=src->nw-1; i>=0; i--) {
+        t = (uint64_t)src->w[i] * 10 + carry;
+        src->w[i] = (uint32_t)t;
+        carry = (uint32_t)(t >> 32);
     }
-    if (dec_digits > 0) {
-        *output++ = '.' ;
+    /* zero tail words stay zero */
+    while (src->nw && !src->w[src->nw-1])
+        src->nw--;
+    return carry;
+}
+
+
+static int ftoa_src_sticky(ftoa_src_t *src)
+{
+    int i;
+
+    for (i=src->ipos; i<src->iend; i++) {
+        if (src->idig[i] != '0')
+            return 1;
+    }
+    return src->nw != 0;
+}
+
 
-        //*******************************************
-        //  convert fractional portion
-        //*******************************************
-        idx = 0 ;
-        while (decimalNum != 0) {
-            tbfr[idx++] = '0' + (decimalNum % 10) ;
-            decimalNum /= 10 ;
+/* exact digits of m*2^e (non-zero for significant mode), not rounded
+   fixed: ndig digits after the point, starting from the 10^0 position
+   otherwise: ndig significant digits */
+static void ftoa_digits(ftoa_dig_t *d, uint32_t m, int e, int ndig, int fixed)
+{
+    ftoa_src_t src;
+    int pos, c;
+
+    ftoa_src_init(&src, m, e);
+    d->n = 0;
+    if (fixed) {
+        if (src.ipos < src.iend) {
+            d->dexp = src.iend - src.ipos - 1;
         }
-        //  pad the decimal portion with 0s as necessary;
-        //  We wouldn't want to report 3.093 as 3.93, would we??
-        while (idx < dec_digits) {
-            tbfr[idx++] = '0' ;
+        else {
+            d->dexp = 0;
+            d->dig[d->n++] = '0';
         }
-        // printf("decimal=%s\n", tbfr) ;
-        if (idx == 0) {
-            *output++ = '0' ;
-        } else {
-            while (idx > 0) {
-                *output++ = tbfr[idx-1] ;
-                idx-- ;
-            }
+        ndig += d->dexp + 1;
+    }
+    else {
+        pos = src.iend - src.ipos - 1;
+        while ((c = ftoa_src_next(&src)) == 0)
+            pos--;
+        d->dexp = pos;
+        d->dig[d->n++] = '0' + c;
+    }
+    while (d->n < ndig)
+        d->dig[d->n++] = '0' + ftoa_src_next(&src);
+    d->rdig = ftoa_src_next(&src);
+    d->sticky = ftoa_src_sticky(&src);
+}
+
+
+/* round half to even at n digits, the digit after is rdig */
+static void ftoa_round(ftoa_dig_t *d, int n, int rdig, int sticky, int fixed)
+{
+    int i;
+
+    d->n = n;
+    if (rdig < 5 || (rdig == 5 && !sticky && !((d->dig[n-1] - '0') & 1)))
+        return;
+    for (i=n-1; i>=0 && d->dig[i]=='9'; i--)
+        d->dig[i] = '0';
+    if (i >= 0) {
+        d->dig[i]++;
+        return;
+    }
+    /* 99.9 -> 100.0 */
+    if (fixed) {
+        memmove(d->dig+1, d->dig, n);
+        d->n++;
+    }
+    d->dig[0] = '1';
+    d->dexp++;
+}
+
+
+/* compare exact digits, b may have more than compared, 1/0/-1 */
+static int ftoa_cmp(const ftoa_dig_t *a, const ftoa_dig_t *b)
+{
+    int i;
+    char ca, cb;
+
+    if (a->dexp != b->dexp)
+        return a->dexp > b->dexp ? 1 : -1;
+    for (i=0; i<a->n || i<b->n; i++) {
+        ca = i < a->n ? a->dig[i] : '0';
+        cb = i < b->n ? b->dig[i] : '0';
+        if (ca != cb)
+            return ca > cb ? 1 : -1;
+    }
+    return (b->rdig || b->sticky) ? -1 : 0;
+}
+
+
+/* the fewest significant digits that read back to the same float:
+   try 1..9 digits of the rounded value against the rounding interval */
+static void ftoa_shortest(ftoa_dig_t *d, uint32_t m, int e, int bexp)
+{
+    ftoa_dig_t lo, hi, v;
+    int n, i, c, inclusive = !(m & 1);
+
+    if (m == (1u << 23) && bexp > 1)
+        ftoa_digits(&lo, 4*m-1, e-2, 10, 0);  /* closer lower neighbour */
+    else
+        ftoa_digits(&lo, 2*m-1, e-1, 10, 0);
+    ftoa_digits(&hi, 2*m+1, e-1, 10, 0);
+    ftoa_digits(&v, m, e, 9, 0);
+    for (n=1; n<=9; n++) {
+        *d = v;
+        if (n < 9) {
+            for (i=n+1, c=v.sticky || v.rdig; i<9; i++)
+                c |= v.dig[i] != '0';
+            ftoa_round(d, n, v.dig[n] - '0', c, 0);
         }
+        else
+            ftoa_round(d, n, v.rdig, v.sticky, 0);
+        c = ftoa_cmp(d, &lo);
+        if (c < 0 || (c == 0 && !inclusive))
+            continue;
+        c = ftoa_cmp(d, &hi);
+        if (c > 0 || (c == 0 && !inclusive))
+            continue;
+        break;
     }
-    *output = 0 ;
+    /* drop trailing zeros */
+    while (d->n > 1 && d->dig[d->n-1] == '0')
+        d->n--;
+}
 
-    //  prepare output
-    output = (outbfr == 0) ? local_bfr : outbfr ;
 
-    return strlen(output) ;
+static char *ftoa_exp(char *p, int x, int flags)
+{
+    *p++ = (flags & FTOA_FLAG_UPPER) ? 'E' : 'e';
+    if (x < 0) {
+        *p++ = '-';
+        x = -x;
+    }
+    else
+        *p++ = '+';
+    if (x >= 100) {
+        *p++ = '0' + x / 100;
+        x %= 100;
+    }
+    *p++ = digit_pairs[x*2];
+    *p++ = digit_pairs[x*2+1];
+    return p;
 }
 
 
-/* convert float to exp mode */
-/* Output format:
-      -N.nnnnnnE+xxxx
-         |____|  |__|
-     dec_digits  exp_digits  
-*/
-static unsigned float_to_exp_str(char *outbfr, float flt, unsigned dec_digits, unsigned exp_digits)
+/* significant digits in fixed or exp notation, strip trailing zeros */
+static char *ftoa_sig(char *p, ftoa_dig_t *d, int use_exp, int strip, int flags)
 {
-    static char local_bfr[128] ;
-    char *output = (outbfr == 0) ? local_bfr : outbfr ;
-    float  mul;
-    int    exp = 0;
-    int    n;
-    int    pow;
-    float  pow2;
-
-    if( isnan(flt) )
-    {
-        //*output++ = signbit(flt) ? ' ' : '-';  // I don't care
-        *output++ = 'n';
-        *output++ = 'a';
-        *output++ = 'n';
+    int i, n = d->n;
+
+    if (strip) {
+        while (n > 1 && d->dig[n-1] == '0')
+            n--;
     }
-    else if( ! isfinite(flt) )
-    {
-        *output++ = signbit(flt) ? ' ' : '-';
-        *output++ = 'i';
-        *output++ = 'n';
-        *output++ = 'f';
+    if (use_exp) {
+        *p++ = d->dig[0];
+        if (n > 1 || (flags & FTOA_FLAG_ALT))
+            *p++ = '.';
+        for (i=1; i<n; i++)
+            *p++ = d->dig[i];
+        return ftoa_exp(p, d->dexp, flags);
+    }
+    if (d->dexp < 0) {
+        *p++ = '0';
+        *p++ = '.';
+        for (i=d->dexp+1; i<0; i++)
+            *p++ = '0';
+        for (i=0; i<n; i++)
+            *p++ = d->dig[i];
+        return p;
+    }
+    for (i=0; i<=d->dexp; i++)
+        *p++ = i < n ? d->dig[i] : '0';
+    if (n > d->dexp+1 || (flags & FTOA_FLAG_ALT))
+        *p++ = '.';
+    for (; i<n; i++)
+        *p++ = d->dig[i];
+    return p;
+}
+
+
+/* conv: 'f', 'e', 'g' (upper case by flag), prec<0 for shortest
+   returns length, buf must hold FTOA_BUF_LEN */
+static int ftoa(char *buf, float f, int prec, int conv, int flags)
+{
+    union { float f; uint32_t u; } v;
+    ftoa_dig_t d;
+    char *p = buf;
+    uint32_t m;
+    int bexp, e, x, i;
+
+    v.f = f;
+    bexp = (v.u >> 23) & 0xFF;
+    m = v.u & 0x7FFFFF;
+    if (v.u >> 31)
+        *p++ = '-';
+    else if (flags & FTOA_FLAG_PLUS)
+        *p++ = '+';
+    else if (flags & FTOA_FLAG_SPACE)
+        *p++ = ' ';
+    if (bexp == 0xFF) {
+        memcpy(p, m ? "nan" : "inf", 3);
+        if (flags & FTOA_FLAG_UPPER) {
+            for (i=0; i<3; i++)
+                p[i] -= 'a' - 'A';
+        }
+        p[3] = 0;
+        return p + 3 - buf;
+    }
+    if (bexp) {
+        m |= 1u << 23;
+        e = bexp - 150;
     }
     else
-    { 
-        // sign convert
-        if( signbit(flt) )
-        {
-            *output++ = '-';
-            flt = -flt;
+        e = -149;
+    if (prec > PRINTF2_FLOAT_PREC_MAX)
+        prec = PRINTF2_FLOAT_PREC_MAX;
+
+    if (prec < 0) {
+        /* shortest, exp notation only if out of float precision */
+        if (!m) {
+            *p++ = '0';
         }
-        else 
-            *output++ = ' ';
-
-        // mul/div 10.0 repeatedly to make 1.0 < f < 10.0
-        mul = flt < 1.0 ? 10.0 : 0.1;
-        while( (flt >= 10.0 || flt < 1.0) && flt != 0 ) 
-        {
-            flt *= mul;
-            exp++;
+        else {
+            ftoa_shortest(&d, m, e, bexp);
+            p = ftoa_sig(p, &d, d.dexp < -4 || d.dexp >= 9, 0, flags);
         }
-
-        // output the float part
-        pow2 = 1;
-        for( n=0; n<=dec_digits; n++ )
-        {
-            *output++ = (int)(flt/pow2) + '0';
-            if( n == 0 )
-                *output++ = '.';
-            flt -= pow2*(int)(flt/pow2);
-            pow2 *= 0.1;
+    }
+    else if (conv == 'f' && e > -32 && e <= 5 && prec <= 9) {
+        /* usual magnitudes: 32.32 fixed point, all digits in one multiply */
+        static const uint32_t pow10[10] = { 1, 10, 100, 1000, 10000, 100000,
+                        1000000, 10000000, 100000000, 1000000000 };
+        uint32_t ipart = e >= 0 ? m << e : m >> -e;
+        uint32_t frac = e >= 0 ? 0 : m << (32 + e);
+        uint64_t t = (uint64_t)frac * pow10[prec];
+        uint32_t fd = (uint32_t)(t >> 32), rem = (uint32_t)t;
+        char tmp[12], *q;
+        if (rem > 0x80000000u || (rem == 0x80000000u && ((prec ? fd : ipart) & 1))) {
+            if (++fd == pow10[prec]) {
+                fd = 0;
+                ipart++;
+            }
+        }
+        q = u32_to_dec(tmp + sizeof(tmp), ipart);
+        if (ipart == 0)
+            *--q = '0';
+        i = tmp + sizeof(tmp) - q;
+        memcpy(p, q, i);
+        p += i;
+        if (prec || (flags & FTOA_FLAG_ALT))
+            *p++ = '.';
+        if (prec) {
+            q = u32_to_dec(tmp + sizeof(tmp), fd);
+            i = tmp + sizeof(tmp) - q;
+            memset(p, '0', prec - i);
+            memcpy(p + prec - i, q, i);
+            p += prec;
+        }
+    }
+    else if (conv == 'f') {
+        ftoa_digits(&d, m, e, prec, 1);
+        ftoa_round(&d, d.n, d.rdig, d.sticky, 1);
+        for (i=0; i<=d.dexp; i++)
+            *p++ = d.dig[i];
+        if (prec || (flags & FTOA_FLAG_ALT))
+            *p++ = '.';
+        for (; i<d.n; i++)
+            *p++ = d.dig[i];
+    }
+    else {
+        if (conv == 'g' && !prec)
+            prec = 1;
+        x = (conv == 'e') ? prec + 1 : prec;
+        if (!m) {
+            memset(d.dig, '0', x);
+            d.n = x;
+            d.dexp = 0;
         }
-    
-        // output the exp part
-        *output++ = 'e';
-        *output++ = (mul > 2.0 && exp) ? '-' : '+';
-        for(pow=1, n=1; n<exp_digits; n++ , pow *= 10);
-        for(n=0; n<exp_digits; n++)
-        {
-            *output++ = exp/pow + '0';
-            exp -= pow * (exp / pow);
-            pow /= 10;
-        } 
-    } 
-    *output = 0;
-
-    //  prepare output
-    output = (outbfr == 0) ? local_bfr : outbfr ;
-    return strlen(output) ;
+        else {
+            ftoa_digits(&d, m, e, x, 0);
+            ftoa_round(&d, x, d.rdig, d.sticky, 0);
+        }
+        if (conv == 'e')
+            p = ftoa_sig(p, &d, 1, 0, flags);
+        else
+            p = ftoa_sig(p, &d, d.dexp < -4 || d.dexp >= prec, !(flags & FTOA_FLAG_ALT), flags);
+    }
+    *p = 0;
+    return p - buf;
+}
+
+
+int stringf_float(char *out, float f, int prec, char conv)
+{
+    char buf[FTOA_BUF_LEN];
+    int len = ftoa(buf, f, prec, conv, 0);
+
+    memcpy(out, buf, len + 1);
+    return len;
 }
 
 
@@ -308,16 +641,13 @@ static unsigned float_to_exp_str(char *outbfr, float flt, unsigned dec_digits, u
 #define  PAD_ZERO    2
 
 static int prints (
-                     char **out,
+                     printf2_out_t *out,
                      const char *string, int width, int pad,
                      unsigned int max_output_len, int *cur_output_char_p)
 {
     register int pc = 0, padchar = ' ';
+    int len = strlen(string), result;
     if (width > 0) {
-        int len = 0;
-        const char *ptr;
-        for (ptr = string; *ptr; ++ptr)
-            ++len;
         if (len >= width)
             width = 0;
         else
@@ -327,22 +657,18 @@ static int prints (
     }
     if (!(pad & PAD_RIGHT)) {
         for (; width > 0; --width) {
-            int result = printchar (
+            result = printchar (
                        out,
                        padchar, max_output_len, cur_output_char_p);
             if (result <0) return result;
             ++pc;
         }
     }
-    for (; *string; ++string) {
-        int result = printchar (
-                   out,
-                   *string, max_output_len, cur_output_char_p);
-        if (result < 0) return result;
-        ++pc;
-    }
+    result = printbuf (out, string, len, max_output_len, cur_output_char_p);
+    if (result < 0) return result;
+    pc += len;
     for (; width > 0; --width) {
-        int result = printchar (
+        result = printchar (
                    out,
                    padchar, max_output_len,cur_output_char_p);
         if (result < 0) return result;
@@ -355,7 +681,7 @@ static int prints (
 /* the following should be enough for 32 bit int */
 #define PRINT_BUF_LEN 12
 static int printi (
-                     char **out,
+                     printf2_out_t *out,
                      int i, uint base, int sign, int width, int pad,
                      int letbase, unsigned int max_output_len,
                      int *cur_output_char_p, int use_leading_plus)
@@ -364,13 +690,6 @@ static int printi (
     char *s;
     int t, neg = 0, pc = 0;
     unsigned u = (unsigned) i;
-    if (i == 0) {
-        print_buf[0] = '0';
-        print_buf[1] = '\0';
-        return prints (
-                        out,
-                        print_buf, width, pad, max_output_len, cur_output_char_p);
-    }
     if (sign && base == 10 && i < 0) {
         neg = 1;
         u = (unsigned) -i;
@@ -379,12 +698,27 @@ static int printi (
     s = print_buf + PRINT_BUF_LEN - 1;
     *s = '\0';
 
-    while (u) {
-        t = u % base;  //lint !e573 !e737 !e713 Warning 573: Signed-unsigned mix with divide
-        if (t >= 10)
-            t += letbase - '0' - 10;
-        *--s = (char) t + '0';
-        u /= base;  //lint !e573 !e737  Signed-unsigned mix with divide
+    if (u == 0) {
+        *--s = '0';
+    }
+    else if (base == 10) {
+        s = u32_to_dec(s, u);
+    }
+    else if (base == 16) {
+        const char *hex = (letbase == 'a') ? "0123456789abcdef" : "0123456789ABCDEF";
+        while (u) {
+            *--s = hex[u & 15];
+            u >>= 4;
+        }
+    }
+    else {
+        while (u) {
+            t = u % base;  //lint !e573 !e737 !e713 Warning 573: Signed-unsigned mix with divide
+            if (t >= 10)
+                t += letbase - '0' - 10;
+            *--s = (char) t + '0';
+            u /= base;  //lint !e573 !e737  Signed-unsigned mix with divide
+        }
     }
     if (neg) {
         if (width && (pad & PAD_ZERO)) {
@@ -415,7 +749,7 @@ static int printi (
 
 //****************************************************************************
 static int print (
-    char **out,
+    printf2_out_t *out,
     unsigned int flags,
     unsigned int max_output_len,
     const char *format,
@@ -429,8 +763,10 @@ static int print (
     int cur_output_char = 0;
     int *cur_output_char_p = &cur_output_char;
     int use_leading_plus = 0 ;  //  start out with this clear
+    int float_flags;
     uint8_t flag_long, flag_half;
     int integer;
+    const char *literal;
 
     max_output_len--; // make room for a trailing '\0'
     for (; *format != 0; ++format) {
@@ -438,21 +774,25 @@ static int print (
             dec_width = 6 ;
             ++format;
             width = pad = 0;
+            float_flags = 0;
             if (*format == '\0')
                 break;
             if (*format == '%')
                 goto out_lbl;
-            if (*format == '-') {
-                ++format;
-                pad = PAD_RIGHT;
-            }
-            if (*format == '+') {
+            while (1) {
+                if (*format == '-')
+                    pad |= PAD_RIGHT;
+                else if (*format == '+')
+                    use_leading_plus = 1 ;
+                else if (*format == ' ')
+                    float_flags |= FTOA_FLAG_SPACE;
+                else if (*format == '#')
+                    float_flags |= FTOA_FLAG_ALT;
+                else if (*format == '0')
+                    pad |= PAD_ZERO;
+                else
+                    break;
                 ++format;
-                use_leading_plus = 1 ;
-            }
-            while (*format == '0') {
-                ++format;
-                pad |= PAD_ZERO;
             }
             post_decimal = 0 ;
             if (*format == '.'  ||
@@ -526,11 +866,11 @@ static int print (
             }
             break;
             case 'p':
-                **out = '0';
-                *out += 1;
-                **out = 'x';
-                *out += 1;
-                pc += 2;
+            {
+                int result = prints ( out, "0x", 0, 0, max_output_len, cur_output_char_p);
+                if (result<0) return result;
+                pc += result;
+            }
             case 'X':
             {
                 integer = va_arg(vargs, int);
@@ -567,28 +907,38 @@ static int print (
             }
             break;
 
+            /* formatted with float precision */
             case 'g':
             case 'f':
-            {
-                double d = va_arg(vargs,double);
-                FLOAT_OR_DOUBLE flt_or_dbl = d;
-                char bfr[81];
-                fltordbl2stri(bfr, flt_or_dbl, dec_width, use_leading_plus);
-                int result = prints (
-                              out,
-                              bfr, width, pad, max_output_len, cur_output_char_p);
-                if (result<0) return result;
-                pc += result;
-                use_leading_plus = 0 ;  //  reset this flag after printing one value
-            }
-            break;
-
             case 'e':
+            case 'G':
+            case 'F':
+            case 'E':
             {
-                float f = va_arg(vargs,double);
-                char bfr[81];
-                float_to_exp_str(bfr, f, 6, 2);
-                int result = prints ( out, bfr, width, pad, max_output_len, cur_output_char_p);
+                float f = (float)va_arg(vargs,double);
+                char bfr[FTOA_BUF_LEN], *b = bfr;
+                int c = *format, result;
+                if (use_leading_plus)
+                    float_flags |= FTOA_FLAG_PLUS;
+                if (c < 'a') {
+                    c += 'a' - 'A';
+                    float_flags |= FTOA_FLAG_UPPER;
+                }
+                result = ftoa(bfr, f, dec_width, c, float_flags);
+                /* zero padding goes after the sign, not for inf/nan */
+                if (*b == '-' || *b == '+' || *b == ' ')
+                    b++;
+                if (*b > '9')
+                    pad &= ~PAD_ZERO;
+                else if ((pad & PAD_ZERO) && width && b != bfr) {
+                    result = printchar ( out, *bfr, max_output_len, cur_output_char_p);
+                    if (result<0) return result;
+                    ++pc;
+                    --width;
+                }
+                if (!(pad & PAD_ZERO) || !width)
+                    b = bfr;
+                result = prints ( out, b, width, pad, max_output_len, cur_output_char_p);
                 if (result<0) return result;
                 pc += result;
                 use_leading_plus = 0 ;  //  reset this flag after printing one value
@@ -610,18 +960,25 @@ static int print (
             }
         } else {
             out_lbl: {
-                int result = printchar ( out, *format, max_output_len, cur_output_char_p);
+                /* run of literal text */
+                literal = format;
+                while (format[1] && format[1] != '%')
+                    ++format;
+                int result = printbuf ( out, literal, format - literal + 1, max_output_len, cur_output_char_p);
                 if (result<0) return result;
-                ++pc;
+                pc += format - literal + 1;
             }
         }
     }  //  for each char in format string
 
     max_output_len++; // make room for a trailing '\0'
 
-    if (!(flags & PRINTF2_FLAGS_NO_TRAILING_NULL)) {
-        if (out) //lint !e850
-            **out = '\0';
+    if (out->sink) {
+        flush_chunk(out);
+    }
+    else if (!(flags & PRINTF2_FLAGS_NO_TRAILING_NULL)) {
+        if (out->str) //lint !e850
+            *out->str = '\0';
         else
             return PRINTF2_NULL_PTR;
     }
@@ -632,10 +989,11 @@ static int print (
 //****************************************************************************
 int stringff (char *out, unsigned int flags, const char *format, ...)
 {
+    printf2_out_t o = { out, 0, 0, 0 };
     va_list vargs;
     va_start(vargs,format);
     int result = print (
-                        &out,
+                        &o,
                         flags,
                         UINT_MAX, format, vargs);
     va_end(vargs);
@@ -646,10 +1004,11 @@ int stringff (char *out, unsigned int flags, const char *format, ...)
 //****************************************************************************
 int stringf (char *out, const char *format, ...)
 {
+    printf2_out_t o = { out, 0, 0, 0 };
     va_list vargs;
     va_start(vargs,format);
     int result = print (
-                        &out,
+                        &o,
                         PRINTF2_FLAGS_NONE,
                         UINT_MAX, format, vargs);
     va_end(vargs);
@@ -660,10 +1019,11 @@ int stringf (char *out, const char *format, ...)
 //****************************************************************************
 int stringffn(char *out,  unsigned int flags, unsigned int max_len, const char *format, ...)
 {
+    printf2_out_t o = { out, 0, 0, 0 };
     va_list vargs;
     va_start(vargs,format);
     int result = print (
-                        &out,
+                        &o,
                         flags,
                         max_len, format, vargs);
     va_end(vargs);
@@ -677,10 +1037,11 @@ int stringffn(char *out,  unsigned int flags, unsigned int max_len, const char *
 //lint -esym(765, stringfn)
 int stringfn(char *out, unsigned int max_len, const char *format, ...)
 {
+    printf2_out_t o = { out, 0, 0, 0 };
     va_list vargs;
     va_start(vargs,format);
     int result = print (
-                        &out,
+                        &o,
                         PRINTF2_FLAGS_NONE,
                         max_len, format, vargs);
     va_end(vargs);
@@ -691,8 +1052,9 @@ int stringfn(char *out, unsigned int max_len, const char *format, ...)
 //****************************************************************************
 int stringffnv(char *out, unsigned int flags, unsigned int max_len, const char *format, va_list vargs)
 {
+    printf2_out_t o = { out, 0, 0, 0 };
     return print (
-                   &out,
+                   &o,
                    flags,
                    max_len,
                    format,
@@ -703,8 +1065,9 @@ int stringffnv(char *out, unsigned int flags, unsigned int max_len, const char *
 //****************************************************************************
 int stringfnv(char *out, unsigned int max_len, const char *format, va_list vargs)
 {
+    printf2_out_t o = { out, 0, 0, 0 };
     return print (
-                   &out,
+                   &o,
                    PRINTF2_FLAGS_NONE,
                    max_len,
                    format,
@@ -713,14 +1076,42 @@ int stringfnv(char *out, unsigned int max_len, const char *format, va_list vargs
 }
 
 
+//****************************************************************************
+//  format directly into the sink, no intermediate line buffer is needed and
+//  the output length is not limited
+//****************************************************************************
+int stringfsv(printf2_sink_t sink, const char *format, va_list vargs)
+{
+    char chunk[PRINTF2_SINK_CHUNK_SIZE];
+    printf2_out_t o = { 0, sink, chunk, 0 };
+    return print (
+                   &o,
+                   PRINTF2_FLAGS_NONE,
+                   UINT_MAX,
+                   format,
+                   vargs
+    );
+}
+
+int stringfs(printf2_sink_t sink, const char *format, ...)
+{
+    va_list vargs;
+    va_start(vargs,format);
+    int result = stringfsv(sink, format, vargs);
+    va_end(vargs);
+    return result;
+}
+
+
 //****************************************************************************
 int snprintf(char *str, size_t maxLen, const char *format, ...)
 {
+    printf2_out_t o = { str, 0, 0, 0 };
     va_list vargs;
     va_start(vargs,format);
 
     int charCnt = print(
-                        &str,
+                        &o,
                         PRINTF2_FLAGS_NONE,
                         (unsigned int)maxLen,
                         format,
@@ -735,11 +1126,12 @@ int snprintf(char *str, size_t maxLen, const char *format, ...)
 //****************************************************************************
 int sprintf(char *str, const char *format, ...)
 {
+    printf2_out_t o = { str, 0, 0, 0 };
     va_list vargs;
     int charCnt;
 
     va_start(vargs,format);
-    charCnt = print( &str, PRINTF2_FLAGS_NONE, UINT_MAX, format, vargs);
+    charCnt = print( &o, PRINTF2_FLAGS_NONE, UINT_MAX, format, vargs);
     va_end(vargs);
     return charCnt;
 }
@@ -748,13 +1140,15 @@ int sprintf(char *str, const char *format, ...)
 /* called by shell_printf, replace the standard lib */
 int vsprintf(char *str, const char *format, va_list ap)
 {
-    return print( &str, PRINTF2_FLAGS_NONE, UINT_MAX, format, ap );
+    printf2_out_t o = { str, 0, 0, 0 };
+    return print( &o, PRINTF2_FLAGS_NONE, UINT_MAX, format, ap );
 }
 
 
 int vsnprintf(char *str, size_t size, const char *format, va_list ap)
 {
-    return print( &str, PRINTF2_FLAGS_NONE, size, format, ap );
+    printf2_out_t o = { str, 0, 0, 0 };
+    return print( &o, PRINTF2_FLAGS_NONE, size, format, ap );
 }
 
 
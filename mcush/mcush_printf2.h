@@ -21,6 +21,11 @@
 
 #define USE_OSTREAM 0
 
+/* sink mode flushes the output in chunks of this size */
+#ifndef PRINTF2_SINK_CHUNK_SIZE
+    #define PRINTF2_SINK_CHUNK_SIZE  32
+#endif
+
 typedef enum {
     PRINTF2_OK = 0,
     PRINTF2_WRITE_ERR = -1,
@@ -32,6 +37,8 @@ typedef enum {
     PRINTF2_FLAGS_NO_TRAILING_NULL = 0x0001,
 } printf2_flags_type;
 
+typedef void (*printf2_sink_t)(const char *buf, int len);
+
 int stringff (char *out, unsigned int flags, const char *format, ...);
 int stringf (char *out, const char *format, ...);
 
@@ -41,4 +48,11 @@ int stringfn(char *out, unsigned int max_len, const char *format, ...);
 int stringffnv(char *out, unsigned int flags, unsigned int max_len, const char *format, va_list vargs);
 int stringfnv(char *out, unsigned int max_len, const char *format, va_list vargs);
 
+int stringfs(printf2_sink_t sink, const char *format, ...);
+int stringfsv(printf2_sink_t sink, const char *format, va_list vargs);
+
+/* single float, conv 'f'/'e'/'g', prec<0 for the shortest string that reads
+   back to the same float */
+int stringf_float(char *out, float f, int prec, char conv);
+
 #endif
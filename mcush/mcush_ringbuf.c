@@ -0,0 +1,119 @@
+/* MCUSH designed by Peng Shulin, all rights reserved. */
+#include <string.h>
+#include "mcush_ringbuf.h"
+
+
+void ringbuf_init( ringbuf_t *rb, void *buf, uint32_t size )
+{
+    rb->buf = (uint8_t*)buf;
+    rb->size = size;
+    ringbuf_reset( rb );
+}
+
+
+void ringbuf_reset( ringbuf_t *rb )
+{
+    rb->head = 0;
+    rb->tail = 0;
+    rb->overrun = 0;
+}
+
+
+/* consumer side, data lost by circular DMA is dropped here */
+static uint32_t ringbuf_check_overrun( ringbuf_t *rb )
+{
+    uint32_t head = rb->head, len = head - rb->tail;
+
+    if( len > rb->size )
+    {
+        rb->overrun += len - rb->size;
+        rb->tail = head - rb->size;
+        len = rb->size;
+    }
+    return len;
+}
+
+
+uint32_t ringbuf_len( ringbuf_t *rb )
+{
+    uint32_t len = rb->head - rb->tail;
+
+    return len > rb->size ? rb->size : len;
+}
+
+
+uint32_t ringbuf_free( ringbuf_t *rb )
+{
+    return rb->size - ringbuf_len( rb );
+}
+
+
+/* producer side, returns bytes written (maybe less than len) */
+uint32_t ringbuf_put( ringbuf_t *rb, const void *buf, uint32_t len )
+{
+    uint32_t head = rb->head, pos, l;
+    uint32_t free = rb->size - (head - rb->tail);
+
+    if( len > free )
+        len = free;
+    pos = head & (rb->size - 1);
+    l = rb->size - pos;
+    if( l > len )
+        l = len;
+    memcpy( rb->buf + pos, buf, l );
+    memcpy( rb->buf, (const uint8_t*)buf + l, len - l );
+    rb->head = head + len;
+    return len;
+}
+
+
+/* consumer side, returns bytes read */
+uint32_t ringbuf_get( ringbuf_t *rb, void *buf, uint32_t len )
+{
+    uint32_t avail = ringbuf_check_overrun( rb ), pos, l;
+
+    if( len > avail )
+        len = avail;
+    pos = rb->tail & (rb->size - 1);
+    l = rb->size - pos;
+    if( l > len )
+        l = len;
+    memcpy( buf, rb->buf + pos, l );
+    memcpy( (uint8_t*)buf + l, rb->buf, len - l );
+    rb->tail += len;
+    return len;
+}
+
+
+/* contiguous data from tail for DMA transmitting, 
+   release it with ringbuf_skip when done */
+uint32_t ringbuf_peek_linear( ringbuf_t *rb, uint8_t **p )
+{
+    uint32_t len = ringbuf_check_overrun( rb ), pos;
+
+    pos = rb->tail & (rb->size - 1);
+    if( len > rb->size - pos )
+        len = rb->size - pos;
+    *p = rb->buf + pos;
+    return len;
+}
+
+
+void ringbuf_skip( ringbuf_t *rb, uint32_t len )
+{
+    rb->tail += len;
+}
+
+
+/* producer is circular DMA, pos is its current write position in buf
+   (size - remaining count), returns bytes received since last update
+   NOTE: call it at least every half buffer (DMA half/full transfer irq),
+   or whole-buffer wraps can not be detected */
+uint32_t ringbuf_dma_update( ringbuf_t *rb, uint32_t pos )
+{
+    uint32_t head = rb->head;
+    uint32_t n = (pos - head) & (rb->size - 1);
+
+    rb->head = head + n;
+    return n;
+}
@@ -0,0 +1,38 @@
+/* MCUSH designed by Peng Shulin, all rights reserved. */
+#ifndef __MCUSH_RINGBUF_H__
+#define __MCUSH_RINGBUF_H__
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* single producer/single consumer byte ring buffer, lock-free
+   size must be power of 2, head/tail are free-running indexes so that
+   full and empty can be told apart, only the producer writes head and
+   only the consumer writes tail
+   the producer can also be a circular DMA writing into buf directly,
+   it is then synchronized with ringbuf_dma_update() */
+typedef struct _ringbuf_t {
+    uint8_t *buf;
+    uint32_t size;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    uint32_t overrun;  /* bytes lost, counted by consumer */
+} ringbuf_t;
+
+void ringbuf_init( ringbuf_t *rb, void *buf, uint32_t size );
+void ringbuf_reset( ringbuf_t *rb );
+uint32_t ringbuf_len( ringbuf_t *rb );
+uint32_t ringbuf_free( ringbuf_t *rb );
+uint32_t ringbuf_put( ringbuf_t *rb, const void *buf, uint32_t len );
+uint32_t ringbuf_get( ringbuf_t *rb, void *buf, uint32_t len );
+uint32_t ringbuf_peek_linear( ringbuf_t *rb, uint8_t **p );
+void ringbuf_skip( ringbuf_t *rb, uint32_t len );
+uint32_t ringbuf_dma_update( ringbuf_t *rb, uint32_t pos );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -5,6 +5,7 @@
 #include <sys/time.h>
 #include <sys/times.h>
 #include <unistd.h>
+#if MCUSH_NEWLIB_STUB
 
 
 
@@ -175,6 +176,4 @@ clock_t _times(struct tms *buf)
     return 0;
 }
 
-
-
-
+#endif
@@ -6,7 +6,7 @@
 #include "mcush.h"
 
 #if MCUSH_VFS
-#define FD_RESERVED  10
+#define FD_RESERVED  MCUSH_VFS_FD_RESERVED
 mcush_vfs_volume_t vfs_vol_tab[MCUSH_VFS_VOLUME_NUM];
 mcush_vfs_file_descriptor_t vfs_fd_tab[MCUSH_VFS_FILE_DESCRIPTOR_NUM];
 
@@ -14,6 +14,241 @@ mcush_vfs_file_descriptor_t vfs_fd_tab[MCUSH_VFS_FILE_DESCRIPTOR_NUM];
 mcush_vfs_statistics_t vfs_stat;
 #endif
 
+#if MCUSH_VFS_PROFILER
+mcush_vfs_profile_t vfs_prof[MCUSH_VFS_VOLUME_NUM];
+
+static void vfs_prof_record( int vol, int op, uint32_t start, int failed, int ret )
+{
+    mcush_vfs_op_profile_t *p = &vfs_prof[vol].op[op];
+    uint32_t t = MCUSH_VFS_PROFILER_COUNTER() - start;
+    int b=0;
+
+    while( (t >> b) && (b < MCUSH_VFS_PROFILER_BUCKETS-1) )
+        b++;
+    p->count++;
+    if( failed )
+        p->err++;
+    p->ticks += t;
+    if( t > p->max )
+        p->max = t;
+    p->hist[b]++;
+    if( (op == MCUSH_VFS_OP_READ) && (ret > 0) )
+        vfs_prof[vol].bytes_read += ret;
+    else if( (op == MCUSH_VFS_OP_WRITE) && (ret > 0) )
+        vfs_prof[vol].bytes_written += ret;
+}
+
+/* ret = call, timed and recorded with the failed condition */
+#define VFS_CALL( ret, vol, op, call, failed )  do { \
+        uint32_t t = MCUSH_VFS_PROFILER_COUNTER(); \
+        ret = call; \
+        vfs_prof_record( vol, op, t, failed, ret ); \
+    } while(0)
+#else
+#define VFS_CALL( ret, vol, op, call, failed )  ret = call
+#endif
+
+
+#if MCUSH_VFS_STATISTICS || MCUSH_VFS_PROFILER
+void mcush_vfs_reset_statistics( void )
+{
+#if MCUSH_VFS_STATISTICS
+    memset( (void*)&vfs_stat, 0, sizeof(vfs_stat) );
+#endif
+#if MCUSH_VFS_PROFILER
+    memset( (void*)vfs_prof, 0, sizeof(vfs_prof) );
+#endif
+}
+#endif
+
+
+#if MCUSH_VFS_PROFILER
+/* records of the volume in vfs_vol_tab, 0 if not mounted */
+const mcush_vfs_profile_t *mcush_vfs_get_profile( int vol )
+{
+    if( (vol < 0) || (vol >= MCUSH_VFS_VOLUME_NUM) || !vfs_vol_tab[vol].mount_point )
+        return 0;
+    return &vfs_prof[vol];
+}
+#endif
+
+
+#if MCUSH_VFS_LOCK
+/* readers are only counted, reader preferred so that a shared holder may
+   call in again (eg. from a list callback) while an exclusive one waits,
+   the exclusive one holds the mutex and blocks new readers on it */
+static void vfs_lock_shared( mcush_vfs_volume_t *vol )
+{
+    while( 1 )
+    {
+        portENTER_CRITICAL();
+        if( ! vol->excl )
+        {
+            vol->readers++;
+            portEXIT_CRITICAL();
+            return;
+        }
+        portEXIT_CRITICAL();
+        xSemaphoreTake( (SemaphoreHandle_t)vol->lock, portMAX_DELAY );
+        xSemaphoreGive( (SemaphoreHandle_t)vol->lock );
+    }
+}
+
+
+static void vfs_unlock_shared( mcush_vfs_volume_t *vol )
+{
+    int wake;
+
+    portENTER_CRITICAL();
+    wake = (--vol->readers == 0) && vol->waiting;
+    if( wake )
+        vol->waiting = 0;
+    portEXIT_CRITICAL();
+    if( wake )
+        xSemaphoreGive( (SemaphoreHandle_t)vol->idle );
+}
+
+
+static void vfs_lock_exclusive( mcush_vfs_volume_t *vol )
+{
+    int busy;
+
+    xSemaphoreTake( (SemaphoreHandle_t)vol->lock, portMAX_DELAY );
+    while( 1 )
+    {
+        portENTER_CRITICAL();
+        busy = vol->readers;
+        if( busy )
+            vol->waiting = 1;
+        else
+            vol->excl = 1;
+        portEXIT_CRITICAL();
+        if( ! busy )
+            return;
+        xSemaphoreTake( (SemaphoreHandle_t)vol->idle, portMAX_DELAY );
+    }
+}
+
+
+static void vfs_unlock_exclusive( mcush_vfs_volume_t *vol )
+{
+    vol->excl = 0;
+    xSemaphoreGive( (SemaphoreHandle_t)vol->lock );
+}
+#endif
+
+
+static void vfs_vol_unlock( mcush_vfs_volume_t *vol, int exclusive )
+{
+#if MCUSH_VFS_LOCK
+    if( exclusive )
+        vfs_unlock_exclusive( vol );
+    else
+        vfs_unlock_shared( vol );
+#endif
+}
+
+
+/* volume of the path locked for one call, 0 if not mounted */
+static mcush_vfs_volume_t *vfs_vol_lock( const char *pathname, int exclusive )
+{
+    mcush_vfs_volume_t *vol = get_vol(pathname);
+
+    if( vol == NULL )
+        return NULL;
+#if MCUSH_VFS_LOCK
+    if( exclusive )
+        vfs_lock_exclusive( vol );
+    else
+        vfs_lock_shared( vol );
+    if( vol->driver == NULL )
+    {
+        /* umounted meanwhile */
+        vfs_vol_unlock( vol, exclusive );
+        return NULL;
+    }
+#endif
+    return vol;
+}
+
+
+#if MCUSH_VFS_LOCK
+/* busy is set in critical sections as well, a task finding it set waits
+   on the semaphore and the fd is handed over to it on unlock */
+static void vfs_fd_take( mcush_vfs_file_descriptor_t *f )
+{
+    portENTER_CRITICAL();
+    if( ! f->busy )
+    {
+        f->busy = 1;
+        portEXIT_CRITICAL();
+        return;
+    }
+    f->waiters++;
+    portEXIT_CRITICAL();
+    xSemaphoreTake( (SemaphoreHandle_t)f->lock, portMAX_DELAY );
+}
+
+
+static void vfs_fd_give( mcush_vfs_file_descriptor_t *f )
+{
+    int wake;
+
+    portENTER_CRITICAL();
+    wake = f->waiters;
+    if( wake )
+        f->waiters--;
+    else
+        f->busy = 0;
+    portEXIT_CRITICAL();
+    if( wake )
+        xSemaphoreGive( (SemaphoreHandle_t)f->lock );
+}
+#endif
+
+
+/* opened fd locked for one call, its volume is shared meanwhile */
+static mcush_vfs_file_descriptor_t *vfs_fd_lock( int fd )
+{
+    mcush_vfs_file_descriptor_t *f;
+#if MCUSH_VFS_LOCK
+    mcush_vfs_volume_t *vol;
+#endif
+
+    fd -= FD_RESERVED;
+    if( (fd < 0) || (fd >= MCUSH_VFS_FILE_DESCRIPTOR_NUM) )
+        return NULL;
+    f = &vfs_fd_tab[fd];
+#if MCUSH_VFS_LOCK
+    if( f->lock == NULL )
+        return NULL;  /* never opened */
+    vol = &vfs_vol_tab[f->vol];
+    vfs_lock_shared( vol );
+    vfs_fd_take( f );
+    if( (f->driver == NULL) || (&vfs_vol_tab[f->vol] != vol) )
+    {
+        /* closed (and reopened) meanwhile */
+        vfs_fd_give( f );
+        vfs_unlock_shared( vol );
+        return NULL;
+    }
+#else
+    if( f->driver == NULL )
+        return NULL;
+#endif
+    return f;
+}
+
+
+static void vfs_fd_unlock( mcush_vfs_file_descriptor_t *f )
+{
+#if MCUSH_VFS_LOCK
+    vfs_fd_give( f );
+    vfs_unlock_shared( &vfs_vol_tab[f->vol] );
+#endif
+}
+
+
 int mcush_mount( const char *mount_point, const mcush_vfs_driver_t *driver )
 {
     int i;
@@ -36,10 +271,22 @@ int mcush_mount( const char *mount_point, const mcush_vfs_driver_t *driver )
     {
         if( ! vfs_vol_tab[i].mount_point )
         {
+#if MCUSH_VFS_LOCK
+            /* kept for later mounts */
+            if( vfs_vol_tab[i].lock == NULL )
+                vfs_vol_tab[i].lock = xSemaphoreCreateMutex();
+            if( vfs_vol_tab[i].idle == NULL )
+                vfs_vol_tab[i].idle = xSemaphoreCreateBinary();
+            if( (vfs_vol_tab[i].lock == NULL) || (vfs_vol_tab[i].idle == NULL) )
+                return 0;
+#endif
             if( driver->mount() )
             {
                 vfs_vol_tab[i].mount_point = mount_point;
                 vfs_vol_tab[i].driver = driver;
+#if MCUSH_VFS_CACHE
+                vfs_vol_tab[i].cache_size = MCUSH_VFS_CACHE_SIZE;
+#endif
                 return 1;
             } 
             else
@@ -51,7 +298,8 @@ int mcush_mount( const char *mount_point, const mcush_vfs_driver_t *driver )
 
 int mcush_umount( const char *mount_point )
 {
-    int i;
+    mcush_vfs_volume_t *vol;
+    int i, ret;
 #if MCUSH_VFS_STATISTICS
     vfs_stat.count_umount++;
 #endif
@@ -63,14 +311,21 @@ int mcush_umount( const char *mount_point )
         if( vfs_vol_tab[i].mount_point && 
             (strcmp(vfs_vol_tab[i].mount_point, mount_point) == 0) )
         {
-            if( vfs_vol_tab[i].driver->umount() )
+            vol = &vfs_vol_tab[i];
+#if MCUSH_VFS_LOCK
+            /* wait for calls in progress */
+            vfs_lock_exclusive( vol );
+#endif
+            ret = vol->driver && vol->driver->umount();
+            if( ret )
             {
-                vfs_vol_tab[i].mount_point = 0;
-                vfs_vol_tab[i].driver = 0;
-                return 1;
+                vol->mount_point = 0;
+                vol->driver = 0;
             }
-            else
-                return 0;
+#if MCUSH_VFS_LOCK
+            vfs_unlock_exclusive( vol );
+#endif
+            return ret;
         }
     }
     return 0;
@@ -124,22 +379,30 @@ mcush_vfs_volume_t *get_vol( const char *name )
 
 int mcush_info( const char *pathname, int *total, int *used )
 {
-    mcush_vfs_volume_t *vol = get_vol(pathname);
+    mcush_vfs_volume_t *vol = vfs_vol_lock( pathname, 0 );
+    int ret;
     if( !vol )
         return 0;
-    return vol->driver->info( total, used );
+    ret = vol->driver->info( total, used );
+    vfs_vol_unlock( vol, 0 );
+    return ret;
 }
 
 
 int mcush_size( const char *pathname, int *size )
 {
-    mcush_vfs_volume_t *vol = get_vol(pathname);
+    mcush_vfs_volume_t *vol;
     char file_name[32];
+    int ret;
     if( ! get_file_name( pathname, file_name ) )
         return 0;
+    vol = vfs_vol_lock( pathname, 0 );
     if( !vol )
         return 0;
-    return vol->driver->size( file_name, size );
+    VFS_CALL( ret, vol - vfs_vol_tab, MCUSH_VFS_OP_SIZE,
+              vol->driver->size( file_name, size ), !ret );
+    vfs_vol_unlock( vol, 0 );
+    return ret;
 }
 
 
@@ -149,33 +412,181 @@ int mcush_search( const char *fname )
 }
 
 
+#if MCUSH_VFS_CACHE
+/* set buffer size for files opened later, 0 to disable */
+int mcush_set_cache_size( const char *mount_point, int size )
+{
+    mcush_vfs_volume_t *vol = get_vol(mount_point);
+
+    if( !vol || (size < 0) || (size > 0xFFFF) )
+        return 0;
+    vol->cache_size = size;
+    return 1;
+}
+
+
+/* write back pending data, what the driver did not take stays dirty
+   for the next try */
+static int vfs_cache_flush( mcush_vfs_file_descriptor_t *f )
+{
+    int done=0, l;
+
+    if( ! f->cache_dirty )
+        return 1;
+    while( done < f->cache_len )
+    {
+        VFS_CALL( l, f->vol, MCUSH_VFS_OP_WRITE,
+                  f->driver->write( f->handle, f->cache + done, f->cache_len - done ), l < 0 );
+        if( l <= 0 )
+            break;
+        done += l;
+    }
+    if( done >= f->cache_len )
+    {
+        f->cache_dirty = 0;
+        f->cache_len = 0;
+        return 1;
+    }
+    if( done )
+    {
+        /* keep the unwritten tail */
+        f->cache_len -= done;
+        memmove( f->cache, f->cache + done, f->cache_len );
+    }
+    return 0;
+}
+
+
+/* forget read-ahead data, the driver goes back to where the caller is */
+static int vfs_cache_drop( mcush_vfs_file_descriptor_t *f )
+{
+    int ahead, r;
+
+    if( f->cache_dirty )
+        return vfs_cache_flush( f );
+    ahead = f->cache_len - f->cache_pos;
+    f->cache_len = f->cache_pos = 0;
+    if( ! ahead )
+        return 1;
+    VFS_CALL( r, f->vol, MCUSH_VFS_OP_SEEK,
+              f->driver->seek( f->handle, -ahead, 1 ), r < 0 );
+    return r >= 0;
+}
+
+
+static int vfs_cache_read( mcush_vfs_file_descriptor_t *f, uint8_t *buf, int len )
+{
+    int l, total=0;
+
+    if( ! vfs_cache_flush( f ) )
+        return -1;
+    while( len > 0 )
+    {
+        l = f->cache_len - f->cache_pos;
+        if( l > 0 )
+        {
+            if( l > len )
+                l = len;
+            memcpy( buf, f->cache + f->cache_pos, l );
+            f->cache_pos += l;
+            buf += l;
+            len -= l;
+            total += l;
+            continue;
+        }
+        if( len >= f->cache_size )
+        {
+            VFS_CALL( l, f->vol, MCUSH_VFS_OP_READ,
+                      f->driver->read( f->handle, buf, len ), l < 0 );
+            if( l < 0 )
+                return total ? total : -1;
+            return total + l;
+        }
+        f->cache_pos = 0;
+        VFS_CALL( l, f->vol, MCUSH_VFS_OP_READ,
+                  f->driver->read( f->handle, f->cache, f->cache_size ), l < 0 );
+        f->cache_len = l > 0 ? l : 0;
+        if( l < 0 )
+            return total ? total : -1;
+        if( l == 0 )
+            break;
+    }
+    return total;
+}
+
+
+static int vfs_cache_write( mcush_vfs_file_descriptor_t *f, const uint8_t *buf, int len )
+{
+    int l, total=0;
+
+    if( ! f->cache_dirty && ! vfs_cache_drop( f ) )
+        return -1;
+    while( len > 0 )
+    {
+        if( ! f->cache_len && (len >= f->cache_size) )
+        {
+            VFS_CALL( l, f->vol, MCUSH_VFS_OP_WRITE,
+                      f->driver->write( f->handle, (void*)buf, len ), l < 0 );
+            if( l < 0 )
+                return total ? total : -1;
+            return total + l;
+        }
+        l = f->cache_size - f->cache_len;
+        if( l > len )
+            l = len;
+        memcpy( f->cache + f->cache_len, buf, l );
+        f->cache_len += l;
+        f->cache_dirty = 1;
+        buf += l;
+        len -= l;
+        total += l;
+        /* bytes in the cache are taken, even if not written back yet */
+        if( (f->cache_len == f->cache_size) && ! vfs_cache_flush( f ) )
+            return total ? total : -1;
+    }
+    return total;
+}
+#endif
+
+
 int mcush_remove( const char *pathname )
 {
-    mcush_vfs_volume_t *vol = get_vol(pathname);
+    mcush_vfs_volume_t *vol;
     char file_name[32];
+    int ret;
     if( ! get_file_name( pathname, file_name ) )
         return 0;
+    vol = vfs_vol_lock( pathname, 1 );
     if( ! vol )
         return 0;
-    return vol->driver->remove( file_name );
+    VFS_CALL( ret, vol - vfs_vol_tab, MCUSH_VFS_OP_REMOVE,
+              vol->driver->remove( file_name ), !ret );
+    vfs_vol_unlock( vol, 1 );
+    return ret;
 }
 
 
 int mcush_rename( const char *old_pathname, const char *new_name )
 {
-    mcush_vfs_volume_t *vol = get_vol(old_pathname);
+    mcush_vfs_volume_t *vol;
     char file_name[32];
+    int ret;
     if( ! get_file_name( old_pathname, file_name ) )
         return 0;
+    vol = vfs_vol_lock( old_pathname, 1 );
     if( ! vol )
         return 0;
-    return vol->driver->rename( file_name, new_name );
+    VFS_CALL( ret, vol - vfs_vol_tab, MCUSH_VFS_OP_RENAME,
+              vol->driver->rename( file_name, new_name ), !ret );
+    vfs_vol_unlock( vol, 1 );
+    return ret;
 }
 
 
 int mcush_open( const char *pathname, const char *mode )
 {
-    mcush_vfs_volume_t *vol = get_vol(pathname);
+    mcush_vfs_volume_t *vol;
+    mcush_vfs_file_descriptor_t *f;
     char file_name[32];
     int fd, i;
 
@@ -184,14 +595,24 @@ int mcush_open( const char *pathname, const char *mode )
 #endif
     if( ! get_file_name( pathname, file_name ) )
         goto err;
+    vol = vfs_vol_lock( pathname, 0 );
     if( ! vol )
         goto err;
     portENTER_CRITICAL();
     for( i=0; i<MCUSH_VFS_FILE_DESCRIPTOR_NUM; i++ )
     {
+#if MCUSH_VFS_LOCK
+        /* busy after close while handed to a waiter */
+        if( (vfs_fd_tab[i].driver == NULL) && ! vfs_fd_tab[i].busy )
+#else
         if( vfs_fd_tab[i].driver == NULL ) 
+#endif
         {
             vfs_fd_tab[i].driver = vol->driver;
+            vfs_fd_tab[i].vol = vol - vfs_vol_tab;
+#if MCUSH_VFS_LOCK
+            vfs_fd_tab[i].busy = 1;  /* until ready */
+#endif
             break;
         }
     }
@@ -199,23 +620,49 @@ int mcush_open( const char *pathname, const char *mode )
     if( i >= MCUSH_VFS_FILE_DESCRIPTOR_NUM )
     {  
         *vol->driver->err = MCUSH_VFS_RESOURCE_LIMIT;
-        goto err;
+        goto err_unlock;
+    }
+    f = &vfs_fd_tab[i];
+#if MCUSH_VFS_LOCK
+    /* kept for later opens */
+    if( f->lock == NULL )
+        f->lock = xSemaphoreCreateBinary();
+    if( f->lock == NULL )
+    {
+        *vol->driver->err = MCUSH_VFS_RESOURCE_LIMIT;
+        f->driver = NULL;
+        vfs_fd_give( f );
+        goto err_unlock;
+    }
+#endif
+    VFS_CALL( fd, f->vol, MCUSH_VFS_OP_OPEN,
+              vol->driver->open( file_name, mode ), !fd );
+    if( fd )
+    { 
+        f->handle = fd;
+        f->unget_char = 0;
+#if MCUSH_VFS_CACHE
+        f->cache_len = f->cache_pos = 0;
+        f->cache_dirty = 0;
+        f->cache_size = vol->cache_size;
+        /* uncached if no memory, or already in memory */
+        f->cache = (vol->cache_size && !vol->driver->mmap) ? pvPortMalloc( vol->cache_size ) : 0;
+#endif
     }
     else
     {
-        fd = vol->driver->open( file_name, mode );
-        if( fd )
-        { 
-            vfs_fd_tab[i].handle = fd;
-        }
-        else
-        {
-            *vol->driver->err = MCUSH_VFS_FAIL_TO_OPEN_FILE;
-            vfs_fd_tab[i].driver = NULL;
-            goto err;
-        }
+        *vol->driver->err = MCUSH_VFS_FAIL_TO_OPEN_FILE;
+        f->driver = NULL;
     }
-    return i+FD_RESERVED;
+#if MCUSH_VFS_LOCK
+    vfs_fd_give( f );
+#endif
+    vfs_vol_unlock( vol, 0 );
+    if( fd )
+        return i+FD_RESERVED;
+    goto err;
+err_unlock:
+    vfs_vol_unlock( vol, 0 );
 err:
 #if MCUSH_VFS_STATISTICS
     vfs_stat.count_open_err++;
@@ -226,7 +673,7 @@ err:
 
 int mcush_seek( int fd, int offset, int where )
 {
-    const mcush_vfs_driver_t *driver;
+    mcush_vfs_file_descriptor_t *f;
     int ret;
 
 #if MCUSH_VFS_STATISTICS
@@ -235,14 +682,19 @@ int mcush_seek( int fd, int offset, int where )
     if( fd == 0 )
         return 0;
 
-    fd -= FD_RESERVED;
-    if( (fd < 0) || (fd >= MCUSH_VFS_FILE_DESCRIPTOR_NUM) )
+    f = vfs_fd_lock( fd );
+    if( f == NULL )
         goto err;
-
-    driver = vfs_fd_tab[fd].driver;
-    if( driver == NULL )
+#if MCUSH_VFS_CACHE
+    if( f->cache && ! vfs_cache_drop( f ) )
+    {
+        vfs_fd_unlock( f );
         goto err;
-    ret = driver->seek( vfs_fd_tab[fd].handle, offset, where );
+    }
+#endif
+    VFS_CALL( ret, f->vol, MCUSH_VFS_OP_SEEK,
+              f->driver->seek( f->handle, offset, where ), ret < 0 );
+    vfs_fd_unlock( f );
     return ret;
 err:
 #if MCUSH_VFS_STATISTICS
@@ -254,8 +706,8 @@ err:
 
 int mcush_read( int fd, void *buf, int len )
 {
+    mcush_vfs_file_descriptor_t *f;
     int ret, unget=0;
-    const mcush_vfs_driver_t *driver;
 
 #if MCUSH_VFS_STATISTICS
     vfs_stat.count_read++;
@@ -264,23 +716,29 @@ int mcush_read( int fd, void *buf, int len )
     if( fd == 0 )
         return shell_read( buf, len );
 
-    fd -= FD_RESERVED;
-    if( (fd < 0) || (fd >= MCUSH_VFS_FILE_DESCRIPTOR_NUM) )
+    f = vfs_fd_lock( fd );
+    if( f == NULL )
         goto err;
-
     if( len <= 0 )
+    {
+        vfs_fd_unlock( f );
         return 0;
-    if( vfs_fd_tab[fd].unget_char )
+    }
+    if( f->unget_char )
     {
-        *(char*)buf++ = vfs_fd_tab[fd].unget_char;
-        vfs_fd_tab[fd].unget_char = 0;
+        *(char*)buf++ = f->unget_char;
+        f->unget_char = 0;
         len--;
         unget = 1;
     }
-    driver = vfs_fd_tab[fd].driver;
-    if( driver == NULL )
-        goto err;
-    ret = driver->read( vfs_fd_tab[fd].handle, buf, len );
+#if MCUSH_VFS_CACHE
+    if( f->cache )
+        ret = vfs_cache_read( f, buf, len );
+    else
+#endif
+    VFS_CALL( ret, f->vol, MCUSH_VFS_OP_READ,
+              f->driver->read( f->handle, buf, len ), ret < 0 );
+    vfs_fd_unlock( f );
     if( ret < 0 )
         return unget ? 1 : -1;
     else
@@ -295,7 +753,8 @@ err:
 
 int mcush_write( int fd, void *buf, int len )
 {
-    const mcush_vfs_driver_t *driver;
+    mcush_vfs_file_descriptor_t *f;
+    int ret;
 
 #if MCUSH_VFS_STATISTICS
     vfs_stat.count_write++;
@@ -306,12 +765,18 @@ int mcush_write( int fd, void *buf, int len )
         shell_write( buf, len );
         return len;
     }
-    fd -= FD_RESERVED;
-    if( (fd < 0) || (fd >= MCUSH_VFS_FILE_DESCRIPTOR_NUM) )
+    f = vfs_fd_lock( fd );
+    if( f == NULL )
         goto err;
-    driver = vfs_fd_tab[fd].driver;
-    if( driver )
-        return driver->write( vfs_fd_tab[fd].handle, buf, len );
+#if MCUSH_VFS_CACHE
+    if( f->cache )
+        ret = vfs_cache_write( f, buf, len );
+    else
+#endif
+    VFS_CALL( ret, f->vol, MCUSH_VFS_OP_WRITE,
+              f->driver->write( f->handle, buf, len ), ret < 0 );
+    vfs_fd_unlock( f );
+    return ret;
 err:
 #if MCUSH_VFS_STATISTICS
     vfs_stat.count_write_err++;
@@ -322,46 +787,71 @@ err:
 
 int mcush_flush( int fd )
 {
-    const mcush_vfs_driver_t *driver;
+    mcush_vfs_file_descriptor_t *f;
+    int ret;
 
 #if MCUSH_VFS_STATISTICS
     vfs_stat.count_flush++;
 #endif
     fd -= FD_RESERVED;
     if( (fd < 0) || (fd >= MCUSH_VFS_FILE_DESCRIPTOR_NUM) )
+        goto err;
+    f = vfs_fd_lock( fd + FD_RESERVED );
+    if( f == NULL )
+        goto err;
+#if MCUSH_VFS_CACHE
+    if( f->cache && ! vfs_cache_flush( f ) )
     {
+        vfs_fd_unlock( f );
+        goto err;
+    }
+#endif
+    /* driver returns 0 and sets its errno if failed */
+    VFS_CALL( ret, f->vol, MCUSH_VFS_OP_FLUSH,
+              f->driver->flush( f->handle ), !ret );
+    vfs_fd_unlock( f );
+    if( ret )
+        return 1;
+err:
 #if MCUSH_VFS_STATISTICS
-        vfs_stat.count_flush_err++;
+    vfs_stat.count_flush_err++;
 #endif
-        return 0;
-    }
-    driver = vfs_fd_tab[fd].driver;
-    if( driver )
-        *driver->err = driver->flush( vfs_fd_tab[fd].handle );
-    return 1;
+    return 0;
 }
 
 
 int mcush_close( int fd )
 {
-    const mcush_vfs_driver_t *driver;
+    mcush_vfs_file_descriptor_t *f;
+    int ret=1, r;
 
 #if MCUSH_VFS_STATISTICS
     vfs_stat.count_close++;
 #endif
-    fd -= FD_RESERVED;
-    if( (fd < 0) || (fd >= MCUSH_VFS_FILE_DESCRIPTOR_NUM) )
+    f = vfs_fd_lock( fd );
+    if( f == NULL )
         goto err;
-    driver = vfs_fd_tab[fd].driver;
-    if( driver )
+#if MCUSH_VFS_CACHE
+    if( f->cache )
     {
-        *driver->err = driver->close( vfs_fd_tab[fd].handle );
-        portENTER_CRITICAL();
-        vfs_fd_tab[fd].driver = NULL;
-        vfs_fd_tab[fd].handle = 0;
-        portEXIT_CRITICAL();
-        return 1;
+        /* closed anyway, but the lost write-back data is reported */
+        ret = vfs_cache_flush( f );
+        vPortFree( f->cache );
+        f->cache = 0;
     }
+#endif
+    /* driver returns 0 and sets its errno if failed */
+    VFS_CALL( r, f->vol, MCUSH_VFS_OP_CLOSE,
+              f->driver->close( f->handle ), !r );
+    if( ! r )
+        ret = 0;
+    portENTER_CRITICAL();
+    f->driver = NULL;
+    f->handle = 0;
+    portEXIT_CRITICAL();
+    vfs_fd_unlock( f );
+    if( ret )
+        return 1;
 err:
 #if MCUSH_VFS_STATISTICS
     vfs_stat.count_close_err++;
@@ -372,37 +862,71 @@ err:
 
 int mcush_list( const char *path, void (*cb)(const char *name, int size, int mode) )
 {
-    mcush_vfs_volume_t *vol = get_vol(path);
+    mcush_vfs_volume_t *vol;
     char mount_point[16];
     char file_name[32];
+    int ret;
 
-    if( ! vol )
-        return 0;
     if( ! get_mount_point( path, mount_point ) )
         return 0;
     if( ! get_file_name( path, &file_name[1] ) )
         strcpy( file_name, "/" );
+    vol = vfs_vol_lock( path, 0 );
+    if( ! vol )
+        return 0;
    
-    return vol->driver->list( file_name, cb ); 
+    VFS_CALL( ret, vol - vfs_vol_tab, MCUSH_VFS_OP_LIST,
+              vol->driver->list( file_name, cb ), !ret );
+    vfs_vol_unlock( vol, 0 );
+    return ret;
+}
+
+
+/* whole contents of an opened file that sits in memory (flash resident
+   volumes), regardless of the position, valid while the volume is mounted,
+   returns 0 if not supported and the caller reads as usual */
+int mcush_mmap( int fd, const void **buf, int *len )
+{
+    mcush_vfs_file_descriptor_t *f;
+    int ret=0;
+
+    f = vfs_fd_lock( fd );
+    if( f == NULL )
+        return 0;
+    if( f->driver->mmap )
+        ret = f->driver->mmap( f->handle, buf, len );
+    vfs_fd_unlock( f );
+    return ret;
 }
 
 
 int mcush_getc( int fd )
 {
     char c;
-    return shell_read_char( &c );
+
+    if( fd == 0 )
+        return shell_read_char( &c );
+    if( mcush_read( fd, &c, 1 ) != 1 )
+        return -1;
+    return (uint8_t)c;
 }
 
 
 int mcush_ungetc( int fd, char c )
 {
-    fd -= FD_RESERVED;
-    if( (fd < 0) || (fd >= MCUSH_VFS_FILE_DESCRIPTOR_NUM) )
-        return 0;
-    if( vfs_fd_tab[fd].unget_char )
+    mcush_vfs_file_descriptor_t *f;
+    int ret=0;
+
+    f = vfs_fd_lock( fd );
+    if( f == NULL )
         return 0;
-    vfs_fd_tab[fd].unget_char = c;
-    return 1;
+    if( ! f->unget_char )
+    {
+        f->unget_char = c;
+        ret = 1;
+    }
+    vfs_fd_unlock( f );
+    return ret;
 }
 
 
@@ -444,6 +968,7 @@ const char *mcush_basename( const char *fname )
 #endif
 
 
+#if MCUSH_NEWLIB_STUB
 int fprintf(FILE *stream, const char *format, ...)
 {
     va_list vargs;
@@ -487,4 +1012,4 @@ int fputs(const char *s, FILE *stream)
         return EOF;
 }
 
-
+#endif
@@ -16,8 +16,58 @@
     #define MCUSH_VFS_STATISTICS  1
 #endif
 
+/* per fd buffer between the fd table and the driver, sequential reads
+   are served from a read-ahead block and small writes are collected
+   until the block is full or on flush/seek/close, requests not smaller
+   than the block go to the driver directly, costs a block of ram for
+   each opened fd */
+#ifndef MCUSH_VFS_CACHE
+    #define MCUSH_VFS_CACHE  0
+#endif
+
+#ifndef MCUSH_VFS_CACHE_SIZE
+    #define MCUSH_VFS_CACHE_SIZE  256  /* default for each volume, 0 for none */
+#endif
+
+/* volumes are shared by file calls and taken exclusively by remove,
+   rename and umount, each fd is locked during a call so that tasks may
+   share it, drivers still guard their own state, costs two semaphores
+   for each volume and one for each fd */
+#ifndef MCUSH_VFS_LOCK
+    #define MCUSH_VFS_LOCK  0
+#endif
+
+/* requests of file calls served by a dedicated task, see mcush_vfs_aio.h */
+#ifndef MCUSH_VFS_AIO
+    #define MCUSH_VFS_AIO  0
+#endif
+
+/* per volume bytes and timing of each driver entry, see sys vfs */
+#ifndef MCUSH_VFS_PROFILER
+    #define MCUSH_VFS_PROFILER  0
+#endif
+#if MCUSH_VFS_PROFILER
+    /* free-running counter, define a high-resolution one (eg. DWT->CYCCNT)
+       together with its frequency if available */
+    #ifndef MCUSH_VFS_PROFILER_COUNTER
+        #define MCUSH_VFS_PROFILER_COUNTER()  xTaskGetTickCount()
+    #endif
+    #ifndef MCUSH_VFS_PROFILER_COUNTER_HZ
+        #define MCUSH_VFS_PROFILER_COUNTER_HZ  configTICK_RATE_HZ
+    #endif
+    /* latency histogram: 0, 1, 2~3, 4~7 ... counts, the last one for
+       all above */
+    #ifndef MCUSH_VFS_PROFILER_BUCKETS
+        #define MCUSH_VFS_PROFILER_BUCKETS  16
+    #endif
+#endif
+
     
 
+/* fds below are not files, 0 is the shell input and 1/2 the shell output
+   of the calling task */
+#define MCUSH_VFS_FD_RESERVED  10
+
 typedef enum {
     MCUSH_VFS_OK = 0,
     MCUSH_VFS_VOLUME_NOT_MOUNTED,
@@ -46,12 +96,22 @@ typedef struct {
     int (*close)( int fd );
     int (*size)( const char *name, int *size );
     int (*list)( const char *path, void (*cb)(const char *name, int size, int mode) );
+    int (*mmap)( int fd, const void **buf, int *len );  /* optional */
 } mcush_vfs_driver_t;
 
 
 typedef struct {
     const char *mount_point;
     const mcush_vfs_driver_t *driver;
+#if MCUSH_VFS_CACHE
+    int cache_size;
+#endif
+#if MCUSH_VFS_LOCK
+    void *lock;  /* mutex, held by the exclusive call */
+    void *idle;  /* binary semaphore, given to it by the last reader */
+    int readers;
+    uint8_t excl, waiting;
+#endif
 } mcush_vfs_volume_t;
 
 
@@ -59,6 +119,18 @@ typedef struct {
     int handle;
     const mcush_vfs_driver_t *driver;
     char unget_char;
+    uint8_t vol;  /* index of vfs_vol_tab */
+#if MCUSH_VFS_LOCK
+    void *lock;  /* binary semaphore for waiters, kept after close */
+    uint8_t busy, waiters;
+#endif
+#if MCUSH_VFS_CACHE
+    uint8_t *cache;
+    uint16_t cache_size;
+    uint16_t cache_len;  /* read-ahead or pending write bytes */
+    uint16_t cache_pos;  /* read position */
+    uint8_t cache_dirty;
+#endif
 } mcush_vfs_file_descriptor_t;
 
 
@@ -74,6 +146,36 @@ typedef struct {
 } mcush_vfs_statistics_t;
 
 
+#if MCUSH_VFS_PROFILER
+/* driver entries */
+enum {
+    MCUSH_VFS_OP_OPEN=0,
+    MCUSH_VFS_OP_CLOSE,
+    MCUSH_VFS_OP_READ,
+    MCUSH_VFS_OP_WRITE,
+    MCUSH_VFS_OP_SEEK,
+    MCUSH_VFS_OP_FLUSH,
+    MCUSH_VFS_OP_SIZE,
+    MCUSH_VFS_OP_LIST,
+    MCUSH_VFS_OP_REMOVE,
+    MCUSH_VFS_OP_RENAME,
+    MCUSH_VFS_OP_NUM,
+};
+
+typedef struct {
+    uint32_t count, err;
+    uint64_t ticks;  /* cumulative, fast counters wrap in seconds */
+    uint32_t max;
+    uint32_t hist[MCUSH_VFS_PROFILER_BUCKETS];
+} mcush_vfs_op_profile_t;
+
+typedef struct {
+    uint32_t bytes_read, bytes_written;
+    mcush_vfs_op_profile_t op[MCUSH_VFS_OP_NUM];
+} mcush_vfs_profile_t;
+#endif
+
+
 int mcush_mount( const char *mount_point, const mcush_vfs_driver_t *driver );
 int mcush_umount( const char *mount_point );
 int mcush_format( const char *mount_point );
@@ -89,11 +191,21 @@ int mcush_write( int fd, void *buf, int len );
 int mcush_flush( int fd );
 int mcush_close( int fd );
 int mcush_list( const char *pathname, void (*cb)(const char *name, int size, int mode) );
+int mcush_mmap( int fd, const void **buf, int *len );
 int mcush_getc( int fd );
 int mcush_ungetc( int fd, char c );
 int mcush_putc( int fd, char c );
 int mcush_puts( int fd, const char *buf );
 int mcush_printf( int fd, const char *fmt, ... );
+#if MCUSH_VFS_CACHE
+int mcush_set_cache_size( const char *mount_point, int size );
+#endif
+#if MCUSH_VFS_STATISTICS || MCUSH_VFS_PROFILER
+void mcush_vfs_reset_statistics( void );
+#endif
+#if MCUSH_VFS_PROFILER
+const mcush_vfs_profile_t *mcush_vfs_get_profile( int vol );
+#endif
 
 int get_mount_point( const char *pathname, char *mount_point );
 int get_file_name( const char *pathname, char *file_name );
@@ -116,6 +228,10 @@ const char *mcush_basename( const char *pathname );
 #include "mcush_vfs_fatfs.h"
 #endif
 
+#if MCUSH_VFS_AIO
+#include "mcush_vfs_aio.h"
+#endif
+
 
 #endif
 
@@ -0,0 +1,215 @@
+/* MCUSH designed by Peng Shulin, all rights reserved. */
+#if MCUSH_VFS
+#include "mcush.h"
+
+#if MCUSH_VFS_AIO
+
+static QueueHandle_t vfs_aio_queue;
+static TaskHandle_t vfs_aio_task;
+static mcush_vfs_aio_stat_t vfs_aio_stat;
+
+
+static int vfs_aio_call( mcush_vfs_aio_req_t *req, int *failed )
+{
+    int ret;
+
+    switch( req->op )
+    {
+    case MCUSH_VFS_AIO_READ:
+        ret = mcush_read( req->fd, req->buf, req->len );
+        *failed = ret < 0;
+        break;
+    case MCUSH_VFS_AIO_WRITE:
+        ret = mcush_write( req->fd, req->buf, req->len );
+        *failed = ret != req->len;
+        break;
+    case MCUSH_VFS_AIO_FLUSH:
+        ret = mcush_flush( req->fd );
+        *failed = ! ret;
+        break;
+    case MCUSH_VFS_AIO_CLOSE:
+        ret = mcush_close( req->fd );
+        *failed = ! ret;
+        break;
+    default:
+        ret = -1;
+        *failed = 1;
+        break;
+    }
+    return ret;
+}
+
+
+static void vfs_aio_task_entry( void *p )
+{
+    mcush_vfs_aio_req_t *req;
+    void (*cb)( mcush_vfs_aio_req_t *req );
+    void *sem;
+    uint32_t start, wait, service;
+    int ret, failed;
+
+    (void)p;
+    while( 1 )
+    {
+        if( xQueueReceive( vfs_aio_queue, &req, portMAX_DELAY ) != pdPASS )
+            continue;
+        start = MCUSH_VFS_AIO_COUNTER();
+        ret = vfs_aio_call( req, &failed );
+        service = MCUSH_VFS_AIO_COUNTER() - start;
+        wait = start - req->submitted;
+        portENTER_CRITICAL();
+        vfs_aio_stat.depth--;
+        vfs_aio_stat.completed++;
+        if( failed )
+            vfs_aio_stat.failed++;
+        vfs_aio_stat.wait += wait;
+        vfs_aio_stat.service += service;
+        if( wait > vfs_aio_stat.wait_max )
+            vfs_aio_stat.wait_max = wait;
+        if( service > vfs_aio_stat.service_max )
+            vfs_aio_stat.service_max = service;
+        portEXIT_CRITICAL();
+        /* the submitter may reuse or release it as soon as done is raised,
+           the waiter can not run between done and the give */
+        cb = req->cb;
+        sem = req->sem;
+        req->ret = ret;
+        if( cb )
+        {
+            req->done = 1;
+            cb( req );
+        }
+        else
+        {
+            vTaskSuspendAll();
+            req->done = 1;
+            xSemaphoreGive( (SemaphoreHandle_t)sem );
+            xTaskResumeAll();
+        }
+    }
+}
+
+
+/* io task and queue are created on first use */
+static int vfs_aio_start( void )
+{
+    QueueHandle_t queue;
+    int ret=1;
+
+    if( vfs_aio_queue )
+        return 1;
+    vTaskSuspendAll();
+    if( ! vfs_aio_queue )
+    {
+        queue = xQueueCreate( MCUSH_VFS_AIO_QUEUE_LEN, sizeof(mcush_vfs_aio_req_t*) );
+        if( queue == NULL )
+            ret = 0;
+        else
+        {
+            vQueueAddToRegistry( queue, "vfsAioQ" );
+            vfs_aio_queue = queue;
+            if( xTaskCreate( vfs_aio_task_entry, (const char *)"vfsAioT",
+                             MCUSH_VFS_AIO_STACK_SIZE / sizeof(portSTACK_TYPE),
+                             NULL, MCUSH_VFS_AIO_PRIORITY, &vfs_aio_task ) != pdPASS )
+            {
+                vfs_aio_queue = NULL;
+                vQueueDelete( queue );
+                ret = 0;
+            }
+        }
+    }
+    xTaskResumeAll();
+    return ret;
+}
+
+
+/* returns 1 if queued, 0 if the queue stays full for block_time,
+   shell fds are refused, the io task has no shell of its own */
+int mcush_vfs_aio_submit( mcush_vfs_aio_req_t *req, int block_time )
+{
+    if( req->fd < MCUSH_VFS_FD_RESERVED )
+        return 0;
+    if( ! vfs_aio_start() )
+        return 0;
+    if( ! req->cb )
+    {
+        if( ! req->sem )
+        {
+            req->sem = (void*)xSemaphoreCreateBinary();
+            if( ! req->sem )
+                return 0;
+        }
+        else
+            xSemaphoreTake( (SemaphoreHandle_t)req->sem, 0 );  /* left by a timed out wait */
+    }
+    /* from a callback, waiting for the io task itself never ends */
+    if( xTaskGetCurrentTaskHandle() == vfs_aio_task )
+        block_time = 0;
+    req->done = 0;
+    req->submitted = MCUSH_VFS_AIO_COUNTER();
+    portENTER_CRITICAL();
+    if( ++vfs_aio_stat.depth > vfs_aio_stat.depth_max )
+        vfs_aio_stat.depth_max = vfs_aio_stat.depth;
+    portEXIT_CRITICAL();
+    if( xQueueSend( vfs_aio_queue, &req, block_time ) != pdPASS )
+    {
+        portENTER_CRITICAL();
+        vfs_aio_stat.depth--;
+        vfs_aio_stat.rejected++;
+        portEXIT_CRITICAL();
+        return 0;
+    }
+    portENTER_CRITICAL();
+    vfs_aio_stat.submitted++;
+    portEXIT_CRITICAL();
+    return 1;
+}
+
+
+/* wait for a request submitted without callback, returns 1 when done */
+int mcush_vfs_aio_wait( mcush_vfs_aio_req_t *req, int block_time )
+{
+    if( ! req->sem )
+        return req->done;
+    while( ! req->done )
+    {
+        if( xSemaphoreTake( (SemaphoreHandle_t)req->sem, block_time ) != pdPASS )
+            return req->done;
+    }
+    return 1;
+}
+
+
+/* free the semaphore of a request that is done or never submitted */
+void mcush_vfs_aio_release( mcush_vfs_aio_req_t *req )
+{
+    if( req->sem )
+    {
+        vSemaphoreDelete( (SemaphoreHandle_t)req->sem );
+        req->sem = NULL;
+    }
+}
+
+
+void mcush_vfs_aio_get_stat( mcush_vfs_aio_stat_t *stat )
+{
+    portENTER_CRITICAL();
+    memcpy( stat, &vfs_aio_stat, sizeof(mcush_vfs_aio_stat_t) );
+    portEXIT_CRITICAL();
+}
+
+
+/* depth is kept for the requests in flight */
+void mcush_vfs_aio_reset_stat( void )
+{
+    portENTER_CRITICAL();
+    vfs_aio_stat.submitted = vfs_aio_stat.completed = 0;
+    vfs_aio_stat.failed = vfs_aio_stat.rejected = 0;
+    vfs_aio_stat.depth_max = vfs_aio_stat.depth;
+    vfs_aio_stat.wait_max = vfs_aio_stat.service_max = 0;
+    vfs_aio_stat.wait = vfs_aio_stat.service = 0;
+    portEXIT_CRITICAL();
+}
+
+#endif
+#endif
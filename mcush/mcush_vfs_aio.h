@@ -0,0 +1,84 @@
+/* MCUSH designed by Peng Shulin, all rights reserved. */
+#ifndef __MCUSH_VFS_AIO_H__
+#define __MCUSH_VFS_AIO_H__
+
+/* read/write/flush/close on opened fds served by the io task, so that the
+   caller is not held by slow drivers (spiffs erase and gc, sd cards)
+   1. fill in op, fd, buf, len and cb (or none for notification), then
+      submit, the request and its buffer belong to the io task until done
+   2. the io task serves requests in order with the blocking mcush_xxx
+      calls, requests on one fd are never reordered
+   3. ret is set as the blocking call returns, done is raised, then the
+      callback is called from the io task, or the semaphore of the
+      request is given (see mcush_vfs_aio_wait)
+   the queue is bounded, submit waits up to block_time when it is full
+   the callback runs in the io task and must not block, it may resubmit
+   with block_time 0 only (forced), the io task can not wait for room in
+   its own queue
+   the semaphore is created on the first submit without callback and kept
+   for reuse, zero the request before the first use and release it with
+   mcush_vfs_aio_release, task notifications are left to the caller (eg.
+   shell jobs use them for kill and input) */
+
+#ifndef MCUSH_VFS_AIO_QUEUE_LEN
+    #define MCUSH_VFS_AIO_QUEUE_LEN  8
+#endif
+
+#ifndef MCUSH_VFS_AIO_PRIORITY
+    #define MCUSH_VFS_AIO_PRIORITY  (MCUSH_PRIORITY-1)  /* below producers */
+#endif
+
+#ifndef MCUSH_VFS_AIO_STACK_SIZE
+    #define MCUSH_VFS_AIO_STACK_SIZE  (2*1024)
+#endif
+
+/* latency counter, same as the profiler if not given */
+#ifndef MCUSH_VFS_AIO_COUNTER
+    #if MCUSH_VFS_PROFILER
+        #define MCUSH_VFS_AIO_COUNTER()  MCUSH_VFS_PROFILER_COUNTER()
+        #define MCUSH_VFS_AIO_COUNTER_HZ  MCUSH_VFS_PROFILER_COUNTER_HZ
+    #else
+        #define MCUSH_VFS_AIO_COUNTER()  xTaskGetTickCount()
+        #define MCUSH_VFS_AIO_COUNTER_HZ  configTICK_RATE_HZ
+    #endif
+#endif
+
+
+enum {
+    MCUSH_VFS_AIO_READ=1,
+    MCUSH_VFS_AIO_WRITE,
+    MCUSH_VFS_AIO_FLUSH,
+    MCUSH_VFS_AIO_CLOSE,
+};
+
+typedef struct _mcush_vfs_aio_req_t mcush_vfs_aio_req_t;
+
+struct _mcush_vfs_aio_req_t {
+    uint8_t op;
+    volatile uint8_t done;
+    int fd;
+    void *buf;
+    int len;
+    int ret;  /* as the blocking call */
+    void (*cb)( mcush_vfs_aio_req_t *req );  /* from the io task, may resubmit */
+    void *arg;  /* for the callback */
+    void *sem;  /* given when done without callback */
+    uint32_t submitted;  /* counter */
+};
+
+typedef struct {
+    uint32_t submitted, completed, failed;
+    uint32_t rejected;  /* queue full */
+    uint32_t depth, depth_max;  /* queued and in service */
+    uint32_t wait_max, service_max;  /* counter ticks */
+    uint64_t wait, service;  /* cumulative */
+} mcush_vfs_aio_stat_t;
+
+
+int mcush_vfs_aio_submit( mcush_vfs_aio_req_t *req, int block_time );
+int mcush_vfs_aio_wait( mcush_vfs_aio_req_t *req, int block_time );
+void mcush_vfs_aio_release( mcush_vfs_aio_req_t *req );
+void mcush_vfs_aio_get_stat( mcush_vfs_aio_stat_t *stat );
+void mcush_vfs_aio_reset_stat( void );
+
+#endif
@@ -4,8 +4,6 @@
 #if MCUSH_FATFS
 #include "ff.h"
 
-#define static
-
 #ifndef FATFS_FD_NUM
 #define FATFS_FD_NUM  MCUSH_VFS_FILE_DESCRIPTOR_NUM
 #endif
@@ -35,7 +33,7 @@ int mcush_fatfs_mount( void )
     {
         return 0;
     }
-    memset( &_fds, 0, sizeof(FIL)*FATFS_FD_NUM );
+    memset( &_fds, 0, sizeof(_fds) );
     _mounted = 1;
     return 1;
 }
@@ -62,19 +60,33 @@ int mcush_fatfs_check( void )
 
 int mcush_fatfs_remove( const char *path )
 {
+    FRESULT ret;
+
     if( ! _mounted )
         return 0;
- 
-    return 0;
+    ret = f_unlink( path );
+    if( ret != FR_OK )
+    {
+        mcush_fatfs_driver_errno = ret;
+        return 0;
+    }
+    return 1;
 }
 
 
 int mcush_fatfs_rename( const char *old, const char *newPath )
 {
+    FRESULT ret;
+
     if( ! _mounted )
         return 0;
-
-     return 0;
+    ret = f_rename( old, newPath );
+    if( ret != FR_OK )
+    {
+        mcush_fatfs_driver_errno = ret;
+        return 0;
+    }
+    return 1;
 }
 
 
@@ -106,8 +118,8 @@ static uint8_t parse_fatfs_mode_flags( const char *mode )
         flags |= FA_CREATE_ALWAYS;
     else
         flags |= FA_OPEN_EXISTING;
-    if( c )
-        flags |= FA_CREATE_NEW;
+    if( c && !w )
+        flags |= FA_OPEN_ALWAYS;  /* "w+" still truncates the existing one */
     return flags;
 }
 
@@ -128,44 +140,95 @@ int mcush_fatfs_open( const char *path, const char *mode )
 {
     FRESULT ret;
     FIL *pfil;
-    int fil_idx = get_fil_free_slot();
-
-    if( fil_idx < 0 )
-        return 0;
+    int fil_idx;
 
     pfil = pvPortMalloc( sizeof(FIL) );
     if( pfil == NULL )
         return 0;
 
+    /* taken before f_open blocks, other tasks may open meanwhile */
+    portENTER_CRITICAL();
+    fil_idx = get_fil_free_slot();
+    if( fil_idx >= 0 )
+        _fds[fil_idx] = pfil;
+    portEXIT_CRITICAL();
+    if( fil_idx < 0 )
+    {
+        vPortFree(pfil);
+        return 0;
+    }
+
     ret = f_open( pfil, path, parse_fatfs_mode_flags(mode) );
     if( ret != FR_OK )
     {
         mcush_fatfs_driver_errno = ret;
+        _fds[fil_idx] = 0;
         vPortFree(pfil);
         return 0;
     }
-
-    _fds[fil_idx] = pfil;
     return fil_idx+1;
 }
 
 
 int mcush_fatfs_read( int fh, void *buf, int len )
 {
-    memset( buf, 0x55, len );
-    return len;
+    FRESULT ret;
+    UINT br;
+
+    if( (fh <= 0) || (fh > FATFS_FD_NUM) || !_fds[fh-1] )
+        return -1;
+    ret = f_read( _fds[fh-1], buf, len, &br );
+    if( ret != FR_OK )
+    {
+        mcush_fatfs_driver_errno = ret;
+        return -1;
+    }
+    return br;
 }
 
 
 int mcush_fatfs_write( int fh, void *buf, int len )
 {
-    return 0;
+    FRESULT ret;
+    UINT bw;
+
+    if( (fh <= 0) || (fh > FATFS_FD_NUM) || !_fds[fh-1] )
+        return -1;
+    ret = f_write( _fds[fh-1], buf, len, &bw );
+    if( ret != FR_OK )
+    {
+        mcush_fatfs_driver_errno = ret;
+        return -1;
+    }
+    return bw;
 }
 
 
 int mcush_fatfs_seek( int fh, int offs, int where )
 {
-    return 0;
+    FIL *pfil;
+    int64_t pos;
+    FRESULT ret;
+
+    if( (fh <= 0) || (fh > FATFS_FD_NUM) || !_fds[fh-1] )
+        return -1;
+    pfil = _fds[fh-1];
+    switch( where )
+    {
+    case 1:  pos = (int64_t)f_tell( pfil ) + offs;  break;
+    case 2:  pos = (int64_t)f_size( pfil ) + offs;  break;
+    default: pos = offs;  break;
+    }
+    /* f_lseek takes unsigned position, before the start would wrap */
+    if( pos < 0 )
+        return -1;
+    ret = f_lseek( pfil, (FSIZE_t)pos );
+    if( ret != FR_OK )
+    {
+        mcush_fatfs_driver_errno = ret;
+        return -1;
+    }
+    return (int)f_tell( pfil );
 }
 
 
@@ -174,11 +237,16 @@ int mcush_fatfs_flush( int fh )
     FRESULT ret;
     FIL *pfil;
 
-    if( (fh <= 0) || (fh > FATFS_FD_NUM) )
+    if( (fh <= 0) || (fh > FATFS_FD_NUM) || !_fds[fh-1] )
         return 0;
     pfil = _fds[--fh];
     ret = f_sync( pfil );
-    return (ret==FR_OK) ? 1 : 0;
+    if( ret != FR_OK )
+    {
+        mcush_fatfs_driver_errno = ret;
+        return 0;
+    }
+    return 1;
 }
 
 
@@ -187,12 +255,18 @@ int mcush_fatfs_close( int fh )
     FRESULT ret;
     FIL *pfil;
 
-    if( (fh <= 0) || (fh > FATFS_FD_NUM) )
+    if( (fh <= 0) || (fh > FATFS_FD_NUM) || !_fds[fh-1] )
         return 0;
     pfil = _fds[--fh];
     ret = f_close( pfil );
-    vPortFree( pfil );
+    /* the handle is released anyway, it is not usable after failure */
     _fds[fh] = 0;
+    vPortFree( pfil );
+    if( ret != FR_OK )
+    {
+        mcush_fatfs_driver_errno = ret;
+        return 0;
+    }
     return 1;
 }
 
@@ -213,7 +287,12 @@ int mcush_fatfs_format( void )
 
 int mcush_fatfs_size( const char *name, int *size )
 {
-    return 0;
+    FILINFO fno;
+
+    if( ! _mounted || (f_stat( name, &fno ) != FR_OK) )
+        return 0;
+    *size = (int)fno.fsize;
+    return 1;
 }
 
 
@@ -225,7 +304,18 @@ int mcush_fatfs_info( int *total, int *used )
 
 int mcush_fatfs_list( const char *pathname, void (*cb)(const char *name, int size, int mode) )
 {
-    return 0;
+    DIR dir;
+    FILINFO fno;
+
+    if( ! _mounted || (f_opendir( &dir, "/" ) != FR_OK) )
+        return 0;
+    while( (f_readdir( &dir, &fno ) == FR_OK) && fno.fname[0] )
+    {
+        if( ! (fno.fattrib & AM_DIR) )
+            (*cb)( fno.fname, (int)fno.fsize, 0 );
+    }
+    f_closedir( &dir );
+    return 1;
 }
 
 
@@ -83,25 +83,29 @@ int mcush_fcfs_open( const char *pathname, const char *mode )
     fcfs_file_t *f = (fcfs_file_t*)(FCFS_ADDR+4);
     int i, j;
     
+    while( (f->offset != 0) && (f->offset != 0xFFFF) )
+    {
+        if( strcmp((char*)(FCFS_ADDR+f->offset), pathname)==0 )
+            break;
+        f++;
+    }
+    if( (f->offset == 0) || (f->offset == 0xFFFF) )
+        return 0;
+    j = strlen((char*)(FCFS_ADDR+f->offset));
+    /* other tasks may open at the same time */
+    portENTER_CRITICAL();
     for( i=0; i<FCFS_FDS_NUM; i++ )
     {
         if( ! _fds[i].file )
         {
-            while( (f->offset != 0) && (f->offset != 0xFFFF) )
-            {
-                if( strcmp((char*)(FCFS_ADDR+f->offset), pathname)==0 )
-                {
-                    _fds[i].file = f;
-                    j = strlen((char*)(FCFS_ADDR+f->offset));
-                    _fds[i].contents = (const char *)(FCFS_ADDR+f->offset+j+1);
-                    _fds[i].pos = 0;
-                    return i+1;
-                }
-                f++;
-            }
+            _fds[i].file = f;
+            _fds[i].contents = (const char *)(FCFS_ADDR+f->offset+j+1);
+            _fds[i].pos = 0;
+            break;
         }
     }
-    return 0;
+    portEXIT_CRITICAL();
+    return i < FCFS_FDS_NUM ? i+1 : 0;
 }
 
 
@@ -119,7 +123,10 @@ int mcush_fcfs_read( int fh, void *buf, int len )
     if( i > len )
         i = len;
     if( i )
+    {
         memcpy( buf, (const void*)&_fds[fh].contents[_fds[fh].pos], i ); 
+        _fds[fh].pos += i;
+    }
     return i;
 }
 
@@ -155,7 +162,7 @@ int mcush_fcfs_seek( int fh, int offs, int where )
 
 int mcush_fcfs_flush( int fh )
 {
-    return 0;
+    return 1;  /* read only */
 }
 
 
@@ -166,6 +173,17 @@ int mcush_fcfs_close( int fh )
 }
 
 
+int mcush_fcfs_mmap( int fh, const void **buf, int *len )
+{
+    fh -= 1;
+    if( !_fds[fh].file ) 
+        return 0;
+    *buf = (const void*)_fds[fh].contents;
+    *len = _fds[fh].file->len;
+    return 1;
+}
+
+
 int mcush_fcfs_size( const char *name, int *size )
 {
     fcfs_file_t *f = (fcfs_file_t *)(FCFS_ADDR+4);
@@ -220,6 +238,7 @@ const mcush_vfs_driver_t mcush_fcfs_driver = {
     mcush_fcfs_close,
     mcush_fcfs_size,
     mcush_fcfs_list,
+    mcush_fcfs_mmap,
     };
 
 #endif
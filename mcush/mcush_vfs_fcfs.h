@@ -36,6 +36,7 @@ int mcush_fcfs_write( int fh, void *buf, int len );
 int mcush_fcfs_flush( int fh );
 int mcush_fcfs_close( int fh );
 int mcush_fcfs_list( const char *pathname, void (*cb)(const char *name, int size, int mode) );
+int mcush_fcfs_mmap( int fh, const void **buf, int *len );
 
 
 extern const mcush_vfs_driver_t mcush_fcfs_driver;
@@ -70,23 +70,23 @@ int mcush_romfs_open( const char *pathname, const char *mode )
     const romfs_file_t *f = romfs_tab;
     int i;
     
+    while( f->name && strcmp(f->name, pathname) )
+        f++;
+    if( ! f->name )
+        return 0;
+    /* other tasks may open at the same time */
+    portENTER_CRITICAL();
     for( i=0; i<ROMFS_FDS_NUM; i++ )
     {
         if( ! _fds[i].file )
         {
-            while( f->name )
-            {
-                if( strcmp(f->name, pathname)==0 )
-                {
-                    _fds[i].file = f;
-                    _fds[i].pos = 0;
-                    return i+1;
-                }
-                f++;
-            }
+            _fds[i].file = f;
+            _fds[i].pos = 0;
+            break;
         }
     }
-    return 0;
+    portEXIT_CRITICAL();
+    return i < ROMFS_FDS_NUM ? i+1 : 0;
 }
 
 
@@ -143,7 +143,7 @@ int mcush_romfs_seek( int fh, int offs, int where )
 
 int mcush_romfs_flush( int fh )
 {
-    return 0;
+    return 1;  /* read only */
 }
 
 
@@ -154,6 +154,17 @@ int mcush_romfs_close( int fh )
 }
 
 
+int mcush_romfs_mmap( int fh, const void **buf, int *len )
+{
+    fh -= 1;
+    if( !_fds[fh].file ) 
+        return 0;
+    *buf = (const void*)_fds[fh].file->contents;
+    *len = _fds[fh].file->len;
+    return 1;
+}
+
+
 int mcush_romfs_size( const char *name, int *size )
 {
     const romfs_file_t *f = romfs_tab;
@@ -208,6 +219,7 @@ const mcush_vfs_driver_t mcush_romfs_driver = {
     mcush_romfs_close,
     mcush_romfs_size,
     mcush_romfs_list,
+    mcush_romfs_mmap,
     };
 
 #endif
@@ -33,6 +33,7 @@ int mcush_romfs_write( int fh, void *buf, int len );
 int mcush_romfs_flush( int fh );
 int mcush_romfs_close( int fh );
 int mcush_romfs_list( const char *pathname, void (*cb)(const char *name, int size, int mode) );
+int mcush_romfs_mmap( int fh, const void **buf, int *len );
 
 
 extern const mcush_vfs_driver_t mcush_romfs_driver;
@@ -22,6 +22,7 @@ static char _work_buf[2*SPIFLASH_CFG_LOG_PAGE_SZ];
 static char _fds[SPIFFS_FD_NUM * sizeof(spiffs_fd)];
 static char _cache_buf[sizeof(spiffs_cache) + SPIFFS_CACHE_NUM * 
                      (sizeof(spiffs_cache_page)+SPIFLASH_CFG_LOG_PAGE_SZ)];
+static int mcush_spiffs_driver_errno;
 SemaphoreHandle_t semaphore_spiffs;
 
 
@@ -209,14 +210,24 @@ int mcush_spiffs_seek( int fh, int offs, int where )
 int mcush_spiffs_flush( int fh )
 {
     int ret = SPIFFS_fflush( &_fs, fh );
-    return ret < 0 ? 0 : ret;
+    if( ret < 0 )
+    {
+        mcush_spiffs_driver_errno = ret;
+        return 0;
+    }
+    return 1;
 }
 
 
 int mcush_spiffs_close( int fh )
 {
     int ret = SPIFFS_close( &_fs, fh );
-    return ret < 0 ? 0 : ret;
+    if( ret < 0 )
+    {
+        mcush_spiffs_driver_errno = ret;
+        return 0;
+    }
+    return 1;
 }
 
 
@@ -270,8 +281,6 @@ int mcush_spiffs_list( const char *pathname, void (*cb)(const char *name, int si
 }
 
 
-static int mcush_spiffs_driver_errno;
-
 const mcush_vfs_driver_t mcush_spiffs_driver = {
     &mcush_spiffs_driver_errno,
     mcush_spiffs_mount,
@@ -0,0 +1,384 @@
+/* MCUSH designed by Peng Shulin, all rights reserved. */
+#if MCUSH_VFS
+#include "mcush.h"
+
+#if USE_CMD_XFER
+
+#define XFER_PACKET_LEN(len)  (XFER_HEAD_LEN+(len)+4)
+#define XFER_CTRL_PAYLOAD  15  /* START is the largest */
+
+
+static void put16( uint8_t *p, uint16_t v )
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+}
+
+
+static void put32( uint8_t *p, uint32_t v )
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+
+static uint32_t get32( const uint8_t *p )
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+
+/* payload is already at buf+XFER_HEAD_LEN */
+static void xfer_send( uint8_t *buf, uint8_t type, uint16_t seq, int len )
+{
+    buf[0] = XFER_SOF;
+    buf[1] = type;
+    put16( &buf[2], seq );
+    put16( &buf[4], len );
+    put32( &buf[XFER_HEAD_LEN+len],
+           crc32_final( crc32_update( crc32_init(), &buf[1], XFER_HEAD_LEN-1+len ) ) );
+    shell_write( (const char*)buf, XFER_PACKET_LEN(len) );
+}
+
+
+static void xfer_send_ctrl( uint8_t type, uint16_t seq, uint8_t code )
+{
+    uint8_t buf[XFER_PACKET_LEN(1)];
+
+    buf[XFER_HEAD_LEN] = code;
+    xfer_send( buf, type, seq, type == XFER_ABORT ? 1 : 0 );
+}
+
+
+static int xfer_read( uint8_t *buf, int len )
+{
+    char c;
+
+    while( len-- )
+    {
+        if( shell_read_char_blocked( &c, XFER_TIMEOUT_MS*configTICK_RATE_HZ/1000 ) == -1 )
+            return 0;
+        *buf++ = (uint8_t)c;
+    }
+    return 1;
+}
+
+
+/* wait for a packet into buf, returns its type, 0 for timeout, -1 for
+   corrupted one, or XFER_ABORT with zero length for Ctrl-C when user_break
+   is set (only before the first packet, data may contain 0x03) */
+static int xfer_recv( uint8_t *buf, int size, uint16_t *seq, int *len, int timeout_ms, int user_break )
+{
+    char c;
+    int l;
+
+    while( 1 )
+    {
+        if( shell_read_char_blocked( &c, timeout_ms*configTICK_RATE_HZ/1000 ) == -1 )
+            return 0;
+        if( c == XFER_SOF )
+            break;
+        if( (c == 0x03) && user_break )
+        {
+            *len = 0;
+            return XFER_ABORT;
+        }
+    }
+    buf[0] = XFER_SOF;
+    if( ! xfer_read( &buf[1], XFER_HEAD_LEN-1 ) )
+        return -1;
+    l = buf[4] | (buf[5] << 8);
+    if( l > size )
+        return -1;
+    if( ! xfer_read( &buf[XFER_HEAD_LEN], l + 4 ) )
+        return -1;
+    if( crc32_final( crc32_update( crc32_init(), &buf[1], XFER_HEAD_LEN-1+l ) )
+            != get32( &buf[XFER_HEAD_LEN+l] ) )
+        return -1;
+    *seq = buf[2] | (buf[3] << 8);
+    *len = l;
+    return buf[1];
+}
+
+
+static void xfer_send_start( uint8_t *buf, int offset, int size, uint32_t crc )
+{
+    uint8_t *p = &buf[XFER_HEAD_LEN];
+
+    put32( p, offset );
+    put32( p+4, size );
+    put32( p+8, crc );
+    put16( p+12, XFER_BLOCK_SIZE );
+    p[14] = XFER_WINDOW;
+    xfer_send( buf, XFER_START, 0, 15 );
+}
+
+
+/* crc of the leading bytes, file position is left at the end of them */
+static int xfer_crc_head( int fd, uint8_t *buf, int len, uint32_t *crc )
+{
+    int r;
+
+    while( len > 0 )
+    {
+        r = mcush_read( fd, buf, len < XFER_BLOCK_SIZE ? len : XFER_BLOCK_SIZE );
+        if( r <= 0 )
+            return 0;
+        *crc = crc32_update( *crc, buf, r );
+        len -= r;
+    }
+    return 1;
+}
+
+
+/* receive file from host, resume appends to what has been saved */
+int mcush_xfer_put( const char *fname, int resume, int *bytes )
+{
+    uint8_t *buf, *payload;
+    int fd=0, size=0, len, type, err=XFER_ERR_NONE;
+    int retry=0, nak=0, started=0, remote=0;
+    uint16_t seq, expected=0;
+    uint32_t crc=crc32_init(), total;
+
+    *bytes = 0;
+    buf = pvPortMalloc( XFER_PACKET_LEN(XFER_BLOCK_SIZE) );
+    if( buf == 0 )
+    {
+        xfer_send_ctrl( XFER_ABORT, 0, XFER_ERR_MEMORY );
+        return XFER_ERR_MEMORY;
+    }
+    payload = &buf[XFER_HEAD_LEN];
+    if( ! resume || ! mcush_size( fname, &size ) )
+        size = 0;
+    if( size )
+    {
+        fd = mcush_open( fname, "r" );
+        if( (fd == 0) || ! xfer_crc_head( fd, buf, size, &crc ) )
+            err = XFER_ERR_FILE;
+        if( fd )
+            mcush_close( fd );
+    }
+    if( ! err )
+    {
+        fd = mcush_open( fname, size ? "a+" : "w+" );
+        if( fd == 0 )
+            err = XFER_ERR_FILE;
+    }
+    total = size;
+    if( ! err )
+        xfer_send_start( buf, size, size, crc32_final( crc ) );
+    while( ! err )
+    {
+        type = xfer_recv( buf, XFER_BLOCK_SIZE, &seq, &len, XFER_TIMEOUT_MS, !started );
+        if( type == 0 )
+        {
+            if( ++retry > XFER_RETRY )
+                err = XFER_ERR_TIMEOUT;
+            else if( started )
+                xfer_send_ctrl( XFER_NAK, expected, 0 );  /* the nak may be lost */
+            else
+                xfer_send_start( buf, size, size, crc32_final( crc ) );
+            continue;
+        }
+        if( type < 0 )
+        {
+            if( started && ! nak )
+            {
+                xfer_send_ctrl( XFER_NAK, expected, 0 );
+                nak = 1;
+            }
+            continue;
+        }
+        switch( type )
+        {
+        case XFER_DATA:
+            started = 1;
+            retry = 0;
+            if( seq == expected )
+            {
+                if( len && (mcush_write( fd, payload, len ) != len) )
+                {
+                    err = XFER_ERR_FILE;
+                    break;
+                }
+                crc = crc32_update( crc, payload, len );
+                total += len;
+                expected++;
+                nak = 0;
+                xfer_send_ctrl( XFER_ACK, expected, 0 );
+            }
+            else if( (uint16_t)(expected - seq) <= XFER_WINDOW )
+                xfer_send_ctrl( XFER_ACK, expected, 0 );  /* resent, ack lost */
+            else if( ! nak )
+            {
+                xfer_send_ctrl( XFER_NAK, expected, 0 );
+                nak = 1;
+            }
+            break;
+        case XFER_END:
+            if( len < 8 )
+                err = XFER_ERR_PROTOCOL;
+            else if( get32( payload ) != total )
+                err = XFER_ERR_LENGTH;
+            else if( get32( payload+4 ) != crc32_final( crc ) )
+                err = XFER_ERR_CRC;
+            else
+            {
+                xfer_send_ctrl( XFER_ACK, expected, 0 );
+                goto done;
+            }
+            break;
+        case XFER_ABORT:
+            err = (len && payload[0]) ? payload[0] : XFER_ERR_USER;
+            remote = len;  /* not for Ctrl-C */
+            break;
+        default:
+            break;
+        }
+    }
+    if( ! remote )
+        xfer_send_ctrl( XFER_ABORT, 0, err );
+done:
+    if( fd )
+        mcush_close( fd );
+    vPortFree( buf );
+    *bytes = total - size;
+    return err;
+}
+
+
+/* send file to host from offset */
+int mcush_xfer_get( const char *fname, int offset, int *bytes )
+{
+    uint8_t *buf, *payload, ctrl[XFER_PACKET_LEN(XFER_CTRL_PAYLOAD)];
+    int fd=0, size, len, type, timeout, err=XFER_ERR_NONE;
+    int retry=0, remote=0, acked=0;
+    uint32_t base=0, next=0, sent=0, blocks, ack;
+    uint32_t crc=crc32_init();
+    uint16_t seq;
+
+    *bytes = 0;
+    buf = pvPortMalloc( XFER_PACKET_LEN(XFER_BLOCK_SIZE) );
+    if( buf == 0 )
+    {
+        xfer_send_ctrl( XFER_ABORT, 0, XFER_ERR_MEMORY );
+        return XFER_ERR_MEMORY;
+    }
+    payload = &buf[XFER_HEAD_LEN];
+    if( ! mcush_size( fname, &size ) || (offset < 0) || (offset > size) )
+        err = XFER_ERR_FILE;
+    else
+    {
+        fd = mcush_open( fname, "r" );
+        if( (fd == 0) || ! xfer_crc_head( fd, buf, offset, &crc ) )
+            err = XFER_ERR_FILE;
+    }
+    if( err )
+        goto abort;
+    xfer_send_start( buf, offset, size, crc32_final( crc ) );
+    blocks = (size - offset + XFER_BLOCK_SIZE - 1) / XFER_BLOCK_SIZE;
+    while( base < blocks )
+    {
+        if( (next < blocks) && (next - base < XFER_WINDOW) )
+        {
+            len = size - offset - next * XFER_BLOCK_SIZE;
+            if( len > XFER_BLOCK_SIZE )
+                len = XFER_BLOCK_SIZE;
+            if( mcush_read( fd, payload, len ) != len )
+            {
+                err = XFER_ERR_FILE;
+                goto abort;
+            }
+            if( next == sent )
+            {
+                crc = crc32_update( crc, payload, len );
+                sent++;
+            }
+            xfer_send( buf, XFER_DATA, (uint16_t)next, len );
+            next++;
+            timeout = 0;  /* only poll for acks while window is open */
+        }
+        else
+            timeout = XFER_TIMEOUT_MS;
+        type = xfer_recv( ctrl, XFER_CTRL_PAYLOAD, &seq, &len, timeout, !acked );
+        if( type == 0 )
+        {
+            if( ! timeout )
+                continue;
+            if( ++retry > XFER_RETRY )
+            {
+                err = XFER_ERR_TIMEOUT;
+                goto abort;
+            }
+            type = XFER_NAK;  /* go back */
+            seq = (uint16_t)base;
+        }
+        if( type == XFER_ABORT )
+        {
+            err = (len && ctrl[XFER_HEAD_LEN]) ? ctrl[XFER_HEAD_LEN] : XFER_ERR_USER;
+            remote = len;
+            goto abort;
+        }
+        if( (type != XFER_ACK) && (type != XFER_NAK) )
+            continue;
+        acked = 1;
+        ack = base + (uint16_t)(seq - (uint16_t)base);
+        if( ack > next )
+            continue;  /* not for this window */
+        if( ack > base )
+        {
+            base = ack;
+            retry = 0;
+        }
+        if( (type == XFER_NAK) && (next != base) )
+        {
+            next = base;
+            if( mcush_seek( fd, offset + next * XFER_BLOCK_SIZE, 0 ) < 0 )
+            {
+                err = XFER_ERR_FILE;
+                goto abort;
+            }
+        }
+    }
+
+    /* all acked, confirm length and crc of the whole file */
+    retry = 0;
+    while( 1 )
+    {
+        put32( payload, size );
+        put32( payload+4, crc32_final( crc ) );
+        xfer_send( buf, XFER_END, (uint16_t)next, 8 );
+        type = xfer_recv( ctrl, XFER_CTRL_PAYLOAD, &seq, &len, XFER_TIMEOUT_MS, !acked );
+        if( type == XFER_ACK )
+            break;
+        if( type == XFER_ABORT )
+        {
+            err = (len && ctrl[XFER_HEAD_LEN]) ? ctrl[XFER_HEAD_LEN] : XFER_ERR_USER;
+            remote = len;
+            goto abort;
+        }
+        if( ++retry > XFER_RETRY )
+        {
+            err = XFER_ERR_TIMEOUT;
+            goto abort;
+        }
+    }
+    mcush_close( fd );
+    vPortFree( buf );
+    *bytes = size - offset;
+    return 0;
+
+abort:
+    if( ! remote )
+        xfer_send_ctrl( XFER_ABORT, 0, err );
+    if( fd )
+        mcush_close( fd );
+    vPortFree( buf );
+    *bytes = base * XFER_BLOCK_SIZE;
+    return err;
+}
+
+#endif
+#endif
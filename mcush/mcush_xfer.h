@@ -0,0 +1,70 @@
+/* MCUSH designed by Peng Shulin, all rights reserved. */
+#ifndef __MCUSH_XFER_H__
+#define __MCUSH_XFER_H__
+
+/* windowed binary file transfer over the shell driver, see cmd_xfer
+       xfer -p [-r] <file>        put, host sends the file
+       xfer -g [-o <offset>] <file>  get, host receives the file
+   packet:  SOF | type(1) | seq(2) | length(2) | payload | crc32(4)
+            crc32 covers type to payload, all little-endian
+   1. device sends START:
+          offset(4) | size(4) | crc32 of [0,offset)(4) | block(2) | window(1)
+      put: offset is the length already saved (-r), the host continues from
+           there if its own crc of the same range matches, else aborts
+      get: offset from -o, size is the file length, the host checks its
+           partial copy against the crc
+   2. sender sends DATA seq=0,1,2... (wraps) with up to block bytes, never
+      more than window packets unacknowledged
+   3. receiver writes in-order DATA straight to the file and ACKs with the
+      next expected seq, NAKs once when a packet is lost or corrupted and
+      again on timeout, sender goes back to that seq on NAK or after a
+      timeout (go-back-N)
+   4. sender sends END: total length(4) | crc32 of the whole file(4),
+      receiver ACKs, or ABORTs on mismatch
+   ABORT: code(1), either side ends the transfer with it
+   the command prints the result line and prompt as usual afterwards */
+
+#ifndef XFER_BLOCK_SIZE
+    #define XFER_BLOCK_SIZE  512
+#endif
+
+#ifndef XFER_WINDOW
+    #define XFER_WINDOW  8
+#endif
+
+#ifndef XFER_TIMEOUT_MS
+    #define XFER_TIMEOUT_MS  1000
+#endif
+
+#ifndef XFER_RETRY
+    #define XFER_RETRY  10
+#endif
+
+#define XFER_SOF  0x02
+#define XFER_HEAD_LEN  6  /* SOF type seq length */
+
+enum {
+    XFER_START=1,
+    XFER_DATA,
+    XFER_ACK,
+    XFER_NAK,
+    XFER_END,
+    XFER_ABORT,
+};
+
+/* abort codes */
+enum {
+    XFER_ERR_NONE=0,
+    XFER_ERR_USER,      /* Ctrl-C or host cancel */
+    XFER_ERR_TIMEOUT,
+    XFER_ERR_FILE,      /* open/read/write/seek failed */
+    XFER_ERR_CRC,       /* whole file crc mismatch */
+    XFER_ERR_LENGTH,    /* total length mismatch */
+    XFER_ERR_PROTOCOL,
+    XFER_ERR_MEMORY,
+};
+
+int mcush_xfer_put( const char *fname, int resume, int *bytes );
+int mcush_xfer_get( const char *fname, int offset, int *bytes );
+
+#endif
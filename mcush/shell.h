@@ -56,6 +56,92 @@ extern "C" {
 #ifndef SHELL_HALT_ON_ADD_CMD_TABLE_FAIL
     #define SHELL_HALT_ON_ADD_CMD_TABLE_FAIL  1
 #endif
+#ifndef SHELL_CMD_INDEX_ENABLE
+    #define SHELL_CMD_INDEX_ENABLE  1
+#endif
+#ifndef USE_SHELL_JOB
+    #define USE_SHELL_JOB  0
+#endif
+#if USE_SHELL_JOB
+    #ifndef SHELL_JOB_NUM
+        #define SHELL_JOB_NUM  2
+    #endif
+    #ifndef SHELL_JOB_OUTPUT_BUF_SIZE
+        #define SHELL_JOB_OUTPUT_BUF_SIZE  512
+    #endif
+    #ifndef SHELL_JOB_STACK_SIZE
+        #define SHELL_JOB_STACK_SIZE  (2*1024)
+    #endif
+    #ifndef SHELL_JOB_PRIORITY
+        #define SHELL_JOB_PRIORITY  (MCUSH_PRIORITY)
+    #endif
+#endif
+#ifndef SHELL_SESSION_NUM
+    #if USE_SHELL_JOB
+        /* each job worker owns a session */
+        #define SHELL_SESSION_NUM  (1+SHELL_JOB_NUM)
+    #else
+        #define SHELL_SESSION_NUM  1
+    #endif
+#endif
+#if USE_SHELL_JOB && (SHELL_SESSION_NUM < 1+SHELL_JOB_NUM)
+    #error "SHELL_SESSION_NUM too small for SHELL_JOB_NUM"
+#endif
+#ifndef USE_SHELL_PROFILER
+    #define USE_SHELL_PROFILER  0
+#endif
+#if USE_SHELL_PROFILER
+    /* free-running counter for command timing, define a high-resolution
+       one (eg. DWT->CYCCNT) together with its frequency if available */
+    #ifndef SHELL_PROFILER_COUNTER
+        #define SHELL_PROFILER_COUNTER()  xTaskGetTickCount()
+    #endif
+    #ifndef SHELL_PROFILER_COUNTER_HZ
+        #define SHELL_PROFILER_COUNTER_HZ  configTICK_RATE_HZ
+    #endif
+#endif
+#ifndef SHELL_WRITE_SINK_NUM
+    #define SHELL_WRITE_SINK_NUM  3
+#endif
+#ifndef SHELL_WRITE_SINK_BUF_SIZE
+    #define SHELL_WRITE_SINK_BUF_SIZE  32
+#endif
+#ifndef USE_SHELL_CHAIN
+    #define USE_SHELL_CHAIN  1
+#endif
+#ifndef USE_SHELL_SCRIPT_IMAGE
+    #define USE_SHELL_SCRIPT_IMAGE  1
+#endif
+#define SHELL_SCRIPT_IMAGE_MAGIC  "MSI\x01"
+#define SHELL_SCRIPT_IMAGE_HEAD_LEN  6
+#if USE_SHELL_SCRIPT_IMAGE && (SHELL_ARGV_LEN > 63)
+    #error "SHELL_ARGV_LEN too large for script image"
+#endif
+#ifndef USE_SHELL_FRAME
+    #define USE_SHELL_FRAME  1
+#endif
+#ifndef SHELL_FRAME_BUF_SIZE
+    #if USE_SHELL_CHAIN
+        /* room for a batch of chained commands */
+        #define SHELL_FRAME_BUF_SIZE  512
+    #else
+        #define SHELL_FRAME_BUF_SIZE  (SHELL_CMDLINE_LEN+SHELL_ARGV_LEN)
+    #endif
+#endif
+#ifndef SHELL_FRAME_ARGV_LEN
+    #if USE_SHELL_CHAIN
+        #define SHELL_FRAME_ARGV_LEN  128
+    #else
+        #define SHELL_FRAME_ARGV_LEN  SHELL_ARGV_LEN
+    #endif
+#endif
+#ifndef SHELL_FRAME_OUTPUT_BUF_SIZE
+    #define SHELL_FRAME_OUTPUT_BUF_SIZE  1024
+#endif
+#ifndef SHELL_FRAME_TIMEOUT_MS
+    #define SHELL_FRAME_TIMEOUT_MS  1000
+#endif
+#define SHELL_FRAME_SOF  0x02
 
 #define STOP_AT_INVALID_ARGUMENT   \
         return mcush_opt_check_invalid_argument(argv[0], &opt, opt_spec);
@@ -68,7 +154,7 @@ extern "C" {
             loop_tick = xTaskGetTickCount(); \
             while( xTaskGetTickCount() < loop_tick + loop_delay*configTICK_RATE_HZ/1000 ) \
             { \
-                if( shell_driver_read_char_blocked(&c, 10*configTICK_RATE_HZ/1000) != -1 ) \
+                if( shell_read_char_blocked(&c, 10*configTICK_RATE_HZ/1000) != -1 ) \
                 { \
                     if( c == 0x03 ) /* Ctrl-C for stop */ \
                         return 0; \
@@ -84,6 +170,16 @@ enum {
     CMD_END,
 };
 
+/* status code of response frame */
+enum {
+    SHELL_FRAME_OK=0,
+    SHELL_FRAME_ERR_CRC,
+    SHELL_FRAME_ERR_LENGTH,
+    SHELL_FRAME_ERR_COMMAND,
+    SHELL_FRAME_OUTPUT_TRUNCATED,
+    SHELL_FRAME_SKIPPED,
+};
+
 typedef struct _shell_cmd {
     uint8_t flag;
     char sname;
@@ -94,7 +190,40 @@ typedef struct _shell_cmd {
 } shell_cmd_t;
 
 
+/* output sink, receives block writes of the session output */
+#define SHELL_WRITE_SINK_EXCLUSIVE  0x01  /* not forwarded to the driver */
+typedef struct _shell_write_sink_t {
+    int (*write)( void *arg, const char *buf, int len );
+    void *arg;
+    uint8_t flag;
+} shell_write_sink_t;
+
+
+/* ram ring buffer for output capture, keeps the latest output */
+typedef struct _shell_write_ring_t {
+    char *buf;
+    int size;
+    int head;  /* next write position */
+    int len;
+    uint8_t overflow;
+} shell_write_ring_t;
+
+
+/* driver of one shell session, the default session uses shell_driver_xxx */
+typedef struct _shell_driver_ops_t {
+    int  (*init)( void );
+    void (*reset)( void );
+    int  (*read_char)( char *c );
+    int  (*read_char_blocked)( char *c, int block_time );
+    int  (*write)( const char *buffer, int len );
+    void (*write_char)( char c );
+} shell_driver_ops_t;
+
+
 typedef struct _shell_control_block_t {
+    const shell_driver_ops_t *driver;
+    void *task;
+    uint8_t closed;
     int errnum;
     char *argv[SHELL_ARGV_LEN];
     uint8_t argc;
@@ -103,26 +232,102 @@ typedef struct _shell_control_block_t {
     uint8_t history_index;
     char cmdline[SHELL_CMDLINE_LEN+1];
     char cmdline_history[SHELL_CMDLINE_HISTORY_LEN+1];
-    const char *(*prompt_hook)(void);
-    const shell_cmd_t *cmd_table[SHELL_CMD_TABLE_LEN];
     const char *script;
     const char *script_free;
     int (*write_sniffer)( const char *buf, int len );
-    //uint8_t write_sniffer_block_mode;
+    shell_write_sink_t write_sink[SHELL_WRITE_SINK_NUM];
+    uint8_t write_sink_num;
+    uint8_t write_sink_exclusive;
+    uint8_t write_sink_buf_len;  /* chars from shell_write_char, not flushed */
+    char write_sink_buf[SHELL_WRITE_SINK_BUF_SIZE];
+#if USE_SHELL_FRAME
+    char *write_capture;
+    int write_capture_size;
+    int write_capture_len;
+    uint8_t write_capture_overflow;
+#endif
 } shell_control_block_t;
 
 
+#if USE_SHELL_PROFILER
+/* execution statistics of one command table entry */
+typedef struct _shell_cmd_stat_t {
+    uint32_t count;
+    uint32_t ticks;  /* cumulative */
+    uint32_t max;
+    int ret;  /* last return code */
+} shell_cmd_stat_t;
+#endif
+
+
+#if USE_SHELL_JOB
+enum {
+    SHELL_JOB_FREE=0,
+    SHELL_JOB_RUNNING,
+    SHELL_JOB_DONE,
+    SHELL_JOB_RESERVED,  /* being started */
+};
+
+/* command line running on a worker task, output kept in buffer */
+typedef struct _shell_job_t {
+    void *task;
+    volatile uint8_t state;
+    volatile uint8_t killed;
+    uint8_t output_overflow;
+    int ret;
+    int output_len;
+    char cmdline[SHELL_CMDLINE_LEN+1];
+    char output[SHELL_JOB_OUTPUT_BUF_SIZE];
+} shell_job_t;
+#endif
+
+
+/* command tables and prompt hook, shared by all sessions */
+typedef struct _shell_common_t {
+    const char *(*prompt_hook)(void);
+    const shell_cmd_t *cmd_table[SHELL_CMD_TABLE_LEN];
+#if SHELL_CMD_INDEX_ENABLE
+    /* entries sorted by name, followed by entries sorted by sname */
+    uint8_t *cmd_index[SHELL_CMD_TABLE_LEN];
+    uint8_t cmd_index_num[SHELL_CMD_TABLE_LEN];
+    uint8_t cmd_index_abbr_num[SHELL_CMD_TABLE_LEN];
+#endif
+#if USE_SHELL_PROFILER
+    shell_cmd_stat_t *cmd_stat[SHELL_CMD_TABLE_LEN];
+#endif
+} shell_common_t;
+
+
 /* APIs */
 int  shell_init( const shell_cmd_t *cmd_table, const char *init_script );
 void shell_run( void );
+int  shell_session_run( const shell_driver_ops_t *driver, const char *init_script );
+void shell_session_close( void );
+#if SHELL_SESSION_NUM > 1
+shell_control_block_t *shell_session_bind( const shell_driver_ops_t *driver, void *task );
+void shell_session_unbind( shell_control_block_t *scb );
+#endif
+#if USE_SHELL_JOB
+int  shell_job_start( const char *cmd_line );
+int  shell_job_kill( int id );
+int  shell_job_free( int id );
+const shell_job_t *shell_job_get( int id );
+int  shell_job_print_output( int id );
+#endif
 void shell_set_prompt_hook( const char *(*hook)(void) );
 int  shell_add_cmd_table( const shell_cmd_t *cmd_table );
+const shell_cmd_t *shell_get_cmd_table( int cmdtab_index );
+#if USE_SHELL_PROFILER
+const shell_cmd_stat_t *shell_get_cmd_stat( int cmdtab_index );
+void shell_reset_cmd_stat( void );
+#endif
 int  shell_print_help( const char *cmd, int show_hidden );
 int  shell_set_script( const char *script, int need_free );
 void shell_set_errnum( int errnum );
 int  shell_get_errnum( void );
 char *shell_get_buf( void );
 int  shell_read_char( char *c );
+int  shell_read_char_blocked( char *c, int block_time );
 int  shell_read( char *buf, int len );
 int  shell_read_line( char *c, const char *prompt );
 char *shell_read_multi_lines( const char *prompt );
@@ -133,6 +338,14 @@ void shell_write_str( const char *str );
 void shell_write_line( const char *str );
 void shell_write_err( const char *str );
 void shell_write_set_sniffer( int (*hook)( const char *buf, int len ) );
+int  shell_write_add_sink( int (*write)( void *arg, const char *buf, int len ), void *arg, int flag );
+int  shell_write_remove_sink( int (*write)( void *arg, const char *buf, int len ), void *arg );
+void shell_write_flush_sink( void );
+void shell_write_ring_init( shell_write_ring_t *ring, char *buf, int size );
+int  shell_write_ring_sink( void *arg, const char *buf, int len );
+int  shell_write_ring_read( shell_write_ring_t *ring, char *buf, int len );
+void shell_write_set_capture( char *buf, int size );
+int  shell_write_get_capture( int *overflow );
 void shell_newline( void );
 void shell_write_int( int i );
 void shell_write_float( float f );
@@ -145,6 +358,12 @@ int  shell_make_float_data_buffer( void **pbuf, int *len );
 int  (*shell_get_cmd_by_name( const char *name ))(int argc, char *argv[]);
 int  shell_call( const char *cmd_name, ... );
 int  shell_call_line( char *cmd_line );
+int  shell_frame_mode( void );
+#if USE_SHELL_SCRIPT_IMAGE
+int  shell_script_compile( const char *script, char **image, int *size );
+int  shell_script_is_image( const char *image, int size );
+int  shell_script_run( char *image, int size );
+#endif
 
 /* driver APIs needed */
 extern int  shell_driver_init( void );
@@ -41,7 +41,12 @@ extern int cmd_copy( int argc, char *argv[] );
 extern int cmd_list( int argc, char *argv[] );
 extern int cmd_load( int argc, char *argv[] );
 extern int cmd_crc( int argc, char *argv[] );
+extern int cmd_xfer( int argc, char *argv[] );
 extern int cmd_loop( int argc, char *argv[] );
+extern int cmd_frame( int argc, char *argv[] );
+extern int cmd_jobs( int argc, char *argv[] );
+extern int cmd_kill( int argc, char *argv[] );
+extern int cmd_capture( int argc, char *argv[] );
 
 
 
@@ -279,7 +284,7 @@ const shell_cmd_t CMD_TAB[] = {
 #if USE_CMD_CP
 {   0, 0, "cp",  cmd_copy, 
     "copy file",
-    "cp <src> <dst>"  },
+    "cp [-b <size>] [-v] <src> <dst>"  },
 #endif
 #if USE_CMD_LS
 {   0, 'l', "ls",  cmd_list, 
@@ -289,18 +294,45 @@ const shell_cmd_t CMD_TAB[] = {
 #if USE_CMD_LOAD
 {   0,  0,  "load",  cmd_load, 
     "load script",
+#if USE_SHELL_SCRIPT_IMAGE
+    "load [-f] [-o <image>] <pathname>" },
+#else
     "load <pathname>" },
 #endif
+#endif
 #if USE_CMD_CRC
 {   0, 0, "crc",  cmd_crc, 
     "file crc check",
     "crc <pathname>"  },
 #endif
+#if USE_CMD_XFER
+{   CMD_HIDDEN, 0, "xfer",  cmd_xfer, 
+    "binary file transfer",
+    "xfer -p [-r]|-g [-o <offset>] <pathname>"  },
+#endif
 #if USE_CMD_LOOP
 {   0, 0, "loop",  cmd_loop, 
     "run command looply",
     "loop <cmd and args>"  },
 #endif
+#if USE_CMD_FRAME
+{   CMD_HIDDEN, 0, "frame",  cmd_frame, 
+    "enter binary frame mode",
+    "frame"  },
+#endif
+#if USE_CMD_JOBS
+{   0, 0, "jobs",  cmd_jobs, 
+    "list background jobs",
+    "jobs [-o <id>]"  },
+{   0, 0, "kill",  cmd_kill, 
+    "stop background job",
+    "kill <id>"  },
+#endif
+#if USE_CMD_CAPTURE
+{   0, 0, "capture",  cmd_capture, 
+    "capture output in ram",
+    "capture [-b <size> [-q]] [-p] [-s]"  },
+#endif
 {   CMD_END  } };
 
 
@@ -469,3 +501,216 @@ int cmd_echo( int argc, char *argv[] )
 #endif
 
 
+#if USE_CMD_FRAME
+int cmd_frame( int argc, char *argv[] )
+{
+    static const mcush_opt_spec const opt_spec[] = {
+        { MCUSH_OPT_NONE } };
+    mcush_opt_parser parser;
+    mcush_opt opt;
+
+    mcush_opt_parser_init(&parser, opt_spec, (const char **)(argv+1), argc-1 );
+    while( mcush_opt_parser_next( &opt, &parser ) )
+    {
+        if( !opt.spec )
+            STOP_AT_INVALID_ARGUMENT 
+    }
+
+    return shell_frame_mode();
+}
+#endif
+
+
+#if USE_CMD_JOBS
+int cmd_jobs( int argc, char *argv[] )
+{
+    static const mcush_opt_spec const opt_spec[] = {
+        { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED,
+          'o', shell_str_output, shell_str_id, "print and clear job output" },
+        { MCUSH_OPT_NONE } };
+    mcush_opt_parser parser;
+    mcush_opt opt;
+    const shell_job_t *job;
+    int i, id=0;
+
+    mcush_opt_parser_init(&parser, opt_spec, (const char **)(argv+1), argc-1 );
+    while( mcush_opt_parser_next( &opt, &parser ) )
+    {
+        if( opt.spec )
+        {
+            if( STRCMP( opt.spec->name, shell_str_output ) == 0 )
+            {
+                if( ! parse_int(opt.value, &id) )
+                    goto usage_error;
+            }
+        }
+        else
+            STOP_AT_INVALID_ARGUMENT 
+    }
+
+    if( id )
+    {
+        job = shell_job_get( id );
+        if( ! job || (job->state == SHELL_JOB_FREE) || (job->state == SHELL_JOB_RESERVED) )
+            return 1;
+        i = job->state;
+        shell_job_print_output( id );
+        /* finished job is released after the output is fetched */
+        if( i == SHELL_JOB_DONE )
+            shell_job_free( id );
+        return 0;
+    }
+
+    for( i=1; i<=SHELL_JOB_NUM; i++ )
+    {
+        job = shell_job_get( i );
+        if( (job->state == SHELL_JOB_FREE) || (job->state == SHELL_JOB_RESERVED) )
+            continue;
+        shell_printf( "[%d] %c %4d %5d%c %s\n", i, 
+                    (job->state == SHELL_JOB_RUNNING) ? 'R' : 'D', job->ret,
+                    job->output_len, job->output_overflow ? '+' : ' ', job->cmdline );
+    }
+    return 0;
+usage_error:
+    mcush_opt_usage_print( argv[0], opt_spec );
+    return -1;
+}
+
+
+int cmd_kill( int argc, char *argv[] )
+{
+    static const mcush_opt_spec const opt_spec[] = {
+        { MCUSH_OPT_ARG, MCUSH_OPT_USAGE_REQUIRED, 
+          0, shell_str_id, 0, "job id" },
+        { MCUSH_OPT_NONE } };
+    mcush_opt_parser parser;
+    mcush_opt opt;
+    const shell_job_t *job;
+    int id=0;
+
+    mcush_opt_parser_init(&parser, opt_spec, (const char **)(argv+1), argc-1 );
+    while( mcush_opt_parser_next( &opt, &parser ) )
+    {
+        if( opt.spec )
+        {
+            if( STRCMP( opt.spec->name, shell_str_id ) == 0 )
+            {
+                if( ! parse_int(opt.value, &id) )
+                    goto usage_error;
+            }
+        }
+        else
+            STOP_AT_INVALID_ARGUMENT 
+    }
+
+    job = shell_job_get( id );
+    if( ! job )
+        goto usage_error;
+    if( job->state == SHELL_JOB_RUNNING )
+        return shell_job_kill( id ) ? 0 : 1;
+    /* already finished, discard it */
+    return shell_job_free( id ) ? 0 : 1;
+usage_error:
+    mcush_opt_usage_print( argv[0], opt_spec );
+    return -1;
+}
+#endif
+
+
+#if USE_CMD_CAPTURE
+/* one capture at a time, output of the session that started it is kept 
+   in ring buffer and fetched later with -p in one go */
+static shell_write_ring_t capture_ring;
+static uint8_t capture_flag;
+
+int cmd_capture( int argc, char *argv[] )
+{
+    static const mcush_opt_spec const opt_spec[] = {
+        { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED,
+          'b', "buffer", "size", "start with buffer size" },
+        { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
+          'q', "quiet", 0, "not output to terminal" },
+        { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
+          'p', "print", 0, "print and clear captured" },
+        { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
+          's', shell_str_stop, 0, "stop and free buffer" },
+        { MCUSH_OPT_NONE } };
+    mcush_opt_parser parser;
+    mcush_opt opt;
+    char buf[64];
+    int size=0, len;
+    uint8_t quiet=0, print=0, stop=0;
+
+    mcush_opt_parser_init(&parser, opt_spec, (const char **)(argv+1), argc-1 );
+    while( mcush_opt_parser_next( &opt, &parser ) )
+    {
+        if( ! opt.spec )
+            STOP_AT_INVALID_ARGUMENT 
+        switch( opt.id )
+        {
+        case 'b':
+            if( ! parse_int(opt.value, &size) || (size <= 0) )
+                goto usage_error;
+            break;
+        case 'q':
+            quiet = 1;
+            break;
+        case 'p':
+            print = 1;
+            break;
+        case 's':
+            stop = 1;
+            break;
+        }
+    }
+
+    if( size )
+    {
+        if( capture_ring.buf )
+            return 1;
+        capture_ring.buf = pvPortMalloc( size );
+        if( ! capture_ring.buf )
+            return 1;
+        shell_write_ring_init( &capture_ring, capture_ring.buf, size );
+        capture_flag = quiet ? SHELL_WRITE_SINK_EXCLUSIVE : 0;
+        if( ! shell_write_add_sink( shell_write_ring_sink, &capture_ring, capture_flag ) )
+        {
+            vPortFree( capture_ring.buf );
+            capture_ring.buf = 0;
+            return 1;
+        }
+        return 0;
+    }
+
+    if( ! capture_ring.buf )
+        return 1;
+    if( print || stop )
+    {
+        /* not from the session that started it */
+        if( ! shell_write_remove_sink( shell_write_ring_sink, &capture_ring ) )
+            return 1;
+    }
+    if( print )
+    {
+        if( capture_ring.overflow )
+            shell_write_line( "..." );
+        while( (len = shell_write_ring_read( &capture_ring, buf, sizeof(buf) )) )
+            shell_write( buf, len );
+        capture_ring.overflow = 0;
+        if( ! stop )
+            shell_write_add_sink( shell_write_ring_sink, &capture_ring, capture_flag );
+    }
+    if( stop )
+    {
+        vPortFree( capture_ring.buf );
+        capture_ring.buf = 0;
+    }
+    if( ! print && ! stop )
+        shell_printf( "%d/%d%s\n", capture_ring.len, capture_ring.size, 
+                      capture_ring.overflow ? " overflow" : "" );
+    return 0;
+usage_error:
+    mcush_opt_usage_print( argv[0], opt_spec );
+    return -1;
+}
+#endif
@@ -242,15 +242,16 @@ err_ack:
 
 int cmd_i2c( int argc, char *argv[] )
 {
+    enum { OPT_DELAY=MCUSH_OPT_ID_USER, OPT_SDA, OPT_SCL, OPT_VALUE };
     static const mcush_opt_spec const opt_spec[] = {
         { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED, 
-          0, shell_str_delay, "delay_us", "default 5" },
+          0, shell_str_delay, "delay_us", "default 5", OPT_DELAY },
         { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED, 
           'a', shell_str_address, shell_str_address, "default 0" },
         { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED, 
-          0, "sda", "sda_pin", "default 0.0" },
+          0, "sda", "sda_pin", "default 0.0", OPT_SDA },
         { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED, 
-          0, "scl", "scl_pin", "default 0.1" },
+          0, "scl", "scl_pin", "default 0.1", OPT_SCL },
         { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
           'I', shell_str_init, 0, "init pins" },
         { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
@@ -262,7 +263,7 @@ int cmd_i2c( int argc, char *argv[] )
         { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED, 
           'r', shell_str_read, "read_cycle", "default 0" },
         { MCUSH_OPT_ARG, MCUSH_OPT_USAGE_REQUIRED, 
-          0, shell_str_value, 0, shell_str_data },
+          0, shell_str_value, 0, shell_str_data, OPT_VALUE },
         { MCUSH_OPT_NONE } };
     mcush_opt_parser parser;
     mcush_opt opt;
@@ -283,58 +284,60 @@ int cmd_i2c( int argc, char *argv[] )
     mcush_opt_parser_init( &parser, opt_spec, (const char **)(argv+1), argc-1 );
     while( mcush_opt_parser_next( &opt, &parser ) )
     {
-        if( opt.spec )
+        if( ! opt.spec )
+            STOP_AT_INVALID_ARGUMENT
+        switch( opt.id )
         {
-            if( STRCMP( opt.spec->name, shell_str_address ) == 0 )
-            {
-                if( parse_int(opt.value, (int*)&i2c_init.addr) )
-                    addr_set = 1;
-                else
-                    goto err_addr;
-            }
-            else if( STRCMP( opt.spec->name, shell_str_delay ) == 0 )
-                parse_int(opt.value, (int*)&i2c_init.delay_us);
-            else if( STRCMP( opt.spec->name, shell_str_read ) == 0 )
-                parse_int(opt.value, (int*)&read_bytes);
-            else if( STRCMP( opt.spec->name, shell_str_init ) == 0 )
-                init = 1;
-            else if( STRCMP( opt.spec->name, shell_str_deinit ) == 0 )
-                deinit = 1;
-            else if( strcmp( opt.spec->name, "nostop" ) == 0 )
-                no_stop = 1;
-            else if( strcmp( opt.spec->name, "lsb" ) == 0 )
-                i2c_init.lsb = 1;
-            else if( strcmp( opt.spec->name, "scl" ) == 0 )
-            {
-                i2c_init.port_scl = strtol( opt.value, &p, 10 );
-                if( !p || (*p!='.') )
-                    goto err_port;
-                if( *(++p) == 0 )
-                    goto err_port;
-                i2c_init.pin_scl = strtol( p, &p, 10 );
-                if( p && *p )
-                    goto err_port;
-            }
-            else if( strcmp( opt.spec->name, "sda" ) == 0 )
-            {
-                i2c_init.port_sda = strtol( opt.value, &p, 10 );
-                if( !p || (*p!='.') )
-                    goto err_port;
-                if( *(++p) == 0 )
-                    goto err_port;
-                i2c_init.pin_sda = strtol( p, &p, 10 );
-                if( p && *p )
-                    goto err_port;
-            }
-            else if( STRCMP( opt.spec->name, shell_str_value ) == 0 )
-            {
-                parser.idx--;
-                break;
-            }
+        case 'a':
+            if( parse_int(opt.value, (int*)&i2c_init.addr) )
+                addr_set = 1;
+            else
+                goto err_addr;
+            break;
+        case OPT_DELAY:
+            parse_int(opt.value, (int*)&i2c_init.delay_us);
+            break;
+        case 'r':
+            parse_int(opt.value, (int*)&read_bytes);
+            break;
+        case 'I':
+            init = 1;
+            break;
+        case 'D':
+            deinit = 1;
+            break;
+        case 'n':
+            no_stop = 1;
+            break;
+        case 'l':
+            i2c_init.lsb = 1;
+            break;
+        case OPT_SCL:
+            i2c_init.port_scl = strtol( opt.value, &p, 10 );
+            if( !p || (*p!='.') )
+                goto err_port;
+            if( *(++p) == 0 )
+                goto err_port;
+            i2c_init.pin_scl = strtol( p, &p, 10 );
+            if( p && *p )
+                goto err_port;
+            break;
+        case OPT_SDA:
+            i2c_init.port_sda = strtol( opt.value, &p, 10 );
+            if( !p || (*p!='.') )
+                goto err_port;
+            if( *(++p) == 0 )
+                goto err_port;
+            i2c_init.pin_sda = strtol( p, &p, 10 );
+            if( p && *p )
+                goto err_port;
+            break;
+        case OPT_VALUE:
+            parser.idx--;
+            goto parse_data;
         }
-        else
-            STOP_AT_INVALID_ARGUMENT  
     }
+parse_data:
 
     if( init )
     {
@@ -632,19 +635,21 @@ int emu_spi_write(int spi_index, uint32_t *buf_out, uint32_t *buf_in, int length
 #define SPI_WRITE_BUFFER_LEN  256
 int cmd_spi( int argc, char *argv[] )
 {
+    enum { OPT_DELAY=MCUSH_OPT_ID_USER, OPT_SDI, OPT_SDO, OPT_SCK, OPT_CS,
+           OPT_CPOL, OPT_CPHA, OPT_LSB, OPT_VALUE };
     static const mcush_opt_spec const opt_spec[] = {
         { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED, 
           'w', shell_str_width, "bits", "default 8" },
         { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED, 
-          0, shell_str_delay, "delay_us", "default 5" },
+          0, shell_str_delay, "delay_us", "default 5", OPT_DELAY },
         { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED, 
-          0, "sdi", "sdi_pin", "default 0.0" },
+          0, "sdi", "sdi_pin", "default 0.0", OPT_SDI },
         { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED, 
-          0, "sdo", "sdo_pin", "default 0.1" },
+          0, "sdo", "sdo_pin", "default 0.1", OPT_SDO },
         { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED, 
-          0, "sck", "sck_pin", "default 0.2" },
+          0, "sck", "sck_pin", "default 0.2", OPT_SCK },
         { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED, 
-          0, "cs", "cs_pin", "default 0.3" },
+          0, "cs", "cs_pin", "default 0.3", OPT_CS },
         { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
           'I', shell_str_init, 0, "init pins" },
         { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
@@ -654,13 +659,13 @@ int cmd_spi( int argc, char *argv[] )
         { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
           'r', shell_str_read, 0, "print readout" },
         { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
-          0, "cpol", 0, "clk polarity" },
+          0, "cpol", 0, "clk polarity", OPT_CPOL },
         { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
-          0, "cpha", 0, "clk phase" },
+          0, "cpha", 0, "clk phase", OPT_CPHA },
         { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
-          0, "lsb", 0, "lsb first" },
+          0, "lsb", 0, "lsb first", OPT_LSB },
         { MCUSH_OPT_ARG, MCUSH_OPT_USAGE_REQUIRED, 
-          0, shell_str_value, 0, shell_str_data },
+          0, shell_str_value, 0, shell_str_data, OPT_VALUE },
         { MCUSH_OPT_NONE } };
     mcush_opt_parser parser;
     mcush_opt opt;
@@ -680,88 +685,90 @@ int cmd_spi( int argc, char *argv[] )
     mcush_opt_parser_init( &parser, opt_spec, (const char **)(argv+1), argc-1 );
     while( mcush_opt_parser_next( &opt, &parser ) )
     {
-        if( opt.spec )
+        if( ! opt.spec )
+            STOP_AT_INVALID_ARGUMENT
+        switch( opt.id )
         {
-            if( STRCMP( opt.spec->name, shell_str_delay ) == 0 )
-                parse_int(opt.value, (int*)&spi_init.delay_us);
-            else if( STRCMP( opt.spec->name, shell_str_read ) == 0 )
-                read_mode = 1;
-            else if( STRCMP( opt.spec->name, shell_str_width ) == 0 )
+        case OPT_DELAY:
+            parse_int(opt.value, (int*)&spi_init.delay_us);
+            break;
+        case 'r':
+            read_mode = 1;
+            break;
+        case 'w':
+            if( parse_int(opt.value, (int*)&spi_init.width) )
             {
-                if( parse_int(opt.value, (int*)&spi_init.width) )
+                if( (spi_init.width < 1) || (spi_init.width > 32) )
                 {
-                    if( (spi_init.width < 1) || (spi_init.width > 32) )
-                    {
-                        shell_write_err( shell_str_width );
-                        return 1;
-                    }
+                    shell_write_err( shell_str_width );
+                    return 1;
                 }
             }
-            else if( STRCMP( opt.spec->name, shell_str_init ) == 0 )
-                init = 1;
-            else if( STRCMP( opt.spec->name, shell_str_deinit ) == 0 )
-                deinit = 1;
-            else if( STRCMP( opt.spec->name, shell_str_update ) == 0 )
-                update = 1;
-            else if( strcmp( opt.spec->name, "cpol" ) == 0 )
-                spi_init.cpol = 1;
-            else if( strcmp( opt.spec->name, "cpha" ) == 0 )
-                spi_init.cpha = 1;
-            else if( strcmp( opt.spec->name, "lsb" ) == 0 )
-                spi_init.lsb = 1;
-            else if( strcmp( opt.spec->name, "sdi" ) == 0 )
-            {
-                spi_init.port_sdi = strtol( opt.value, &p, 10 );
-                if( !p || (*p!='.') )
-                    goto err_port;
-                if( *(++p) == 0 )
-                    goto err_port;
-                spi_init.pin_sdi = strtol( p, &p, 10 );
-                if( p && *p )
-                    goto err_port;
-            }
-            else if( strcmp( opt.spec->name, "sdo" ) == 0 )
-            {
-                spi_init.port_sdo = strtol( opt.value, &p, 10 );
-                if( !p || (*p!='.') )
-                    goto err_port;
-                if( *(++p) == 0 )
-                    goto err_port;
-                spi_init.pin_sdo = strtol( p, &p, 10 );
-                if( p && *p )
-                    goto err_port;
-            }
-            else if( strcmp( opt.spec->name, "sck" ) == 0 )
-            {
-                spi_init.port_sck = strtol( opt.value, &p, 10 );
-                if( !p || (*p!='.') )
-                    goto err_port;
-                if( *(++p) == 0 )
-                    goto err_port;
-                spi_init.pin_sck = strtol( p, &p, 10 );
-                if( p && *p )
-                    goto err_port;
-            }
-            else if( strcmp( opt.spec->name, "cs" ) == 0 )
-            {
-                spi_init.port_cs = strtol( opt.value, &p, 10 );
-                if( !p || (*p!='.') )
-                    goto err_port;
-                if( *(++p) == 0 )
-                    goto err_port;
-                spi_init.pin_cs = strtol( p, &p, 10 );
-                if( p && *p )
-                    goto err_port;
-            }
-            else if( STRCMP( opt.spec->name, shell_str_value ) == 0 )
-            {
-                parser.idx--;
-                break;
-            }
+            break;
+        case 'I':
+            init = 1;
+            break;
+        case 'D':
+            deinit = 1;
+            break;
+        case 'U':
+            update = 1;
+            break;
+        case OPT_CPOL:
+            spi_init.cpol = 1;
+            break;
+        case OPT_CPHA:
+            spi_init.cpha = 1;
+            break;
+        case OPT_LSB:
+            spi_init.lsb = 1;
+            break;
+        case OPT_SDI:
+            spi_init.port_sdi = strtol( opt.value, &p, 10 );
+            if( !p || (*p!='.') )
+                goto err_port;
+            if( *(++p) == 0 )
+                goto err_port;
+            spi_init.pin_sdi = strtol( p, &p, 10 );
+            if( p && *p )
+                goto err_port;
+            break;
+        case OPT_SDO:
+            spi_init.port_sdo = strtol( opt.value, &p, 10 );
+            if( !p || (*p!='.') )
+                goto err_port;
+            if( *(++p) == 0 )
+                goto err_port;
+            spi_init.pin_sdo = strtol( p, &p, 10 );
+            if( p && *p )
+                goto err_port;
+            break;
+        case OPT_SCK:
+            spi_init.port_sck = strtol( opt.value, &p, 10 );
+            if( !p || (*p!='.') )
+                goto err_port;
+            if( *(++p) == 0 )
+                goto err_port;
+            spi_init.pin_sck = strtol( p, &p, 10 );
+            if( p && *p )
+                goto err_port;
+            break;
+        case OPT_CS:
+            spi_init.port_cs = strtol( opt.value, &p, 10 );
+            if( !p || (*p!='.') )
+                goto err_port;
+            if( *(++p) == 0 )
+                goto err_port;
+            spi_init.pin_cs = strtol( p, &p, 10 );
+            if( p && *p )
+                goto err_port;
+            break;
+        case OPT_VALUE:
+            parser.idx--;
+            goto parse_data;
         }
-        else
-            STOP_AT_INVALID_ARGUMENT  
     }
+parse_data:
 
     if( init )
     {
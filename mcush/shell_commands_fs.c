@@ -33,6 +33,10 @@ int do_test_file( const char *mount_point )
 #define CAT_BUF_RAW  100
 #define CAT_BUF_B64  180
 #define CAT_BUF_LEN  (CAT_BUF_RAW+CAT_BUF_B64)
+#ifndef CAT_B64_RAW
+    #define CAT_B64_RAW  (57*8)  /* 8 full lines each read */
+#endif
+#define CAT_B64_CODE  (CAT_B64_RAW/3*4+CAT_B64_RAW/57+8)
 int cmd_cat( int argc, char *argv[] )
 {
     static const mcush_opt_spec const opt_spec[] = {
@@ -53,6 +57,10 @@ int cmd_cat( int argc, char *argv[] )
     uint32_t delay=0;
     char fname[32];
     char buf[CAT_BUF_LEN];
+    char *rbuf=buf;
+    int rsize=CAT_BUF_LEN;
+    const char *map=0, *src;
+    int map_len;
     int i, j;
     int fd;
     void *input=0;
@@ -160,16 +168,46 @@ int cmd_cat( int argc, char *argv[] )
     { 
         if( ! mcush_size( fname, &size ) )
             return 1;
+        if( b64 )
+        {
+            /* encode in large blocks, fall back to the stack buffer */
+            rbuf = pvPortMalloc( CAT_B64_RAW + CAT_B64_CODE );
+            if( rbuf )
+                rsize = CAT_B64_RAW;
+            else
+            {
+                rbuf = buf;
+                rsize = CAT_BUF_RAW;
+            }
+        }
         fd = mcush_open( fname, "r" );
         if( fd == 0 )
+        {
+            if( rbuf != buf )
+                vPortFree( rbuf );
             return 1;
+        }
+        /* mapped file is written out in place, no copy */
+        if( mcush_mmap( fd, (const void**)&map, &map_len ) )
+            size = map_len;
         bytes = 0;
         while( 1 )
         {    
-            i = mcush_read( fd, buf, b64 ? CAT_BUF_RAW : CAT_BUF_LEN );
+            if( map )
+            {
+                src = map + bytes;
+                i = size - bytes < rsize ? size - bytes : rsize;
+            }
+            else
+            {
+                src = rbuf;
+                i = mcush_read( fd, rbuf, rsize );
+            }
             if( i < 0 )
             {
                 mcush_close(fd);
+                if( rbuf != buf )
+                    vPortFree( rbuf );
                 shell_write_char( '\n' );
                 return 1;
             }
@@ -188,12 +226,12 @@ int cmd_cat( int argc, char *argv[] )
             {
                 if( b64 )
                 {
-                    j = base64_encode_block( buf, i, &buf[CAT_BUF_RAW], &state_en );
-                    shell_write( buf + CAT_BUF_RAW, j );
+                    j = base64_encode_block( src, i, rbuf + rsize, &state_en );
+                    shell_write( rbuf + rsize, j );
                 }
                 else
-                    shell_write( buf, i );
-                if( i < (b64 ? CAT_BUF_RAW : CAT_BUF_LEN) )
+                    shell_write( src, i );
+                if( i < rsize )
                 {
                     if( b64 )
                     {
@@ -213,17 +251,21 @@ int cmd_cat( int argc, char *argv[] )
                 break;  // end
             }
 
-            while( shell_driver_read_char_blocked(&c, delay*configTICK_RATE_HZ/1000) != -1 )
+            while( shell_read_char_blocked(&c, delay*configTICK_RATE_HZ/1000) != -1 )
             {
                 if( c == 0x03 ) /* Ctrl-C for stop */
                 {
                     mcush_close(fd);
+                    if( rbuf != buf )
+                        vPortFree( rbuf );
                     shell_write_char( '\n' );
                     return 0;
                 }
             }
         }
         mcush_close(fd);
+        if( rbuf != buf )
+            vPortFree( rbuf );
         shell_write_str( "\n" );
     }
     return 0;
@@ -301,63 +343,63 @@ int cmd_rename( int argc, char *argv[] )
 #if USE_CMD_CP
 int cmd_copy( int argc, char *argv[] )
 {
+    enum { OPT_FILE=MCUSH_OPT_ID_USER };
     static const mcush_opt_spec const opt_spec[] = {
+        { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED, 
+          'b', "buffer", "size", "buffer size" },
+        { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
+          'v', "verbose", 0, "print throughput" },
         { MCUSH_OPT_ARG, MCUSH_OPT_USAGE_REQUIRED, 
-          0, shell_str_file, 0, "src -> dst" },
+          0, shell_str_file, 0, "src -> dst", OPT_FILE },
         { MCUSH_OPT_NONE } };
     mcush_opt_parser parser;
     mcush_opt opt;
     char *fname=0, *fname2=0;
-    char buf[256];
-    int i, j;
-    int fd, fd2;
+    int buf_size=0, verbose=0;
+    mcush_file_copy_stat_t stat;
+    uint32_t ms;
 
     mcush_opt_parser_init(&parser, opt_spec, (const char **)(argv+1), argc-1 );
     while( mcush_opt_parser_next( &opt, &parser ) )
     {
-        if( opt.spec )
+        if( ! opt.spec )
+            STOP_AT_INVALID_ARGUMENT 
+        switch( opt.id )
         {
-            if( STRCMP( opt.spec->name, shell_str_file ) == 0 )
+        case 'b':
+            if( ! parse_int(opt.value, &buf_size) || (buf_size <= 0) )
             {
-                fname = (char*)opt.value;
-                if( parser.idx + 1 < argc )
-                    fname2 = argv[parser.idx+1];
-                break;
+                shell_write_err( shell_str_parameter );
+                return -1;
             }
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        case OPT_FILE:
+            fname = (char*)opt.value;
+            if( parser.idx + 1 < argc )
+                fname2 = argv[parser.idx+1];
+            break;
         }
-        else
-            STOP_AT_INVALID_ARGUMENT 
+        if( fname )
+            break;  /* dst follows, not parsed as an option */
     }
 
     if( !fname || !fname2 )
         return -1;
     //if( strcmp(fname, fname2) == 0 )
     //    return 0;
-       
-    fd = mcush_open( fname, "r" );
-    if( fd == 0 )
+
+    if( ! mcush_file_copy( fname, fname2, buf_size, &stat ) )
         return 1;
-    fd2 = mcush_open( fname2, "w+" );
-    if( fd2 == 0 )
+    if( verbose )
     {
-        mcush_close( fd );
-        return 1;
+        ms = stat.ticks * 1000 / configTICK_RATE_HZ;
+        shell_printf( "%d bytes, %d ms, %d KB/s, buffer %d%s\n", stat.bytes, ms,
+                      ms ? (int)((uint64_t)stat.bytes * 1000 / ms / 1024) : 0,
+                      stat.buf_size, stat.overlapped ? " x2" : "" );
     }
-
-    while( 1 )
-    {    
-        i = mcush_read( fd, buf, 256 );
-        if( i==0 )
-            break;
-        j = mcush_write( fd2, buf, i );
-        if( i != j )
-            break;
-        if( i<256 )
-            break;
-    }
-
-    mcush_close( fd );
-    mcush_close( fd2 );
     return 0;
 }
 #endif
@@ -399,9 +441,12 @@ int cmd_list( int argc, char *argv[] )
     }
 
     file_name[0] = 0;
-    if( path && ! get_mount_point( path, mount_point ) )
-        return 1;
-    get_file_name( path, file_name );
+    if( path )
+    {
+        if( ! get_mount_point( path, mount_point ) )
+            return 1;
+        get_file_name( path, file_name );
+    }
      
     for( i=0; i< MCUSH_VFS_VOLUME_NUM; i++ )
     {
@@ -425,6 +470,12 @@ int cmd_list( int argc, char *argv[] )
 int cmd_load( int argc, char *argv[] )
 {
     static const mcush_opt_spec const opt_spec[] = {
+#if USE_SHELL_SCRIPT_IMAGE
+        { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
+          'f', "feed", 0, "feed text into line editor" },
+        { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED, 
+          'o', shell_str_output, shell_str_file, "save compiled image, not run" },
+#endif
         { MCUSH_OPT_ARG, MCUSH_OPT_USAGE_REQUIRED, 
           0, shell_str_file, 0, shell_str_file_name },
         { MCUSH_OPT_NONE } };
@@ -434,8 +485,16 @@ int cmd_load( int argc, char *argv[] )
     int size;
     int fd;
     void *buf=0;
+    const void *map=0;
     int i;
+#if USE_SHELL_SCRIPT_IMAGE
+    char fname_out[32];
+    char *image;
+    int image_size;
+    uint8_t feed=0;
 
+    fname_out[0] = 0;
+#endif
     fname[0] = 0;
     mcush_opt_parser_init(&parser, opt_spec, (const char **)(argv+1), argc-1 );
     while( mcush_opt_parser_next( &opt, &parser ) )
@@ -444,6 +503,12 @@ int cmd_load( int argc, char *argv[] )
         {
             if( STRCMP( opt.spec->name, shell_str_file ) == 0 )
                 strcpy( fname, (char*)opt.value );
+#if USE_SHELL_SCRIPT_IMAGE
+            else if( STRCMP( opt.spec->name, shell_str_output ) == 0 )
+                strcpy( fname_out, (char*)opt.value );
+            else if( strcmp( opt.spec->name, "feed" ) == 0 )
+                feed = 1;
+#endif
         }
         else
             STOP_AT_INVALID_ARGUMENT 
@@ -456,21 +521,25 @@ int cmd_load( int argc, char *argv[] )
     if( !size )
         return 0;
 
+    fd = mcush_open( fname, "r" );
+    if( fd == 0 )
+        return 1;
+    if( mcush_mmap( fd, &map, &i ) )
+        size = i;
+
+    /* copied to ram even if mapped, text script is kept null-terminated
+       and commands may modify their arguments, from an image as well */
     buf = pvPortMalloc( size + 1 );
     if( !buf )
     {
+        mcush_close(fd);
         shell_write_err( shell_str_script );
         return 1;
     }
-
-    fd = mcush_open( fname, "r" );
-    if( fd == 0 )
-    {
-        vPortFree(buf);
-        return 1;
-    }
-    
-    i = mcush_read( fd, buf, size );   
+    if( map )
+        memcpy( buf, map, size );
+    else
+        i = mcush_read( fd, buf, size );   
     mcush_close(fd);
 
     if( i != size )
@@ -481,6 +550,45 @@ int cmd_load( int argc, char *argv[] )
     }
   
     ((char*)buf)[i] = 0; 
+#if USE_SHELL_SCRIPT_IMAGE
+    if( shell_script_is_image( buf, size ) )
+    {
+        /* already compiled */
+        if( feed || fname_out[0] )
+        {
+            vPortFree(buf);
+            return 1;
+        }
+        i = shell_script_run( buf, size );
+        vPortFree(buf);
+        return i;
+    }
+    if( ! feed )
+    {
+        i = shell_script_compile( buf, &image, &image_size );
+        vPortFree(buf);
+        if( ! i )
+        {
+            shell_write_err( shell_str_script );
+            return 1;
+        }
+        if( fname_out[0] )
+        {
+            i = 1;
+            fd = mcush_open( fname_out, "w+" );
+            if( fd )
+            {
+                if( mcush_write( fd, image, image_size ) == image_size )
+                    i = 0;
+                mcush_close(fd);
+            }
+        }
+        else
+            i = shell_script_run( image, image_size );
+        vPortFree(image);
+        return i;
+    }
+#endif
     shell_set_script( buf, 1 );
     return 0;
 }
@@ -524,6 +632,75 @@ int cmd_crc( int argc, char *argv[] )
 #endif
 
 
+#if USE_CMD_XFER
+int cmd_xfer( int argc, char *argv[] )
+{
+    enum { OPT_FILE=MCUSH_OPT_ID_USER };
+    static const mcush_opt_spec const opt_spec[] = {
+        { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
+          'p', "put", 0, "receive file from host" },
+        { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
+          'g', "get", 0, "send file to host" },
+        { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
+          'r', "resume", 0, "put after saved part" },
+        { MCUSH_OPT_VALUE, MCUSH_OPT_USAGE_REQUIRED | MCUSH_OPT_USAGE_VALUE_REQUIRED, 
+          'o', shell_str_offset, shell_str_offset, "get from offset" },
+        { MCUSH_OPT_ARG, MCUSH_OPT_USAGE_REQUIRED, 
+          0, shell_str_file, 0, shell_str_file_name, OPT_FILE },
+        { MCUSH_OPT_NONE } };
+    mcush_opt_parser parser;
+    mcush_opt opt;
+    uint8_t put=0, get=0, resume=0;
+    int offset=0, bytes, err;
+    char *fname=0;
+
+    mcush_opt_parser_init(&parser, opt_spec, (const char **)(argv+1), argc-1 );
+    while( mcush_opt_parser_next( &opt, &parser ) )
+    {
+        if( ! opt.spec )
+            STOP_AT_INVALID_ARGUMENT 
+        switch( opt.id )
+        {
+        case 'p':
+            put = 1;
+            break;
+        case 'g':
+            get = 1;
+            break;
+        case 'r':
+            resume = 1;
+            break;
+        case 'o':
+            if( ! parse_int(opt.value, &offset) || (offset < 0) )
+            {
+                shell_write_err( shell_str_parameter );
+                return -1;
+            }
+            break;
+        case OPT_FILE:
+            fname = (char*)opt.value;
+            break;
+        }
+    }
+
+    if( !fname || (put == get) )
+        return -1;
+
+    if( put )
+        err = mcush_xfer_put( fname, resume, &bytes );
+    else
+        err = mcush_xfer_get( fname, offset, &bytes );
+    if( err )
+    {
+        shell_printf( "err %d, %d bytes\n", err, bytes );
+        return 1;
+    }
+    shell_printf( "%d bytes\n", bytes );
+    return 0;
+}
+#endif
+
+
 #if USE_CMD_SPIFFS
 #include "mcush_vfs_spiffs.h"
 #include "spi_flash.h"
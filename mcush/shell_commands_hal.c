@@ -346,7 +346,7 @@ int cmd_led( int argc, char *argv[] )
         test_on = 0;
         while( 1 )
         {
-            if( (shell_driver_read_char_blocked(&c, 250*configTICK_RATE_HZ/1000) != -1 ) && (c == 0x03) )  /* Ctrl-C for quit */
+            if( (shell_read_char_blocked(&c, 250*configTICK_RATE_HZ/1000) != -1 ) && (c == 0x03) )  /* Ctrl-C for quit */
                 break;
             for( index=0; index<led_num; index++ )
             {
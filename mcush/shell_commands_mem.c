@@ -397,7 +397,7 @@ int cmd_dump( int argc, char *argv[] )
                 for( i=0; i<4; i++ )
                 {
                     if( float_mode )
-                        shell_printf("%e", *(float*)addr2);
+                        shell_printf("% e", *(float*)addr2);
                     else if( unsigned_mode )
                         shell_printf("%u", *(uint32_t*)addr2);
                     else
@@ -415,7 +415,7 @@ int cmd_dump( int argc, char *argv[] )
         }
         shell_write_str( "\r\n" );
         /* check if Ctrl-C is pressed */
-        if( shell_driver_read_char_blocked(&c, 0) != -1 )
+        if( shell_read_char_blocked(&c, 0) != -1 )
             if( c == 0x03 ) /* Ctrl-C for stop */
                 return 0;
     }
@@ -2,6 +2,8 @@
 #include "mcush.h"
 #include "hal.h"
 
+#define SYS_RESET  (USE_SHELL_PROFILER || (MCUSH_VFS && (MCUSH_VFS_STATISTICS || MCUSH_VFS_PROFILER || MCUSH_VFS_AIO)))
+
 
 #if USE_CMD_UPTIME
 int cmd_uptime( int argc, char *argv[] )
@@ -33,11 +35,86 @@ void task_idle_counter_entry(void *p)
         (*cnt)++;
 }
 
+
+#if MCUSH_VFS && MCUSH_VFS_PROFILER
+/* driver calls of each mounted volume, histogram counts the calls taking
+   0, 1, 2~3, 4~7 ... counter ticks */
+static void print_vfs_profile( void )
+{
+    static const char * const op_name[MCUSH_VFS_OP_NUM] = {
+        "open", "close", "read", "write", "seek",
+        "flush", "size", "list", "remove", "rename" };
+    extern mcush_vfs_volume_t vfs_vol_tab[MCUSH_VFS_VOLUME_NUM];
+    const mcush_vfs_profile_t *prof;
+    const mcush_vfs_op_profile_t *p;
+    uint32_t t;
+    int i, j, k, n;
+
+    t = MCUSH_VFS_PROFILER_COUNTER();
+    t = MCUSH_VFS_PROFILER_COUNTER() - t;
+    shell_printf( "counter: %u Hz, overhead: %u\n", MCUSH_VFS_PROFILER_COUNTER_HZ, t );
+    for( i=0; i<MCUSH_VFS_VOLUME_NUM; i++ )
+    {
+        prof = mcush_vfs_get_profile( i );
+        if( ! prof )
+            continue;
+        shell_printf( "/%s: read %u, written %u bytes\n", vfs_vol_tab[i].mount_point,
+                      prof->bytes_read, prof->bytes_written );
+        shell_write_line( "op        count    err  total(ms)    max(us)  histogram" );
+        for( j=0; j<MCUSH_VFS_OP_NUM; j++ )
+        {
+            p = &prof->op[j];
+            if( ! p->count )
+                continue;
+            shell_printf( "%-6s %8u %6u %10u %10u ", op_name[j], p->count, p->err,
+                (uint32_t)(p->ticks * 1000 / MCUSH_VFS_PROFILER_COUNTER_HZ),
+                (uint32_t)((uint64_t)p->max * 1000000 / MCUSH_VFS_PROFILER_COUNTER_HZ) );
+            for( n=MCUSH_VFS_PROFILER_BUCKETS; (n > 1) && !p->hist[n-1]; n-- )
+                ;
+            for( k=0; k<n; k++ )
+                shell_printf( " %u", p->hist[k] );
+            shell_write_char( '\n' );
+        }
+    }
+}
+#endif
+
+
+#if MCUSH_VFS && MCUSH_VFS_AIO
+/* io task queue, latencies from submit to service and of the call */
+static void print_vfs_aio( void )
+{
+    mcush_vfs_aio_stat_t s;
+    uint32_t n;
+
+    mcush_vfs_aio_get_stat( &s );
+    n = s.completed ? s.completed : 1;
+    shell_printf( "aio: queue %u, depth %u (max %u), submitted %u, completed %u, failed %u, rejected %u\n",
+                  MCUSH_VFS_AIO_QUEUE_LEN, s.depth, s.depth_max, s.submitted,
+                  s.completed, s.failed, s.rejected );
+    shell_printf( "aio wait(us): avg %u, max %u, service(us): avg %u, max %u\n",
+                  (uint32_t)(s.wait / n * 1000000 / MCUSH_VFS_AIO_COUNTER_HZ),
+                  (uint32_t)((uint64_t)s.wait_max * 1000000 / MCUSH_VFS_AIO_COUNTER_HZ),
+                  (uint32_t)(s.service / n * 1000000 / MCUSH_VFS_AIO_COUNTER_HZ),
+                  (uint32_t)((uint64_t)s.service_max * 1000000 / MCUSH_VFS_AIO_COUNTER_HZ) );
+}
+#endif
+
+
 int cmd_system( int argc, char *argv[] )
 {
     static const mcush_opt_spec const opt_spec[] = {
+#if SYS_RESET
+        { MCUSH_OPT_SWITCH, MCUSH_OPT_USAGE_REQUIRED, 
+          'r', shell_str_reset, 0, "reset profile/vfs statistics" },
+#endif
+#if USE_SHELL_PROFILER
+        { MCUSH_OPT_ARG, MCUSH_OPT_USAGE_REQUIRED, 
+          0, shell_str_type, 0, "(t)ask|(q)ueue|(k)ern|heap|stack|(i)dle|v(f)s|(p)rofile" },
+#else
         { MCUSH_OPT_ARG, MCUSH_OPT_USAGE_REQUIRED, 
           0, shell_str_type, 0, "(t)ask|(q)ueue|(k)ern|heap|stack|(i)dle|v(f)s" },
+#endif
         { MCUSH_OPT_NONE } };
     mcush_opt_parser parser;
     mcush_opt opt;
@@ -53,6 +130,14 @@ int cmd_system( int argc, char *argv[] )
     TaskHandle_t task_idle_counter;
     char buf[1024];
     TaskStatus_t *task_status_array;
+#if USE_SHELL_PROFILER
+    const shell_cmd_t *ct;
+    const shell_cmd_stat_t *stat;
+    uint32_t t;
+#endif
+#if SYS_RESET
+    uint8_t reset=0;
+#endif
     
     mcush_opt_parser_init( &parser, opt_spec, (const char **)(argv+1), argc-1 );
     while( mcush_opt_parser_next( &opt, &parser ) )
@@ -61,6 +146,10 @@ int cmd_system( int argc, char *argv[] )
         {
             if( STRCMP( opt.spec->name, shell_str_type ) == 0 )
                 type = opt.value;
+#if SYS_RESET
+            else if( STRCMP( opt.spec->name, shell_str_reset ) == 0 )
+                reset = 1;
+#endif
         }
         else
             STOP_AT_INVALID_ARGUMENT 
@@ -169,7 +258,7 @@ int cmd_system( int argc, char *argv[] )
         /* check for continuous 0.5 second */
         idle_counter_last = idle_counter;
         hal_wdg_clear();
-        while( shell_driver_read_char_blocked(&c, configTICK_RATE_HZ / 2) != -1 )
+        while( shell_read_char_blocked(&c, configTICK_RATE_HZ / 2) != -1 )
         {
             hal_wdg_clear();
             if( c == 0x03 ) /* Ctrl-C for stop */
@@ -191,7 +280,7 @@ int cmd_system( int argc, char *argv[] )
         idle_counter_last = idle_counter;
         while( 1 )
         {
-            while( shell_driver_read_char_blocked(&c, configTICK_RATE_HZ) != -1 )
+            while( shell_read_char_blocked(&c, configTICK_RATE_HZ) != -1 )
             {
                 if( c == 0x03 ) /* Ctrl-C for stop */
                 {
@@ -204,9 +293,54 @@ int cmd_system( int argc, char *argv[] )
             shell_printf( "%d %%\n", i * 100 / idle_counter_max );
         }
     }
+#if USE_SHELL_PROFILER
+    else if( (strcmp( type, "p" ) == 0 ) || (strcmp( type, "profile" ) == 0) )
+    {
+        if( reset )
+        {
+            shell_reset_cmd_stat();
+            return 0;
+        }
+        /* cost of the timing itself, included in every record */
+        t = SHELL_PROFILER_COUNTER();
+        t = SHELL_PROFILER_COUNTER() - t;
+        shell_printf( "counter: %u Hz, overhead: %u\n", SHELL_PROFILER_COUNTER_HZ, t );
+        shell_write_line( "command       count  total(ms)    max(us)  ret" );
+        for( i=0; (ct = shell_get_cmd_table(i)) != 0; i++ )
+        {
+            stat = shell_get_cmd_stat(i);
+            if( ! stat )
+                continue;
+            for( j=0; ct[j].name; j++ )
+            {
+                if( ! stat[j].count )
+                    continue;
+                shell_printf( "%-10s %8u %10u %10u  %d\n", ct[j].name, stat[j].count,
+                    (uint32_t)((uint64_t)stat[j].ticks * 1000 / SHELL_PROFILER_COUNTER_HZ),
+                    (uint32_t)((uint64_t)stat[j].max * 1000000 / SHELL_PROFILER_COUNTER_HZ),
+                    stat[j].ret );
+            }
+        }
+    }
+#endif
 #if MCUSH_VFS
     else if( (strcmp( type, "f" ) == 0 ) || (strcmp( type, "vfs" ) == 0) )
     {
+#if MCUSH_VFS_CACHE
+        extern mcush_vfs_volume_t vfs_vol_tab[MCUSH_VFS_VOLUME_NUM];
+#endif
+#if MCUSH_VFS_STATISTICS || MCUSH_VFS_PROFILER || MCUSH_VFS_AIO
+        if( reset )
+        {
+#if MCUSH_VFS_STATISTICS || MCUSH_VFS_PROFILER
+            mcush_vfs_reset_statistics();
+#endif
+#if MCUSH_VFS_AIO
+            mcush_vfs_aio_reset_stat();
+#endif
+            return 0;
+        }
+#endif
 #if MCUSH_VFS_STATISTICS
         extern mcush_vfs_statistics_t vfs_stat;
         mcush_vfs_statistics_t stat;  /* take snapshot */
@@ -218,6 +352,19 @@ int cmd_system( int argc, char *argv[] )
         shell_printf( "read:  %u / %u\n", stat.count_read, stat.count_read_err );
         shell_printf( "write: %u / %u\n", stat.count_write, stat.count_write_err );
         shell_printf( "flush: %u / %u\n", stat.count_flush, stat.count_flush_err );
+#endif
+#if MCUSH_VFS_CACHE
+        for( i=0; i<MCUSH_VFS_VOLUME_NUM; i++ )
+        {
+            if( vfs_vol_tab[i].mount_point )
+                shell_printf( "cache /%s: %d\n", vfs_vol_tab[i].mount_point, vfs_vol_tab[i].cache_size );
+        }
+#endif
+#if MCUSH_VFS_PROFILER
+        print_vfs_profile();
+#endif
+#if MCUSH_VFS_AIO
+        print_vfs_aio();
 #endif
     }
 #endif
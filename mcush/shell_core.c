@@ -6,42 +6,91 @@
 #include <string.h>
 #include <limits.h>
 #include "mcush.h"
+#if USE_SHELL_PRINTF2
+#include "mcush_printf2.h"
+#endif
 
 #if DEBUG_SHELL
 #define static
 #endif
 
-static shell_control_block_t scb;
+static const shell_driver_ops_t shell_default_driver = {
+    shell_driver_init,
+    shell_driver_reset,
+    shell_driver_read_char,
+    shell_driver_read_char_blocked,
+    shell_driver_write,
+    shell_driver_write_char,
+};
+
+/* session 0 is the default one started by shell_run, the others are
+   bound to the task that called shell_session_run */
+static shell_control_block_t scb_tab[SHELL_SESSION_NUM];
+static shell_common_t shell_common;
+
+#if SHELL_SESSION_NUM > 1
+static shell_control_block_t *shell_get_session( void )
+{
+    void *task = (void*)xTaskGetCurrentTaskHandle();
+    int i;
+
+    for( i=1; i<SHELL_SESSION_NUM; i++ )
+    {
+        if( scb_tab[i].task == task )
+            return &scb_tab[i];
+    }
+    return &scb_tab[0];
+}
+#define SHELL_SESSION()  shell_get_session()
+#else
+#define SHELL_SESSION()  (&scb_tab[0])
+#endif
 
 
 int shell_read_char( char *c )
 {
+    shell_control_block_t *scb = SHELL_SESSION();
     int ret=-1;
 
-    if( scb.script )
+    if( scb->script )
     {
-        if( *scb.script )
+        if( *scb->script )
         {
-            *c = *scb.script++;
+            *c = *scb->script++;
             ret = *c;
         }
         else
         {
-            scb.script = 0;
-            if( scb.script_free )
+            scb->script = 0;
+            if( scb->script_free )
             {
-                vPortFree( (void*)scb.script_free );
-                scb.script_free = 0;
+                vPortFree( (void*)scb->script_free );
+                scb->script_free = 0;
             }
         }
     }
     if( ret == -1 )
-        ret = shell_driver_read_char( c );
+    {
+        /* waiting for input, let the sinks see the echo/prompt */
+        if( scb->write_sink_buf_len )
+            shell_write_flush_sink();
+        ret = scb->driver->read_char( c );
+    }
 
     return ret;
 }
 
 
+int shell_read_char_blocked( char *c, int block_time )
+{
+    shell_control_block_t *scb = SHELL_SESSION();
+
+    if( scb->write_sink_buf_len )
+        shell_write_flush_sink();
+    return scb->driver->read_char_blocked( c, block_time );
+}
+
+
 int shell_read( char *buf, int len )
 {
     int r=0;
@@ -63,30 +112,222 @@ int shell_read_feed( char *buf, int len )
 }
 
 
-void shell_write_set_sniffer( int (*hook)( const char *buf, int len )/*, int block_mode*/ )
+static int shell_write_sniffer_sink( void *arg, const char *buf, int len )
+{
+    return ((shell_control_block_t*)arg)->write_sniffer( buf, len );
+}
+
+
+/* add output sink to current session, exclusive sink takes the output 
+   away from the driver (eg. capture/redirect), returns 0 if table full */
+int shell_write_add_sink( int (*write)( void *arg, const char *buf, int len ), void *arg, int flag )
 {
-    scb.write_sniffer = hook;
-    //scb.write_sniffer_block_mode = block_mode;
+    shell_control_block_t *scb = SHELL_SESSION();
+    shell_write_sink_t *sink;
+
+    if( scb->write_sink_num >= SHELL_WRITE_SINK_NUM )
+        return 0;
+    /* the staged chars belong to the output before */
+    shell_write_flush_sink();
+    sink = &scb->write_sink[scb->write_sink_num++];
+    sink->write = write;
+    sink->arg = arg;
+    sink->flag = flag;
+    if( flag & SHELL_WRITE_SINK_EXCLUSIVE )
+        scb->write_sink_exclusive++;
+    return 1;
 }
 
 
+int shell_write_remove_sink( int (*write)( void *arg, const char *buf, int len ), void *arg )
+{
+    shell_control_block_t *scb = SHELL_SESSION();
+    int i;
+
+    shell_write_flush_sink();
+    for( i=0; i<scb->write_sink_num; i++ )
+    {
+        if( (scb->write_sink[i].write == write) && (scb->write_sink[i].arg == arg) )
+        {
+            if( scb->write_sink[i].flag & SHELL_WRITE_SINK_EXCLUSIVE )
+                scb->write_sink_exclusive--;
+            scb->write_sink_num--;
+            memmove( &scb->write_sink[i], &scb->write_sink[i+1], 
+                     (scb->write_sink_num - i) * sizeof(shell_write_sink_t) );
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+static void shell_write_to_sink( shell_control_block_t *scb, const char *buf, int len )
+{
+    int i;
+
+    for( i=0; i<scb->write_sink_num; i++ )
+        scb->write_sink[i].write( scb->write_sink[i].arg, buf, len );
+}
+
+
+/* pass chars staged by shell_write_char to the sinks */
+void shell_write_flush_sink( void )
+{
+    shell_control_block_t *scb = SHELL_SESSION();
+    int len = scb->write_sink_buf_len;
+
+    if( len )
+    {
+        scb->write_sink_buf_len = 0;
+        shell_write_to_sink( scb, scb->write_sink_buf, len );
+    }
+}
+
+
+void shell_write_set_sniffer( int (*hook)( const char *buf, int len ) )
+{
+    shell_control_block_t *scb = SHELL_SESSION();
+
+    if( scb->write_sniffer )
+        shell_write_remove_sink( shell_write_sniffer_sink, scb );
+    scb->write_sniffer = hook;
+    if( hook )
+        shell_write_add_sink( shell_write_sniffer_sink, scb, 0 );
+}
+
+
+void shell_write_ring_init( shell_write_ring_t *ring, char *buf, int size )
+{
+    ring->buf = buf;
+    ring->size = size;
+    ring->head = 0;
+    ring->len = 0;
+    ring->overflow = 0;
+}
+
+
+/* sink for shell_write_add_sink with the ring as arg, 
+   the oldest output is overwritten when full */
+int shell_write_ring_sink( void *arg, const char *buf, int len )
+{
+    shell_write_ring_t *ring = (shell_write_ring_t*)arg;
+    int ret = len, l;
+
+    if( len >= ring->size )
+    {
+        /* only the tail fits */
+        buf += len - ring->size;
+        len = ring->size;
+        ring->overflow = 1;
+    }
+    if( ring->len + len > ring->size )
+        ring->overflow = 1;
+    l = ring->size - ring->head;
+    if( l > len )
+        l = len;
+    memcpy( ring->buf + ring->head, buf, l );
+    memcpy( ring->buf, buf + l, len - l );
+    ring->head = (ring->head + len) % ring->size;
+    ring->len += len;
+    if( ring->len > ring->size )
+        ring->len = ring->size;
+    return ret;
+}
+
+
+/* read and remove the oldest output, returns bytes read */
+int shell_write_ring_read( shell_write_ring_t *ring, char *buf, int len )
+{
+    int tail, l;
+
+    if( len > ring->len )
+        len = ring->len;
+    tail = (ring->head - ring->len + ring->size) % ring->size;
+    l = ring->size - tail;
+    if( l > len )
+        l = len;
+    memcpy( buf, ring->buf + tail, l );
+    memcpy( buf + l, ring->buf, len - l );
+    ring->len -= len;
+    return len;
+}
+
+
+#if USE_SHELL_FRAME
+static int shell_write_capture( void *arg, const char *buf, int len )
+{
+    shell_control_block_t *scb = (shell_control_block_t*)arg;
+    int free = scb->write_capture_size - scb->write_capture_len;
+
+    if( len > free )
+    {
+        len = free;
+        scb->write_capture_overflow = 1;
+    }
+    memcpy( scb->write_capture + scb->write_capture_len, buf, len );
+    scb->write_capture_len += len;
+    return len;
+}
+
+
+/* redirect output into buffer instead of the driver, 
+   set buf to zero to stop capturing */
+void shell_write_set_capture( char *buf, int size )
+{
+    shell_control_block_t *scb = SHELL_SESSION();
+
+    if( scb->write_capture )
+        shell_write_remove_sink( shell_write_capture, scb );
+    scb->write_capture = buf;
+    scb->write_capture_size = size;
+    scb->write_capture_len = 0;
+    scb->write_capture_overflow = 0;
+    if( buf )
+        shell_write_add_sink( shell_write_capture, scb, SHELL_WRITE_SINK_EXCLUSIVE );
+}
+
+
+int shell_write_get_capture( int *overflow )
+{
+    shell_control_block_t *scb = SHELL_SESSION();
+
+    shell_write_flush_sink();
+    if( overflow )
+        *overflow = scb->write_capture_overflow;
+    return scb->write_capture_len;
+}
+#endif
+
+
+/* the sinks see single chars (echo, etc) in blocks */
 void shell_write_char( char c )
 {
-    if( scb.write_sniffer )
+    shell_control_block_t *scb = SHELL_SESSION();
+
+    if( scb->write_sink_num )
     {
-        scb.write_sniffer( &c, 1 );
+        scb->write_sink_buf[scb->write_sink_buf_len++] = c;
+        if( scb->write_sink_buf_len >= SHELL_WRITE_SINK_BUF_SIZE )
+            shell_write_flush_sink();
+        if( scb->write_sink_exclusive )
+            return;
     }
-    shell_driver_write_char( c );
+    scb->driver->write_char( c );
 }
 
  
 void shell_write( const char *buf, int len )
 {
-    if( scb.write_sniffer )
+    shell_control_block_t *scb = SHELL_SESSION();
+
+    if( scb->write_sink_num )
     {
-        scb.write_sniffer( buf, len );
+        shell_write_flush_sink();
+        shell_write_to_sink( scb, buf, len );
+        if( scb->write_sink_exclusive )
+            return;
     }
-    shell_driver_write( (const char*)buf, len ); 
+    scb->driver->write( (const char*)buf, len ); 
 }
 
 
@@ -128,12 +369,21 @@ int shell_printf( char *fmt, ... )
 {
     va_list ap;
     int n;
+#if USE_SHELL_PRINTF2
+    /* stream through shell_write in small chunks, no line buffer needed */
+    va_start( ap, fmt );
+    n = stringfsv( shell_write, fmt, ap );
+    va_end( ap );
+#else
     char buf[SHELL_LINE_BUF_SIZE];
 
     va_start( ap, fmt );
-    n = vsprintf( buf, fmt, ap );
+    n = vsnprintf( buf, SHELL_LINE_BUF_SIZE, fmt, ap );
+    if( n >= SHELL_LINE_BUF_SIZE )
+        n = SHELL_LINE_BUF_SIZE - 1;
     shell_write( buf, n );
     va_end( ap );
+#endif
     return n;
 }
 
@@ -167,13 +417,107 @@ void shell_write_mem( const char *mem, int length )
 
 void shell_set_errnum( int errnum )
 {
-    scb.errnum = errnum;
+    SHELL_SESSION()->errnum = errnum;
 }
 
 
 int shell_get_errnum( void )
 {
-    return scb.errnum;
+    return SHELL_SESSION()->errnum;
+}
+
+
+#if SHELL_CMD_INDEX_ENABLE
+/* build sorted index for the command table, so that command searching 
+   can use binary search instead of scanning all entries,
+   table that fails to be indexed will be searched linearly */
+static void shell_build_cmd_index( int cmdtab_index )
+{
+    const shell_cmd_t *ct = shell_common.cmd_table[cmdtab_index];
+    uint8_t *idx;
+    int num, abbr_num, i, j;
+
+    for( num=0, abbr_num=0; ct[num].name; num++ )
+    {
+        if( ct[num].sname )
+            abbr_num++;
+    }
+    if( (num == 0) || (num > 255) )
+        return;
+    idx = pvPortMalloc( num + abbr_num );
+    if( ! idx )
+        return;
+    /* insertion sort, stable for entries with the same name */
+    for( i=0; i<num; i++ )
+    {
+        for( j=i; (j>0) && (strcmp( ct[idx[j-1]].name, ct[i].name ) > 0); j-- )
+            idx[j] = idx[j-1];
+        idx[j] = i;
+    }
+    for( i=0, abbr_num=0; i<num; i++ )
+    {
+        if( ! ct[i].sname )
+            continue;
+        for( j=abbr_num; (j>0) && ((uint8_t)ct[idx[num+j-1]].sname > (uint8_t)ct[i].sname); j-- )
+            idx[num+j] = idx[num+j-1];
+        idx[num+j] = i;
+        abbr_num++;
+    }
+    shell_common.cmd_index[cmdtab_index] = idx;
+    shell_common.cmd_index_num[cmdtab_index] = num;
+    shell_common.cmd_index_abbr_num[cmdtab_index] = abbr_num;
+}
+#endif
+
+
+#if USE_SHELL_PROFILER
+static void shell_alloc_cmd_stat( int cmdtab_index )
+{
+    const shell_cmd_t *ct = shell_common.cmd_table[cmdtab_index];
+    int num;
+
+    for( num=0; ct[num].name; num++ );
+    if( num == 0 )
+        return;
+    shell_common.cmd_stat[cmdtab_index] = pvPortMalloc( num * sizeof(shell_cmd_stat_t) );
+    if( shell_common.cmd_stat[cmdtab_index] )
+        memset( shell_common.cmd_stat[cmdtab_index], 0, num * sizeof(shell_cmd_stat_t) );
+}
+
+
+/* statistics array of the table, same order as the entries */
+const shell_cmd_stat_t *shell_get_cmd_stat( int cmdtab_index )
+{
+    if( (cmdtab_index < 0) || (cmdtab_index >= SHELL_CMD_TABLE_LEN) )
+        return 0;
+    return shell_common.cmd_stat[cmdtab_index];
+}
+
+
+void shell_reset_cmd_stat( void )
+{
+    const shell_cmd_t *ct;
+    int i, num;
+
+    for( i=0; (i < SHELL_CMD_TABLE_LEN) && shell_common.cmd_table[i]; i++ )
+    {
+        if( ! shell_common.cmd_stat[i] )
+            continue;
+        ct = shell_common.cmd_table[i];
+        for( num=0; ct[num].name; num++ );
+        portENTER_CRITICAL();
+        memset( shell_common.cmd_stat[i], 0, num * sizeof(shell_cmd_stat_t) );
+        portEXIT_CRITICAL();
+    }
+}
+#endif
+
+
+const shell_cmd_t *shell_get_cmd_table( int cmdtab_index )
+{
+    if( (cmdtab_index < 0) || (cmdtab_index >= SHELL_CMD_TABLE_LEN) )
+        return 0;
+    return shell_common.cmd_table[cmdtab_index];
 }
 
 
@@ -183,9 +527,15 @@ int shell_add_cmd_table( const shell_cmd_t *cmd_table )
 
     for( i=0; i<SHELL_CMD_TABLE_LEN; i++ )
     {
-        if( ! scb.cmd_table[i] )
+        if( ! shell_common.cmd_table[i] )
         {
-            scb.cmd_table[i] = cmd_table;
+            shell_common.cmd_table[i] = cmd_table;
+#if SHELL_CMD_INDEX_ENABLE
+            shell_build_cmd_index( i );
+#endif
+#if USE_SHELL_PROFILER
+            shell_alloc_cmd_stat( i );
+#endif
             return 1;
         }
     }
@@ -198,11 +548,13 @@ int shell_add_cmd_table( const shell_cmd_t *cmd_table )
 
 const char *shell_get_prompt( void )
 {
-    if( scb.prompt_hook )
-        return (*scb.prompt_hook)();
-    if( scb.errnum < 0 )
+    shell_control_block_t *scb = SHELL_SESSION();
+
+    if( shell_common.prompt_hook )
+        return (*shell_common.prompt_hook)();
+    if( scb->errnum < 0 )
         return "?>";
-    else if( scb.errnum > 0 )
+    else if( scb->errnum > 0 )
         return "!>";
     else
         return "=>";
@@ -211,13 +563,13 @@ const char *shell_get_prompt( void )
 
 void shell_set_prompt_hook( const char *(*hook)(void) )
 {
-    scb.prompt_hook = hook;
+    shell_common.prompt_hook = hook;
 }
 
 
 char *shell_get_buf( void )
 {
-    return scb.cmdline;
+    return SHELL_SESSION()->cmdline;
 }
 
 
@@ -319,14 +671,56 @@ static int shell_split_cmdline_into_argvs( char *cmd_line, uint8_t *argc, char *
 
 static int shell_search_command( int cmdtab_index, char *cmd_name )
 {
-    const shell_cmd_t *ct = scb.cmd_table[cmdtab_index];
+    const shell_cmd_t *ct = shell_common.cmd_table[cmdtab_index];
     int i, abbr;
+#if SHELL_CMD_INDEX_ENABLE
+    const uint8_t *idx = shell_common.cmd_index[cmdtab_index];
+    int lo, hi, mid;
+#endif
 
     if( ct == 0 )
         return -1;
     if( (cmd_name == 0) || (*cmd_name == 0) )
         return -1;
-    abbr = (strlen(cmd_name) == 1) ? 1 : 0;
+    abbr = (cmd_name[1] == 0) ? 1 : 0;
+#if SHELL_CMD_INDEX_ENABLE
+    if( idx )
+    {
+        /* binary search for the first matched entry */
+        if( abbr )
+        {
+            idx += shell_common.cmd_index_num[cmdtab_index];
+            lo = 0;
+            hi = shell_common.cmd_index_abbr_num[cmdtab_index];
+            while( lo < hi )
+            {
+                mid = (lo + hi) >> 1;
+                if( (uint8_t)ct[idx[mid]].sname < (uint8_t)*cmd_name )
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            if( (lo < shell_common.cmd_index_abbr_num[cmdtab_index]) && (ct[idx[lo]].sname == *cmd_name) )
+                return idx[lo];
+        }
+        else
+        {
+            lo = 0;
+            hi = shell_common.cmd_index_num[cmdtab_index];
+            while( lo < hi )
+            {
+                mid = (lo + hi) >> 1;
+                if( strcmp( ct[idx[mid]].name, cmd_name ) < 0 )
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            if( (lo < shell_common.cmd_index_num[cmdtab_index]) && (strcmp( ct[idx[lo]].name, cmd_name ) == 0) )
+                return idx[lo];
+        }
+        return -1;
+    }
+#endif
     for( i=0; ct->name; i++, ct++ )
     {
         /* search sequence: abbreviated command first */
@@ -347,32 +741,34 @@ static int shell_search_command( int cmdtab_index, char *cmd_name )
 
 static void shell_add_cmd_to_history( void )
 {
+    shell_control_block_t *scb = SHELL_SESSION();
     char *p1, *p2;
 
-    if( scb.cmdline_len == 0 )
+    if( scb->cmdline_len == 0 )
         return;
-    if( scb.cmdline_len > SHELL_CMDLINE_HISTORY_LEN )
+    if( scb->cmdline_len > SHELL_CMDLINE_HISTORY_LEN )
         return;
-    p1 = &scb.cmdline_history[SHELL_CMDLINE_HISTORY_LEN];
-    p2 = p1 - scb.cmdline_len - 1;
-    while( p1 >= scb.cmdline_history )
+    p1 = &scb->cmdline_history[SHELL_CMDLINE_HISTORY_LEN];
+    p2 = p1 - scb->cmdline_len - 1;
+    while( p1 >= scb->cmdline_history )
         *p1-- = *p2--;
-    strcpy( scb.cmdline_history, scb.cmdline );
-    p1 = &scb.cmdline_history[SHELL_CMDLINE_HISTORY_LEN];
+    strcpy( scb->cmdline_history, scb->cmdline );
+    p1 = &scb->cmdline_history[SHELL_CMDLINE_HISTORY_LEN];
     while( *p1 )
         *p1-- = 0;
-    scb.history_index = 0;
+    scb->history_index = 0;
 }
 
 
 static char *shell_get_history( int index )
 {
-    char *p = scb.cmdline_history;
+    shell_control_block_t *scb = SHELL_SESSION();
+    char *p = scb->cmdline_history;
 
     while( index > 1 )
     {
         while(*p++);  /* move to next item */
-        if( !*p || p >= &scb.cmdline_history[SHELL_CMDLINE_HISTORY_LEN] )
+        if( !*p || p >= &scb->cmdline_history[SHELL_CMDLINE_HISTORY_LEN] )
             return 0;
         index--;
     }
@@ -382,12 +778,13 @@ static char *shell_get_history( int index )
 
 static int shell_process_char( char c )
 {
+    shell_control_block_t *scb = SHELL_SESSION();
     int i;
     char *p;
 
     if( c == '\n' )
     {
-        scb.errnum = 0;
+        scb->errnum = 0;
         shell_write_char( '\n' );
         return 1;
     }
@@ -400,46 +797,46 @@ static int shell_process_char( char c )
     }
 #endif
 #if SHELL_IGNORE_LEADING_SPACE
-    else if( (scb.cmdline_len == 0) && ((c == ' ') || (c == '\t')) )  /* ignore */
+    else if( (scb->cmdline_len == 0) && ((c == ' ') || (c == '\t')) )  /* ignore */
     {
     }
 #endif
     else if( (c == '\b') || (c == 0x7F) )  /* backspace, DEL */
     {
-        if( scb.cmdline_len && scb.cmdline_cursor )
+        if( scb->cmdline_len && scb->cmdline_cursor )
         {
-            if( scb.cmdline_len == scb.cmdline_cursor )
+            if( scb->cmdline_len == scb->cmdline_cursor )
             {
-                scb.cmdline[--scb.cmdline_len] = 0;
+                scb->cmdline[--scb->cmdline_len] = 0;
                 shell_write_str( "\b \b" );
-                scb.cmdline_cursor--;
+                scb->cmdline_cursor--;
             }
             else
             {
-                for( i=scb.cmdline_cursor; i<scb.cmdline_len; i++ )
-                    scb.cmdline[i-1] = scb.cmdline[i];
-                scb.cmdline[--scb.cmdline_len] = 0;
-                scb.cmdline_cursor--;
+                for( i=scb->cmdline_cursor; i<scb->cmdline_len; i++ )
+                    scb->cmdline[i-1] = scb->cmdline[i];
+                scb->cmdline[--scb->cmdline_len] = 0;
+                scb->cmdline_cursor--;
                 shell_write_char( '\b' );
-                shell_write_str( &scb.cmdline[scb.cmdline_cursor] );
+                shell_write_str( &scb->cmdline[scb->cmdline_cursor] );
                 shell_write_char( ' ' );
-                for( i=scb.cmdline_len+1; i>scb.cmdline_cursor; i-- )
+                for( i=scb->cmdline_len+1; i>scb->cmdline_cursor; i-- )
                     shell_write_char( '\b' );
             }
         }
     }
     else if( c == 0x03 )  /* Ctrl-C, reset line */
     {
-        shell_driver_reset();
-        scb.cmdline_len = 0;
-        scb.cmdline_cursor = 0;
-        scb.errnum = 0;
-        scb.history_index = 0;
+        scb->driver->reset();
+        scb->cmdline_len = 0;
+        scb->cmdline_cursor = 0;
+        scb->errnum = 0;
+        scb->history_index = 0;
         return -1;
     }
     else if( c == 0x1A )  /* Ctrl-Z, end of input */
     {
-        scb.cmdline[scb.cmdline_cursor] = 0;
+        scb->cmdline[scb->cmdline_cursor] = 0;
         return -2;
     }
     else if( (c == 0x10) || (c == 0x0E) )  /* Ctrl-P/N, previous/next history */
@@ -447,85 +844,85 @@ static int shell_process_char( char c )
         p = 0;
         if( c == 0x10 )  /* Ctrl-P */
         {
-            p = shell_get_history( scb.history_index + 1 );
+            p = shell_get_history( scb->history_index + 1 );
             if( p )
-                scb.history_index += 1;
+                scb->history_index += 1;
         }
         else if( c == 0x0E )  /* Ctrl-N */
         {
-            if( scb.history_index > 1 )
+            if( scb->history_index > 1 )
             {
-                p = shell_get_history( scb.history_index - 1 );
+                p = shell_get_history( scb->history_index - 1 );
                 if( p )
-                    scb.history_index -= 1;
+                    scb->history_index -= 1;
             }
         }
         if( p )
         {
-            while( scb.cmdline_cursor < scb.cmdline_len )
+            while( scb->cmdline_cursor < scb->cmdline_len )
             {
                 shell_write_str( " " );
-                scb.cmdline_cursor++;
+                scb->cmdline_cursor++;
             }
-            while( scb.cmdline_len )
+            while( scb->cmdline_len )
             {
                 shell_write_str( "\b \b" );
-                scb.cmdline_len--;
+                scb->cmdline_len--;
             }
-            strcpy( scb.cmdline, p );
-            scb.cmdline_cursor = scb.cmdline_len = strlen(scb.cmdline);
-            shell_write_str( scb.cmdline );
+            strcpy( scb->cmdline, p );
+            scb->cmdline_cursor = scb->cmdline_len = strlen(scb->cmdline);
+            shell_write_str( scb->cmdline );
         }
     }
     else if( c == 0x01 )  /* Ctrl-A, begin */
     {
-        while( scb.cmdline_cursor )
+        while( scb->cmdline_cursor )
         {
             shell_write_char( '\b' );
-            scb.cmdline_cursor--;
+            scb->cmdline_cursor--;
         }
     }
     else if( c == 0x05 )  /* Ctrl-E, end */
     {
-        while( scb.cmdline_cursor < scb.cmdline_len )
-            shell_write_char( scb.cmdline[scb.cmdline_cursor++] );
+        while( scb->cmdline_cursor < scb->cmdline_len )
+            shell_write_char( scb->cmdline[scb->cmdline_cursor++] );
     }
     else if( c == 0x06 )  /* Ctrl-F, right */
     {
-        if( scb.cmdline_cursor < scb.cmdline_len )
-            shell_write_char( scb.cmdline[scb.cmdline_cursor++] );
+        if( scb->cmdline_cursor < scb->cmdline_len )
+            shell_write_char( scb->cmdline[scb->cmdline_cursor++] );
     }
     else if( c == 0x02 )  /* Ctrl-B, left */
     {
-        if( scb.cmdline_cursor )
+        if( scb->cmdline_cursor )
         {
             shell_write_char( '\b' );
-            scb.cmdline_cursor--;
+            scb->cmdline_cursor--;
         }
     }
     else if( c == 0x04 )  /* Ctrl-D, delete */
     {
-        if( scb.cmdline_cursor < scb.cmdline_len )
+        if( scb->cmdline_cursor < scb->cmdline_len )
         {
-            for( i=scb.cmdline_cursor; i<scb.cmdline_len; i++ )
-                scb.cmdline[i] = scb.cmdline[i+1];
-            scb.cmdline[--scb.cmdline_len] = 0;
-            shell_write_str( &scb.cmdline[scb.cmdline_cursor] );
+            for( i=scb->cmdline_cursor; i<scb->cmdline_len; i++ )
+                scb->cmdline[i] = scb->cmdline[i+1];
+            scb->cmdline[--scb->cmdline_len] = 0;
+            shell_write_str( &scb->cmdline[scb->cmdline_cursor] );
             shell_write_char( ' ' );
-            for( i=scb.cmdline_len+1; i>scb.cmdline_cursor; i-- )
+            for( i=scb->cmdline_len+1; i>scb->cmdline_cursor; i-- )
                 shell_write_char( '\b' );
         }
     }
     else if( c == 0x0B )  /* Ctrl-K, kill remaining */
     {
-        if( scb.cmdline_cursor < scb.cmdline_len )
+        if( scb->cmdline_cursor < scb->cmdline_len )
         {
-            scb.cmdline[scb.cmdline_cursor] = 0;
-            for( i=scb.cmdline_cursor; i<scb.cmdline_len; i++ )
+            scb->cmdline[scb->cmdline_cursor] = 0;
+            for( i=scb->cmdline_cursor; i<scb->cmdline_len; i++ )
                 shell_write_char( ' ' );
-            for( i=scb.cmdline_cursor; i<scb.cmdline_len; i++ )
+            for( i=scb->cmdline_cursor; i<scb->cmdline_len; i++ )
                 shell_write_char( '\b' );
-            scb.cmdline_len = scb.cmdline_cursor;
+            scb->cmdline_len = scb->cmdline_cursor;
         }
     }
     else if( c == 0x0C )  /* Ctrl-L, update, ignore */
@@ -534,26 +931,26 @@ static int shell_process_char( char c )
     else if( c == 0 )  /* NULL, ignore */
     {
     }
-    else if( scb.cmdline_len < SHELL_CMDLINE_LEN )  /* new char */
+    else if( scb->cmdline_len < SHELL_CMDLINE_LEN )  /* new char */
     {
         if( c == '\t')  /* convert TAB to space */
             c = ' ';
-        if( scb.cmdline_cursor == scb.cmdline_len )  /* append */
+        if( scb->cmdline_cursor == scb->cmdline_len )  /* append */
         {
-            scb.cmdline[scb.cmdline_len++] = c;
-            scb.cmdline[scb.cmdline_len] = 0;
-            scb.cmdline_cursor++;
+            scb->cmdline[scb->cmdline_len++] = c;
+            scb->cmdline[scb->cmdline_len] = 0;
+            scb->cmdline_cursor++;
             shell_write_char( c );
         }
         else  /* insert */
         {
-            scb.cmdline[scb.cmdline_len+1] = 0;
-            for( i=scb.cmdline_len; i>scb.cmdline_cursor; i-- )
-                scb.cmdline[i] = scb.cmdline[i-1];
-            scb.cmdline_len++;
-            scb.cmdline[scb.cmdline_cursor++] = c;
-            shell_write_str( &scb.cmdline[scb.cmdline_cursor-1] );
-            for( i=scb.cmdline_len; i>scb.cmdline_cursor; i-- )
+            scb->cmdline[scb->cmdline_len+1] = 0;
+            for( i=scb->cmdline_len; i>scb->cmdline_cursor; i-- )
+                scb->cmdline[i] = scb->cmdline[i-1];
+            scb->cmdline_len++;
+            scb->cmdline[scb->cmdline_cursor++] = c;
+            shell_write_str( &scb->cmdline[scb->cmdline_cursor-1] );
+            for( i=scb->cmdline_len; i>scb->cmdline_cursor; i-- )
                 shell_write_char( '\b' );
         }
     }
@@ -561,36 +958,251 @@ static int shell_process_char( char c )
 }            
 
 
-static int shell_process_command( void )
+/* search all tables, return entry index and set the table index */
+static int shell_find_command( const char *name, int *cmdtab_index )
 {
-    int (*cmd)(int argc, char *argv[]);
     int i, j;
 
-    if( shell_split_cmdline_into_argvs( scb.cmdline, &scb.argc, &scb.argv[0] ) )
+    for( i = 0; i < SHELL_CMD_TABLE_LEN; i++ )
     {
-        for( j = 0; j < SHELL_CMD_TABLE_LEN; j++ )
+        j = shell_search_command( i, (char*)name );
+        if( j != -1 )
         {
-            i = shell_search_command( j, scb.argv[0] );
-            if( i == -1 )
-                continue;
-            else
-                break;
+            *cmdtab_index = i;
+            return j;
+        }
+    }
+    return -1;
+}
+
+
+/* run the command entry, record the execution statistics if enabled */
+static int shell_run_command( int cmdtab_index, int index, int argc, char *argv[] )
+{
+    int (*cmd)(int argc, char *argv[]) = shell_common.cmd_table[cmdtab_index][index].cmd;
+#if USE_SHELL_PROFILER
+    shell_cmd_stat_t *stat = shell_common.cmd_stat[cmdtab_index];
+    uint32_t t;
+    int ret;
+
+    if( ! stat )
+        return (*cmd)( argc, argv );
+    stat += index;
+    t = SHELL_PROFILER_COUNTER();
+    ret = (*cmd)( argc, argv );
+    t = SHELL_PROFILER_COUNTER() - t;
+    portENTER_CRITICAL();
+    stat->count++;
+    stat->ticks += t;
+    if( t > stat->max )
+        stat->max = t;
+    stat->ret = ret;
+    portEXIT_CRITICAL();
+    return ret;
+#else
+    return (*cmd)( argc, argv );
+#endif
+}
+
+
+#if USE_SHELL_WRITE_REDIRECT
+static int shell_write_file_sink( void *arg, const char *buf, int len )
+{
+    return mcush_write( (int)(intptr_t)arg, (void*)buf, len );
+}
+#endif
+
+
+/* run the command, output redirection to file is supported with 
+   the last two arguments: "cmd ... > file" or "cmd ... >> file" */
+static int shell_exec_command( int cmdtab_index, int index, int argc, char *argv[] )
+{
+#if USE_SHELL_WRITE_REDIRECT
+    char *redirect = (argc > 2) ? argv[argc-2] : 0;
+    int fd, ret;
+
+    if( redirect && (redirect[0] == '>') && 
+        ((redirect[1] == 0) || ((redirect[1] == '>') && (redirect[2] == 0))) )
+    {
+        fd = mcush_open( argv[argc-1], redirect[1] ? "a+" : "w+" );
+        if( fd == 0 )
+        {
+            shell_printf( "open %s failed\n", argv[argc-1] );
+            return 1;
         }
-        if( i == -1 )
+        if( ! shell_write_add_sink( shell_write_file_sink, (void*)(intptr_t)fd, SHELL_WRITE_SINK_EXCLUSIVE ) )
         {
-            shell_write_str( "Invalid command: " );
-            shell_write_line( scb.argv[0] );
-            scb.errnum = -1;
+            mcush_close( fd );
+            return 1;
+        }
+        argv[argc-2] = 0;
+        ret = shell_run_command( cmdtab_index, index, argc-2, argv );
+        shell_write_remove_sink( shell_write_file_sink, (void*)(intptr_t)fd );
+        mcush_close( fd );
+        return ret;
+    }
+#endif
+    return shell_run_command( cmdtab_index, index, argc, argv );
+}
+
+
+/* split and run one command, returns -1 for invalid command, 
+   or ret unchanged for empty line */
+static int shell_exec_single_line( char *cmd_line, int ret, int verbose )
+{
+    char *argv[SHELL_ARGV_LEN];
+    uint8_t argc;
+    int i, j;
+
+    if( shell_split_cmdline_into_argvs( cmd_line, &argc, &argv[0] ) )
+    {
+        j = shell_find_command( argv[0], &i );
+        if( j == -1 )
+        {
+            if( verbose )
+            {
+                shell_write_str( "Invalid command: " );
+                shell_write_line( argv[0] );
+            }
+            return -1;
+        }
+        ret = shell_exec_command( i, j, argc, argv );
+    }
+    return ret;
+}
+
+
+/* chaining operator before/after the command */
+enum {
+    SHELL_CHAIN_END=0,
+    SHELL_CHAIN_SEQ,  /* ; */
+    SHELL_CHAIN_AND,  /* && */
+    SHELL_CHAIN_OR,   /* || */
+};
+
+/* whether the next command runs, by the operator before it */
+#define SHELL_CHAIN_RUN( op, ret )  (((op) == SHELL_CHAIN_SEQ) || (((op) == SHELL_CHAIN_AND) == ((ret) == 0)))
+
+
+#if USE_SHELL_CHAIN
+/* cut the first command off the chained line, quoted parts are skipped,
+   returns the rest and sets the operator that follows */
+static char *shell_chain_next( char *cmd_line, uint8_t *op )
+{
+    char *p = cmd_line, quote=0;
+
+    for( ; *p; p++ )
+    {
+        if( quote )
+        {
+            if( IS_END_QUOTE(*p) )
+                quote = 0;
+        }
+        else if( IS_START_QUOTE(*p) )
+            quote = *p;
+        else if( *p == ';' )
+        {
+            *p = 0;
+            *op = SHELL_CHAIN_SEQ;
+            return p+1;
+        }
+        else if( ((*p == '&') || (*p == '|')) && (*(p+1) == *p) )
+        {
+            *op = (*p == '&') ? SHELL_CHAIN_AND : SHELL_CHAIN_OR;
+            *p = 0;
+            return p+2;
+        }
+    }
+    *op = SHELL_CHAIN_END;
+    return p;
+}
+
+
+/* operator is ";", "&&" or "||" as whole argument, used in frame mode */
+static uint8_t shell_chain_op( const char *arg )
+{
+    if( (arg[0] == ';') && (arg[1] == 0) )
+        return SHELL_CHAIN_SEQ;
+    if( ((arg[0] == '&') || (arg[0] == '|')) && (arg[1] == arg[0]) && (arg[2] == 0) )
+        return (arg[0] == '&') ? SHELL_CHAIN_AND : SHELL_CHAIN_OR;
+    return SHELL_CHAIN_END;
+}
+
+
+#endif
+
+
+/* run the command line, with chaining "a ; b" runs both, "a && b" runs
+   b only if a succeeds, "a || b" runs b only if a fails,
+   returns the result of the last command that runs */
+static int shell_exec_line( char *cmd_line, int ret, int verbose )
+{
+#if USE_SHELL_CHAIN
+    char *next;
+    uint8_t op=SHELL_CHAIN_SEQ, run;
+
+    do
+    {
+        run = SHELL_CHAIN_RUN( op, ret );
+        next = shell_chain_next( cmd_line, &op );
+        if( run )
+            ret = shell_exec_single_line( cmd_line, ret, verbose );
+        cmd_line = next;
+    } while( op != SHELL_CHAIN_END );
+    return ret;
+#else
+    return shell_exec_single_line( cmd_line, ret, verbose );
+#endif
+}
+
+
+static int shell_process_command( void )
+{
+    shell_control_block_t *scb = SHELL_SESSION();
+#if USE_SHELL_CHAIN
+    /* commands reading input lines (mkbuf, etc) reuse scb->cmdline, 
+       the commands chained after them are run from the copy */
+    char cmdline[SHELL_CMDLINE_LEN+1];
+#endif
+#if USE_SHELL_JOB
+    char *p;
+    int i;
+#endif
+
+#if USE_SHELL_JOB
+    /* trailing '&', run in background */
+    p = scb->cmdline + strlen(scb->cmdline);
+    while( (p > scb->cmdline) && IS_SPACE(*(p-1)) )
+        p--;
+    if( (p > scb->cmdline) && (*(p-1) == '&') && 
+        ((p-1 == scb->cmdline) || (*(p-2) != '&')) )
+    {
+        *(p-1) = 0;
+        i = shell_job_start( scb->cmdline );
+        if( i < 0 )
+        {
+            shell_write_line( "no free job" );
+            scb->errnum = 1;
         }
         else
         {
-            cmd = ((shell_cmd_t*)(scb.cmd_table[j] + i))->cmd;
-            scb.errnum = (*cmd)( scb.argc, scb.argv );
+            shell_printf( "[%d]\n", i );
+            scb->errnum = 0;
         }
     }
-    scb.cmdline[0] = 0;
-    scb.cmdline_len = 0; 
-    scb.cmdline_cursor = 0;
+    else
+#endif
+    {
+#if USE_SHELL_CHAIN
+        strcpy( cmdline, scb->cmdline );
+        scb->errnum = shell_exec_line( cmdline, scb->errnum, 1 );
+#else
+        scb->errnum = shell_exec_line( scb->cmdline, scb->errnum, 1 );
+#endif
+    }
+    scb->cmdline[0] = 0;
+    scb->cmdline_len = 0; 
+    scb->cmdline_cursor = 0;
     return 1;
 }
 
@@ -599,13 +1211,10 @@ int (*shell_get_cmd_by_name( const char *name ))(int argc, char *argv[])
 {
     int i, j;
 
-    for( i = 0; i < SHELL_CMD_TABLE_LEN; i++ )
-    {
-        j = shell_search_command( i, (char*)name );
-        if( j != -1 )
-            return ((shell_cmd_t*)(scb.cmd_table[i] + j))->cmd;
-    }
-    return 0;
+    j = shell_find_command( name, &i );
+    if( j == -1 )
+        return 0;
+    return shell_common.cmd_table[i][j].cmd;
 }
 
 
@@ -613,36 +1222,36 @@ int shell_print_help( const char *cmd, int show_hidden )
 {
     int i, j;
 
-    for( i = 0; (i < SHELL_CMD_TABLE_LEN) && scb.cmd_table[i]; i++ )
+    for( i = 0; (i < SHELL_CMD_TABLE_LEN) && shell_common.cmd_table[i]; i++ )
     {
-        for( j=0; scb.cmd_table[i][j].name; j++ )
+        for( j=0; shell_common.cmd_table[i][j].name; j++ )
         {
             if( cmd && *cmd )
             {
                 if( strlen(cmd) > 1 )
                 {
-                    if( strcmp(cmd, scb.cmd_table[i][j].name) != 0 )
+                    if( strcmp(cmd, shell_common.cmd_table[i][j].name) != 0 )
                         continue;
                 }
                 else
                 {
-                    if( (strcmp(cmd, scb.cmd_table[i][j].name) != 0) || \
-                        (*cmd != scb.cmd_table[i][j].sname) )
+                    if( (strcmp(cmd, shell_common.cmd_table[i][j].name) != 0) || \
+                        (*cmd != shell_common.cmd_table[i][j].sname) )
                         continue;
                 }
             }
-            if( !show_hidden && (scb.cmd_table[i][j].flag == CMD_HIDDEN) )
+            if( !show_hidden && (shell_common.cmd_table[i][j].flag == CMD_HIDDEN) )
                 continue;
-            shell_write_str( scb.cmd_table[i][j].name );
-            if( scb.cmd_table[i][j].sname )
+            shell_write_str( shell_common.cmd_table[i][j].name );
+            if( shell_common.cmd_table[i][j].sname )
             {
                 shell_write_char( '/' );
-                shell_write_char( scb.cmd_table[i][j].sname );
+                shell_write_char( shell_common.cmd_table[i][j].sname );
             }
             shell_write_str( "  " );
-            shell_write_line( scb.cmd_table[i][j].description );
+            shell_write_line( shell_common.cmd_table[i][j].description );
             shell_write_str( "  " );
-            shell_write_line( scb.cmd_table[i][j].usage );
+            shell_write_line( shell_common.cmd_table[i][j].usage );
         }
     }
     return 0;
@@ -651,37 +1260,50 @@ int shell_print_help( const char *cmd, int show_hidden )
 
 int shell_init( const shell_cmd_t *cmd_table, const char *init_script )
 {
-    memset( &scb, 0, sizeof(shell_control_block_t) );
-    scb.cmd_table[0] = cmd_table;
-    scb.script = init_script;
-    return shell_driver_init();
+    shell_control_block_t *scb = &scb_tab[0];
+
+    memset( scb, 0, sizeof(shell_control_block_t) );
+    memset( &shell_common, 0, sizeof(shell_common_t) );
+    scb->driver = &shell_default_driver;
+    shell_common.cmd_table[0] = cmd_table;
+#if SHELL_CMD_INDEX_ENABLE
+    shell_build_cmd_index( 0 );
+#endif
+#if USE_SHELL_PROFILER
+    shell_alloc_cmd_stat( 0 );
+#endif
+    scb->script = init_script;
+    return scb->driver->init();
 }
 
 
 int shell_set_script( const char *script, int need_free )
 {
+    shell_control_block_t *scb = SHELL_SESSION();
+
     if( !script )
         return 0;
-    scb.script = script;
-    if( scb.script_free )
-        vPortFree( (void*)scb.script_free );
-    scb.script_free = need_free ? script : 0;
+    scb->script = script;
+    if( scb->script_free )
+        vPortFree( (void*)scb->script_free );
+    scb->script_free = need_free ? script : 0;
     return 1;
 }
 
 
 int shell_read_line( char *buf, const char *prompt )
 {
+    shell_control_block_t *scb = SHELL_SESSION();
     char c;
     int r;
 
-    scb.cmdline_len = 0;
-    scb.cmdline_cursor = 0;
+    scb->cmdline_len = 0;
+    scb->cmdline_cursor = 0;
     if( prompt )
         shell_write_str( prompt );
     else
         shell_write_str( SHELL_INPUT_SUB_PROMPT ); 
-    while( 1 )
+    while( ! scb->closed )
     {
         if( shell_read_char(&c) == -1 )
             continue;
@@ -689,12 +1311,12 @@ int shell_read_line( char *buf, const char *prompt )
         switch( r ) 
         {
         case 1:  /* end of line */
-            scb.cmdline[scb.cmdline_len] = 0;
-            if( scb.cmdline_len )
+            scb->cmdline[scb->cmdline_len] = 0;
+            if( scb->cmdline_len )
                 shell_add_cmd_to_history();
             if( buf )
-                strcpy( buf, scb.cmdline );
-            return scb.cmdline_len;
+                strcpy( buf, scb->cmdline );
+            return scb->cmdline_len;
         case -1:  /* Ctrl-C */
         case -2:  /* Ctrl-Z, end of input */
             shell_write_str("\r\n");
@@ -703,13 +1325,17 @@ int shell_read_line( char *buf, const char *prompt )
             return r;
         }
     }
+    /* session closed, same as Ctrl-C */
+    if( buf )
+        *buf = 0;
+    return -1;
 }
 
 
 char *shell_read_multi_lines( const char *prompt )
 {
     char *buf1=0, *buf2=shell_get_buf(), *p;
-    int len=0, alloc_size=SHELL_READ_LINES_ALLOC_SIZE_INC;
+    int len=0, line_len, alloc_size=SHELL_READ_LINES_ALLOC_SIZE_INC;
 
     buf1 = pvPortMalloc(SHELL_READ_LINES_ALLOC_SIZE_INC);
     if( !buf1 )
@@ -717,7 +1343,7 @@ char *shell_read_multi_lines( const char *prompt )
     *buf1 = 0;
     while( 1 )
     {
-        switch( shell_read_line(0, prompt) )
+        switch( line_len = shell_read_line(0, prompt) )
         {
         case 0:  /* empty line */
         case -2:  /* Ctrl-Z, end of input */
@@ -727,18 +1353,20 @@ char *shell_read_multi_lines( const char *prompt )
         case -1:  /* Ctrl-C, stop */
             goto abort;
         default:  /* normal line */
-            len += strlen(buf2) + 1;
-            if( (len+1) > alloc_size )
+            if( (len+line_len+2) > alloc_size )
             {
-                while( (len+1) > alloc_size )
-                    alloc_size += SHELL_READ_LINES_ALLOC_SIZE_INC;
+                /* grow geometrically, keeps the total copy cost linear */
+                while( (len+line_len+2) > alloc_size )
+                    alloc_size *= 2;
                 p = realloc( buf1, alloc_size );
                 if( !p )
                     goto alloc_err;
                 buf1 = p; 
             }
-            strcat( buf1, buf2 );
-            strcat( buf1, "\n" );
+            memcpy( buf1+len, buf2, line_len );
+            len += line_len;
+            buf1[len++] = '\n';
+            buf1[len] = 0;
             break;
         }
     }
@@ -755,105 +1383,91 @@ alloc_err:
 }
 
 
-int shell_make_16bits_data_buffer( void **pbuf, int *len )
+#define IS_DATA_SEPARATOR( c )   (((c)==' ')||((c)==',')||((c)=='\t')||((c)=='\r')||((c)=='\n'))
+
+/* read numbers line by line and convert them directly into the output 
+   buffer, the input text is never kept as a whole */
+static int shell_make_data_buffer( void **pbuf, int *len, int float_mode )
 {
-    void *buf=0;
-    int buf_len;
-    uint16_t *p, r;
-    char *p2, *p3;
+    char *line=shell_get_buf(), *p, *p2;
+    char *buf, *buf2;
+    int unit = float_mode ? sizeof(float) : sizeof(uint16_t);
+    int buf_len=0, alloc_size=SHELL_FLOAT_BUF_ALLOC_SIZE_INC;
 
-    buf = shell_read_multi_lines(0);
+    buf = pvPortMalloc( alloc_size );
     if( ! buf )
-        return 0;
-    buf_len = 0;
-    p = (uint16_t*)buf;
-    p2 = (char*)buf;
-    while( *p2 )
+        goto alloc_err;
+    while( 1 )
     {
-        r = strtol( p2, &p3, 0 );
-        if( !p3 || !*p3 )
-            break;
-        if( p2==p3 )
+        switch( shell_read_line(0, 0) )
+        {
+        case -1:  /* Ctrl-C, stop */
             goto fail;
-        while( *p3 && ((*p3==' ')||(*p3==',')||(*p3=='\t')||(*p3=='\r')||(*p3=='\n')) )
-            p3++;
-        //if( *p3 && !(*p3>='0' && *p3<='9') )
-        //    goto fail;
-        p2 = p3;
-        *p++ = r;
-        buf_len += 1;
+        case 0:  /* empty line */
+        case -2:  /* Ctrl-Z, end of input */
+            goto done;
+        }
+        p = line;
+        while( 1 )
+        {
+            while( IS_DATA_SEPARATOR(*p) )
+                p++;
+            if( ! *p )
+                break;
+            if( (buf_len+1) * unit > alloc_size )
+            {
+                buf2 = realloc( buf, alloc_size * 2 );
+                if( ! buf2 )
+                    goto alloc_err;
+                buf = buf2;
+                alloc_size *= 2;
+            }
+            if( float_mode )
+                ((float*)buf)[buf_len] = strtof( p, &p2 );
+            else
+                ((uint16_t*)buf)[buf_len] = strtol( p, &p2, 0 );
+            if( p2 == p )
+                goto fail;
+            p = p2;
+            buf_len += 1;
+        }
     }
+done:
     if( !buf_len )
         goto fail;
-    p2 = (char*)realloc( buf, buf_len * 2 );
-    if( p2 )
-        buf = (uint16_t*)p2;
+    buf2 = realloc( buf, buf_len * unit );
+    if( buf2 )
+        buf = buf2;
     *pbuf = buf;
     *len = buf_len;
     return 1;
+alloc_err:
+    shell_write_line("malloc failed");
 fail:
-    vPortFree( buf );
+    if( buf )
+        vPortFree( buf );
     return 0;
 }
 
 
-int shell_make_float_data_buffer( void **pbuf, int *len )
+int shell_make_16bits_data_buffer( void **pbuf, int *len )
 {
-    void *buf=0, *buf2=0;
-    int buf_len;
-    float *p, r;
-    char *p2, *p3;
+    return shell_make_data_buffer( pbuf, len, 0 );
+}
 
-    buf = shell_read_multi_lines(0);
-    if( ! buf )
-        return 0;
-    buf2 = pvPortMalloc(SHELL_FLOAT_BUF_ALLOC_SIZE_INC);
-    if( ! buf2 )
-        goto alloc_err;
-    buf_len = 0;
-    p = (float*)buf2;
-    p2 = (char*)buf;
-    while( *p2 )
-    {
-        r = strtof( p2, &p3 );
-        if( !p3 || !*p3 )
-            break;
-        if( p2==p3 )
-            goto fail;
-        while( *p3 && ((*p3==' ')||(*p3==',')||(*p3=='\t')||(*p3=='\r')||(*p3=='\n')) )
-            p3++;
-        //if( *p3 && !(*p3>='0' && *p3<='9') )
-        //    goto fail;
-        p2 = p3;
-        *p++ = r;
-        buf_len += 1;
-    }
-    if( !buf_len )
-        goto fail;
-    vPortFree(buf);
-    p = (float*)realloc( buf2, buf_len * 4 );
-    if( p )
-        buf2 = (float*)p;
-    *pbuf = buf2;
-    *len = buf_len;
-    return 1;
-alloc_err:
-    shell_write_line("malloc failed");
-fail:
-    if( buf )
-        vPortFree(buf);
-    if( buf2 )
-        vPortFree(buf2);
-    return 0;
+
+int shell_make_float_data_buffer( void **pbuf, int *len )
+{
+    return shell_make_data_buffer( pbuf, len, 1 );
 }
 
 
-void shell_run( void )
+static void shell_loop( shell_control_block_t *scb )
 {
     shell_write_str("\r\n");
     shell_write_str( shell_get_prompt() );
     
-    while( 1 )
+    while( ! scb->closed )
     {
 //#if HAL_WDG_ENABLE
 //        hal_wdg_clear();
@@ -868,8 +1482,81 @@ void shell_run( void )
         default:  /* commands */
             shell_process_command();
         }
-        shell_write_str( shell_get_prompt() );
+        if( ! scb->closed )
+            shell_write_str( shell_get_prompt() );
+    }
+}
+
+
+void shell_run( void )
+{
+    shell_loop( &scb_tab[0] );
+}
+
+
+#if SHELL_SESSION_NUM > 1
+/* claim a free session for the task (the calling one if NULL),
+   returns 0 if none */
+shell_control_block_t *shell_session_bind( const shell_driver_ops_t *driver, void *task )
+{
+    shell_control_block_t *scb=0;
+    int i;
+
+    portENTER_CRITICAL();
+    for( i=1; i<SHELL_SESSION_NUM; i++ )
+    {
+        if( ! scb_tab[i].driver )
+        {
+            scb = &scb_tab[i];
+            memset( scb, 0, sizeof(shell_control_block_t) );
+            scb->driver = driver;
+            scb->task = task ? task : (void*)xTaskGetCurrentTaskHandle();
+            break;
+        }
     }
+    portEXIT_CRITICAL();
+    return scb;
+}
+
+
+void shell_session_unbind( shell_control_block_t *scb )
+{
+    if( scb->script_free )
+        vPortFree( (void*)scb->script_free );
+    scb->script_free = 0;
+    scb->task = 0;
+    scb->driver = 0;
+}
+#endif
+
+
+/* run another shell session on the driver in the calling task, 
+   returns 0 if no free session, or after shell_session_close is called */
+int shell_session_run( const shell_driver_ops_t *driver, const char *init_script )
+{
+#if SHELL_SESSION_NUM > 1
+    shell_control_block_t *scb = shell_session_bind( driver, 0 );
+
+    if( ! scb )
+        return 0;
+    scb->script = init_script;
+    if( scb->driver->init() )
+        shell_loop( scb );
+    shell_session_unbind( scb );
+    return 1;
+#else
+    (void)driver;
+    (void)init_script;
+    return 0;
+#endif
+}
+
+
+/* called by the session driver (eg. connection lost), the session loop 
+   stops after current line */
+void shell_session_close( void )
+{
+    SHELL_SESSION()->closed = 1;
 }
 
 
@@ -879,13 +1566,12 @@ int shell_call( const char *cmd_name, ... )
 {
     va_list ap;
     int ret=0;
-    int (*cmd)(int argc, char *argv[]);
     char *argv[SHELL_ARGV_LEN], *s;
-    int argc;
+    int argc, i, j;
 
     va_start( ap, cmd_name );
-    cmd = shell_get_cmd_by_name( cmd_name );
-    if( cmd == 0 )
+    j = shell_find_command( cmd_name, &i );
+    if( j == -1 )
         ret = -1;
     else
     {
@@ -899,7 +1585,7 @@ int shell_call( const char *cmd_name, ... )
             else
                 break;
         }
-        ret = cmd( argc, argv );
+        ret = shell_exec_command( i, j, argc, argv );
     }
     va_end( ap );
     return ret;
@@ -910,24 +1596,331 @@ int shell_call( const char *cmd_name, ... )
    NOTE: cmd_line will be split into several sub-strings */
 int shell_call_line( char *cmd_line )
 {
-    int ret=-1;
-    int (*cmd)(int argc, char *argv[]);
-    char *argv[SHELL_ARGV_LEN];   
-    uint8_t argc;
     char cmdline[SHELL_CMDLINE_LEN+1];
 
     strcpy( cmdline, cmd_line );  /* input line maybe in FLASH area */
+    return shell_exec_line( cmdline, -1, 0 );
+}
+
+
+
+
+#if USE_SHELL_SCRIPT_IMAGE
+/* compile script text into program image, so that it can be run (many
+   times) without the line editor and re-tokenizing
+   image: magic(4) | commands(2) | { op:argc(1) | argv[0] 0 argv[1] 0 ... } ...
+   op (high 2 bits) is the chaining operator before the command,
+   the image contains no pointer and can be saved as file */
+int shell_script_compile( const char *script, char **image, int *size )
+{
+    char line[SHELL_CMDLINE_LEN+1], *argv[SHELL_ARGV_LEN];
+    const char *p;
+    char *buf, *out, *cmd, *next;
+    uint8_t argc, op, op_next;
+    int len, lines, i;
+
+    if( ! script || ! image || ! size )
+        return 0;
+    /* upper limit: argc and terminator for each line/chained command */
+    for( lines=1, p=script; *p; p++ )
+    {
+        if( (*p == '\n') || (*p == ';') )
+            lines++;
+    }
+    buf = pvPortMalloc( SHELL_SCRIPT_IMAGE_HEAD_LEN + (p - script) + lines * 2 );
+    if( ! buf )
+        return 0;
+    memcpy( buf, SHELL_SCRIPT_IMAGE_MAGIC, 4 );
+    out = buf + SHELL_SCRIPT_IMAGE_HEAD_LEN;
+    lines = 0;
+    p = script;
+    while( *p )
+    {
+        /* fetch one line, too long line is truncated as in line editor */
+        for( len=0; *p && (*p != '\n'); p++ )
+        {
+            if( (*p != '\r') && (len < SHELL_CMDLINE_LEN) )
+                line[len++] = (*p == '\t') ? ' ' : *p;
+        }
+        line[len] = 0;
+        if( *p )
+            p++;
+        op = SHELL_CHAIN_SEQ;
+        cmd = line;
+        do
+        {
+#if USE_SHELL_CHAIN
+            next = shell_chain_next( cmd, &op_next );
+#else
+            next = cmd;
+            op_next = SHELL_CHAIN_END;
+#endif
+            if( shell_split_cmdline_into_argvs( cmd, &argc, &argv[0] ) )
+            {
+                *out++ = (op << 6) | argc;
+                for( i=0; i<argc; i++ )
+                {
+                    len = strlen( argv[i] ) + 1;
+                    memcpy( out, argv[i], len );
+                    out += len;
+                }
+                if( ++lines > 0xFFFF )
+                {
+                    vPortFree( buf );
+                    return 0;
+                }
+            }
+            op = op_next;
+            cmd = next;
+        } while( op != SHELL_CHAIN_END );
+    }
+    buf[4] = lines & 0xFF;
+    buf[5] = (lines >> 8) & 0xFF;
+    len = out - buf;
+    out = realloc( buf, len );
+    *image = out ? out : buf;
+    *size = len;
+    return 1;
+}
+
+
+int shell_script_is_image( const char *image, int size )
+{
+    return (size >= SHELL_SCRIPT_IMAGE_HEAD_LEN) && (memcmp( image, SHELL_SCRIPT_IMAGE_MAGIC, 4 ) == 0);
+}
+
 
-    if( shell_split_cmdline_into_argvs( cmdline, &argc, &argv[0] ) )
+/* run the program image, each command is called as shell_call does,
+   returns the result of the last command, or -1 for bad image/command */
+int shell_script_run( char *image, int size )
+{
+    char *argv[SHELL_ARGV_LEN];
+    char *p, *end = image + size;
+    int lines, argc, ret=0, i, j;
+    uint8_t op;
+
+    if( ! shell_script_is_image( image, size ) )
+        return -1;
+    lines = (uint8_t)image[4] | ((uint8_t)image[5] << 8);
+    p = image + SHELL_SCRIPT_IMAGE_HEAD_LEN;
+    while( lines-- )
     {
-        if( argc > 0 )
+        if( p >= end )
+            return -1;
+        op = (uint8_t)*p >> 6;
+        argc = (uint8_t)*p++ & 0x3F;
+        if( (argc == 0) || (argc > SHELL_ARGV_LEN) )
+            return -1;
+        for( i=0; i<argc; i++ )
         {
-            cmd = shell_get_cmd_by_name( argv[0] );
-            if( cmd ) 
-                ret = cmd( argc, argv );
+            argv[i] = p;
+            while( (p < end) && *p )
+                p++;
+            if( p++ >= end )
+                return -1;
         }
+        if( ! SHELL_CHAIN_RUN( op, ret ) )
+            continue;
+        j = shell_find_command( argv[0], &i );
+        if( j == -1 )
+        {
+            shell_write_str( "Invalid command: " );
+            shell_write_line( argv[0] );
+            ret = -1;
+        }
+        else
+            ret = shell_exec_command( i, j, argc, argv );
+        SHELL_SESSION()->errnum = ret;
     }
     return ret;
 }
+#endif
+
+
+#if USE_SHELL_FRAME
+/* binary frame mode for host automation, without echo/history/prompt
+   request:  SOF | length(2) | argv[0] 0 argv[1] 0 ... | crc(2)
+   response: SOF | length(2) | status(1) | return code(4) | output ... | crc(2)
+   length/return code/crc are little-endian, crc16_modbus covers length 
+   and payload, empty request (or Ctrl-C while idle) quits the mode
+   commands chained with ";", "&&", "||" arguments get one response each,
+   status SHELL_FRAME_SKIPPED for those not run, a request of operators
+   only gets one SHELL_FRAME_ERR_COMMAND, a command with more than
+   SHELL_ARGV_LEN arguments rejects the request with SHELL_FRAME_ERR_LENGTH
+   NOTE: commands that read from shell input are not supported */
+static int shell_frame_read( uint8_t *buf, int len )
+{
+    shell_control_block_t *scb = SHELL_SESSION();
+    char c;
+
+    while( len-- )
+    {
+        if( scb->driver->read_char_blocked( &c, SHELL_FRAME_TIMEOUT_MS*configTICK_RATE_HZ/1000 ) == -1 )
+            return 0;
+        *buf++ = (uint8_t)c;
+    }
+    return 1;
+}
+
+
+static void shell_frame_write( uint8_t status, int ret, const char *output, int len )
+{
+    shell_control_block_t *scb = SHELL_SESSION();
+    uint8_t head[8];
+    uint16_t crc;
+
+    len += 5;
+    head[0] = SHELL_FRAME_SOF;
+    head[1] = len & 0xFF;
+    head[2] = (len >> 8) & 0xFF;
+    head[3] = status;
+    head[4] = ret & 0xFF;
+    head[5] = (ret >> 8) & 0xFF;
+    head[6] = (ret >> 16) & 0xFF;
+    head[7] = (ret >> 24) & 0xFF;
+    len -= 5;
+    crc = crc16_modbus_update( crc16_modbus_init(), &head[1], 7 );
+    crc = crc16_modbus_update( crc, (const uint8_t*)output, len );
+    scb->driver->write( (const char*)head, 8 );
+    if( len )
+        scb->driver->write( output, len );
+    head[0] = crc & 0xFF;
+    head[1] = (crc >> 8) & 0xFF;
+    scb->driver->write( (const char*)head, 2 );
+}
+
 
+int shell_frame_mode( void )
+{
+    shell_control_block_t *scb = SHELL_SESSION();
+    uint8_t *buf, head[2];
+    char *output, *p, **argv;
+    int len, argc, ret, overflow, i, j, k, n, words;
+    uint8_t status, op, op_next, replied;
+    uint16_t crc;
+    char c;
 
+    /* argv | request | output */
+    argv = pvPortMalloc( (SHELL_FRAME_ARGV_LEN+1) * sizeof(char*) + SHELL_FRAME_BUF_SIZE + 2 + SHELL_FRAME_OUTPUT_BUF_SIZE );
+    if( ! argv )
+    {
+        shell_write_line("malloc failed");
+        return 1;
+    }
+    buf = (uint8_t*)&argv[SHELL_FRAME_ARGV_LEN+1];
+    output = (char*)buf + SHELL_FRAME_BUF_SIZE + 2;
+    shell_frame_write( SHELL_FRAME_OK, 0, 0, 0 );  /* ready */
+    while( 1 )
+    {
+        if( scb->driver->read_char_blocked( &c, portMAX_DELAY ) == -1 )
+            continue;
+        if( c == 0x03 )  /* Ctrl-C, quit */
+            break;
+        if( c != SHELL_FRAME_SOF )
+            continue;
+        if( ! shell_frame_read( head, 2 ) )
+            continue;
+        len = head[0] | (head[1] << 8);
+        if( len > SHELL_FRAME_BUF_SIZE )
+        {
+            shell_frame_write( SHELL_FRAME_ERR_LENGTH, -1, 0, 0 );
+            continue;
+        }
+        if( ! shell_frame_read( buf, len + 2 ) )
+            continue;
+        crc = crc16_modbus_update( crc16_modbus_init(), head, 2 );
+        crc = crc16_modbus_update( crc, buf, len );
+        if( crc != (buf[len] | (buf[len+1] << 8)) )
+        {
+            shell_frame_write( SHELL_FRAME_ERR_CRC, -1, 0, 0 );
+            continue;
+        }
+        if( len == 0 )  /* empty request, quit */
+        {
+            shell_frame_write( SHELL_FRAME_OK, 0, 0, 0 );
+            break;
+        }
+        buf[len] = 0;  /* terminate the last argument */
+        argc = 0;
+        p = (char*)buf;
+        while( (p < (char*)buf + len) && (argc < SHELL_FRAME_ARGV_LEN) )
+        {
+            argv[argc++] = p;
+            p += strlen(p) + 1;
+        }
+        /* each chained command is limited as on the command line */
+        words = 0;
+        for( n=0; n<argc; n++ )
+        {
+#if USE_SHELL_CHAIN
+            if( shell_chain_op( argv[n] ) != SHELL_CHAIN_END )
+            {
+                words = 0;
+                continue;
+            }
+#endif
+            if( ++words > SHELL_ARGV_LEN )
+                break;
+        }
+        if( (p < (char*)buf + len) || (n < argc) )
+        {
+            /* too many arguments, do not run part of them */
+            shell_frame_write( SHELL_FRAME_ERR_LENGTH, -1, 0, 0 );
+            continue;
+        }
+        ret = 0;
+        replied = 0;
+        op = SHELL_CHAIN_SEQ;
+        for( k=0; k<argc; k=n+1 )
+        {
+            /* chained commands, one response for each of them */
+            op_next = SHELL_CHAIN_END;
+            for( n=k; n<argc; n++ )
+            {
+#if USE_SHELL_CHAIN
+                op_next = shell_chain_op( argv[n] );
+                if( op_next != SHELL_CHAIN_END )
+                    break;
+#endif
+            }
+            if( n == k )
+            {
+                op = op_next;
+                continue;
+            }
+            if( ! SHELL_CHAIN_RUN( op, ret ) )
+            {
+                shell_frame_write( SHELL_FRAME_SKIPPED, ret, 0, 0 );
+                replied = 1;
+                op = op_next;
+                continue;
+            }
+            j = shell_find_command( argv[k], &i );
+            shell_write_set_capture( output, SHELL_FRAME_OUTPUT_BUF_SIZE );
+            if( j != -1 )
+            {
+                argv[n] = 0;
+                ret = shell_exec_command( i, j, n-k, &argv[k] );
+                status = SHELL_FRAME_OK;
+            }
+            else
+            {
+                ret = -1;
+                status = SHELL_FRAME_ERR_COMMAND;
+            }
+            len = shell_write_get_capture( &overflow );
+            shell_write_set_capture( 0, 0 );
+            if( overflow && (status == SHELL_FRAME_OK) )
+                status = SHELL_FRAME_OUTPUT_TRUNCATED;
+            scb->errnum = ret;
+            shell_frame_write( status, ret, output, len );
+            replied = 1;
+            op = op_next;
+        }
+        if( ! replied )
+            shell_frame_write( SHELL_FRAME_ERR_COMMAND, -1, 0, 0 );  /* no command */
+    }
+    vPortFree( argv );
+    return 0;
+}
+#endif
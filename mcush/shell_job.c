@@ -0,0 +1,224 @@
+/* background jobs, command line ending with '&' runs on worker task
+ * MCUSH designed by Peng Shulin, all rights reserved. */
+#include "mcush.h"
+
+#if USE_SHELL_JOB
+
+/* every job slot owns a worker task (created on first use) bound to its
+   own shell session, so output goes into the job buffer and the commands
+   polling for Ctrl-C (LOOP_CHECK, etc) see it when the job is killed */
+static shell_job_t job_tab[SHELL_JOB_NUM];
+
+
+static shell_job_t *shell_job_current( void )
+{
+    void *task = (void*)xTaskGetCurrentTaskHandle();
+    int i;
+
+    for( i=0; i<SHELL_JOB_NUM; i++ )
+    {
+        if( job_tab[i].task == task )
+            return &job_tab[i];
+    }
+    return 0;
+}
+
+
+static int shell_job_driver_init( void )
+{
+    return 1;
+}
+
+
+static void shell_job_driver_reset( void )
+{
+}
+
+
+static int shell_job_driver_read_char( char *c )
+{
+    shell_job_t *job = shell_job_current();
+
+    if( job && job->killed )
+    {
+        *c = 0x03;
+        return (int)*c;
+    }
+    return -1;
+}
+
+
+static int shell_job_driver_read_char_blocked( char *c, int block_time )
+{
+    shell_job_t *job = shell_job_current();
+
+    if( ! job )
+        return -1;
+    if( ! job->killed )
+        ulTaskNotifyTake( pdTRUE, block_time );
+    return shell_job_driver_read_char( c );
+}
+
+
+static int shell_job_driver_write( const char *buffer, int len )
+{
+    shell_job_t *job = shell_job_current();
+    int free;
+
+    if( ! job )
+        return 0;
+    portENTER_CRITICAL();
+    free = SHELL_JOB_OUTPUT_BUF_SIZE - job->output_len;
+    if( len > free )
+    {
+        len = free;
+        job->output_overflow = 1;
+    }
+    memcpy( job->output + job->output_len, buffer, len );
+    job->output_len += len;
+    portEXIT_CRITICAL();
+    return len;
+}
+
+
+static void shell_job_driver_write_char( char c )
+{
+    shell_job_driver_write( &c, 1 );
+}
+
+
+static const shell_driver_ops_t shell_job_driver = {
+    shell_job_driver_init,
+    shell_job_driver_reset,
+    shell_job_driver_read_char,
+    shell_job_driver_read_char_blocked,
+    shell_job_driver_write,
+    shell_job_driver_write_char,
+};
+
+
+/* the session is bound by shell_job_start before the first job */
+static void shell_job_task_entry( void *p )
+{
+    shell_job_t *job = (shell_job_t*)p;
+
+    while( 1 )
+    {
+        ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+        /* stale notification from kill after the job finished */
+        if( job->state != SHELL_JOB_RUNNING )
+            continue;
+        /* cmdline is copied, as shell_call_line splits it */
+        job->ret = shell_call_line( job->cmdline );
+        job->state = SHELL_JOB_DONE;
+    }
+}
+
+
+/* returns job id (start from 1), or -1 if no free slot/task/session */
+int shell_job_start( const char *cmd_line )
+{
+    shell_job_t *job=0;
+    TaskHandle_t task;
+    int i;
+
+    portENTER_CRITICAL();
+    for( i=0; i<SHELL_JOB_NUM; i++ )
+    {
+        if( job_tab[i].state == SHELL_JOB_FREE )
+        {
+            job = &job_tab[i];
+            job->state = SHELL_JOB_RESERVED;
+            break;
+        }
+    }
+    portEXIT_CRITICAL();
+    if( ! job )
+        return -1;
+    strncpy( job->cmdline, cmd_line, SHELL_CMDLINE_LEN );
+    job->cmdline[SHELL_CMDLINE_LEN] = 0;
+    job->killed = 0;
+    job->ret = 0;
+    job->output_len = 0;
+    job->output_overflow = 0;
+    if( ! job->task )
+    {
+        if( xTaskCreate( (TaskFunction_t)shell_job_task_entry, (const char *)"jobT",
+                    SHELL_JOB_STACK_SIZE / sizeof(portSTACK_TYPE),
+                    job, SHELL_JOB_PRIORITY, &task ) != pdPASS )
+        {
+            job->state = SHELL_JOB_FREE;
+            return -1;
+        }
+        /* sessions may be taken by others (eg. remote shells) */
+        if( ! shell_session_bind( &shell_job_driver, (void*)task ) )
+        {
+            vTaskDelete( task );
+            job->state = SHELL_JOB_FREE;
+            return -1;
+        }
+        job->task = (void*)task;
+    }
+    job->state = SHELL_JOB_RUNNING;
+    xTaskNotifyGive( (TaskHandle_t)job->task );
+    return i+1;
+}
+
+
+static shell_job_t *shell_job_from_id( int id )
+{
+    if( (id < 1) || (id > SHELL_JOB_NUM) )
+        return 0;
+    return &job_tab[id-1];
+}
+
+
+const shell_job_t *shell_job_get( int id )
+{
+    return shell_job_from_id( id );
+}
+
+
+/* the command stops only when it checks the input for Ctrl-C */
+int shell_job_kill( int id )
+{
+    shell_job_t *job = shell_job_from_id( id );
+
+    if( ! job || (job->state != SHELL_JOB_RUNNING) )
+        return 0;
+    job->killed = 1;
+    xTaskNotifyGive( (TaskHandle_t)job->task );
+    return 1;
+}
+
+
+/* release the finished job */
+int shell_job_free( int id )
+{
+    shell_job_t *job = shell_job_from_id( id );
+
+    if( ! job || (job->state != SHELL_JOB_DONE) )
+        return 0;
+    job->state = SHELL_JOB_FREE;
+    return 1;
+}
+
+
+/* print and remove the collected output, the job may still be running */
+int shell_job_print_output( int id )
+{
+    shell_job_t *job = shell_job_from_id( id );
+    int len;
+
+    if( ! job || (job->state == SHELL_JOB_FREE) || (job->state == SHELL_JOB_RESERVED) )
+        return 0;
+    len = job->output_len;
+    shell_write( job->output, len );
+    portENTER_CRITICAL();
+    memmove( job->output, job->output + len, job->output_len - len );
+    job->output_len -= len;
+    portEXIT_CRITICAL();
+    return 1;
+}
+
+#endif
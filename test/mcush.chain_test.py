@@ -0,0 +1,40 @@
+#!/usr/bin/env python
+# chained commands on one line, including one that reads input lines
+import sys
+from mcush import *
+
+
+def main(argv=None):
+    s = Mcush.Mcush()
+    # sequence, and/or by the result
+    assert s.writeCommand( 'echo A ; echo B' ) == ['A', 'B']
+    assert s.writeCommand( 'echo A && echo B' ) == ['A', 'B']
+    assert s.writeCommand( 'echo A || echo B' ) == ['A']
+    # the data lines of mkbuf must not replace the chained command
+    s.setPrompts( s.DEFAULT_PROMPTS_MULTILINE )
+    s.writeCommand( 'mkbuf ; echo CHAINED' )
+    s.writeCommand( '1 2 3 4 5 6 7 8 9' )
+    s.setPrompts()
+    ret = s.writeCommand( '' )
+    assert ret[-1] == 'CHAINED', ret
+    r = Utils.parseKeyValueLines( ret[:-1] )
+    assert int(r['length']) == 9
+    s.free( int(r['address'], 16) )
+    # batch in frame mode
+    s.frameEnter()
+    ret = s.frameBatch( ['echo A', 'echo B'] )
+    assert ret == [['A'], ['B']], ret
+    # operators only, still answered
+    s.frameWrite( [';', '&&'] )
+    assert s.frameRead()[0] == s.FRAME_STATUS_COMMAND_ERR
+    # one command over the argv limit, nothing is run
+    s.frameWrite( ['echo', 'A', ';', 'echo'] + ['B'] * 40 )
+    assert s.frameRead()[0] == s.FRAME_STATUS_LENGTH_ERR
+    assert s.frameCommand( 'echo C' ) == ['C']
+    s.frameExit()
+    print( 'chain test passed' )
+    s.disconnect()
+        
+   
+if __name__ == '__main__':
+    main(sys.argv)
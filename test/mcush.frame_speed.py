@@ -0,0 +1,36 @@
+#!/usr/bin/env python
+# compare command rate of line mode, binary frame mode and chained batch
+import sys
+import time
+from mcush import *
+
+
+def main(argv=None):
+    try:
+        count = int(argv[1])
+    except:
+        count = 1000
+    cmd = 'uptime'
+    s = Mcush.Mcush()
+    t0 = time.time()
+    for i in range(count):
+        s.writeCommand( cmd )
+    dt = time.time() - t0
+    print( 'line mode:  %d commands, %.1f cmd/s'% (count, count/dt) )
+    s.frameEnter()
+    t0 = time.time()
+    for i in range(count):
+        s.frameCommand( cmd )
+    dt = time.time() - t0
+    print( 'frame mode: %d commands, %.1f cmd/s'% (count, count/dt) )
+    batch = 20
+    t0 = time.time()
+    for i in range(count//batch):
+        s.frameBatch( [cmd] * batch )
+    dt = time.time() - t0
+    s.frameExit()
+    print( 'frame batch of %d: %d commands, %.1f cmd/s'% (batch, count//batch*batch, count//batch*batch/dt) )
+    s.disconnect()
+   
+if __name__ == '__main__':
+    main(sys.argv)
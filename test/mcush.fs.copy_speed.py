@@ -0,0 +1,37 @@
+#!/usr/bin/env python
+# copy file between volumes with different buffer sizes and check result,
+# on posix port set MCUSH_SPIFLASH_DELAY/MCUSH_FATFS_DELAY to emulate media
+import os
+import sys
+from mcush import *
+
+
+def main(argv=None):
+    try:
+        size = int(argv[1])
+    except:
+        size = 65536
+    try:
+        src, dst = argv[2], argv[3]
+    except:
+        src, dst = '/f/cp_src.bin', '/s/cp_dst.bin'
+    bak = os.path.dirname(src) + '/cp_bak.bin'
+    local = 'cp_src.bin'
+    dat = os.urandom(size)
+    open(local, 'wb+').write(dat)
+    s = Mcush.Mcush()
+    s.setTimeout( 60 )
+    s.xferPut( src, local )
+    crc = Utils.crc( dat )
+    for buf_size in [256, 1024, 4096, 16384]:
+        for a, b in [(src, dst), (dst, bak)]:
+            ret = s.writeCommand( 'cp -v -b %d %s %s'% (buf_size, a, b) )
+            assert s.crc( b ) == crc
+            print( '%s -> %s: %s'% (a, b, ret[0]) )
+    s.remove( bak )
+    s.remove( dst )
+    s.disconnect()
+    os.remove( local )
+   
+if __name__ == '__main__':
+    main(sys.argv)
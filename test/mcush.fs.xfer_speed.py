@@ -0,0 +1,50 @@
+#!/usr/bin/env python
+# compare file transfer rate of xfer command and cat -b (putFile/getFile)
+import os
+import sys
+import time
+from mcush import *
+
+
+def main(argv=None):
+    try:
+        size = int(argv[1])
+    except:
+        size = 32768
+    try:
+        pathname = argv[2]
+    except:
+        pathname = '/s/test.bin'
+    local_put, local_get = 'xfer_put.bin', 'xfer_get.bin'
+    dat = os.urandom(size)
+    open(local_put, 'wb+').write(dat)
+    s = Mcush.Mcush()
+    t0 = time.time()
+    s.putFile( pathname, local_put )
+    dt = time.time() - t0
+    print( 'putFile:  %d bytes, %.1f KB/s'% (size, size/dt/1024) )
+    t0 = time.time()
+    s.getFile( pathname, local_get )
+    dt = time.time() - t0
+    print( 'getFile:  %d bytes, %.1f KB/s'% (size, size/dt/1024) )
+    t0 = time.time()
+    s.xferPut( pathname, local_put )
+    dt = time.time() - t0
+    assert s.crc( pathname ) == Utils.crc( dat )
+    print( 'xfer put: %d bytes, %.1f KB/s'% (size, size/dt/1024) )
+    t0 = time.time()
+    s.xferGet( pathname, local_get )
+    dt = time.time() - t0
+    assert open(local_get, 'rb').read() == dat
+    print( 'xfer get: %d bytes, %.1f KB/s'% (size, size/dt/1024) )
+    # resume from half of the local copy
+    open(local_get, 'wb+').write(dat[:size//2])
+    s.xferGet( pathname, local_get, resume=True )
+    assert open(local_get, 'rb').read() == dat
+    print( 'xfer get resumed' )
+    s.disconnect()
+    os.remove( local_put )
+    os.remove( local_get )
+   
+if __name__ == '__main__':
+    main(sys.argv)
@@ -0,0 +1,51 @@
+#!/usr/bin/env python
+# background jobs (command line ending with '&') running at the same time
+import sys
+import time
+from mcush import *
+
+
+def wait_done( s, ids, timeout=5 ):
+    t0 = time.time()
+    while time.time() < t0 + timeout:
+        states = {}
+        for line in s.writeCommand( 'jobs' ):
+            states[int(line[1:line.index(']')])] = line.split()[1]
+        if all( states.get(i) == 'D' for i in ids ):
+            return time.time() - t0
+        time.sleep( 0.05 )
+    raise Exception( 'jobs not done: %s'% str(states) )
+
+
+def main(argv=None):
+    s = Mcush.Mcush()
+    # fill all the slots, the last one is refused
+    ids = []
+    while True:
+        try:
+            ret = s.writeCommand( 'wait 500 ; echo J%d &'% len(ids) )
+        except Instrument.CommandExecuteError as e:
+            assert 'no free job' in str(e), e
+            break
+        ids.append( int(ret[0].strip('[]')) )
+    assert len(ids) > 1, ids
+    # all of them run at once, in much less than one after another
+    t = wait_done( s, ids )
+    assert t < 0.5 * len(ids), t
+    for n, i in enumerate(ids):
+        assert s.writeCommand( 'jobs -o %d'% i ) == ['J%d'% n]
+    assert s.writeCommand( 'jobs' ) == []
+    # slots are reused, and a killed job stops
+    i = int(s.writeCommand( 'loop -l 50 echo K &' )[0].strip('[]'))
+    i2 = int(s.writeCommand( 'wait 200 ; echo L &' )[0].strip('[]'))
+    time.sleep( 0.3 )
+    s.writeCommand( 'kill %d'% i )
+    wait_done( s, [i, i2] )
+    assert 'K' in s.writeCommand( 'jobs -o %d'% i )
+    assert s.writeCommand( 'jobs -o %d'% i2 ) == ['L']
+    print( 'job test passed' )
+    s.disconnect()
+        
+   
+if __name__ == '__main__':
+    main(sys.argv)
@@ -0,0 +1,75 @@
+#!/usr/bin/env python
+# two shell sessions (eg. uart and vcp, or halposix with MCUSH_PTY=2)
+# driven at the same time, each must see only its own output,
+# aggregate throughput compared with one session alone
+#   mcush.session_test.py <port1> <port2> [count]
+import sys
+import time
+import threading
+from mcush import *
+
+
+def run( s, tag, count, result ):
+    n = 0
+    t0 = time.time()
+    for i in range(count):
+        cmd = 'echo %s_%d'% (tag, i)
+        ret = s.writeCommand( cmd )
+        assert ret == ['%s_%d'% (tag, i)], ret
+        n += len(cmd) + len(ret[0]) + 4
+    result[tag] = (time.time() - t0, n)
+
+
+def main(argv=None):
+    try:
+        ports = argv[1:3]
+        assert len(ports) == 2
+    except:
+        ports = Env.PORTS_LIST[:2]
+    try:
+        count = int(argv[3])
+    except:
+        count = 1000
+    s1 = Mcush.Mcush( ports[0] )
+    s2 = Mcush.Mcush( ports[1] )
+
+    # one session alone
+    result = {}
+    run( s1, 'A', count, result )
+    dt, n = result['A']
+    single = count / dt
+    print( 'one session:  %d commands, %.1f cmd/s, %.1f KB/s'% (count, single, n/dt/1000) )
+
+    # both at once
+    result = {}
+    threads = [ threading.Thread( target=run, args=(s, tag, count, result) ) \
+                for s, tag in [(s1, 'A'), (s2, 'B')] ]
+    t0 = time.time()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    dt = time.time() - t0
+    assert sorted(result.keys()) == ['A', 'B'], result
+    n = result['A'][1] + result['B'][1]
+    print( 'two sessions: %d commands, %.1f cmd/s, %.1f KB/s (x%.2f)'% \
+           (2*count, 2*count/dt, n/dt/1000, 2*count/dt/single) )
+    for tag in ['A', 'B']:
+        print( '  session %s: %.1f cmd/s'% (tag, count/result[tag][0]) )
+
+    # line input of one session is not disturbed by commands of the other
+    s1.setPrompts( s1.DEFAULT_PROMPTS_MULTILINE )
+    s1.writeCommand( 'mkbuf' )
+    s1.writeCommand( '1 2 3' )
+    assert s2.writeCommand( 'echo B' ) == ['B']
+    s1.writeCommand( '4' )
+    s1.setPrompts()
+    r = Utils.parseKeyValueLines( s1.writeCommand( '' ) )
+    assert int(r['length']) == 4, r
+    print( 'session test passed' )
+    s1.disconnect()
+    s2.disconnect()
+
+
+if __name__ == '__main__':
+    main(sys.argv)
@@ -8,6 +8,7 @@ import sys
 import time
 import base64
 import binascii
+from struct import unpack
 import logging
 from . import Env
 from . import Utils
@@ -491,6 +492,164 @@ class Mcush( Instrument.SerialInstrument ):
             sent += len(d) 
             if segment_done_callback:
                 segment_done_callback(1+i, dat_segments, sent, dat_size)
+
+    # windowed binary transfer, see mcush_xfer.h
+    XFER_SOF = 0x02
+    XFER_START = 1
+    XFER_DATA = 2
+    XFER_ACK = 3
+    XFER_NAK = 4
+    XFER_END = 5
+    XFER_ABORT = 6
+    XFER_ERR_USER = 1
+    XFER_ERR_CRC = 4
+    XFER_RETRY = 10
+
+    def xferWrite( self, typ, seq, payload=b'' ):
+        body = bytearray([typ]) + bytearray(Utils.H2s(seq & 0xFFFF)) + \
+               bytearray(Utils.H2s(len(payload))) + bytearray(payload)
+        crc = Utils.crc( bytes(body) )
+        self.port.write( bytes(bytearray([self.XFER_SOF]) + body + bytearray(Utils.I2s(crc))) )
+        self.port.flush()
+
+    def xferRead( self, size=0x1000 ):
+        '''return (type, seq, payload), None for timeout, type 0 for corrupted one'''
+        while True:
+            c = self.port.read(1)
+            if not c:
+                return None
+            if bytearray(c)[0] == self.XFER_SOF:
+                break
+        head = self.port.read(5)
+        if len(head) != 5:
+            return (0, 0, b'')
+        length = Utils.s2H(head[3:5])
+        if length > size:
+            return (0, 0, b'')
+        body = self.port.read(length+4)
+        if len(body) != length+4:
+            return (0, 0, b'')
+        if Utils.crc( bytes(head) + bytes(body[:length]) ) != Utils.s2I(body[length:]):
+            return (0, 0, b'')
+        return bytearray(head)[0], Utils.s2H(head[1:3]), body[:length]
+
+    def xferStart( self, cmd ):
+        self.writeLine( cmd )
+        for i in range(self.XFER_RETRY):
+            pkt = self.xferRead()
+            if pkt is None:
+                break
+            if pkt[0] == self.XFER_START:
+                return unpack( '<IIIHB', pkt[2][:15] )
+            if pkt[0] == self.XFER_ABORT:
+                break
+        self.xferFinish( cmd )
+        raise Instrument.CommandExecuteError( cmd + ', no start' )
+
+    def xferAbort( self, cmd, code ):
+        self.xferWrite( self.XFER_ABORT, 0, bytearray([code]) )
+        self.xferFinish( cmd )
+        raise Instrument.CommandExecuteError( cmd + ', aborted %d'% code )
+
+    def xferFinish( self, cmd ):
+        ret = [cmd] + self.readUntilPrompts()
+        self.checkReturnedPrompt( ret )
+        return ret[1:-1]
+
+    def xferPut( self, pathname, local_pathname, resume=False, segment_done_callback=None ):
+        '''write local file with xfer command, resume continues from what the
+           device has saved if it matches the local file'''
+        dat = open(local_pathname, 'rb').read()
+        cmd = 'xfer -p %s%s'% ('-r ' if resume else '', self.convPathname(pathname))
+        offset, size, crc, block, window = self.xferStart( cmd )
+        if offset > len(dat) or Utils.crc(dat[:offset]) != crc:
+            self.xferAbort( cmd, self.XFER_ERR_CRC )
+        blocks = (len(dat) - offset + block - 1) // block
+        base, nxt, retry = 0, 0, 0
+        while base < blocks:
+            while nxt < blocks and nxt - base < window:
+                p = offset + nxt * block
+                self.xferWrite( self.XFER_DATA, nxt, dat[p:p+block] )
+                nxt += 1
+            pkt = self.xferRead( 15 )
+            if pkt is None:
+                retry += 1
+                if retry > self.XFER_RETRY:
+                    self.xferAbort( cmd, self.XFER_ERR_USER )
+                nxt = base  # go back
+                continue
+            typ, seq = pkt[0], pkt[1]
+            if typ == self.XFER_ABORT:
+                self.xferFinish( cmd )
+                raise Instrument.CommandExecuteError( cmd + ', aborted by device' )
+            if typ not in [self.XFER_ACK, self.XFER_NAK]:
+                continue
+            ack = base + ((seq - base) & 0xFFFF)
+            if ack > nxt:
+                continue
+            if ack > base:
+                base, retry = ack, 0
+                if segment_done_callback:
+                    sent = min(base*block, len(dat)-offset)
+                    segment_done_callback(base, blocks, sent, len(dat)-offset)
+            if typ == self.XFER_NAK:
+                nxt = base
+        end = bytearray(Utils.I2s(len(dat))) + bytearray(Utils.I2s(Utils.crc(dat)))
+        for i in range(self.XFER_RETRY):
+            self.xferWrite( self.XFER_END, nxt, end )
+            pkt = self.xferRead( 15 )
+            if pkt and pkt[0] in [self.XFER_ACK, self.XFER_ABORT]:
+                break
+        return self.xferFinish( cmd )
+
+    def xferGet( self, pathname, local_pathname, resume=False ):
+        '''read remote file with xfer command, resume continues after the
+           local file if it matches the device one'''
+        old = b''
+        if resume and os.path.isfile(local_pathname):
+            old = open(local_pathname, 'rb').read()
+        cmd = 'xfer -g -o %d %s'% (len(old), self.convPathname(pathname))
+        offset, size, crc, block, window = self.xferStart( cmd )
+        if offset != len(old) or Utils.crc(old) != crc:
+            self.xferAbort( cmd, self.XFER_ERR_CRC )
+        dat, expected, nak, retry = [old], 0, False, 0
+        while True:
+            pkt = self.xferRead( block )
+            if pkt is None:
+                retry += 1
+                if retry > self.XFER_RETRY:
+                    self.xferAbort( cmd, self.XFER_ERR_USER )
+                self.xferWrite( self.XFER_NAK, expected )
+                continue
+            typ, seq, payload = pkt
+            if typ == 0:
+                if not nak:
+                    self.xferWrite( self.XFER_NAK, expected )
+                    nak = True
+            elif typ == self.XFER_DATA:
+                retry = 0
+                if seq == expected & 0xFFFF:
+                    dat.append( bytes(payload) )
+                    expected += 1
+                    nak = False
+                    self.xferWrite( self.XFER_ACK, expected )
+                elif ((expected - seq) & 0xFFFF) <= window:
+                    self.xferWrite( self.XFER_ACK, expected )
+                elif not nak:
+                    self.xferWrite( self.XFER_NAK, expected )
+                    nak = True
+            elif typ == self.XFER_END:
+                dat = b''.join(dat)
+                total, crc = unpack( '<II', payload[:8] )
+                if total != len(dat) or crc != Utils.crc(dat):
+                    self.xferAbort( cmd, self.XFER_ERR_CRC )
+                self.xferWrite( self.XFER_ACK, expected )
+                break
+            elif typ == self.XFER_ABORT:
+                self.xferFinish( cmd )
+                raise Instrument.CommandExecuteError( cmd + ', aborted by device' )
+        open( local_pathname, 'wb+' ).write(dat)
+        return self.xferFinish( cmd )
  
     def spiffs( self, command, value=None, addr=None, compact_mode=None ):
         cmd = 'spiffs -c %s'% command
@@ -890,6 +1049,98 @@ class Mcush( Instrument.SerialInstrument ):
         command = 'crc %s'% pathname 
         ret = self.writeCommand( command )
         return int(ret[0], 16)
+
+    # binary frame mode, see shell_frame_mode() in shell_core.c
+    FRAME_SOF = 0x02
+    FRAME_STATUS_OK = 0
+    FRAME_STATUS_CRC_ERR = 1
+    FRAME_STATUS_LENGTH_ERR = 2
+    FRAME_STATUS_COMMAND_ERR = 3
+    FRAME_STATUS_TRUNCATED = 4
+    FRAME_STATUS_SKIPPED = 5
+
+    def frameWrite( self, argv ):
+        payload = bytearray()
+        for a in argv:
+            if not isinstance(a, bytes):
+                a = a.encode('utf8')
+            payload += bytearray(a) + bytearray([0])
+        head = bytearray(Utils.H2s(len(payload)))
+        crc = Utils.crc16_modbus( head + payload )
+        self.port.write( bytes(bytearray([self.FRAME_SOF]) + head + payload + bytearray(Utils.H2s(crc))) )
+        self.port.flush()
+
+    def frameRead( self ):
+        while True:
+            c = self.port.read(1)
+            if not c:
+                raise Instrument.CommandTimeoutError( 'No response' )
+            if bytearray(c)[0] == self.FRAME_SOF:
+                break
+        head = self.port.read(2)
+        length = Utils.s2H(head)
+        body = self.port.read(length+2)
+        if len(body) != length+2:
+            raise Instrument.CommandTimeoutError( 'Frame incomplete' )
+        if Utils.crc16_modbus(head + body[:length]) != Utils.s2H(body[length:]):
+            raise Instrument.ResponseError( 'Frame crc error' )
+        status, ret = bytearray(body)[0], Utils.s2i(body[1:5])
+        return status, ret, body[5:length]
+
+    def frameEnter( self ):
+        '''enter binary frame mode'''
+        self.writeLine( 'frame' )
+        self.frameRead()  # ready frame
+
+    def frameExit( self ):
+        '''quit binary frame mode'''
+        self.frameWrite( [] )
+        self.frameRead()
+        self.readUntilPrompts()
+
+    def frameCommand( self, cmd ):
+        '''write command in frame mode and return output lines'''
+        if isinstance(cmd, (list, tuple)):
+            argv = cmd
+        else:
+            argv = cmd.split()
+        self.frameWrite( argv )
+        status, ret, output = self.frameRead()
+        return self.frameCheckResult( argv, status, ret, output )
+
+    def frameCheckResult( self, argv, status, ret, output ):
+        if Env.PYTHON_V3:
+            output = output.decode('utf8', 'ignore')
+        lines = [l.rstrip() for l in output.splitlines()]
+        if status == self.FRAME_STATUS_COMMAND_ERR or ret < 0:
+            raise Instrument.CommandSyntaxError( ' '.join(argv) + ', returns: ' + ','.join(lines) )
+        elif status not in [self.FRAME_STATUS_OK, self.FRAME_STATUS_TRUNCATED] or ret > 0:
+            raise Instrument.CommandExecuteError( ' '.join(argv) + ', returns: ' + ','.join(lines) )
+        return lines
+
+    def frameBatch( self, cmds ):
+        '''write commands chained with ';' in one frame, 
+           return list of output lines for each command'''
+        argvs = []
+        for cmd in cmds:
+            if isinstance(cmd, (list, tuple)):
+                argvs.append( list(cmd) )
+            else:
+                argvs.append( cmd.split() )
+        chained = []
+        for argv in argvs:
+            if chained:
+                chained.append( ';' )
+            chained += argv
+        self.frameWrite( chained )
+        responses = []
+        for argv in argvs:
+            status, ret, output = self.frameRead()
+            if status in [self.FRAME_STATUS_CRC_ERR, self.FRAME_STATUS_LENGTH_ERR]:
+                raise Instrument.ResponseError( 'Frame rejected, status %d'% status )
+            responses.append( (status, ret, output) )
+        return [self.frameCheckResult( argv, status, ret, output ) 
+                for argv, (status, ret, output) in zip(argvs, responses)]
         
  
     def luaReset( self ):
@@ -280,6 +280,17 @@ def crc( data, oldcrc=0 ):
     v = crc32( data, oldcrc )
     return v & 0xFFFFFFFF
 
+def crc16_modbus( data, oldcrc=0xFFFF ):
+    v = oldcrc
+    for c in bytearray(data):
+        v ^= c
+        for i in range(8):
+            if v & 1:
+                v = (v >> 1) ^ 0xA001
+            else:
+                v >>= 1
+    return v
+
 
 class colored_string():
     COLOR = {
@@ -14,6 +14,23 @@ OUTPUT_C_HEAD = '../mcush/mcush_lib_crc.h'
 
 COMMON_C_SRC = '''\
 #include <stdint.h>
+#include <string.h>
+#include "mcush_lib_crc.h"
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    #define _CRC_LOAD32(p)  ((uint32_t)(p)[0] | ((uint32_t)(p)[1] << 8) | \\
+                             ((uint32_t)(p)[2] << 16) | ((uint32_t)(p)[3] << 24))
+#else
+    /* copied, not read through a uint32_t pointer (strict aliasing),
+       one word load as data is aligned by caller */
+    static inline uint32_t _crc_load32( const uint8_t *p )
+    {
+        uint32_t w;
+        memcpy( &w, p, 4 );
+        return w;
+    }
+    #define _CRC_LOAD32(p)  _crc_load32(p)
+#endif
 
 uint8_t _crc8( const uint8_t *data, int len, uint8_t crc, const uint8_t *table )
 {
@@ -37,26 +54,131 @@ uint16_t _crc16( const uint8_t *data, int len, uint16_t crc, const uint16_t *tab
     return crc;
 }
 
-uint32_t _crc32( const uint8_t *data, int len, uint32_t crc, const uint32_t *table )
+uint32_t _crc32_update( const uint8_t *data, int len, uint32_t crc, const uint32_t *table )
 {
-    crc = crc ^ 0xFFFFFFFFu;
     while (len > 0)
     {
         crc = table[*data ^ (uint8_t)crc] ^ (crc >> 8);
         data++;
         len--;
     }
-    crc = crc ^ 0xFFFFFFFFU;
     return crc;
 }
+
+uint32_t _crc32( const uint8_t *data, int len, uint32_t crc, const uint32_t *table )
+{
+    return _crc32_update( data, len, crc ^ 0xFFFFFFFFu, table ) ^ 0xFFFFFFFFu;
+}
+
+/* slicing-by-4/8, table[n] is the crc of one byte followed by n zero bytes,
+   so 4 (or 8) lookups consume one aligned word (two words) per loop */
+uint16_t _crc16_slicing( const uint8_t *data, int len, uint16_t crc, const uint16_t (*table)[256] )
+{
+#if CRC_SLICING > 1
+    uint32_t w;
+
+    while( (len > 0) && ((uintptr_t)data & 3) )
+    {
+        crc = table[0][*data++ ^ (uint8_t)crc] ^ (crc >> 8);
+        len--;
+    }
+#if CRC_SLICING > 4
+    while( len >= 8 )
+    {
+        w = crc ^ _CRC_LOAD32(data);
+        crc = table[7][w & 0xFF] ^ table[6][(w >> 8) & 0xFF] ^
+              table[5][(w >> 16) & 0xFF] ^ table[4][w >> 24];
+        w = _CRC_LOAD32(data + 4);
+        crc ^= table[3][w & 0xFF] ^ table[2][(w >> 8) & 0xFF] ^
+               table[1][(w >> 16) & 0xFF] ^ table[0][w >> 24];
+        data += 8;
+        len -= 8;
+    }
+#endif
+    while( len >= 4 )
+    {
+        w = crc ^ _CRC_LOAD32(data);
+        crc = table[3][w & 0xFF] ^ table[2][(w >> 8) & 0xFF] ^
+              table[1][(w >> 16) & 0xFF] ^ table[0][w >> 24];
+        data += 4;
+        len -= 4;
+    }
+#endif
+    return _crc16( data, len, crc, table[0] );
+}
+
+uint32_t _crc32_slicing( const uint8_t *data, int len, uint32_t crc, const uint32_t (*table)[256] )
+{
+#if CRC_SLICING > 1
+    uint32_t w;
+
+    while( (len > 0) && ((uintptr_t)data & 3) )
+    {
+        crc = table[0][*data++ ^ (uint8_t)crc] ^ (crc >> 8);
+        len--;
+    }
+#if CRC_SLICING > 4
+    while( len >= 8 )
+    {
+        w = crc ^ _CRC_LOAD32(data);
+        crc = table[7][w & 0xFF] ^ table[6][(w >> 8) & 0xFF] ^
+              table[5][(w >> 16) & 0xFF] ^ table[4][w >> 24];
+        w = _CRC_LOAD32(data + 4);
+        crc ^= table[3][w & 0xFF] ^ table[2][(w >> 8) & 0xFF] ^
+               table[1][(w >> 16) & 0xFF] ^ table[0][w >> 24];
+        data += 8;
+        len -= 8;
+    }
+#endif
+    while( len >= 4 )
+    {
+        w = crc ^ _CRC_LOAD32(data);
+        crc = table[3][w & 0xFF] ^ table[2][(w >> 8) & 0xFF] ^
+              table[1][(w >> 16) & 0xFF] ^ table[0][w >> 24];
+        data += 4;
+        len -= 4;
+    }
+#endif
+    return _crc32_update( data, len, crc, table[0] );
+}
 '''
 
 COMMON_C_HEAD = '''\
 #include <stdint.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* lookup tables per byte for the sliced crcs, 1 (bytewise), 4 or 8,
+   costs (CRC_SLICING-1)*256 more entries each (crc16_modbus and crc32),
+   define it for the whole build as the tables are shared */
+#ifndef CRC_SLICING
+    #define CRC_SLICING  1
+#endif
+
+#if (CRC_SLICING != 1) && (CRC_SLICING != 4) && (CRC_SLICING != 8)
+    #error "CRC_SLICING must be 1, 4 or 8"
+#endif
+
 uint8_t _crc8(const uint8_t *data, int len, uint8_t crc, const uint8_t *table);
 uint16_t _crc16(const uint8_t *data, int len, uint16_t crc, const uint16_t *table);
 uint32_t _crc32(const uint8_t *data, int len, uint32_t crc, const uint32_t *table);
+uint32_t _crc32_update(const uint8_t *data, int len, uint32_t crc, const uint32_t *table);
+uint16_t _crc16_slicing(const uint8_t *data, int len, uint16_t crc, const uint16_t (*table)[256]);
+uint32_t _crc32_slicing(const uint8_t *data, int len, uint32_t crc, const uint32_t (*table)[256]);
+
+/* streaming api, for each crc type:
+       crcX( buf, len ) == crcX_final( crcX_update( crcX_init(), buf, len ) )
+   crcX_update is weak, hal may override it with the hardware crc unit,
+   the value passed between calls is the raw crc register */
+'''
+
+COMMON_H_TAIL = '''
+#ifdef __cplusplus
+}
+#endif
+
 '''
 
 
@@ -81,20 +203,33 @@ H.writeLine( COMMON_C_HEAD )
 INT_CTYPE = ['uint8_t', 'uint16_t', 'uint32_t', 'uint32_t']
 INT_WIDTH = [8, 16, 32, 32]
 INT_FORMAT = ['0x%02Xu', '0x%04Xu', '0x%08Xu', '0x%08Xu']
+INT_MASK = [0xFF, 0xFFFF, 0xFFFFFFFF, 0xFFFFFFFF]
 
 CRC_DEF = [
-# mod_name, export_name
-('crc-8',  'crc8'),
-('crc-16', 'crc16'),
-('xmodem', 'crc16_xmodem'),
-('modbus', 'crc16_modbus'),
-('kermit', 'crc16_kermit'),
-('crc-24', 'crc24'),
-('crc-32', 'crc32'),
+# mod_name, export_name, slicing
+('crc-8',  'crc8',         False),
+('crc-16', 'crc16',        False),
+('xmodem', 'crc16_xmodem', False),
+('modbus', 'crc16_modbus', True),
+('kermit', 'crc16_kermit', False),
+('crc-24', 'crc24',        False),
+('crc-32', 'crc32',        True),
 ]
 
 
-for crc_type, export_name in CRC_DEF:
+def writeTable( table, crc_format, indent='    ' ):
+    line = ''
+    for i in table:
+        s = (crc_format% i) + ','
+        if len(line) + len(s) + len(indent) + 4 > 79:
+            C.writeLine( indent+line )
+            line = s
+        else:
+            line += s
+    C.writeLine( indent+line )
+
+
+for crc_type, export_name, slicing in CRC_DEF:
     print crc_type
     c = crcmod.predefined.PredefinedCrc(crc_type)
     #crc_name = crc_type.lower().replace('-','_')
@@ -106,25 +241,60 @@ for crc_type, export_name in CRC_DEF:
     crc_poly = c.poly
     crc_reverse = c.reverse
     crc_table_name = export_name + '_table'
+    # _crc32 runs with inverted register, streaming api exposes the raw one
+    crc_xor = INT_MASK[c.digest_size-1] if crc_width == 32 else 0
     func_declare = '%s %s( uint8_t *buf, int len )'% (crc_ctype, crc_name)
+    init_declare = '%s %s_init( void )'% (crc_ctype, crc_name)
+    update_declare = '%s %s_update( %s crc, const uint8_t *buf, int len )'% (crc_ctype, crc_name, crc_ctype)
+    final_declare = '%s %s_final( %s crc )'% (crc_ctype, crc_name, crc_ctype)
     C.writeLine( '\n// poly=0x%X, init=0x%X, reverse=%d'% (crc_poly, crc_init, int(crc_reverse)) )
-    C.writeLine( 'const %s %s[256] = {'% (crc_ctype, crc_table_name) )
-    line = ''
-    for i in c.table:
-        s = (crc_format% i) + ','
-        if len(line) + len(s) + 8 > 79:
-            C.writeLine( '    '+line )
-            line = s
-        else:
-            line += s
-    C.writeLine( '    '+line+'};\n' )
-    C.writeLine( '%s\n{'% func_declare ); 
-    C.writeLine( '    return _crc%d( buf, len, 0x%X, %s );'% (crc_width, crc_init, crc_table_name) )
-    C.writeLine( '}\n' ); 
-    H.writeLine( 'const %s %s[256];'% (crc_ctype, crc_table_name) )
-    H.writeLine( '%s;'% func_declare ); 
+    if slicing:
+        # table[n][i] = table[n-1][i] followed by one more zero byte
+        tables = [list(c.table)]
+        for n in range(1, 8):
+            tables.append( [(t >> 8) ^ c.table[t & 0xFF] for t in tables[n-1]] )
+        C.writeLine( 'const %s %ss[CRC_SLICING][256] = {'% (crc_ctype, crc_table_name) )
+        for n in range(8):
+            if n == 1:
+                C.writeLine( '#if CRC_SLICING > 1' )
+            elif n == 4:
+                C.writeLine( '#endif' )
+                C.writeLine( '#if CRC_SLICING > 4' )
+            C.writeLine( '    {' )
+            writeTable( tables[n], crc_format, '        ' )
+            C.writeLine( '    },' )
+        C.writeLine( '#endif' )
+        C.writeLine( '};\n' )
+        crc_update = '_crc%d_slicing( buf, len, crc, %ss )'% (crc_width, crc_table_name)
+        H.writeLine( 'extern const %s %ss[CRC_SLICING][256];'% (crc_ctype, crc_table_name) )
+        H.writeLine( '#define %s  (%ss[0])'% (crc_table_name, crc_table_name) )
+    else:
+        C.writeLine( 'const %s %s[256] = {'% (crc_ctype, crc_table_name) )
+        writeTable( c.table, crc_format )
+        C.writeLine( '};\n' )
+        crc_update = '_crc%d%s( buf, len, crc, %s )'% (crc_width, '_update' if crc_width == 32 else '', crc_table_name)
+        H.writeLine( 'extern const %s %s[256];'% (crc_ctype, crc_table_name) )
+    C.writeLine( '%s\n{'% init_declare )
+    C.writeLine( '    return 0x%Xu;'% (crc_init ^ crc_xor) )
+    C.writeLine( '}\n' )
+    C.writeLine( '__attribute__((weak)) %s\n{'% update_declare )
+    C.writeLine( '    return %s;'% crc_update )
+    C.writeLine( '}\n' )
+    C.writeLine( '%s\n{'% final_declare )
+    if crc_xor:
+        C.writeLine( '    return crc ^ 0x%Xu;'% crc_xor )
+    else:
+        C.writeLine( '    return crc;' )
+    C.writeLine( '}\n' )
+    C.writeLine( '%s\n{'% func_declare )
+    C.writeLine( '    return %s_final( %s_update( %s_init(), buf, len ) );'% (crc_name, crc_name, crc_name) )
+    C.writeLine( '}\n' )
+    H.writeLine( '%s;'% func_declare )
+    H.writeLine( '%s;'% init_declare )
+    H.writeLine( '%s;'% update_declare )
+    H.writeLine( '%s;'% final_declare )
 
 C.writeLine()
-H.writeLine()
+H.writeLine( COMMON_H_TAIL )
 C.close()
 H.close()